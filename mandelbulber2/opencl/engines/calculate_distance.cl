@@ -119,7 +119,7 @@ formulaOut CalculateDistance(__constant sClInConstants *consts, float3 point,
 
 #ifdef ANALYTIC_DE
 #ifdef BOOLEAN_OPERATORS
-	if (consts->sequence.DEType[forcedFormulaIndexForSequence] == analyticDEType)
+	if (FRACTAL_SEQUENCE(consts).DEType[forcedFormulaIndexForSequence] == analyticDEType)
 #endif
 	{
 		out = Fractal(consts, point, calcParam, calcModeNormal, NULL, forcedFormulaIndex);
@@ -171,7 +171,7 @@ formulaOut CalculateDistance(__constant sClInConstants *consts, float3 point,
 
 #ifdef DELTA_DE
 #ifdef BOOLEAN_OPERATORS
-	if (consts->sequence.DEType[forcedFormulaIndexForSequence] == deltaDEType)
+	if (FRACTAL_SEQUENCE(consts).DEType[forcedFormulaIndexForSequence] == deltaDEType)
 #endif
 	{
 
@@ -388,7 +388,7 @@ formulaOut CalculateDistance(__constant sClInConstants *consts, float3 point,
 
 	for (int i = 0; i < NUMBER_OF_FRACTALS - 1; i++)
 	{
-		if (consts->fractal[i + 1].formula != 0) // != fractal::none
+		if (FRACTAL_PARAMS(consts)[i + 1].formula != 0) // != fractal::none
 		{
 			float3 pointTemp = point - consts->params.formulaPosition[i + 1];
 			pointTemp = Matrix33MulFloat3(consts->params.mRotFormulaRotation[i + 1], pointTemp);
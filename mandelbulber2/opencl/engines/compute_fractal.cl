@@ -66,6 +66,16 @@
 #define FORMULA_ITER_9 DummyIteration
 #endif /*FORMULA_ITER_9*/
 
+// In specialized kernel parameters of formulas and hybrid sequence are compile-time constants
+// (generated by cOpenClEngineRenderFractal::CreateSpecializedFractalData())
+#ifdef SPECIALIZED_FRACTAL
+#define FRACTAL_PARAMS(consts) (specializedFractals.fractal)
+#define FRACTAL_SEQUENCE(consts) (specializedSequence.sequence)
+#else
+#define FRACTAL_PARAMS(consts) ((consts)->fractal)
+#define FRACTAL_SEQUENCE(consts) ((consts)->sequence)
+#endif
+
 typedef struct
 {
 	float4 z;
@@ -118,11 +128,11 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 
 #ifdef BOOLEAN_OPERATORS
 	if (forcedFormulaIndex >= 0)
-		z.w = consts->sequence.initialWAxis[forcedFormulaIndex];
+		z.w = FRACTAL_SEQUENCE(consts).initialWAxis[forcedFormulaIndex];
 	else
-		z.w = consts->sequence.initialWAxis[0];
+		z.w = FRACTAL_SEQUENCE(consts).initialWAxis[0];
 #else
-	z.w = consts->sequence.initialWAxis[0];
+	z.w = FRACTAL_SEQUENCE(consts).initialWAxis[0];
 #endif
 
 	float initialWAxisColor = z.w;
@@ -153,7 +163,7 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 	aux.DE0 = 0.0;
 	aux.dist = 1000.0f;
 	aux.pseudoKleinianDE = 1.0f;
-	aux.actualScale = consts->fractal[fractalIndex].mandelbox.scale;
+	aux.actualScale = FRACTAL_PARAMS(consts)[fractalIndex].mandelbox.scale;
 	aux.actualScaleA = 0.0f;
 	aux.color = 1.0f;
 	aux.colorHybrid = 0.0f;
@@ -162,7 +172,7 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 	int sequence = 0;
 	__constant sFractalCl *fractal;
 
-	__constant sFractalCl *defaultFractal = &consts->fractal[fractalIndex];
+	__constant sFractalCl *defaultFractal = &FRACTAL_PARAMS(consts)[fractalIndex];
 
 	__global sFractalColoringCl *fractalColoring = (material) ? &material->fractalColoring : NULL;
 
@@ -176,12 +186,12 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 		if (forcedFormulaIndex >= 0)
 			sequence = forcedFormulaIndex;
 		else
-			sequence = consts->sequence.hybridSequence[min(i, 249)];
+			sequence = FRACTAL_SEQUENCE(consts).hybridSequence[min(i, 249)];
 #else
 		sequence = 0;
 #endif
 
-		fractal = &consts->fractal[sequence];
+		fractal = &FRACTAL_PARAMS(consts)[sequence];
 
 		aux.i = i;
 
@@ -204,7 +214,7 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 		float tempAuxColor = aux.color;
 
 #ifdef ITERATION_WEIGHT
-		if (consts->sequence.formulaWeight[sequence] > 0)
+		if (FRACTAL_SEQUENCE(consts).formulaWeight[sequence] > 0)
 		{
 #endif
 
@@ -231,7 +241,7 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 
 		if (aux.r < 0.0f) // if was run DummyIteration
 		{
-			float high = consts->sequence.bailout[sequence] * 10.0f;
+			float high = FRACTAL_SEQUENCE(consts).bailout[sequence] * 10.0f;
 			z = high;
 			aux.r = length(z);
 			out.distance = 10.0f;
@@ -241,46 +251,46 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 			return out;
 		}
 
-		if (consts->sequence.addCConstant[sequence])
+		if (FRACTAL_SEQUENCE(consts).addCConstant[sequence])
 		{
 			switch (fractal->formula)
 			{
 				case 64: // aboxMod1
 				case 73: // amazingSurf
 				{
-					if (consts->sequence.juliaEnabled[sequence])
+					if (FRACTAL_SEQUENCE(consts).juliaEnabled[sequence])
 					{
-						float4 juliaC = consts->sequence.juliaConstant[sequence]
-														* consts->sequence.constantMultiplier[sequence];
+						float4 juliaC = FRACTAL_SEQUENCE(consts).juliaConstant[sequence]
+														* FRACTAL_SEQUENCE(consts).constantMultiplier[sequence];
 						z += (float4){juliaC.y, juliaC.x, juliaC.z, juliaC.w};
 					}
 					else
 					{
 						z += (float4){aux.const_c.y, aux.const_c.x, aux.const_c.z, aux.const_c.w}
-								 * consts->sequence.constantMultiplier[sequence];
+								 * FRACTAL_SEQUENCE(consts).constantMultiplier[sequence];
 					}
 					break;
 				}
 
 				default:
 				{
-					if (consts->sequence.juliaEnabled[sequence])
+					if (FRACTAL_SEQUENCE(consts).juliaEnabled[sequence])
 					{
-						z += consts->sequence.juliaConstant[sequence]
-								 * consts->sequence.constantMultiplier[sequence];
+						z += FRACTAL_SEQUENCE(consts).juliaConstant[sequence]
+								 * FRACTAL_SEQUENCE(consts).constantMultiplier[sequence];
 					}
 					else
 					{
-						z += aux.const_c * consts->sequence.constantMultiplier[sequence];
+						z += aux.const_c * FRACTAL_SEQUENCE(consts).constantMultiplier[sequence];
 					}
 				}
 			}
 		}
 
 #ifdef ITERATION_WEIGHT
-		if (consts->sequence.isHybrid)
+		if (FRACTAL_SEQUENCE(consts).isHybrid)
 		{
-			float k = consts->sequence.formulaWeight[sequence];
+			float k = FRACTAL_SEQUENCE(consts).formulaWeight[sequence];
 			if (k < 1.0f)
 			{
 				z = SmoothCVector(tempZ, z, k);
@@ -296,26 +306,26 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 		aux.r = length(z);
 
 		// escape conditions
-		if (consts->sequence.checkForBailout[sequence])
+		if (FRACTAL_SEQUENCE(consts).checkForBailout[sequence])
 		{
 			// mode normal or deltaDE center point
 			if (mode == calcModeNormal || mode == calcModeDeltaDE1)
 			{
-				if (aux.r > consts->sequence.bailout[sequence])
+				if (aux.r > FRACTAL_SEQUENCE(consts).bailout[sequence])
 				{
 					out.maxiter = false;
 					break;
 				}
 
-				if (consts->sequence.useAdditionalBailoutCond[sequence])
+				if (FRACTAL_SEQUENCE(consts).useAdditionalBailoutCond[sequence])
 				{
-					if (length(z - lastZ) / aux.r < 0.1f / consts->sequence.bailout[sequence])
+					if (length(z - lastZ) / aux.r < 0.1f / FRACTAL_SEQUENCE(consts).bailout[sequence])
 					{
 						out.maxiter = false;
 						break;
 					}
 
-					if (length(z - lastLastZ) / aux.r < 0.1f / consts->sequence.bailout[sequence])
+					if (length(z - lastLastZ) / aux.r < 0.1f / FRACTAL_SEQUENCE(consts).bailout[sequence])
 					{
 						out.maxiter = false;
 						break;
@@ -375,8 +385,8 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 					if (fractal->formula != 8)
 					{
 						if (len < colorMin) colorMin = len;
-						if (aux.r > consts->sequence.bailout[sequence]) break;
-						if (consts->sequence.useAdditionalBailoutCond[sequence]
+						if (aux.r > FRACTAL_SEQUENCE(consts).bailout[sequence]) break;
+						if (FRACTAL_SEQUENCE(consts).useAdditionalBailoutCond[sequence]
 								&& length(z - lastZ) / aux.r < 1e-15f)
 							break;
 					}
@@ -389,7 +399,7 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 						else
 						{
 							if (len < colorMin) colorMin = len; // colorMin for hybrid mode ??
-							if (aux.r > consts->sequence.bailout[sequence] || length(z - lastZ) / aux.r < 1e-15f)
+							if (aux.r > FRACTAL_SEQUENCE(consts).bailout[sequence] || length(z - lastZ) / aux.r < 1e-15f)
 								break;
 						}
 					}
@@ -417,7 +427,7 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 				if (i >= consts->params.common.fakeLightsMinIter
 						&& i <= consts->params.common.fakeLightsMaxIter)
 					orbitTrapTotal += (1.0f / (distance * distance));
-				if (distance > consts->sequence.bailout[sequence])
+				if (distance > FRACTAL_SEQUENCE(consts).bailout[sequence])
 				{
 					out.orbitTrapR = orbitTrapTotal;
 					break;
@@ -466,10 +476,10 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 	float rxy = length(z.xy);
 	dist = max(rxy - aux.pseudoKleinianDE, fabs(rxy * z.z) / aux.r) / fabs(aux.DE);
 #elif ANALYTIC_JOS_KLEINIAN_DE
-	if (consts->fractal[0].transformCommon.spheresEnabled)
-		z.y = min(z.y, consts->fractal[0].transformCommon.foldingValue - z.y);
-	dist = min(z.y, consts->fractal[0].analyticDE.tweak005)
-				 / max(fabs(aux.DE), consts->fractal[0].analyticDE.offset1);
+	if (FRACTAL_PARAMS(consts)[0].transformCommon.spheresEnabled)
+		z.y = min(z.y, FRACTAL_PARAMS(consts)[0].transformCommon.foldingValue - z.y);
+	dist = min(z.y, FRACTAL_PARAMS(consts)[0].analyticDE.tweak005)
+				 / max(fabs(aux.DE), FRACTAL_PARAMS(consts)[0].analyticDE.offset1);
 #elif ANALYTIC_CUSTOM_DE
 	dist = aux.dist;
 #elif ANALYTIC_MAXAXIS_DE
@@ -483,7 +493,7 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 #else //  IS_NOT HYBRID
 	if (aux.DE > 0.0)
 	{
-		switch (consts->sequence.DEAnalyticFunction[sequence])
+		switch (FRACTAL_SEQUENCE(consts).DEAnalyticFunction[sequence])
 		{
 			case clAnalyticFunctionLogarithmic:
 			{
@@ -540,16 +550,16 @@ formulaOut Fractal(__constant sClInConstants *consts, float3 point, sClCalcParam
 #ifdef USE_FRACTAL_COLORING
 	if (mode == calcModeColouring)
 	{
-		enumColoringFunctionCl coloringFunction = consts->sequence.coloringFunction[sequence];
-		out.colorIndex = CalculateColorIndex(consts->sequence.isHybrid, aux.r, z, colorMin, &aux,
+		enumColoringFunctionCl coloringFunction = FRACTAL_SEQUENCE(consts).coloringFunction[sequence];
+		out.colorIndex = CalculateColorIndex(FRACTAL_SEQUENCE(consts).isHybrid, aux.r, z, colorMin, &aux,
 			fractalColoring, coloringFunction, defaultFractal);
 	}
 #endif
 
 #ifdef DELTA_JOS_KLEINIAN_DE
 	// needed for JosKleinian fractal to calculate spheres in deltaDE mode
-	if (consts->fractal[sequence].transformCommon.spheresEnabled)
-		z.y = min(z.y, consts->fractal[sequence].transformCommon.foldingValue - z.y);
+	if (FRACTAL_PARAMS(consts)[sequence].transformCommon.spheresEnabled)
+		z.y = min(z.y, FRACTAL_PARAMS(consts)[sequence].transformCommon.foldingValue - z.y);
 #endif
 
 	// end
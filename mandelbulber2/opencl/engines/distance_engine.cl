@@ -39,9 +39,13 @@ int GetInteger(int byte, __global char *array)
 }
 
 //------------------ MAIN RENDER FUNCTION --------------------
-kernel void fractal3D(__global float *outDistance, __global char *inBuff,
-	__constant sClInConstants *consts, float3 point)
+kernel void fractal3D(__global float4 *inPoints, __global float *outDistance,
+	__global char *inBuff, __constant sClInConstants *consts, int numberOfPoints)
 {
+	const int index = get_global_id(0);
+	if (index >= numberOfPoints) return;
+	float3 point = inPoints[index].xyz;
+
 	//-------- decode data file ----------------
 	// main offset for materials
 
@@ -82,5 +86,5 @@ kernel void fractal3D(__global float *outDistance, __global char *inBuff,
 	outF = CalculateDistance(consts, point, &calcParam, &renderData);
 	float dist = outF.distance;
 
-	outDistance[0] = dist;
+	outDistance[index] = dist;
 }
@@ -148,9 +148,9 @@ QMAKE_CXXFLAGS += -I/usr/include/gsl
 m1:QMAKE_CXXFLAGS += -I/opt/homebrew/include
 
 # library linking
-unix:!macx:LIBS += -lpng -lgsl -lgslcblas -llzo2 -fopenmp
-macx:!m1:LIBS += -lpng -lgsl -lgslcblas -llzo2 -fopenmp
-macx:m1:LIBS += -lpng -lgsl -lgslcblas -llzo2 -lomp
+unix:!macx:LIBS += -lpng -lz -lgsl -lgslcblas -llzo2 -fopenmp
+macx:!m1:LIBS += -lpng -lz -lgsl -lgslcblas -llzo2 -fopenmp
+macx:m1:LIBS += -lpng -lz -lgsl -lgslcblas -llzo2 -lomp
 #macx:m1:LIBS += -lpng -lgsl -lgslcblas -llzo2
 
 macx:!m1:LIBS += -framework CoreFoundation
@@ -163,6 +163,7 @@ void cPreferencesDialog::on_buttonBox_accepted()
 	gOpenCl->openClHardware->CreateAllContexts(selectedPlatform, deviceType);
 
 	gTextureCache->setMaxSize(gPar->Get<int>("maximum_texture_cache_size") * 1024L * 1024L);
+	gTextureCache->setDiskCacheEnabled(gPar->Get<bool>("texture_disk_cache"));
 
 	gPar->Set<int>("toolbar_icon_size", gPar->Get<int>("toolbar_icon_size"));
 	gMainInterface->mainWindow->slotPopulateToolbar(true);
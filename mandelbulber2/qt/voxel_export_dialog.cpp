@@ -86,6 +86,7 @@ void cVoxelExportDialog::on_pushButton_start_render_layers_clicked()
 		int samplesY = gPar->Get<int>("voxel_samples_y");
 		int samplesZ = gPar->Get<int>("voxel_samples_z");
 		bool greyscale = gPar->Get<bool>("voxel_greyscale_iterations");
+		bool sparse = gPar->Get<bool>("voxel_sparse");
 
 		QDir folder(folderString);
 		if (folder.exists())
@@ -93,7 +94,7 @@ void cVoxelExportDialog::on_pushButton_start_render_layers_clicked()
 			slicerBusy = true;
 			// voxelExport deleted by deleteLater()
 			voxelExport = new cVoxelExport(
-				samplesX, samplesY, samplesZ, limitMin, limitMax, folder, maxIter, greyscale);
+				samplesX, samplesY, samplesZ, limitMin, limitMax, folder, maxIter, greyscale, sparse);
 			QObject::connect(voxelExport,
 				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
 				SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
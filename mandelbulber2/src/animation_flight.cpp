@@ -52,6 +52,7 @@
 #include "files.h"
 #include "global_data.hpp"
 #include "headless.h"
+#include "image_saving_pipeline.hpp"
 #include "initparameters.hpp"
 #include "interface.hpp"
 #include "netrender.hpp"
@@ -394,6 +395,9 @@ void cFlightAnimation::RecordFlight(bool continueRecording)
 
 	mainInterface->progressBarAnimation->show();
 
+	// recorded frames are saved in background, so the flight is not slowed down by encoding
+	cImageSavingPipeline savingPipeline;
+
 	while (!mainInterface->stopRequest)
 	{
 		emit updateProgressAndStatus(QObject::tr("Recording flight animation"),
@@ -531,7 +535,7 @@ void cFlightAnimation::RecordFlight(bool continueRecording)
 		const QString filename = GetFlightFilename(index, false);
 		const ImageFileSave::enumImageFileType fileType =
 			ImageFileSave::enumImageFileType(params->Get<int>("flight_animation_image_type"));
-		SaveImage(filename, fileType, image, gMainInterface->mainWindow);
+		savingPipeline.SaveImage(image, filename, fileType);
 
 		gApplication->processEvents();
 
@@ -1038,6 +1042,9 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 
 	InitFrameMarkers(frameRanges);
 
+	// frames are saved in background. Destructor waits until all frames are written
+	cImageSavingPipeline savingPipeline;
+
 	try
 	{
 		// updating parameters
@@ -1118,7 +1125,17 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 			const QString filename = GetFlightFilename(index, gNetRender->IsClient());
 			const ImageFileSave::enumImageFileType fileType =
 				ImageFileSave::enumImageFileType(params->Get<int>("flight_animation_image_type"));
-			listOfSavedFiles = SaveImage(filename, fileType, image, gMainInterface->mainWindow);
+
+			if (gNetRender->IsClient())
+			{
+				// list of saved files is needed immediately to send them to the server
+				listOfSavedFiles = SaveImage(filename, fileType, image, gMainInterface->mainWindow);
+			}
+			else
+			{
+				// next frame is interpolated and rendered while this one is encoded
+				savingPipeline.SaveImage(image, filename, fileType);
+			}
 
 			renderedFramesCount++;
 			alreadyRenderedFrames[index] = true;
@@ -95,6 +95,7 @@ void cAnimationFrames::AddFrame(const std::shared_ptr<cParameterContainer> param
 	int indexTemp = index;
 	if (index == -1) indexTemp = frames.size();
 	frames.insert(indexTemp, frame);
+	revision++;
 }
 
 void cAnimationFrames::AddAnimatedParameter(const QString &parameterName,
@@ -110,6 +111,7 @@ void cAnimationFrames::AddAnimatedParameter(const QString &parameterName,
 			frame.parameters.AddParamFromOneParameter(
 				defaultValue.GetOriginalContainerName() + "_" + parameterName, defaultValue);
 		}
+		revision++;
 
 		// if parameter container is nullptr then will be used default global container for sound
 		// parameters
@@ -188,12 +190,14 @@ int cAnimationFrames::GetNumberOfFrames() const
 void cAnimationFrames::Clear()
 {
 	frames.clear();
+	revision++;
 }
 
 void cAnimationFrames::ClearAll()
 {
 	frames.clear();
 	listOfParameters.clear();
+	revision++;
 }
 
 int cAnimationFrames::IndexOnList(QString parameterName, QString containerName)
@@ -336,6 +340,7 @@ void cAnimationFrames::RemoveAnimatedParameter(const QString &fullParameterName)
 			break;
 		}
 	}
+	revision++;
 }
 
 void cAnimationFrames::RemoveMissingParameters(
@@ -371,6 +376,7 @@ void cAnimationFrames::DeleteFrames(int begin, int end)
 	{
 		frames.removeAt(i);
 	}
+	revision++;
 }
 
 void cAnimationFrames::ModifyFrame(int index, sAnimationFrame &frame)
@@ -378,12 +384,14 @@ void cAnimationFrames::ModifyFrame(int index, sAnimationFrame &frame)
 	if (index >= 0 && index < frames.size())
 	{
 		frames[index] = frame;
+		revision++;
 	}
 }
 
 void cAnimationFrames::AddFrame(const sAnimationFrame &frame)
 {
 	frames.append(frame);
+	revision++;
 }
 
 void cAnimationFrames::AddAudioParameter(const QString &parameterName, enumVarType paramType,
@@ -601,6 +609,7 @@ void cAnimationFrames::SetListOfParametersAndClear(
 {
 	listOfParameters = _listOfParameters;
 	frames.clear();
+	revision++;
 	audioTracks.DeleteAllAudioTracks(params);
 	RegenerateAudioTracks(params);
 }
@@ -113,9 +113,14 @@ public:
 	{
 		frames = _frames;
 		listOfParameters = _listOfParameters;
+		revision++;
 	}
 	QList<sAnimationFrame> GetFrames() const { return frames; }
 	QList<sParameterDescription> GetListOfParameters() const { return listOfParameters; }
+
+	// increased on every change of frames or list of parameters, so data derived from them
+	// (e.g. compiled interpolation curves) can be checked if still valid
+	quint64 GetRevision() const { return revision; }
 	void SetListOfParametersAndClear(
 		QList<sParameterDescription> _listOfParameters, std::shared_ptr<cParameterContainer> params);
 
@@ -150,6 +155,7 @@ protected:
 	QList<sAnimationFrame> frames;
 	QList<sParameterDescription> listOfParameters;
 	cAudioTrackCollection audioTracks;
+	quint64 revision = 0;
 };
 
 extern std::shared_ptr<cAnimationFrames> gAnimFrames;
@@ -47,9 +47,11 @@
 #include "animation_path_data.hpp"
 #include "cimage.hpp"
 #include "common_math.h"
+#include "distance_query.hpp"
 #include "files.h"
 #include "global_data.hpp"
 #include "headless.h"
+#include "image_saving_pipeline.hpp"
 #include "initparameters.hpp"
 #include "interface.hpp"
 #include "light.h"
@@ -934,6 +936,9 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 
 	InitFrameMarkers(frameRanges);
 
+	// frames are saved in background. Destructor waits until all frames are written
+	cImageSavingPipeline savingPipeline;
+
 	try
 	{
 		// updating parameters
@@ -1034,34 +1039,18 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 			QStringList listOfSavedFiles;
 			const QString filename = GetKeyframeFilename(index, subIndex, gNetRender->IsClient());
 
+			const ImageFileSave::enumImageFileType fileType =
+				ImageFileSave::enumImageFileType(params->Get<int>("keyframe_animation_image_type"));
+
 			if (gNetRender->IsClient())
 			{
-				const ImageFileSave::enumImageFileType fileType =
-					ImageFileSave::enumImageFileType(params->Get<int>("keyframe_animation_image_type"));
+				// list of saved files is needed immediately to send them to the server
 				listOfSavedFiles = SaveImage(filename, fileType, image, gMainInterface->mainWindow);
 			}
 			else
 			{
-				std::shared_ptr<cImage> imageCopy(new cImage(*image.get()));
-
-				const ImageFileSave::enumImageFileType fileType =
-					ImageFileSave::enumImageFileType(params->Get<int>("keyframe_animation_image_type"));
-
-				cKeyframeSaveImageThread *savingThread =
-					new cKeyframeSaveImageThread(imageCopy, filename, fileType);
-
-				QThread *thread = new QThread();
-				thread->setObjectName("Image saving thread");
-
-				connect(thread, &QThread::started, savingThread, &cKeyframeSaveImageThread::startSaving);
-
-				connect(savingThread, &cKeyframeSaveImageThread::savingFinished, savingThread,
-					&cKeyframeSaveImageThread::deleteLater);
-				connect(savingThread, &cKeyframeSaveImageThread::savingFinished, thread, &QThread::quit);
-				connect(thread, &QThread::finished, thread, &QThread::deleteLater);
-
-				savingThread->moveToThread(thread);
-				thread->start();
+				// next frame is interpolated and rendered while this one is encoded
+				savingPipeline.SaveImage(image, filename, fileType);
 			}
 
 			renderedFramesCount++;
@@ -1647,6 +1636,34 @@ QList<int> cKeyframeAnimation::CheckForCollisions(double minDist, bool *stopRequ
 
 	keyframes->ClearMorphCache();
 
+	// camera parameters don't change the fractal, so consecutive frames which differ only by
+	// camera are checked together, with single preparation of parameters for distance estimation
+	const QStringList cameraParameters = {
+		"camera", "target", "camera_top", "camera_rotation", "camera_distance_to_target"};
+	QList<cAnimationFrames::sParameterDescription> fractalParameters;
+	for (const auto &parameter : keyframes->GetListOfUsedParameters())
+	{
+		if (parameter.containerName != "main" || !cameraParameters.contains(parameter.parameterName))
+			fractalParameters.append(parameter);
+	}
+
+	QVector<CVector3> points;
+	QVector<int> framesOfPoints;
+	std::shared_ptr<cParameterContainer> batchPar;
+	std::shared_ptr<cFractalContainer> batchFractPar;
+	QString batchState;
+
+	auto checkBatch = [&]() {
+		if (points.isEmpty()) return;
+		const QVector<double> distances = gDistanceQuery.Distances(points, batchPar, batchFractPar);
+		for (int i = 0; i < distances.size(); i++)
+		{
+			if (distances[i] < minDist) listOfCollisions.append(framesOfPoints[i]);
+		}
+		points.clear();
+		framesOfPoints.clear();
+	};
+
 	for (int frameIndex = 0; frameIndex < keyframes->GetTotalNumberOfFrames(); frameIndex++)
 	{
 		int index = keyframes->GetKeyframeIndex(frameIndex);
@@ -1656,13 +1673,30 @@ QList<int> cKeyframeAnimation::CheckForCollisions(double minDist, bool *stopRequ
 
 		keyframes->GetInterpolatedFrameAndConsolidate(frameIndex, tempPar, tempFractPar);
 		tempPar->Set("frame_no", frameIndex);
-		const CVector3 point = tempPar->Get<CVector3>("camera");
-		const double dist = mainInterface->GetDistanceForPoint(point, tempPar, tempFractPar);
-		if (dist < minDist)
+
+		QString state;
+		for (const auto &parameter : fractalParameters)
 		{
-			listOfCollisions.append(frameIndex);
+			std::shared_ptr<cParameterContainer> container =
+				cAnimationFrames::ContainerSelector(parameter.containerName, tempPar, tempFractPar);
+			if (container)
+				state += container->GetAsOneParameter(parameter.parameterName).Get<QString>(valueActual)
+								 + ";";
 		}
 
+		if (!batchPar || state != batchState)
+		{
+			checkBatch();
+			batchPar = std::make_shared<cParameterContainer>();
+			*batchPar = *tempPar;
+			batchFractPar = std::make_shared<cFractalContainer>();
+			*batchFractPar = *tempFractPar;
+			batchState = state;
+		}
+
+		points.append(tempPar->Get<CVector3>("camera"));
+		framesOfPoints.append(frameIndex);
+
 		if (frameIndex % 100 == 0)
 		{
 			emit updateProgressAndStatus(QObject::tr("Checking for collisions"),
@@ -1672,6 +1706,8 @@ QList<int> cKeyframeAnimation::CheckForCollisions(double minDist, bool *stopRequ
 		}
 	}
 
+	checkBatch();
+
 	emit updateProgressAndStatus(QObject::tr("Checking for collisions"),
 		QObject::tr("Checking for collisions finished"), 1.0, cProgressText::progress_ANIMATION);
 
@@ -2263,17 +2299,3 @@ void cKeyframeRenderThread::startAnimationRender()
 	gKeyframeAnimation->RenderKeyframes(&gMainInterface->stopRequest);
 	emit renderingFinished();
 }
-
-cKeyframeSaveImageThread::cKeyframeSaveImageThread(std::shared_ptr<cImage> _image,
-	const QString &_filename, ImageFileSave::enumImageFileType _fileType)
-{
-	image = _image;
-	filename = _filename;
-	fileType = _fileType;
-}
-
-void cKeyframeSaveImageThread::startSaving()
-{
-	SaveImage(filename, fileType, image, nullptr);
-	emit savingFinished();
-}
@@ -240,24 +240,4 @@ signals:
 	void renderingFinished();
 };
 
-class cKeyframeSaveImageThread : public QThread
-{
-	Q_OBJECT;
-
-public:
-	cKeyframeSaveImageThread(std::shared_ptr<cImage> _image, const QString &_filename,
-		ImageFileSave::enumImageFileType _fileType);
-
-public slots:
-	void startSaving();
-
-private:
-	std::shared_ptr<cImage> image;
-	QString filename;
-	ImageFileSave::enumImageFileType fileType;
-
-signals:
-	void savingFinished();
-};
-
 #endif /* MANDELBULBER2_SRC_ANIMATION_KEYFRAMES_HPP_ */
@@ -35,7 +35,7 @@
 #include "audio_track.h"
 
 #include <gsl/gsl_errno.h>
-#include <gsl/gsl_fft_complex.h>
+#include <gsl/gsl_fft_real.h>
 
 #include <QAudioDecoder>
 #include <QAudioFormat>
@@ -44,12 +44,19 @@
 #include <QAudioRecorder>
 #endif
 
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QtCore/QtGlobal>
 
 #include "audio_fft_data.h"
 #include "files.h"
 #include "netrender.hpp"
+#include "system_directories.hpp"
 #include "write_log.hpp"
 
 // custom includes
@@ -79,6 +86,7 @@ void cAudioTrack::Clear()
 	soundDelay = 0;
 	maxVolume = 0.0;
 	maxFft = 0.0;
+	audioFileHash.clear();
 	rawAudio.clear();
 
 	fftAudio.clear();
@@ -196,6 +204,8 @@ void cAudioTrack::LoadAudio(const QString &_filename)
 		emit loadingFailed();
 		return;
 	}
+
+	audioFileHash = CalculateFileHash(filename);
 }
 
 void cAudioTrack::slotReadBuffer()
@@ -280,55 +290,209 @@ void cAudioTrack::calculateFFT()
 {
 	if (loaded && !fftCalculated && length > cAudioFFTData::fftSize)
 	{
+		fftAudio.resize(numberOfFrames);
+		maxFft = 0.0;
+		maxFftArray = cAudioFFTData();
+
+		if (LoadFFTFromCache())
+		{
+			fftCalculated = true;
+			WriteLog("FFT data loaded from cache", 2);
+			return;
+		}
+
 		WriteLog("FFT calculation started", 2);
 		emit loadingProgress(tr("Calculating FFT"));
 		QApplication::processEvents();
 
-		fftAudio.resize(numberOfFrames);
+		const int fftSize = cAudioFFTData::fftSize;
+		const int overSample = int(sampleRate / framesPerSecond / fftSize + 2);
 
-		const int overSample = int(sampleRate / framesPerSecond / cAudioFFTData::fftSize + 2);
+		// Hann window function
+		std::vector<double> window(fftSize);
+		for (int i = 0; i < fftSize; i++)
+		{
+			window[i] = 0.5 * (1.0 - cos((2.0 * M_PI * i) / (fftSize - 1)));
+		}
 
-#pragma omp parallel for
-		for (int frame = 0; frame < numberOfFrames; ++frame)
+#pragma omp parallel
 		{
-			cAudioFFTData fftFrame;
+			// maximum values are collected per thread and merged at the end
+			float threadMaxFft = 0.0;
+			std::unique_ptr<cAudioFFTData> threadMaxFftArray(new cAudioFFTData);
+			std::vector<double> fftData(fftSize);
 
-			for (int ov = 0; ov < overSample; ov++)
+#pragma omp for schedule(dynamic, 16)
+			for (int frame = 0; frame < numberOfFrames; ++frame)
 			{
-				const int sampleOffset =
-					int(qint64(frame * overSample + ov) * sampleRate / framesPerSecond / overSample);
+				cAudioFFTData &fftFrame = fftAudio[frame];
+				fftFrame = cAudioFFTData();
 
-				// prepare complex data for fft transform
-				double fftData[cAudioFFTData::fftSize * 2];
-				for (int i = 0; i < cAudioFFTData::fftSize; i++)
+				for (int ov = 0; ov < overSample; ov++)
 				{
-					fftData[2 * i] =
-						double(getSample(i + sampleOffset)) * 0.5
-						* (1.0 - cos((2.0 * M_PI * i) / (cAudioFFTData::fftSize - 1))); // Hann window function
-
-					fftData[2 * i + 1] = 0.0;
+					const int sampleOffset =
+						int(qint64(frame * overSample + ov) * sampleRate / framesPerSecond / overSample);
+
+					for (int i = 0; i < fftSize; i++)
+					{
+						fftData[i] = double(getSample(i + sampleOffset)) * window[i];
+					}
+
+					// real input FFT. Result is in half-complex format: real parts in [0 .. n/2],
+					// imaginary parts in [n-1 .. n/2+1]
+					gsl_fft_real_radix2_transform(fftData.data(), 1, fftSize);
+
+					// spectrum of real signal is symmetric, so magnitudes of upper half are mirrored
+					for (int i = 0; i <= fftSize / 2; i++)
+					{
+						const float re = fftData[i];
+						const float im = (i == 0 || i == fftSize / 2) ? 0.0f : float(fftData[fftSize - i]);
+						const float absVal = sqrt(re * re + im * im);
+						fftFrame.data[i] += absVal / overSample;
+						threadMaxFft = qMax(absVal, threadMaxFft);
+						threadMaxFftArray->data[i] = qMax(threadMaxFftArray->data[i], absVal);
+					}
 				}
 
-				// do FFT
-				const gsl_complex_packed_array data = fftData;
-				gsl_fft_complex_radix2_forward(data, 1, cAudioFFTData::fftSize);
+				for (int i = 1; i < fftSize / 2; i++)
+				{
+					fftFrame.data[fftSize - i] = fftFrame.data[i];
+				}
+			}
 
-				// write ready FFT data to storage buffer
-				for (int i = 0; i < cAudioFFTData::fftSize; i++)
+#pragma omp critical
+			{
+				maxFft = qMax(maxFft, threadMaxFft);
+				for (int i = 0; i <= fftSize / 2; i++)
 				{
-					const float re = fftData[2 * i];
-					const float im = fftData[2 * i + 1];
-					float absVal = sqrt(re * re + im * im);
-					fftFrame.data[i] += absVal / overSample;
-					maxFft = qMax(absVal, maxFft);
-					maxFftArray.data[i] = qMax(maxFftArray.data[i], absVal);
+					maxFftArray.data[i] = qMax(maxFftArray.data[i], threadMaxFftArray->data[i]);
 				}
 			}
-			fftAudio[frame] = fftFrame;
 		}
+
+		for (int i = 1; i < fftSize / 2; i++)
+		{
+			maxFftArray.data[fftSize - i] = maxFftArray.data[i];
+		}
+
 		fftCalculated = true;
 		WriteLog("FFT calculation finished", 2);
+
+		SaveFFTToCache();
+	}
+}
+
+QString cAudioTrack::FFTCacheFileName() const
+{
+	if (audioFileHash.isEmpty()) return QString();
+
+	// everything what changes FFT result is a part of the key
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(audioFileHash);
+	hash.addData(QByteArray::number(framesPerSecond, 'g', 17));
+	hash.addData(QByteArray::number(sampleRate));
+	hash.addData(QByteArray::number(length));
+	hash.addData(QByteArray::number(cAudioFFTData::fftSize));
+	hash.addData(QByteArray::number(fftCacheVersion));
+
+	return systemDirectories.GetAudioFFTCacheFolder() + QDir::separator()
+				 + QString::fromLatin1(hash.result().toHex()) + ".fft";
+}
+
+bool cAudioTrack::LoadFFTFromCache()
+{
+	const QString fileName = FFTCacheFileName();
+	if (fileName.isEmpty()) return false;
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) return false;
+
+	const int halfSize = cAudioFFTData::fftSize / 2 + 1;
+	const qint64 halfSizeBytes = qint64(halfSize) * sizeof(float);
+
+	QDataStream stream(&file);
+	qint32 version, frames, fftSize;
+	stream >> version >> frames >> fftSize;
+	if (stream.status() != QDataStream::Ok || version != fftCacheVersion || frames != numberOfFrames
+			|| fftSize != cAudioFFTData::fftSize)
+	{
+		WriteLogString("Audio FFT cache file is not valid", fileName, 2);
+		return false;
 	}
+
+	// only half of spectrum is stored. The rest is mirrored
+	bool ok = stream.readRawData(reinterpret_cast<char *>(&maxFft), sizeof(float)) == sizeof(float);
+	ok &= stream.readRawData(reinterpret_cast<char *>(maxFftArray.data), halfSizeBytes)
+				== halfSizeBytes;
+	for (int frame = 0; frame < numberOfFrames && ok; frame++)
+	{
+		ok &= stream.readRawData(reinterpret_cast<char *>(fftAudio[frame].data), halfSizeBytes)
+					== halfSizeBytes;
+	}
+
+	if (!ok)
+	{
+		WriteLogString("Audio FFT cache file is truncated", fileName, 2);
+		maxFft = 0.0;
+		maxFftArray = cAudioFFTData();
+		return false;
+	}
+
+	for (int i = 1; i < cAudioFFTData::fftSize / 2; i++)
+	{
+		maxFftArray.data[cAudioFFTData::fftSize - i] = maxFftArray.data[i];
+		for (int frame = 0; frame < numberOfFrames; frame++)
+		{
+			fftAudio[frame].data[cAudioFFTData::fftSize - i] = fftAudio[frame].data[i];
+		}
+	}
+
+	// refresh modification time, so the cache file is not deleted as old
+	file.close();
+	file.open(QIODevice::ReadWrite);
+	file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+	return true;
+}
+
+void cAudioTrack::SaveFFTToCache() const
+{
+	const QString fileName = FFTCacheFileName();
+	if (fileName.isEmpty()) return;
+
+	const int halfSize = cAudioFFTData::fftSize / 2 + 1;
+	const int halfSizeBytes = halfSize * int(sizeof(float));
+
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		WriteLogString("Cannot write audio FFT cache file", fileName, 2);
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream << qint32(fftCacheVersion) << qint32(numberOfFrames) << qint32(cAudioFFTData::fftSize);
+	stream.writeRawData(reinterpret_cast<const char *>(&maxFft), sizeof(float));
+	stream.writeRawData(reinterpret_cast<const char *>(maxFftArray.data), halfSizeBytes);
+	for (int frame = 0; frame < numberOfFrames; frame++)
+	{
+		stream.writeRawData(reinterpret_cast<const char *>(fftAudio[frame].data), halfSizeBytes);
+	}
+
+	if (stream.status() == QDataStream::Ok && file.commit())
+		WriteLogString("Audio FFT data saved to cache", fileName, 2);
+	else
+		WriteLogString("Cannot write audio FFT cache file", fileName, 2);
+}
+
+QByteArray cAudioTrack::CalculateFileHash(const QString &fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	if (!hash.addData(&file)) return QByteArray();
+	return hash.result();
 }
 
 cAudioFFTData cAudioTrack::getFFTSample(int frame) const
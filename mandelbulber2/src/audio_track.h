@@ -81,6 +81,14 @@ private slots:
 	void slotError(QAudioDecoder::Error error);
 
 private:
+	QString FFTCacheFileName() const;
+	bool LoadFFTFromCache();
+	void SaveFFTToCache() const;
+	static QByteArray CalculateFileHash(const QString &fileName);
+
+	// has to be increased when format of FFT cache file is changed
+	static const int fftCacheVersion = 1;
+
 	std::unique_ptr<QAudioDecoder> decoder;
 	std::vector<float> rawAudio;
 	std::vector<cAudioFFTData> fftAudio;
@@ -99,6 +107,7 @@ private:
 	float maxVolume;
 	float maxFft;
 	cAudioFFTData maxFftArray;
+	QByteArray audioFileHash;
 
 signals:
 	void loadingFinished();
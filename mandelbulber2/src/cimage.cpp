@@ -37,6 +37,7 @@
 #include <qpainter.h>
 
 #include "common_math.h"
+#include "post_effect_stages.hpp"
 
 cImage::cImage(int w, int h, bool _allocLater)
 {
@@ -81,6 +82,24 @@ cImage::~cImage()
 
 cImage::cImage(cImage &source)
 {
+	previewAllocated = false;
+	imageWidget = nullptr;
+	previewWidth = 0;
+	previewHeight = 0;
+	previewScale = 1.0;
+	previewVisibleWidth = 0;
+	previewVisibleHeight = 0;
+	fastPreview = false;
+	useResizeOnChangeSize = false;
+	isUsed = false;
+	previewPyramidValid = false;
+
+	CopyImageData(source);
+}
+
+void cImage::CopyImageData(cImage &source)
+{
+	// vectors keep their capacity, so copying to already used image doesn't reallocate memory
 	isAllocated = source.isAllocated;
 	image8 = source.image8;
 	image16 = source.image16;
@@ -102,30 +121,22 @@ cImage::cImage(cImage &source)
 	globalIllumination = source.globalIllumination;
 	notDenoised = source.notDenoised;
 
-	previewAllocated = false;
-	imageWidget = nullptr;
-
 	adj = source.adj;
 	opt = source.opt;
 	width = source.width;
 	height = source.height;
 	gammaTable = source.gammaTable;
-	previewWidth = 0;
-	previewHeight = 0;
-	previewScale = 1.0;
-	previewVisibleWidth = 0;
-	previewVisibleHeight = 0;
 	isMainImage = source.isMainImage;
 	gammaTablePrepared = source.gammaTablePrepared;
 	allocLater = source.allocLater;
 	isStereoLeftRight = source.isStereoLeftRight;
-	fastPreview = false;
-	useResizeOnChangeSize = false;
 	meta = source.meta;
 
 	progressiveFactor = source.progressiveFactor;
 
-	isUsed = false;
+	// preview is not copied, so the pyramid has to be built again
+	previewPyramid.clear();
+	previewPyramidValid = false;
 }
 
 bool cImage::AllocMem()
@@ -177,6 +188,8 @@ bool cImage::AllocMem()
 	preview.clear();
 	preview2.clear();
 	previewAllocated = false;
+	previewPyramid.clear();
+	previewPyramidValid = false;
 
 	isAllocated = true;
 	return true;
@@ -374,23 +387,101 @@ void cImage::CalculateGammaTable()
 	}
 }
 
+void cImage::CompileSpan(quint64 address, quint64 count)
+{
+	// pixels are processed in short blocks stored as separate channels, so the compiler can
+	// vectorize all arithmetic (only tanh and gamma table lookups stay scalar)
+	const int blockSize = 64;
+	float R[blockSize];
+	float G[blockSize];
+	float B[blockSize];
+
+	const float brightness = adj.brightness;
+	const float contrast = adj.contrast;
+	const float saturation = adj.saturation;
+	const bool hdrEnabled = adj.hdrEnabled;
+	const int *gamma = gammaTable.data();
+
+	float const rFactor = 0.299f;
+	float const gFactor = .587f;
+	float const bFactor = .114f;
+
+	for (quint64 blockStart = 0; blockStart < count; blockStart += blockSize)
+	{
+		const int n = int(qMin(quint64(blockSize), count - blockStart));
+		const sRGBFloat *source = &postImageFloat[address + blockStart];
+		sRGB16 *target16 = &image16[address + blockStart];
+		sRGB8 *target8 = &image8[address + blockStart];
+
+		for (int i = 0; i < n; i++)
+		{
+			R[i] = qMax((source[i].R * brightness - 0.5f) * contrast + 0.5f, 0.0f);
+			G[i] = qMax((source[i].G * brightness - 0.5f) * contrast + 0.5f, 0.0f);
+			B[i] = qMax((source[i].B * brightness - 0.5f) * contrast + 0.5f, 0.0f);
+		}
+
+		if (hdrEnabled)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				R[i] = tanhf(R[i]);
+				G[i] = tanhf(G[i]);
+				B[i] = tanhf(B[i]);
+			}
+		}
+
+		// saturation
+		for (int i = 0; i < n; i++)
+		{
+			float V = sqrtf(R[i] * R[i] * rFactor + G[i] * G[i] * gFactor + B[i] * B[i] * bFactor);
+			R[i] = clamp(V + (R[i] - V) * saturation, 0.0f, 1.0f) * 65535.0f;
+			G[i] = clamp(V + (G[i] - V) * saturation, 0.0f, 1.0f) * 65535.0f;
+			B[i] = clamp(V + (B[i] - V) * saturation, 0.0f, 1.0f) * 65535.0f;
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			sRGB16 pixel16;
+			pixel16.R = quint16(gamma[quint16(R[i])]);
+			pixel16.G = quint16(gamma[quint16(G[i])]);
+			pixel16.B = quint16(gamma[quint16(B[i])]);
+			target16[i] = pixel16;
+			target8[i] = sRGB8(quint8(pixel16.R / 256), quint8(pixel16.G / 256), quint8(pixel16.B / 256));
+		}
+	}
+}
+
 void cImage::CompileImage(QList<int> *list)
 {
-	int listIndex = 0;
-	for (quint64 y = 0; y < height; y++)
+	// 16-bit and 8-bit images are updated in the same pass
+	if (imageFloat.empty() || postImageFloat.empty()) return;
+
+	CalculateGammaTable();
+
+	if (list)
 	{
-		if (list)
+		const int count = list->size();
+		const int *lines = list->constData();
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int index = 0; index < count; index++)
 		{
-			if (listIndex >= list->size()) break;
-			y = quint64(list->at(listIndex));
-			listIndex++;
+			quint64 y = quint64(lines[index]);
+			if (y < height) CompileSpan(y * width, width);
 		}
-		for (quint64 x = 0; x < width; x++)
+	}
+	else
+	{
+		// bands of rows are small enough to keep source and target data in cache
+		const qint64 bandHeight = 8;
+		const qint64 numberOfBands = (qint64(height) + bandHeight - 1) / bandHeight;
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (qint64 band = 0; band < numberOfBands; band++)
 		{
-			quint64 address = x + y * width;
-			sRGBFloat pixel = postImageFloat[address];
-			sRGB16 newPixel16 = CalculatePixel(pixel);
-			image16[address] = newPixel16;
+			quint64 yStart = quint64(band * bandHeight);
+			quint64 yEnd = qMin(yStart + bandHeight, height);
+			CompileSpan(yStart * width, (yEnd - yStart) * width);
 		}
 	}
 }
@@ -399,17 +490,19 @@ void cImage::CompileImage(const QList<QRect> *list)
 {
 	if (!imageFloat.empty() && !postImageFloat.empty())
 	{
+		CalculateGammaTable();
+
 		for (auto rect : *list)
 		{
-			for (quint64 y = quint64(rect.top()); y <= quint64(rect.bottom()); y++)
+			const qint64 top = rect.top();
+			const qint64 bottom = rect.bottom();
+			const quint64 left = quint64(rect.left());
+			const quint64 rectWidth = quint64(rect.width());
+
+#pragma omp parallel for schedule(dynamic, 1)
+			for (qint64 y = top; y <= bottom; y++)
 			{
-				for (quint64 x = quint64(rect.left()); x <= quint64(rect.right()); x++)
-				{
-					quint64 address = x + y * width;
-					sRGBFloat pixel = postImageFloat[address];
-					sRGB16 newPixel16 = CalculatePixel(pixel);
-					image16[address] = newPixel16;
-				}
+				CompileSpan(left + quint64(y) * width, rectWidth);
 			}
 		}
 	}
@@ -458,7 +551,10 @@ void cImage::SetImageParameters(sImageAdjustments adjustments)
 
 quint8 *cImage::ConvertTo8bitChar()
 {
-	for (quint64 i = 0; i < quint64(width) * quint64(height); i++)
+	const qint64 size = qint64(width) * qint64(height);
+
+#pragma omp parallel for
+	for (qint64 i = 0; i < size; i++)
 	{
 		image8[i].R = image16[i].R / 256;
 		image8[i].G = image16[i].G / 256;
@@ -518,33 +614,6 @@ quint8 *cImage::ConvertGenericRGBTo16bitWord(std::vector<sRGBFloat> &from, std::
 	return reinterpret_cast<quint8 *>(to.data());
 }
 
-sRGB8 cImage::Interpolation(float x, float y) const
-{
-	sRGB8 colour = sRGB8(0, 0, 0);
-	if (x >= 0 && x < width - 1 && y >= 0 && y < height - 1)
-	{
-		quint64 ix = quint64(x);
-		quint64 iy = quint64(y);
-		int rx = int((x - ix) * 256);
-		int ry = int((y - iy) * 256);
-		int rxi = 255 - rx;
-		int ryi = 255 - ry;
-		int rxRy = rx * ry;
-		int rxRyi = rx * ryi;
-		int rxiRy = rxi * ry;
-		int rxiRyi = rxi * ryi;
-
-		sRGB8 k1 = image8[iy * width + ix];
-		sRGB8 k2 = image8[iy * width + ix + 1];
-		sRGB8 k3 = image8[(iy + 1) * width + ix];
-		sRGB8 k4 = image8[(iy + 1) * width + ix + 1];
-		colour.R = quint8((k1.R * rxiRyi + k2.R * rxRyi + k3.R * rxiRy + k4.R * rxRy) / 65536);
-		colour.G = quint8((k1.G * rxiRyi + k2.G * rxRyi + k3.G * rxiRy + k4.G * rxRy) / 65536);
-		colour.B = quint8((k1.B * rxiRyi + k2.B * rxRyi + k3.B * rxiRy + k4.B * rxRy) / 65536);
-	}
-	return colour;
-}
-
 quint8 *cImage::CreatePreview(
 	double scale, int visibleWidth, int visibleHeight, QWidget *widget = nullptr)
 {
@@ -581,6 +650,145 @@ quint8 *cImage::CreatePreview(
 	return ptr;
 }
 
+bool cImage::PreparePreviewPyramid()
+{
+	// levels are halved until the next one would be smaller than the preview
+	std::vector<std::pair<quint64, quint64>> levelSizes;
+	quint64 levelWidth = width;
+	quint64 levelHeight = height;
+	while ((levelWidth + 1) / 2 >= previewWidth && (levelHeight + 1) / 2 >= previewHeight
+				 && levelWidth > 1 && levelHeight > 1)
+	{
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+		levelSizes.emplace_back(levelWidth, levelHeight);
+	}
+
+	bool sizeMatches = levelSizes.size() == previewPyramid.size();
+	for (size_t i = 0; i < levelSizes.size() && sizeMatches; i++)
+	{
+		sizeMatches = previewPyramid[i].width == levelSizes[i].first
+									&& previewPyramid[i].height == levelSizes[i].second;
+	}
+
+	if (!sizeMatches)
+	{
+		previewPyramid.resize(levelSizes.size());
+		for (size_t i = 0; i < levelSizes.size(); i++)
+		{
+			previewPyramid[i].width = levelSizes[i].first;
+			previewPyramid[i].height = levelSizes[i].second;
+			previewPyramid[i].pixels.resize(levelSizes[i].first * levelSizes[i].second);
+		}
+		previewPyramidValid = false;
+	}
+
+	return previewPyramidValid;
+}
+
+void cImage::UpdatePreviewPyramid(quint64 x0, quint64 y0, quint64 x1, quint64 y1)
+{
+	// region is given in image coordinates (inclusive) and is propagated to all levels
+	const sRGB8 *source = image8.data();
+	quint64 sourceWidth = width;
+	quint64 sourceHeight = height;
+
+	for (auto &level : previewPyramid)
+	{
+		x0 /= 2;
+		y0 /= 2;
+		x1 /= 2;
+		y1 /= 2;
+
+		sRGB8 *target = level.pixels.data();
+		const quint64 targetWidth = level.width;
+
+#pragma omp parallel for
+		for (qint64 y = qint64(y0); y <= qint64(y1); y++)
+		{
+			const sRGB8 *line1 = &source[quint64(2 * y) * sourceWidth];
+			const sRGB8 *line2 = &source[qMin(quint64(2 * y + 1), sourceHeight - 1) * sourceWidth];
+			for (quint64 x = x0; x <= x1; x++)
+			{
+				quint64 sx1 = 2 * x;
+				quint64 sx2 = qMin(2 * x + 1, sourceWidth - 1);
+				sRGB8 pixel;
+				pixel.R = quint8((line1[sx1].R + line1[sx2].R + line2[sx1].R + line2[sx2].R + 2) / 4);
+				pixel.G = quint8((line1[sx1].G + line1[sx2].G + line2[sx1].G + line2[sx2].G + 2) / 4);
+				pixel.B = quint8((line1[sx1].B + line1[sx2].B + line2[sx1].B + line2[sx2].B + 2) / 4);
+				target[quint64(y) * targetWidth + x] = pixel;
+			}
+		}
+
+		source = target;
+		sourceWidth = level.width;
+		sourceHeight = level.height;
+	}
+}
+
+void cImage::CalculatePreviewLine(quint64 y, quint64 xStart, quint64 xEnd)
+{
+	const quint64 w = previewWidth;
+	const quint64 h = previewHeight;
+
+	if (fastPreview)
+	{
+		float scaleX = float(width) / w;
+		float scaleY = float(height) / h;
+		quint64 yy = qMin(quint64(y * scaleY), height - 1);
+		for (quint64 x = xStart; x <= xEnd; x++)
+		{
+			quint64 xx = qMin(quint64(x * scaleX), width - 1);
+			preview[x + y * w] = image8[yy * width + xx];
+		}
+	}
+	else
+	{
+		// bilinear sampling of the smallest pyramid level which is still not smaller than preview
+		const sRGB8 *source = image8.data();
+		quint64 sourceWidth = width;
+		quint64 sourceHeight = height;
+		if (!previewPyramid.empty())
+		{
+			source = previewPyramid.back().pixels.data();
+			sourceWidth = previewPyramid.back().width;
+			sourceHeight = previewPyramid.back().height;
+		}
+
+		float scaleX = float(sourceWidth) / w;
+		float scaleY = float(sourceHeight) / h;
+
+		float fy = clamp((y + 0.5f) * scaleY - 0.5f, 0.0f, float(sourceHeight - 1));
+		quint64 y1 = quint64(fy);
+		quint64 y2 = qMin(y1 + 1, sourceHeight - 1);
+		float ky = fy - y1;
+		const sRGB8 *line1 = &source[y1 * sourceWidth];
+		const sRGB8 *line2 = &source[y2 * sourceWidth];
+
+		for (quint64 x = xStart; x <= xEnd; x++)
+		{
+			float fx = clamp((x + 0.5f) * scaleX - 0.5f, 0.0f, float(sourceWidth - 1));
+			quint64 x1 = quint64(fx);
+			quint64 x2 = qMin(x1 + 1, sourceWidth - 1);
+			float kx = fx - x1;
+
+			float k11 = (1.0f - kx) * (1.0f - ky);
+			float k12 = kx * (1.0f - ky);
+			float k21 = (1.0f - kx) * ky;
+			float k22 = kx * ky;
+
+			sRGB8 newPixel;
+			newPixel.R = quint8(line1[x1].R * k11 + line1[x2].R * k12 + line2[x1].R * k21
+													+ line2[x2].R * k22 + 0.5f);
+			newPixel.G = quint8(line1[x1].G * k11 + line1[x2].G * k12 + line2[x1].G * k21
+													+ line2[x2].G * k22 + 0.5f);
+			newPixel.B = quint8(line1[x1].B * k11 + line1[x2].B * k12 + line2[x1].B * k21
+													+ line2[x2].B * k22 + 0.5f);
+			preview[x + y * w] = newPixel;
+		}
+	}
+}
+
 void cImage::UpdatePreview(QList<int> *list)
 {
 	if (previewAllocated && !allocLater)
@@ -595,72 +803,50 @@ void cImage::UpdatePreview(QList<int> *list)
 		}
 		else
 		{
-			float scaleX = float(width) / w;
 			float scaleY = float(height) / h;
 
-			// number of pixels to sum
-			int countX = int(float(width) / w + 1);
-			int countY = int(float(height) / h + 1);
-			int factor = countX * countY;
-
-			float deltaX = scaleX / countX;
-			float deltaY = scaleY / countY;
-
-			int listIndex = 0;
-
-			for (quint64 y = 0; y < h; y++)
+			// with fast preview the pyramid is not maintained
+			bool wholePyramid = fastPreview || !PreparePreviewPyramid() || !list;
+			if (!fastPreview && wholePyramid)
 			{
+				UpdatePreviewPyramid(0, 0, width - 1, height - 1);
+				previewPyramidValid = true;
+			}
+			if (fastPreview) previewPyramidValid = false;
 
-				if (list)
+			std::vector<char> dirtyLines(h, list ? 0 : 1);
+			if (list)
+			{
+				// consecutive lines are updated together
+				int index = 0;
+				while (index < list->size())
 				{
-					if (listIndex >= list->size()) break;
-
-					if (scaleY * y < list->at(listIndex) - int(scaleY) - 1) continue;
-
-					while (scaleY * y - int(scaleY) - 1 > list->at(listIndex))
+					int first = list->at(index);
+					int last = first;
+					while (index + 1 < list->size() && list->at(index + 1) == last + 1)
 					{
-						listIndex++;
-						if (listIndex >= list->size()) break;
+						index++;
+						last++;
 					}
+					index++;
+
+					if (first < 0 || quint64(last) >= height) continue;
+
+					if (!wholePyramid) UpdatePreviewPyramid(0, quint64(first), width - 1, quint64(last));
+
+					// margin covers the support of bilinear sampling on the pyramid level
+					qint64 yStart = qMax(qint64(first / scaleY) - 2, qint64(0));
+					qint64 yEnd = qMin(qint64((last + 1) / scaleY) + 2, qint64(h) - 1);
+					for (qint64 y = yStart; y <= yEnd; y++)
+						dirtyLines[quint64(y)] = 1;
 				}
+			}
 
-				for (quint64 x = 0; x < w; x++)
-				{
-					if (fastPreview)
-					{
-						quint64 xx = quint64(x * scaleX);
-						quint64 yy = quint64(y * scaleY);
-						preview[x + y * w] = image8[yy * width + xx];
-					}
-					else
-					{
-						int R = 0;
-						int G = 0;
-						int B = 0;
-						for (int j = 0; j < countY; j++)
-						{
-							float yy = y * scaleY + j * deltaY - 0.5f;
-
-							for (int i = 0; i < countX; i++)
-							{
-								float xx = x * scaleX + i * deltaX - 0.5f;
-								if (xx > 0 && xx < width - 1 && yy > 0 && yy < height - 1)
-								{
-									sRGB8 oldPixel = Interpolation(xx, yy);
-									R += oldPixel.R;
-									G += oldPixel.G;
-									B += oldPixel.B;
-								}
-							} // next i
-						}		// next j
-						sRGB8 newPixel;
-						newPixel.R = quint8(R / factor);
-						newPixel.G = quint8(G / factor);
-						newPixel.B = quint8(B / factor);
-						preview[x + y * w] = newPixel;
-					}
-				} // next x
-			}		// next y
+#pragma omp parallel for schedule(dynamic, 1)
+			for (qint64 y = 0; y < qint64(h); y++)
+			{
+				if (dirtyLines[quint64(y)]) CalculatePreviewLine(quint64(y), 0, w - 1);
+			}
 		}
 		preview2 = preview;
 		previewMutex.unlock();
@@ -685,70 +871,36 @@ void cImage::UpdatePreview(const QList<QRect> *list)
 		}
 		else
 		{
+			float scaleX = float(width) / w;
+			float scaleY = float(height) / h;
+
+			bool wholePyramid = fastPreview || !PreparePreviewPyramid();
+			if (!fastPreview && wholePyramid)
+			{
+				UpdatePreviewPyramid(0, 0, width - 1, height - 1);
+				previewPyramidValid = true;
+			}
+			if (fastPreview) previewPyramidValid = false;
+
 			for (auto rect : *list)
 			{
-				float scaleX = float(width) / w;
-				float scaleY = float(height) / h;
-
-				// number of pixels to sum
-				int countX = int(float(width) / w + 1);
-				int countY = int(float(height) / h + 1);
-				int factor = countX * countY;
-
-				float deltaX = scaleX / countX;
-				float deltaY = scaleY / countY;
-
-				quint64 xStart = quint64(rect.left() / scaleX);
-				xStart = qMax(xStart, 0ULL);
-				quint64 xEnd = quint64((rect.right() + 1) / scaleX);
-				xEnd = qMin(xEnd, w - 1);
-				quint64 yStart = quint64(rect.top() / scaleY);
-				yStart = qMax(yStart, 0ULL);
-				quint64 yEnd = quint64((rect.bottom() + 1) / scaleY);
-				yEnd = qMin(yEnd, h - 1);
-
-				//#ifndef _WIN32
-				//#pragma omp parallel for
-				//#endif
-				for (quint64 y = yStart; y <= yEnd; y++)
+				if (!wholePyramid)
 				{
-					for (quint64 x = xStart; x <= xEnd; x++)
-					{
-						if (fastPreview)
-						{
-							quint64 xx = quint64(x * scaleX);
-							quint64 yy = quint64(y * scaleY);
-							preview[x + y * w] = image8[yy * width + xx];
-						}
-						else
-						{
-							int R = 0;
-							int G = 0;
-							int B = 0;
-							for (int j = 0; j < countY; j++)
-							{
-								float yy = y * scaleY + j * deltaY - 0.5f;
-
-								for (int i = 0; i < countX; i++)
-								{
-									float xx = x * scaleX + i * deltaX - 0.5f;
-									if (xx > 0 && xx < width - 1 && yy > 0 && yy < height - 1)
-									{
-										sRGB8 oldPixel = Interpolation(xx, yy);
-										R += oldPixel.R;
-										G += oldPixel.G;
-										B += oldPixel.B;
-									}
-								} // next i
-							}		// next j
-							sRGB8 newPixel;
-							newPixel.R = quint8(R / factor);
-							newPixel.G = quint8(G / factor);
-							newPixel.B = quint8(B / factor);
-							preview[x + y * w] = newPixel;
-						}
-					} // next x
-				}		// next y
+					UpdatePreviewPyramid(quint64(rect.left()), quint64(rect.top()),
+						quint64(rect.right()), quint64(rect.bottom()));
+				}
+
+				// margin covers the support of bilinear sampling on the pyramid level
+				qint64 xStart = qMax(qint64(rect.left() / scaleX) - 2, qint64(0));
+				qint64 xEnd = qMin(qint64((rect.right() + 1) / scaleX) + 2, qint64(w) - 1);
+				qint64 yStart = qMax(qint64(rect.top() / scaleY) - 2, qint64(0));
+				qint64 yEnd = qMin(qint64((rect.bottom() + 1) / scaleY) + 2, qint64(h) - 1);
+
+#pragma omp parallel for
+				for (qint64 y = yStart; y <= yEnd; y++)
+				{
+					CalculatePreviewLine(quint64(y), quint64(xStart), quint64(xEnd));
+				}
 			}
 		}
 
@@ -1075,6 +1227,12 @@ void cImage::CircleBorder(
 	previewMutex.unlock();
 }
 
+cPostEffectStages *cImage::GetPostEffectStages()
+{
+	if (!postEffectStages) postEffectStages.reset(new cPostEffectStages(this));
+	return postEffectStages.get();
+}
+
 void cImage::NullPostEffect(QList<int> *list)
 {
 	if (!imageFloat.empty() && !postImageFloat.empty())
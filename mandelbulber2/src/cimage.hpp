@@ -49,6 +49,9 @@
 #include "color_structures.hpp"
 #include "image_adjustments.h"
 
+// forward declarations
+class cPostEffectStages;
+
 struct sImageOptional
 {
 	sImageOptional() {}
@@ -94,6 +97,7 @@ class cImage
 public:
 	cImage(int w, int h, bool _allocLater = false);
 	cImage(cImage &source);
+	void CopyImageData(cImage &source);
 	void construct();
 
 	~cImage();
@@ -115,6 +119,9 @@ public:
 	void SetAsMainImage() { isMainImage = true; }
 	bool IsMainImage() const { return isMainImage; }
 
+	// stored outputs of post effects, used to recalculate only changed parts of image
+	cPostEffectStages *GetPostEffectStages();
+
 	void SetFastPreview(bool enable) { fastPreview = enable; }
 	void SetResizeOnChangeSize(bool enable) { useResizeOnChangeSize = enable; }
 
@@ -375,7 +382,10 @@ public:
 	double VisualCompare(std::shared_ptr<cImage> refImage, bool checkIfBlank);
 
 private:
-	sRGB8 Interpolation(float x, float y) const;
+	void CompileSpan(quint64 address, quint64 count);
+	bool PreparePreviewPyramid();
+	void UpdatePreviewPyramid(quint64 x0, quint64 y0, quint64 x1, quint64 y1);
+	void CalculatePreviewLine(quint64 y, quint64 xStart, quint64 xEnd);
 	bool AllocMem();
 	void FreeImage();
 	static inline sRGB16 Black16() { return sRGB16(0, 0, 0); }
@@ -407,6 +417,16 @@ private:
 
 	std::vector<sRGB8> preview;
 	std::vector<sRGB8> preview2;
+
+	// box filtered levels of image8 (each one is half of the previous), used to scale preview
+	struct sPreviewPyramidLevel
+	{
+		std::vector<sRGB8> pixels;
+		quint64 width = 0;
+		quint64 height = 0;
+	};
+	std::vector<sPreviewPyramidLevel> previewPyramid;
+	bool previewPyramidValid;
 	QWidget *imageWidget;
 
 	sImageAdjustments adj;
@@ -427,6 +447,7 @@ private:
 	bool fastPreview;
 	bool useResizeOnChangeSize;
 	QMap<QString, QString> meta;
+	std::unique_ptr<cPostEffectStages> postEffectStages;
 
 	QMutex previewMutex;
 
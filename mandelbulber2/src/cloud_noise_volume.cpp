@@ -0,0 +1,217 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cCloudNoiseVolume - tileable volume with precomputed Perlin noise used for volumetric
+ * clouds. Octaves are sampled from the same volume with trilinear interpolation, so the
+ * time dependent shifts (clouds speed) don't require recalculation of the volume.
+ */
+
+#include "cloud_noise_volume.hpp"
+
+#include <cmath>
+
+#include <QElapsedTimer>
+#include <QMutex>
+
+#include "perlin_noise_octaves.h"
+#include "write_log.hpp"
+
+cCloudNoiseVolume::cCloudNoiseVolume(std::uint32_t _seed)
+{
+	seed = _seed;
+	Generate();
+}
+
+std::shared_ptr<const cCloudNoiseVolume> cCloudNoiseVolume::GetVolume(std::uint32_t seed)
+{
+	static QMutex mutex;
+	static std::shared_ptr<const cCloudNoiseVolume> lastVolume;
+
+	QMutexLocker lock(&mutex);
+	if (!lastVolume || lastVolume->GetSeed() != seed)
+	{
+		lastVolume.reset(new cCloudNoiseVolume(seed));
+	}
+	return lastVolume;
+}
+
+void cCloudNoiseVolume::Generate()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	cPerlinNoiseOctaves perlinNoise(seed);
+	const std::uint8_t *p = perlinNoise.GetSeeds();
+
+	volume.resize(size_t(size) * size * size);
+
+	const int mask = period - 1;
+	const double step = 1.0 / samplesPerUnit;
+
+	// fade and gradient coordinates are the same for all lattice cells, so they are calculated
+	// once. Inner loop over x works on plain arrays and can be vectorized by compiler
+	double fade[samplesPerUnit];
+	double frac[samplesPerUnit];
+	for (int i = 0; i < samplesPerUnit; i++)
+	{
+		frac[i] = i * step;
+		fade[i] = cPerlinNoiseOctaves::Fade(frac[i]);
+	}
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int iz = 0; iz < size; iz++)
+	{
+		const int Z = iz / samplesPerUnit;
+		const int Z1 = (Z + 1) & mask;
+		const double z = frac[iz % samplesPerUnit];
+		const double w = fade[iz % samplesPerUnit];
+
+		for (int iy = 0; iy < size; iy++)
+		{
+			const int Y = iy / samplesPerUnit;
+			const int Y1 = (Y + 1) & mask;
+			const double y = frac[iy % samplesPerUnit];
+			const double v = fade[iy % samplesPerUnit];
+
+			float *row = &volume[(size_t(iz) * size + iy) * size];
+
+			for (int X = 0; X < period; X++)
+			{
+				// hashes of 8 corners of lattice cell. Lattice is wrapped to 'period'
+				const int X1 = (X + 1) & mask;
+				const int A = p[X] + Y;
+				const int B = p[X1] + Y;
+				const int A1 = p[X] + Y1;
+				const int B1 = p[X1] + Y1;
+				const std::uint8_t hAA = p[p[A] + Z];
+				const std::uint8_t hBA = p[p[B] + Z];
+				const std::uint8_t hAB = p[p[A1] + Z];
+				const std::uint8_t hBB = p[p[B1] + Z];
+				const std::uint8_t hAA1 = p[p[A] + Z1];
+				const std::uint8_t hBA1 = p[p[B] + Z1];
+				const std::uint8_t hAB1 = p[p[A1] + Z1];
+				const std::uint8_t hBB1 = p[p[B1] + Z1];
+
+				float *cell = row + X * samplesPerUnit;
+				for (int i = 0; i < samplesPerUnit; i++)
+				{
+					const double x = frac[i];
+					const double u = fade[i];
+					using pn = cPerlinNoiseOctaves;
+					cell[i] = float(pn::Lerp(w,
+						pn::Lerp(v, pn::Lerp(u, pn::Grad(hAA, x, y, z), pn::Grad(hBA, x - 1, y, z)),
+							pn::Lerp(u, pn::Grad(hAB, x, y - 1, z), pn::Grad(hBB, x - 1, y - 1, z))),
+						pn::Lerp(v, pn::Lerp(u, pn::Grad(hAA1, x, y, z - 1), pn::Grad(hBA1, x - 1, y, z - 1)),
+							pn::Lerp(u, pn::Grad(hAB1, x, y - 1, z - 1), pn::Grad(hBB1, x - 1, y - 1, z - 1)))));
+				}
+			}
+		}
+	}
+
+	WriteLog(QString("cCloudNoiseVolume: noise volume %1^3 generated in %2 ms")
+						 .arg(size)
+						 .arg(timer.elapsed()),
+		2);
+}
+
+double cCloudNoiseVolume::Sample(double x, double y, double z) const
+{
+	// noise coordinates converted to volume coordinates
+	x *= samplesPerUnit;
+	y *= samplesPerUnit;
+	z *= samplesPerUnit;
+
+	const double fx = std::floor(x);
+	const double fy = std::floor(y);
+	const double fz = std::floor(z);
+	const double tx = x - fx;
+	const double ty = y - fy;
+	const double tz = z - fz;
+
+	// volume is tileable, so indexes are wrapped
+	const int mask = size - 1;
+	const int x0 = int(std::int64_t(fx) & mask);
+	const int y0 = int(std::int64_t(fy) & mask);
+	const int z0 = int(std::int64_t(fz) & mask);
+	const int x1 = (x0 + 1) & mask;
+	const int y1 = (y0 + 1) & mask;
+	const int z1 = (z0 + 1) & mask;
+
+	const float *plane0 = &volume[size_t(z0) * size * size];
+	const float *plane1 = &volume[size_t(z1) * size * size];
+	const float *row00 = plane0 + y0 * size;
+	const float *row01 = plane0 + y1 * size;
+	const float *row10 = plane1 + y0 * size;
+	const float *row11 = plane1 + y1 * size;
+
+	const double c00 = row00[x0] + tx * (row00[x1] - row00[x0]);
+	const double c01 = row01[x0] + tx * (row01[x1] - row01[x0]);
+	const double c10 = row10[x0] + tx * (row10[x1] - row10[x0]);
+	const double c11 = row11[x0] + tx * (row11[x1] - row11[x0]);
+	const double c0 = c00 + ty * (c01 - c00);
+	const double c1 = c10 + ty * (c11 - c10);
+	return c0 + tz * (c1 - c0);
+}
+
+double cCloudNoiseVolume::normalizedOctaveNoise3D_0_1(
+	double x, double y, double z, double shx, double shy, double shz, std::int32_t octaves) const
+{
+	// the same octave scheme as in cPerlinNoiseOctaves::accumulatedOctaveNoise3D()
+	double result = 0;
+	double amp = 1;
+
+	for (std::int32_t i = 0; i < octaves; ++i)
+	{
+		double sh = ((double)(octaves - i) / octaves + 1.13f) * 0.597f;
+		double shiftVectorX = shx * sh;
+		double shiftVectorY = shy * sh;
+		double shiftVectorZ = shz * sh;
+
+		x -= shiftVectorX * 0.2;
+		y -= shiftVectorY * 0.2;
+		z -= shiftVectorZ * 0.2;
+
+		result += Sample(x - shiftVectorX, y - shiftVectorY, z - shiftVectorZ) * amp;
+
+		// noise is periodic, so coordinates can be wrapped to keep precision for high octaves
+		x -= period * std::floor(x / period);
+		y -= period * std::floor(y / period);
+		z -= period * std::floor(z / period);
+
+		x *= 2.0;
+		y *= 2.0;
+		z *= 2.0;
+		amp /= 2.0;
+	}
+
+	result /= cPerlinNoiseOctaves::Weight(octaves);
+	return result * 0.5 + 0.5;
+}
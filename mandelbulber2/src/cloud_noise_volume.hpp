@@ -0,0 +1,72 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cCloudNoiseVolume - tileable volume with precomputed Perlin noise used for volumetric
+ * clouds. Octaves are sampled from the same volume with trilinear interpolation, so the
+ * time dependent shifts (clouds speed) don't require recalculation of the volume.
+ */
+
+#ifndef MANDELBULBER2_SRC_CLOUD_NOISE_VOLUME_HPP_
+#define MANDELBULBER2_SRC_CLOUD_NOISE_VOLUME_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class cCloudNoiseVolume
+{
+public:
+	explicit cCloudNoiseVolume(std::uint32_t seed);
+	~cCloudNoiseVolume() = default;
+
+	// returns shared volume for given seed. Volume is calculated only when seed has changed
+	static std::shared_ptr<const cCloudNoiseVolume> GetVolume(std::uint32_t seed);
+
+	// equivalent of cPerlinNoiseOctaves::normalizedOctaveNoise3D_0_1()
+	double normalizedOctaveNoise3D_0_1(
+		double x, double y, double z, double shx, double shy, double shz, std::int32_t octaves) const;
+
+	std::uint32_t GetSeed() const { return seed; }
+
+private:
+	double Sample(double x, double y, double z) const;
+	void Generate();
+
+	// noise repeats every 'period' units of noise coordinates (has to be power of 2)
+	static const int period = 16;
+	static const int samplesPerUnit = 8;
+	static const int size = period * samplesPerUnit;
+
+	std::uint32_t seed;
+	std::vector<float> volume;
+};
+
+#endif /* MANDELBULBER2_SRC_CLOUD_NOISE_VOLUME_HPP_ */
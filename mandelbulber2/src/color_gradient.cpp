@@ -69,6 +69,7 @@ cColorGradient::~cColorGradient() = default;
 int cColorGradient::AddColor(sRGB color, float position)
 {
 	sorted = false;
+	lookupTable.clear();
 	position = CorrectPosition(position, -1);
 	color = MakeGrayscaleIfNeeded(color);
 	sColor positionedColor = {color, position};
@@ -81,6 +82,7 @@ void cColorGradient::ModifyColor(int index, sRGB color)
 	if (index < colors.size())
 	{
 		sorted = false;
+		lookupTable.clear();
 		color = MakeGrayscaleIfNeeded(color);
 		colors[index].color = color;
 	}
@@ -97,6 +99,7 @@ void cColorGradient::ModifyPosition(int index, float position)
 	if (index < colors.size())
 	{
 		sorted = false;
+		lookupTable.clear();
 		colors[index].position = position;
 	}
 	else
@@ -112,6 +115,7 @@ void cColorGradient::RemoveColor(int index)
 		if (index < colors.size())
 		{
 			sorted = false;
+			lookupTable.clear();
 			colors.removeAt(index);
 		}
 		else
@@ -229,6 +233,24 @@ sRGBFloat cColorGradient::InterpolateFloat(int paletteIndex, float pos, bool smo
 	return color;
 }
 
+void cColorGradient::BakeLookupTable(bool smooth)
+{
+	SortGradient();
+
+	std::vector<float> table((lookupTableSegments + 1) * 4, 0.0f);
+	int paletteIndex = 0;
+	for (int i = 0; i <= lookupTableSegments; i++)
+	{
+		float pos = float(i) / lookupTableSegments;
+		paletteIndex = PaletteIterator(paletteIndex, pos);
+		sRGBFloat color = InterpolateFloat(paletteIndex, pos, smooth);
+		table[i * 4] = color.R;
+		table[i * 4 + 1] = color.G;
+		table[i * 4 + 2] = color.B;
+	}
+	lookupTable.swap(table);
+}
+
 QVector<sRGB> cColorGradient::GetGradient(int length, bool smooth)
 {
 	QVector<sRGB> gradient;
@@ -307,6 +329,7 @@ void cColorGradient::SetColorsFromString(const QString &string)
 	QStringList split = string.split(" ");
 	colors.clear();
 	sorted = false;
+	lookupTable.clear();
 
 	if (split.size() < 2)
 	{
@@ -360,11 +383,13 @@ void cColorGradient::DeleteAll()
 	colors.clear();
 	sortedColors.clear();
 	sorted = false;
+	lookupTable.clear();
 }
 
 void cColorGradient::DeleteAndKeepTwo()
 {
 	sorted = false;
+	lookupTable.clear();
 	int numberOfColors = colors.size();
 	for (int index = 2; index < numberOfColors; index++)
 	{
@@ -34,7 +34,10 @@
 
 #ifndef MANDELBULBER2_SRC_COLOR_GRADIENT_H_
 #define MANDELBULBER2_SRC_COLOR_GRADIENT_H_
+#include <vector>
+
 #include <QList>
+#include <QtGlobal>
 
 #include "color_structures.hpp"
 
@@ -72,6 +75,25 @@ public:
 	void DeleteAll();
 	void DeleteAndKeepTwo();
 
+	// bakes gradient into lookup table used by GetColorFloatBaked()
+	void BakeLookupTable(bool smooth);
+
+	// fast sampling of baked gradient (linear interpolation between table entries)
+	sRGBFloat GetColorFloatBaked(float position) const
+	{
+		if (lookupTable.empty()) return GetColorFloat(position, false);
+
+		float pos = qBound(0.0f, position, 1.0f) * lookupTableSegments;
+		int index = qMin(int(pos), lookupTableSegments - 1);
+		float delta = pos - index;
+		const float *color1 = &lookupTable[index * 4];
+		const float *color2 = color1 + 4;
+		float color[4];
+		for (int i = 0; i < 4; i++)
+			color[i] = color1[i] + (color2[i] - color1[i]) * delta;
+		return sRGBFloat(color[0], color[1], color[2]);
+	}
+
 private:
 	int PaletteIterator(int paletteIndex, float position) const;
 	sRGB Interpolate(int paletteIndex, float pos, bool smooth) const;
@@ -81,6 +103,10 @@ private:
 
 	QList<sColor> colors;
 	QList<sColor> sortedColors;
+
+	// rgb + padding for each entry, lookupTableSegments + 1 entries
+	static const int lookupTableSegments = 1024;
+	std::vector<float> lookupTable;
 	bool grayscale;
 	bool sorted;
 };
@@ -57,6 +57,7 @@
 #include "system_data.hpp"
 #include "system_directories.hpp"
 #include "test.hpp"
+#include "trace.hpp"
 #include "write_log.hpp"
 
 cCommandLineInterface::cCommandLineInterface(QCoreApplication *_qApplication)
@@ -152,6 +153,12 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *_qApplication)
 			"main", "Specify custom system log filepath (default is: ~/.mandelbulber_log.txt)."),
 		QCoreApplication::translate("main", "N"));
 
+	const QCommandLineOption traceOption(QStringList({"trace"}),
+		QCoreApplication::translate("main",
+			"Saves timing of render phases to file N in Chrome trace format (chrome://tracing, "
+			"ui.perfetto.dev)."),
+		QCoreApplication::translate("main", "N"));
+
 	const QCommandLineOption queueOption(QStringList({"q", "queue"}),
 		QCoreApplication::translate("main", "Renders all images from common queue."));
 
@@ -164,6 +171,11 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *_qApplication)
 			" parameter difficulty (1 -> very easy, > 20 -> very hard, 10 -> default)."
 			" When [output] option is set to a folder, the example-test images will be stored there."));
 
+	const QCommandLineOption startupBenchmarkOption(QStringList({"benchmark-startup"}),
+		QCoreApplication::translate("main",
+			"Measures time of program initialization phases (until first image could be rendered) and "
+			"exits."));
+
 	const QCommandLineOption gpuOption(QStringList({"g", "gpu"}),
 		QCoreApplication::translate(
 			"main", "Runs the program in opencl mode and selects first available gpu device."));
@@ -180,7 +192,9 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *_qApplication)
 		QCoreApplication::translate("main",
 			"Renders the voxel volume. Output formats are:\n"
 			"  slice - stack of PNG images into one folder (default)\n"
-			"  ply   - Polygon File Format (single 3d file)\n"),
+			"  ply   - Polygon File Format (single 3d file)\n"
+			"  obj   - Wavefront OBJ (single 3d file)\n"
+			"  sparse - narrow band distance volume (single sparse volume file)\n"),
 		QCoreApplication::translate("main", "FORMAT"));
 
 	const QCommandLineOption statsOption(QStringList({"stats"}),
@@ -203,6 +217,7 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *_qApplication)
 	parser.addOption(noguiOption);
 	parser.addOption(outputOption);
 	parser.addOption(logFilepathOption);
+	parser.addOption(traceOption);
 	parser.addOption(keyframeOption);
 	parser.addOption(flightOption);
 	parser.addOption(silentOption);
@@ -219,6 +234,7 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *_qApplication)
 	parser.addOption(queueOption);
 	parser.addOption(testOption);
 	parser.addOption(benchmarkOption);
+	parser.addOption(startupBenchmarkOption);
 	parser.addOption(touchOption);
 	parser.addOption(voxelOption);
 	parser.addOption(overrideOption);
@@ -255,12 +271,14 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *_qApplication)
 	cliData.portText = parser.value(portOption);
 	cliData.outputText = parser.value(outputOption);
 	cliData.logFilepathText = parser.value(logFilepathOption);
+	cliData.traceFileText = parser.value(traceOption);
 	cliData.listParameters = parser.isSet(listOption);
 	cliData.queue = parser.isSet(queueOption);
 	cliData.voxel = parser.isSet(voxelOption);
 	cliData.voxelFormat = parser.value(voxelOption);
 	cliData.test = parser.isSet(testOption);
 	cliData.benchmark = parser.isSet(benchmarkOption);
+	cliData.startupBenchmark = parser.isSet(startupBenchmarkOption);
 	cliData.touch = parser.isSet(touchOption);
 	cliData.gpu = parser.isSet(gpuOption);
 	cliData.gpuAll = parser.isSet(gpuAllOption);
@@ -280,6 +298,7 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *_qApplication)
 	if (cliData.queue) cliData.nogui = true;
 	if (cliData.test) cliData.nogui = true;
 	if (cliData.benchmark) cliData.nogui = true;
+	if (cliData.startupBenchmark) cliData.nogui = true;
 	cliOperationalMode = modeBootOnly;
 }
 
@@ -302,6 +321,12 @@ void cCommandLineInterface::ReadCLI()
 		systemData.SetLogfileName(cliData.logFilepathText);
 	}
 
+	// trace of render phases
+	if (cliData.traceFileText != "")
+	{
+		cTrace::Enable(cliData.traceFileText);
+	}
+
 	// run test cases
 	if (cliData.test) runTestCasesAndExit();
 	// run benchmarks
@@ -638,6 +663,54 @@ void cCommandLineInterface::printParametersAndExit()
 	exit(0);
 }
 
+void cCommandLineInterface::printStartupBenchmarkAndExit(
+	const QList<QPair<QString, qint64>> &startupPhases)
+{
+	QTextStream out(stdout);
+	out << cHeadless::colorize(
+		"\nStartup phases:\n", cHeadless::ansiYellow, cHeadless::noExplicitColor, true);
+
+	qint64 previousTime = 0;
+	for (const auto &phase : startupPhases)
+	{
+		out << QString("%1: %2 ms\n")
+						 .arg(phase.first, -45)
+						 .arg((phase.second - previousTime) / 1.0e6, 0, 'f', 3);
+		previousTime = phase.second;
+	}
+	out << QString("%1: %2 ms\n").arg("total", -45).arg(previousTime / 1.0e6, 0, 'f', 3);
+
+	// cold start: all definitions evaluated for every container (as without shared defaults)
+	// warm: containers initialized from shared default definitions
+	const int repeats = 10;
+	for (int cold = 1; cold >= 0; cold--)
+	{
+		QElapsedTimer timer;
+		timer.start();
+		for (int r = 0; r < repeats; r++)
+		{
+			std::shared_ptr<cParameterContainer> par(new cParameterContainer);
+			std::shared_ptr<cFractalContainer> parFractal(new cFractalContainer);
+			par->SetContainerName("main");
+			cold ? InitParamsWithoutDefaults(par) : InitParams(par);
+			for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+			{
+				parFractal->at(i)->SetContainerName(QString("fractal") + QString::number(i));
+				cold ? InitFractalParamsWithoutDefaults(parFractal->at(i))
+						 : InitFractalParams(parFractal->at(i));
+			}
+		}
+		out << QString("%1: %2 ms\n")
+						 .arg(cold ? "parameter containers, all definitions evaluated"
+											 : "parameter containers from shared defaults",
+							 -45)
+						 .arg(timer.nsecsElapsed() / 1.0e6 / repeats, 0, 'f', 3);
+	}
+
+	out.flush();
+	exit(0);
+}
+
 void cCommandLineInterface::runTestCasesAndExit()
 {
 	systemData.noGui = true;
@@ -645,7 +718,7 @@ void cCommandLineInterface::runTestCasesAndExit()
 	arguments.removeOne(QString("--test"));
 	arguments.removeOne(QString("-t"));
 
-	QStringList outputStrings({"-o", "--output", "--logfilepath"});
+	QStringList outputStrings({"-o", "--output", "--logfilepath", "--trace"});
 	for (int i = 0; i < outputStrings.size(); i++)
 	{
 		const int index = arguments.indexOf(outputStrings[i]);
@@ -721,7 +794,7 @@ void cCommandLineInterface::runBenchmarksAndExit()
 		}
 	}
 
-	QStringList outputStrings({"-o", "--output", "--logfilepath"});
+	QStringList outputStrings({"-o", "--output", "--logfilepath", "--trace"});
 	for (int i = 0; i < outputStrings.size(); i++)
 	{
 		const int index = arguments.indexOf(outputStrings[i]);
@@ -1155,7 +1228,7 @@ void cCommandLineInterface::handleEndFrame()
 
 void cCommandLineInterface::handleVoxel()
 {
-	QStringList allowedVoxelFormat({"ply", "slice"});
+	QStringList allowedVoxelFormat({"ply", "obj", "slice", "sparse"});
 	WriteLogString(
 		"CommandLineInterface::handleVoxel(): cliData.voxelFormat", cliData.voxelFormat, 3);
 	if (!allowedVoxelFormat.contains(cliData.voxelFormat))
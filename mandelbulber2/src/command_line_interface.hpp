@@ -90,6 +90,9 @@ public:
 	void ReadCLI();
 	void ProcessCLI() const;
 	bool isNoGUI() const { return cliData.nogui; }
+	bool isStartupBenchmark() const { return cliData.startupBenchmark; }
+	[[noreturn]] static void printStartupBenchmarkAndExit(
+		const QList<QPair<QString, qint64>> &startupPhases);
 
 private:
 	// ## helper methods for ReadCLI
@@ -133,6 +136,7 @@ private:
 		bool voxel;
 		bool test;
 		bool benchmark;
+		bool startupBenchmark;
 		bool touch;
 		bool gpu;
 		bool gpuAll;
@@ -147,6 +151,7 @@ private:
 		QString outputText;
 		QString voxelFormat;
 		QString logFilepathText;
+		QString traceFileText;
 	} cliData;
 
 	QCommandLineParser parser;
@@ -43,21 +43,18 @@ double DisplacementMap(
 	double oldDistance, CVector3 point, int objectId, sRenderData *data, double reduce)
 {
 	double distance = oldDistance;
-	if (data)
+	if (data && data->ObjectHasFlag(objectId, sRenderData::objectHasDisplacement))
 	{
-		const cMaterial *mat = &data->materials[data->objectData[objectId].materialId];
+		const cMaterial *mat = data->GetObjectMaterial(objectId);
 
-		if (mat->displacementTexture.IsLoaded())
-		{
-			CVector2<float> textureCoordinates;
-			textureCoordinates =
-				TextureMapping(point, CVector3(0.0, 0.0, 1.0), data->objectData[objectId], mat)
-				+ CVector2<float>(0.5f, 0.5f);
-			sRGBFloat bump3 = mat->displacementTexture.Pixel(textureCoordinates);
-			double bump = double(bump3.R);
-			distance -= bump * mat->displacementTextureHeight / reduce;
-			if (distance < 0.0) distance = 0.0;
-		}
+		CVector2<float> textureCoordinates;
+		textureCoordinates =
+			TextureMapping(point, CVector3(0.0, 0.0, 1.0), data->objectData[objectId], mat)
+			+ CVector2<float>(0.5f, 0.5f);
+		sRGBFloat bump3 = mat->displacementTexture.Pixel(textureCoordinates);
+		double bump = double(bump3.R);
+		distance -= bump * mat->displacementTextureHeight / reduce;
+		if (distance < 0.0) distance = 0.0;
 	}
 	return distance;
 }
@@ -69,17 +66,15 @@ CVector3 FractalizeTexture(const CVector3 &point, sRenderData *data, const sPara
 	if (objectId < 0) objectId = 0;
 
 	CVector3 pointFractalized = point;
-	if (data)
+	if (data && data->ObjectHasFlag(objectId, sRenderData::objectFractalize))
 	{
-		const cMaterial *mat = &data->materials[data->objectData[objectId].materialId];
-		if (mat->textureFractalize)
-		{
-			sFractalIn fractIn(point, 0, params.N, &params.common, forcedFormulaIndex, false, mat);
-			sFractalOut fractOut;
-			Compute<fractal::calcModeCubeOrbitTrap>(fractals, fractIn, &fractOut);
-			pointFractalized = fractOut.z;
-			*reduceDisplacement = pow(2.0, fractOut.iters);
-		}
+		const cMaterial *mat = data->GetObjectMaterial(objectId);
+
+		sFractalIn fractIn(point, 0, params.N, &params.common, forcedFormulaIndex, false, mat);
+		sFractalOut fractOut;
+		Compute<fractal::calcModeCubeOrbitTrap>(fractals, fractIn, &fractOut);
+		pointFractalized = fractOut.z;
+		*reduceDisplacement = pow(2.0, fractOut.iters);
 	}
 	return pointFractalized;
 }
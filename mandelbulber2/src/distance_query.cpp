@@ -0,0 +1,222 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDistanceQuery - calculates distances to the fractal surface for sets of points.
+ * Parameters prepared for distance estimation are cached and reused as long as
+ * revisions of the parameter containers don't change.
+ */
+
+#include "distance_query.hpp"
+
+#include "calculate_distance.hpp"
+#include "fractal_container.hpp"
+#include "fractparams.hpp"
+#include "nine_fractals.hpp"
+#include "opencl_engine_render_fractal.h"
+#include "opencl_global.h"
+#include "parameters.hpp"
+#include "write_log.hpp"
+
+cDistanceQuery gDistanceQuery;
+
+cDistanceQuery::cDistanceQuery() = default;
+
+cDistanceQuery::~cDistanceQuery() = default;
+
+double cDistanceQuery::Distance(CVector3 point, std::shared_ptr<cParameterContainer> par,
+	std::shared_ptr<cFractalContainer> parFractal)
+{
+	QVector<double> distances = Distances(QVector<CVector3>({point}), par, parFractal);
+	return distances.isEmpty() ? 0.0 : distances.first();
+}
+
+QVector<double> cDistanceQuery::Distances(const QVector<CVector3> &points,
+	std::shared_ptr<cParameterContainer> par, std::shared_ptr<cFractalContainer> parFractal)
+{
+	if (points.isEmpty()) return QVector<double>();
+
+	std::shared_ptr<sPreparedParams> prepared = GetPreparedParams(par, parFractal);
+
+	if (prepared->openClEnabled)
+		return DistancesOpenCl(points, prepared, par, parFractal);
+	else
+		return DistancesCpu(points, prepared);
+}
+
+void cDistanceQuery::Clear()
+{
+	QMutexLocker lock(&cacheMutex);
+	cache.clear();
+}
+
+void cDistanceQuery::BeginSession()
+{
+	sessionActive = true;
+}
+
+void cDistanceQuery::EndSession()
+{
+	sessionActive = false;
+	ReleaseOpenClEngine();
+}
+
+void cDistanceQuery::ReleaseOpenClEngine()
+{
+#ifdef USE_OPENCL
+	if (engineLocked)
+	{
+		gOpenCl->openClEngineRenderFractal->ReleaseMemory();
+		gOpenCl->openClEngineRenderFractal->Unlock();
+		engineLocked = false;
+	}
+#endif
+	engineParams.reset();
+}
+
+QVector<quint64> cDistanceQuery::GetRevisions(std::shared_ptr<const cParameterContainer> par,
+	std::shared_ptr<const cFractalContainer> parFractal)
+{
+	QVector<quint64> revisions;
+	revisions.reserve(NUMBER_OF_FRACTALS + 1);
+	revisions.append(par->GetRevision());
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+	{
+		revisions.append(parFractal->at(i)->GetRevision());
+	}
+	return revisions;
+}
+
+std::shared_ptr<cDistanceQuery::sPreparedParams> cDistanceQuery::GetPreparedParams(
+	std::shared_ptr<cParameterContainer> par, std::shared_ptr<cFractalContainer> parFractal)
+{
+	QVector<quint64> revisions = GetRevisions(par, parFractal);
+
+	QMutexLocker lock(&cacheMutex);
+
+	for (int i = 0; i < cache.size(); i++)
+	{
+		if (cache[i]->revisions == revisions)
+		{
+			if (i > 0) cache.move(i, 0);
+			return cache.first();
+		}
+	}
+
+	WriteLog("cDistanceQuery: preparing parameters for distance calculation", 3);
+
+	std::shared_ptr<sPreparedParams> prepared(new sPreparedParams);
+	prepared->revisions = revisions;
+	prepared->params.reset(new sParamRender(par));
+	prepared->fractals.reset(new cNineFractals(parFractal, par));
+#ifdef USE_OPENCL
+	prepared->openClEnabled = par->Get<bool>("opencl_enabled") && parFractal->isUsedCustomFormula();
+#endif
+
+	cache.prepend(prepared);
+	while (cache.size() > maxCachedParams)
+		cache.removeLast();
+
+	return prepared;
+}
+
+QVector<double> cDistanceQuery::DistancesCpu(
+	const QVector<CVector3> &points, std::shared_ptr<const sPreparedParams> prepared)
+{
+	QVector<double> distances(points.size());
+	const sParamRender &params = *prepared->params;
+	const cNineFractals &fractals = *prepared->fractals;
+
+	// single point is calculated in calling thread (it's the most common case)
+#pragma omp parallel for schedule(dynamic, 1) if (points.size() > 1)
+	for (int i = 0; i < points.size(); i++)
+	{
+		sDistanceIn in(points[i], 0, false);
+		sDistanceOut out;
+		distances[i] = CalculateDistance(params, fractals, in, &out);
+	}
+
+	return distances;
+}
+
+QVector<double> cDistanceQuery::DistancesOpenCl(const QVector<CVector3> &points,
+	std::shared_ptr<const sPreparedParams> prepared, std::shared_ptr<cParameterContainer> par,
+	std::shared_ptr<cFractalContainer> parFractal)
+{
+	QVector<double> distances(points.size(), 0.0);
+
+#ifdef USE_OPENCL
+	// OpenCL engine is shared with rendering, so it is set up once for the whole batch of points,
+	// or once for the whole session if parameters don't change
+	if (engineParams != prepared)
+	{
+		if (engineLocked)
+		{
+			gOpenCl->openClEngineRenderFractal->ReleaseMemory();
+		}
+		else
+		{
+			gOpenCl->openClEngineRenderFractal->Lock();
+			engineLocked = true;
+		}
+		engineParams.reset();
+
+		gOpenCl->openClEngineRenderFractal->SetDistanceMode();
+		gOpenCl->openClEngineRenderFractal->SetParameters(
+			par, parFractal, prepared->params, prepared->fractals, nullptr, false);
+		if (!gOpenCl->openClEngineRenderFractal->LoadSourcesAndCompile(par))
+		{
+			WriteLog("cDistanceQuery: OpenCL program cannot be compiled", 1);
+			ReleaseOpenClEngine();
+			return QVector<double>();
+		}
+		gOpenCl->openClEngineRenderFractal->CreateKernel4Program(par);
+		gOpenCl->openClEngineRenderFractal->PreAllocateBuffers(par);
+		gOpenCl->openClEngineRenderFractal->CreateCommandQueue();
+		engineParams = prepared;
+	}
+
+	// all points of the batch are calculated in as few kernel launches as possible
+	if (!gOpenCl->openClEngineRenderFractal->CalculateDistances(points, &distances))
+	{
+		WriteLog("cDistanceQuery: OpenCL distance calculation failed", 1);
+		ReleaseOpenClEngine();
+		return QVector<double>();
+	}
+
+	if (!sessionActive) ReleaseOpenClEngine();
+#else
+	Q_UNUSED(prepared);
+	Q_UNUSED(par);
+	Q_UNUSED(parFractal);
+#endif
+
+	return distances;
+}
@@ -0,0 +1,106 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDistanceQuery - calculates distances to the fractal surface for sets of points.
+ * Parameters prepared for distance estimation are cached and reused as long as
+ * revisions of the parameter containers don't change.
+ */
+
+#ifndef MANDELBULBER2_SRC_DISTANCE_QUERY_HPP_
+#define MANDELBULBER2_SRC_DISTANCE_QUERY_HPP_
+
+#include <memory>
+
+#include <QList>
+#include <QMutex>
+#include <QVector>
+
+#include "algebra.hpp"
+
+class cParameterContainer;
+class cFractalContainer;
+class cNineFractals;
+struct sParamRender;
+
+class cDistanceQuery
+{
+public:
+	cDistanceQuery();
+	~cDistanceQuery();
+
+	double Distance(CVector3 point, std::shared_ptr<cParameterContainer> par,
+		std::shared_ptr<cFractalContainer> parFractal);
+	// distances for all points, calculated with single preparation of parameters. Returns empty
+	// vector if distances cannot be calculated (OpenCL program not compiled)
+	QVector<double> Distances(const QVector<CVector3> &points,
+		std::shared_ptr<cParameterContainer> par, std::shared_ptr<cFractalContainer> parFractal);
+	void Clear();
+
+	// between BeginSession() and EndSession() the OpenCL engine stays locked and prepared for the
+	// last used parameters, so series of Distances() calls (e.g. iterative scans) is not set up
+	// again for every call. Has to be used from single thread
+	void BeginSession();
+	void EndSession();
+
+private:
+	struct sPreparedParams
+	{
+		QVector<quint64> revisions;
+		std::shared_ptr<sParamRender> params;
+		std::shared_ptr<cNineFractals> fractals;
+		bool openClEnabled = false;
+	};
+
+	static QVector<quint64> GetRevisions(std::shared_ptr<const cParameterContainer> par,
+		std::shared_ptr<const cFractalContainer> parFractal);
+	std::shared_ptr<sPreparedParams> GetPreparedParams(
+		std::shared_ptr<cParameterContainer> par, std::shared_ptr<cFractalContainer> parFractal);
+	QVector<double> DistancesCpu(
+		const QVector<CVector3> &points, std::shared_ptr<const sPreparedParams> prepared);
+	QVector<double> DistancesOpenCl(const QVector<CVector3> &points,
+		std::shared_ptr<const sPreparedParams> prepared, std::shared_ptr<cParameterContainer> par,
+		std::shared_ptr<cFractalContainer> parFractal);
+	void ReleaseOpenClEngine();
+
+	// most recently used parameters are at the beginning
+	QList<std::shared_ptr<sPreparedParams>> cache;
+	QMutex cacheMutex;
+	static const int maxCachedParams = 4;
+
+	bool sessionActive = false;
+	bool engineLocked = false;
+	// parameters for which OpenCL engine is prepared during the session
+	std::shared_ptr<const sPreparedParams> engineParams;
+};
+
+extern cDistanceQuery gDistanceQuery;
+
+#endif /* MANDELBULBER2_SRC_DISTANCE_QUERY_HPP_ */
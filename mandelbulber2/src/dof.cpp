@@ -195,7 +195,6 @@ void cPostRenderingDOF::Render(cRegion<int> screenRegion, float deep, float neut
 		image->CompileImage();
 		if (image->IsPreview())
 		{
-			image->ConvertTo8bitChar();
 			image->UpdatePreview();
 			emit updateImage();
 		}
@@ -341,7 +340,6 @@ void cPostRenderingDOF::Render(cRegion<int> screenRegion, float deep, float neut
 					timerRefresh.restart();
 
 					image->CompileImage();
-					image->ConvertTo8bitChar();
 					image->UpdatePreview();
 					emit updateImage();
 
@@ -46,6 +46,7 @@
 #include <ImfHeader.h>
 #include <ImfOutputFile.h>
 #include <ImfStringAttribute.h>
+#include <ImfThreading.h>
 #include <half.h>
 #endif // USE_EXR
 //#include <libpng16/pngconf.h>
@@ -59,13 +60,19 @@
 #include <QMap>
 #include <QStringList>
 #include <QVector>
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <zlib.h>
 #include "common_math.h"
 #include "cimage.hpp"
 #include "error_message.hpp"
 #include "files.h"
 #include "initparameters.hpp"
+#include "parallel_deflate.hpp"
 #include "parameters.hpp"
+#include "system.hpp"
+#include "trace.hpp"
 #include "write_log.hpp"
 // custom includes
 #ifdef USE_TIFF
@@ -239,6 +246,7 @@ QString ImageFileSave::CreateFullFileNameAndMakeDir(const QString &filename,
 
 QStringList ImageFileSavePNG::SaveImage()
 {
+	cScopedTrace trace("PNG saving", "file");
 	updateProgressAndStatusStarted();
 
 	QStringList listOfSavedFiles;
@@ -303,6 +311,7 @@ QStringList ImageFileSavePNG::SaveImage()
 
 QStringList ImageFileSaveJPG::SaveImage()
 {
+	cScopedTrace trace("JPG saving", "file");
 	updateProgressAndStatusStarted();
 
 	QStringList listOfSavedFiles;
@@ -413,6 +422,7 @@ QStringList ImageFileSaveJPG::SaveImage()
 #ifdef USE_TIFF
 QStringList ImageFileSaveTIFF::SaveImage()
 {
+	cScopedTrace trace("TIFF saving", "file");
 	updateProgressAndStatusStarted();
 
 	QStringList listOfSavedFiles;
@@ -464,6 +474,7 @@ QStringList ImageFileSaveTIFF::SaveImage()
 #ifdef USE_EXR
 QStringList ImageFileSaveEXR::SaveImage()
 {
+	cScopedTrace trace("EXR saving", "file");
 	updateProgressAndStatusStarted();
 
 	QStringList listOfSavedFiles;
@@ -478,6 +489,74 @@ QStringList ImageFileSaveEXR::SaveImage()
 }
 #endif /* USE_EXR */
 
+// adaptive PNG row filtering (filter with minimal sum of absolute differences, like in libpng).
+// 16-bit samples are swapped to big endian order. Rows are filtered in parallel
+static void FilterPngRows(const std::vector<png_bytep> &rows, uint64_t rowBytes,
+	uint64_t bytesPerPixel, bool swap16, std::vector<unsigned char> *filtered)
+{
+	const uint64_t height = rows.size();
+	const uint64_t stride = rowBytes + 1;
+	filtered->resize(height * stride);
+
+#pragma omp parallel
+	{
+		std::vector<unsigned char> current(rowBytes);
+		std::vector<unsigned char> previous(rowBytes);
+		std::vector<unsigned char> candidate(rowBytes);
+
+#pragma omp for schedule(dynamic, 16)
+		for (int64_t y = 0; y < int64_t(height); y++)
+		{
+			const uint64_t swapMask = swap16 ? 1 : 0;
+			for (uint64_t i = 0; i < rowBytes; i++)
+			{
+				current[i] = rows[y][i ^ swapMask];
+				previous[i] = (y > 0) ? rows[y - 1][i ^ swapMask] : 0;
+			}
+
+			unsigned char *outRow = &(*filtered)[y * stride];
+			uint64_t bestSum = UINT64_MAX;
+			for (int filterType = PNG_FILTER_VALUE_NONE; filterType <= PNG_FILTER_VALUE_PAETH;
+					 filterType++)
+			{
+				uint64_t sum = 0;
+				for (uint64_t i = 0; i < rowBytes; i++)
+				{
+					const int a = (i >= bytesPerPixel) ? current[i - bytesPerPixel] : 0;
+					const int b = previous[i];
+					const int c = (i >= bytesPerPixel) ? previous[i - bytesPerPixel] : 0;
+					int predictor = 0;
+					switch (filterType)
+					{
+						case PNG_FILTER_VALUE_SUB: predictor = a; break;
+						case PNG_FILTER_VALUE_UP: predictor = b; break;
+						case PNG_FILTER_VALUE_AVG: predictor = (a + b) / 2; break;
+						case PNG_FILTER_VALUE_PAETH:
+						{
+							const int p = a + b - c;
+							const int pa = abs(p - a);
+							const int pb = abs(p - b);
+							const int pc = abs(p - c);
+							predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+							break;
+						}
+						default: break;
+					}
+					const unsigned char value = static_cast<unsigned char>(current[i] - predictor);
+					candidate[i] = value;
+					sum += uint64_t(abs(int(static_cast<signed char>(value))));
+				}
+				if (sum < bestSum)
+				{
+					bestSum = sum;
+					outRow[0] = static_cast<unsigned char>(filterType);
+					std::copy(candidate.begin(), candidate.end(), outRow + 1);
+				}
+			}
+		}
+	}
+}
+
 void ImageFileSavePNG::SavePNG(QString filenameInput, std::shared_ptr<cImage> image,
 	structSaveImageChannel imageChannel, bool appendAlpha)
 {
@@ -547,7 +626,6 @@ void ImageFileSavePNG::SavePNG(QString filenameInput, std::shared_ptr<cImage> im
 			PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
 		png_write_info(png_ptr, info_ptr);
-		png_set_swap(png_ptr);
 
 		/* write bytes */
 		if (setjmp(png_jmpbuf(png_ptr))) throw QString("[write_png_file] Error during writing bytes");
@@ -657,8 +735,17 @@ void ImageFileSavePNG::SavePNG(QString filenameInput, std::shared_ptr<cImage> im
 			bool zLogarithmicScale = gPar->Get<bool>("zbuffer_logarithmic");
 			bool invertZ = gPar->Get<bool>("zbuffer_invert");
 
-			for (uint64_t y = 0; y < height; y++)
+			if (imageChannel.contentType == IMAGE_CONTENT_COLOR
+					&& imageChannel.channelQuality != IMAGE_CHANNEL_QUALITY_16 && appendAlpha)
 			{
+				image->ConvertAlphaTo8bit();
+				image->ConvertTo8bitChar();
+			}
+
+#pragma omp parallel for schedule(dynamic, 16)
+			for (int64_t yy = 0; yy < int64_t(height); yy++)
+			{
+				const uint64_t y = uint64_t(yy);
 				for (uint64_t x = 0; x < width; x++)
 				{
 					uint64_t ptr = (x + y * width) * pixelSize;
@@ -679,11 +766,6 @@ void ImageFileSavePNG::SavePNG(QString filenameInput, std::shared_ptr<cImage> im
 							{
 								if (appendAlpha)
 								{
-									if (x == 0 && y == 0)
-									{
-										image->ConvertAlphaTo8bit();
-										image->ConvertTo8bitChar();
-									}
 									sRGBA8 *typedColorPtr = reinterpret_cast<sRGBA8 *>(&colorPtr[ptr]);
 									*typedColorPtr = sRGBA8(image->GetPixelImage8(x, y));
 									typedColorPtr->A = image->GetPixelAlpha8(x, y);
@@ -774,18 +856,27 @@ void ImageFileSavePNG::SavePNG(QString filenameInput, std::shared_ptr<cImage> im
 			}
 		}
 
-		// png_write_image(png_ptr, row_pointers);
-		for (uint64_t r = 0; r < height; r += SAVE_CHUNK_SIZE)
+		// rows are filtered and compressed on all cores, so IDAT chunks are written directly
+		// instead of png_write_rows()
+		std::vector<unsigned char> filteredRows;
+		FilterPngRows(row_pointers, width * pixelSize, pixelSize, qualitySizeByte == 2, &filteredRows);
+
+		std::vector<unsigned char> compressedRows;
+		if (!ZlibCompressParallel(filteredRows.data(), filteredRows.size(), Z_DEFAULT_COMPRESSION,
+					&compressedRows, [this](double progress) { updateProgressAndStatusChannel(progress); }))
+			throw QString("[write_png_file] Error during compression");
+
+		const size_t idatChunkSize = 1024 * 1024;
+		for (size_t offset = 0; offset < compressedRows.size(); offset += idatChunkSize)
 		{
-			uint64_t currentChunkSize = std::min(height - r, SAVE_CHUNK_SIZE);
-			png_write_rows(png_ptr, png_bytepp(&row_pointers[r]), currentChunkSize);
-			updateProgressAndStatusChannel(1.0 * r / height);
+			png_write_chunk(png_ptr, png_const_bytep("IDAT"), &compressedRows[offset],
+				std::min(idatChunkSize, compressedRows.size() - offset));
 		}
 
 		/* end write */
 		if (setjmp(png_jmpbuf(png_ptr))) throw QString("[write_png_file] Error during end of write");
 
-		png_write_end(png_ptr, info_ptr);
+		png_write_chunk(png_ptr, png_const_bytep("IEND"), nullptr, 0);
 		png_destroy_write_struct(&png_ptr, &info_ptr);
 
 		fclose(fp);
@@ -1254,7 +1345,8 @@ void ImageFileSaveEXR::SaveEXR(QString filename, std::shared_ptr<cImage> image,
 
 	Imf::Header header(width, height);
 	Imf::FrameBuffer frameBuffer;
-	std::vector<char> buffer;
+	// every channel needs own buffer which is valid until all pixels are written
+	std::list<std::vector<char>> channelBuffers;
 
 	// compress each scan line on its own. This gives a good compression / read performance tradeoff
 	header.compression() = Imf::ZIPS_COMPRESSION;
@@ -1274,12 +1366,15 @@ void ImageFileSaveEXR::SaveEXR(QString filename, std::shared_ptr<cImage> image,
 
 		uint64_t pixelSize = sizeof(tsRGB<half>);
 		if (imfQuality == Imf::FLOAT) pixelSize = sizeof(tsRGB<float>);
-		buffer.resize(uint64_t(width) * height * pixelSize);
+		channelBuffers.emplace_back(uint64_t(width) * height * pixelSize);
+		std::vector<char> &buffer = channelBuffers.back();
 		tsRGB<half> *halfPointer = reinterpret_cast<tsRGB<half> *>(buffer.data());
 		tsRGB<float> *floatPointer = reinterpret_cast<tsRGB<float> *>(buffer.data());
 
-		for (uint64_t y = 0; y < height; y++)
+#pragma omp parallel for schedule(dynamic, 16)
+		for (int64_t yy = 0; yy < int64_t(height); yy++)
 		{
+			const uint64_t y = uint64_t(yy);
 			for (uint64_t x = 0; x < width; x++)
 			{
 				uint64_t ptr = x + y * width;
@@ -1324,12 +1419,15 @@ void ImageFileSaveEXR::SaveEXR(QString filename, std::shared_ptr<cImage> image,
 
 		uint64_t pixelSize = sizeof(half);
 		if (imfQuality == Imf::FLOAT) pixelSize = sizeof(float);
-		buffer.resize(uint64_t(width) * height * pixelSize);
+		channelBuffers.emplace_back(uint64_t(width) * height * pixelSize);
+		std::vector<char> &buffer = channelBuffers.back();
 		half *halfPointer = reinterpret_cast<half *>(buffer.data());
 		float *floatPointer = reinterpret_cast<float *>(buffer.data());
 
-		for (uint64_t y = 0; y < height; y++)
+#pragma omp parallel for schedule(dynamic, 16)
+		for (int64_t yy = 0; yy < int64_t(height); yy++)
 		{
+			const uint64_t y = uint64_t(yy);
 			for (uint64_t x = 0; x < width; x++)
 			{
 				uint64_t ptr = x + y * width;
@@ -1370,11 +1468,14 @@ void ImageFileSaveEXR::SaveEXR(QString filename, std::shared_ptr<cImage> image,
 		else
 		{
 			uint64_t pixelSize = sizeof(half);
-			buffer.resize(uint64_t(width) * height * pixelSize);
+			channelBuffers.emplace_back(uint64_t(width) * height * pixelSize);
+			std::vector<char> &buffer = channelBuffers.back();
 			half *halfPointer = reinterpret_cast<half *>(buffer.data());
 
-			for (uint64_t y = 0; y < height; y++)
+#pragma omp parallel for schedule(dynamic, 16)
+			for (int64_t yy = 0; yy < int64_t(height); yy++)
 			{
+				const uint64_t y = uint64_t(yy);
 				for (uint64_t x = 0; x < width; x++)
 				{
 					uint64_t ptr = x + y * width;
@@ -1389,49 +1490,50 @@ void ImageFileSaveEXR::SaveEXR(QString filename, std::shared_ptr<cImage> image,
 	if (imageConfig.contains(IMAGE_CONTENT_NORMAL))
 	{
 		SaveExrRgbChannel(QStringList{"n.X", "n.Y", "n.Z"}, imageConfig[IMAGE_CONTENT_NORMAL], &header,
-			&frameBuffer, width, height);
+			&frameBuffer, width, height, &channelBuffers);
 	}
 
 	if (imageConfig.contains(IMAGE_CONTENT_NORMAL_WORLD))
 	{
 		SaveExrRgbChannel(QStringList{"nW.X", "nW.Y", "nW.Z"}, imageConfig[IMAGE_CONTENT_NORMAL_WORLD],
-			&header, &frameBuffer, width, height);
+			&header, &frameBuffer, width, height, &channelBuffers);
 	}
 
 	if (imageConfig.contains(IMAGE_CONTENT_SPECULAR))
 	{
 		SaveExrRgbChannel(QStringList{"s.X", "s.Y", "s.Z"}, imageConfig[IMAGE_CONTENT_SPECULAR],
-			&header, &frameBuffer, width, height);
+			&header, &frameBuffer, width, height, &channelBuffers);
 	}
 
 	if (imageConfig.contains(IMAGE_CONTENT_DIFFUSE))
 	{
 		SaveExrRgbChannel(QStringList{"d.R", "d.G", "d.B"}, imageConfig[IMAGE_CONTENT_DIFFUSE], &header,
-			&frameBuffer, width, height);
+			&frameBuffer, width, height, &channelBuffers);
 	}
 
 	if (imageConfig.contains(IMAGE_CONTENT_WORLD_POSITION))
 	{
 		SaveExrRgbChannel(QStringList{"p.X", "p.Y", "p.Z"}, imageConfig[IMAGE_CONTENT_WORLD_POSITION],
-			&header, &frameBuffer, width, height);
+			&header, &frameBuffer, width, height, &channelBuffers);
 	}
 
 	if (imageConfig.contains(IMAGE_CONTENT_SHADOWS))
 	{
 		SaveExrRgbChannel(QStringList{"p.X", "p.Y", "p.Z"}, imageConfig[IMAGE_CONTENT_SHADOWS], &header,
-			&frameBuffer, width, height);
+			&frameBuffer, width, height, &channelBuffers);
 	}
 
 	if (imageConfig.contains(IMAGE_CONTENT_GLOBAL_ILLUMINATION))
 	{
 		SaveExrRgbChannel(QStringList{"p.X", "p.Y", "p.Z"},
-			imageConfig[IMAGE_CONTENT_GLOBAL_ILLUMINATION], &header, &frameBuffer, width, height);
+			imageConfig[IMAGE_CONTENT_GLOBAL_ILLUMINATION], &header, &frameBuffer, width, height,
+			&channelBuffers);
 	}
 
 	if (imageConfig.contains(IMAGE_CONTENT_NOT_DENOISED))
 	{
 		SaveExrRgbChannel(QStringList{"p.X", "p.Y", "p.Z"}, imageConfig[IMAGE_CONTENT_NOT_DENOISED],
-			&header, &frameBuffer, width, height);
+			&header, &frameBuffer, width, height, &channelBuffers);
 	}
 
 	// insert meta data
@@ -1443,6 +1545,9 @@ void ImageFileSaveEXR::SaveEXR(QString filename, std::shared_ptr<cImage> image,
 			i.key().toStdString().c_str(), Imf::StringAttribute(i.value().toStdString().c_str()));
 	}
 
+	// scan line blocks are compressed by OpenEXR thread pool
+	Imf::setGlobalThreadCount(get_cpu_count());
+
 	Imf::OutputFile file(filename.toStdString().c_str(), header);
 	file.setFrameBuffer(frameBuffer);
 
@@ -1455,7 +1560,8 @@ void ImageFileSaveEXR::SaveEXR(QString filename, std::shared_ptr<cImage> image,
 }
 
 void ImageFileSaveEXR::SaveExrRgbChannel(QStringList names, structSaveImageChannel imageChannel,
-	Imf::Header *header, Imf::FrameBuffer *frameBuffer, uint64_t width, uint64_t height)
+	Imf::Header *header, Imf::FrameBuffer *frameBuffer, uint64_t width, uint64_t height,
+	std::list<std::vector<char>> *channelBuffers)
 {
 	bool linear = gPar->Get<bool>("linear_colorspace");
 	// add rgb channel header
@@ -1471,12 +1577,15 @@ void ImageFileSaveEXR::SaveExrRgbChannel(QStringList names, structSaveImageChann
 
 	int pixelSize = sizeof(tsRGB<half>);
 	if (imfQuality == Imf::FLOAT) pixelSize = sizeof(tsRGB<float>);
-	std::vector<char> buffer(uint64_t(width) * height * pixelSize);
+	channelBuffers->emplace_back(uint64_t(width) * height * pixelSize);
+	std::vector<char> &buffer = channelBuffers->back();
 	tsRGB<half> *halfPointer = reinterpret_cast<tsRGB<half> *>(buffer.data());
 	tsRGB<float> *floatPointer = reinterpret_cast<tsRGB<float> *>(buffer.data());
 
-	for (uint64_t y = 0; y < height; y++)
+#pragma omp parallel for schedule(dynamic, 16)
+	for (int64_t yy = 0; yy < int64_t(height); yy++)
 	{
+		const uint64_t y = uint64_t(yy);
 		for (uint64_t x = 0; x < width; x++)
 		{
 			uint64_t ptr = (x + y * width);
@@ -1636,8 +1745,24 @@ bool ImageFileSaveTIFF::SaveTIFF(QString filenameInput, std::shared_ptr<cImage>
 	bool invertZ = gPar->Get<bool>("zbuffer_invert");
 	float kZ = log(maxZ / minZ);
 
-	for (uint64_t y = 0; y < height; y++)
+	// 8-bit buffers are prepared before parallel conversion
+	if (imageChannel.contentType == IMAGE_CONTENT_COLOR
+			&& imageChannel.channelQuality != IMAGE_CHANNEL_QUALITY_32
+			&& imageChannel.channelQuality != IMAGE_CHANNEL_QUALITY_16)
+	{
+		if (appendAlpha) image->ConvertAlphaTo8bit();
+		image->ConvertTo8bitChar();
+	}
+	if (imageChannel.contentType == IMAGE_CONTENT_ALPHA
+			&& imageChannel.channelQuality != IMAGE_CHANNEL_QUALITY_16)
+	{
+		image->ConvertAlphaTo8bit();
+	}
+
+#pragma omp parallel for schedule(dynamic, 16)
+	for (int64_t yy = 0; yy < int64_t(height); yy++)
 	{
+		const uint64_t y = uint64_t(yy);
 		for (uint64_t x = 0; x < width; x++)
 		{
 			uint64_t ptr = (x + y * width) * pixelSize;
@@ -1683,21 +1808,12 @@ bool ImageFileSaveTIFF::SaveTIFF(QString filenameInput, std::shared_ptr<cImage>
 					{
 						if (appendAlpha)
 						{
-							if (x == 0 && y == 0)
-							{
-								image->ConvertAlphaTo8bit();
-								image->ConvertTo8bitChar();
-							}
 							sRGBA8 *typedColorPtr = reinterpret_cast<sRGBA8 *>(&colorPtr[ptr]);
 							*typedColorPtr = sRGBA8(image->GetPixelImage8(x, y));
 							typedColorPtr->A = image->GetPixelAlpha8(x, y);
 						}
 						else
 						{
-							if (x == 0 && y == 0)
-							{
-								image->ConvertTo8bitChar();
-							}
 							sRGB8 *typedColorPtr = reinterpret_cast<sRGB8 *>(&colorPtr[ptr]);
 							*typedColorPtr = sRGB8(image->GetPixelImage8(x, y));
 						}
@@ -1718,10 +1834,6 @@ bool ImageFileSaveTIFF::SaveTIFF(QString filenameInput, std::shared_ptr<cImage>
 					}
 					else
 					{
-						if (x == 0 && y == 0)
-						{
-							image->ConvertAlphaTo8bit();
-						}
 						unsigned char *typedColorPtr = reinterpret_cast<unsigned char *>(&colorPtr[ptr]);
 						*typedColorPtr = image->GetPixelAlpha8(x, y);
 					}
@@ -1808,20 +1920,46 @@ bool ImageFileSaveTIFF::SaveTIFF(QString filenameInput, std::shared_ptr<cImage>
 		}
 	}
 
-	// TIFFWriteEncodedStrip(
-	//	tiff, 0, static_cast<void *>(colorPtr), tsize_t(width * height * pixelSize));
-	for (uint64_t r = 0; r < height; r += SAVE_CHUNK_SIZE)
+	// strips are deflated in parallel (batch of strips per core) and written as raw strips
+	const uint64_t numberOfStrips = (height + SAVE_CHUNK_SIZE - 1) / SAVE_CHUNK_SIZE;
+	const uint64_t stripsInBatch = uint64_t(std::max(1, get_cpu_count()));
+	std::vector<std::vector<unsigned char>> compressedStrips(stripsInBatch);
+	std::vector<char> stripResults(stripsInBatch);
+	bool result = true;
+
+	for (uint64_t batchStart = 0; batchStart < numberOfStrips && result; batchStart += stripsInBatch)
 	{
-		uint64_t currentChunkSize = std::min(height - r, SAVE_CHUNK_SIZE);
-		// needs buffer with offset position
-		char *buf = static_cast<char *>(colorPtr.data()) + r * pixelSize * width;
-		tsize_t size = tsize_t(currentChunkSize * pixelSize * width);
-		TIFFWriteEncodedStrip(tiff, r / SAVE_CHUNK_SIZE, buf, size);
-		updateProgressAndStatusChannel(1.0 * r / height);
+		const uint64_t batchSize = std::min(stripsInBatch, numberOfStrips - batchStart);
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int64_t i = 0; i < int64_t(batchSize); i++)
+		{
+			const uint64_t r = (batchStart + i) * SAVE_CHUNK_SIZE;
+			const uint64_t currentChunkSize = std::min(height - r, SAVE_CHUNK_SIZE);
+			// needs buffer with offset position
+			const unsigned char *buf =
+				reinterpret_cast<const unsigned char *>(colorPtr.data()) + r * pixelSize * width;
+			stripResults[i] = DeflateStrip(buf, currentChunkSize * pixelSize * width,
+				Z_DEFAULT_COMPRESSION, nullptr, 0, true, false, &compressedStrips[i]);
+		}
+
+		for (uint64_t i = 0; i < batchSize; i++)
+		{
+			if (!stripResults[i]
+					|| TIFFWriteRawStrip(tiff, uint32_t(batchStart + i), compressedStrips[i].data(),
+							 tsize_t(compressedStrips[i].size()))
+							 < 0)
+			{
+				qCritical() << "SaveTiff() cannot write strip";
+				result = false;
+				break;
+			}
+		}
+		updateProgressAndStatusChannel(1.0 * (batchStart + batchSize) / numberOfStrips);
 	}
 	TIFFClose(tiff);
 
-	return true;
+	return result;
 }
 
 void ImageFileSaveTIFF::SaveTiffRgbPixel(
@@ -39,8 +39,10 @@
 #ifndef MANDELBULBER2_SRC_FILE_IMAGE_HPP_
 #define MANDELBULBER2_SRC_FILE_IMAGE_HPP_
 
+#include <list>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include <QMap>
 #include <QObject>
@@ -251,7 +253,8 @@ public:
 	void SaveEXR(QString filename, std::shared_ptr<cImage> image,
 		QMap<enumImageContentType, structSaveImageChannel> imageConfig);
 	void SaveExrRgbChannel(QStringList names, structSaveImageChannel imageChannel,
-		Imf::Header *header, Imf::FrameBuffer *frameBuffer, uint64_t width, uint64_t height);
+		Imf::Header *header, Imf::FrameBuffer *frameBuffer, uint64_t width, uint64_t height,
+		std::list<std::vector<char>> *channelBuffers);
 };
 #endif /* USE_EXR */
 
@@ -31,35 +31,48 @@
  *
  * file mesh class to store different mesh file formats
  *
- * Each mesh file type derives MeshFileSave and implements the SaveMesh
- * method to store the mesh data with the corresponding file format
+ * Each mesh file type derives MeshFileSave and implements the streaming
+ * methods to store the mesh data with the corresponding file format
  */
 
 #include "file_mesh.hpp"
 
+#include <climits>
+#include <cmath>
+#include <cstring>
+
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
 
+#include "common_math.h"
 #include "error_message.hpp"
 #include "files.h"
 #include "initparameters.hpp"
 #include "parameters.hpp"
 
-MeshFileSave::MeshFileSave(
-	QString filename, structSaveMeshConfig meshConfig, structSaveMeshData meshData)
+MeshFileSave::MeshFileSave(QString filename, structSaveMeshConfig meshConfig)
 {
 	this->filename = filename;
 	this->meshConfig = meshConfig;
-	this->meshData = meshData;
+	withColor = meshConfig.contentTypes.contains(MESH_CONTENT_COLOR);
+	quantized = meshConfig.precisionType == MESH_PRECISION_INT16;
+	vertexCount = 0;
+	polygonCount = 0;
+
+	// positions are mapped from the export box to [-32767, 32767] with uniform scale
+	quantizationOffset = (meshConfig.limitMin + meshConfig.limitMax) * 0.5;
+	CVector3 halfSize = (meshConfig.limitMax - meshConfig.limitMin) * 0.5;
+	double maxHalfSize = dMax(halfSize.x, halfSize.y, halfSize.z);
+	quantizationScale = (maxHalfSize > 0.0) ? 32767.0 / maxHalfSize : 1.0;
 }
 
-MeshFileSave *MeshFileSave::create(
-	QString filename, structSaveMeshConfig meshConfig, structSaveMeshData meshData)
+MeshFileSave *MeshFileSave::create(QString filename, structSaveMeshConfig meshConfig)
 {
 	switch (meshConfig.fileType)
 	{
-		case MESH_FILE_TYPE_PLY: return new MeshFileSavePLY(filename, meshConfig, meshData);
+		case MESH_FILE_TYPE_PLY: return new MeshFileSavePLY(filename, meshConfig);
+		case MESH_FILE_TYPE_OBJ: return new MeshFileSaveOBJ(filename, meshConfig);
 	}
 	qCritical() << "fileType " << MeshFileExtension(meshConfig.fileType) << " not supported!";
 	return nullptr;
@@ -70,14 +83,15 @@ QString MeshFileSave::MeshFileExtension(enumMeshFileType meshFileType)
 	switch (meshFileType)
 	{
 		case MESH_FILE_TYPE_PLY: return "ply";
+		case MESH_FILE_TYPE_OBJ: return "obj";
 	}
 	return "";
 }
 
 MeshFileSave::enumMeshFileType MeshFileSave::MeshFileType(QString meshFileExtension)
 {
-	if (meshFileExtension == "ply")
-		return MESH_FILE_TYPE_PLY;
+	if (meshFileExtension.toLower() == "obj")
+		return MESH_FILE_TYPE_OBJ;
 	else
 		return MESH_FILE_TYPE_PLY;
 }
@@ -86,117 +100,302 @@ QString MeshFileSave::MeshNameWithoutExtension(QString path)
 {
 	QFileInfo fi(path);
 	QString fileName = fi.completeBaseName();
-	if (!QStringList({"ply"}).contains(fi.suffix()))
+	if (!QStringList({"ply", "obj"}).contains(fi.suffix()))
 	{
 		fileName += "." + fi.suffix();
 	}
 	return fi.path() + QDir::separator() + fileName;
 }
 
-void MeshFileSavePLY::SaveMesh()
+qint16 MeshFileSave::Quantize(double value, double offset) const
 {
-	emit updateProgressAndStatus(getJobName(), QString("Started"), 0.0);
-	SavePLY();
-	emit updateProgressAndStatus(getJobName(), QString("Finished"), 1.0);
+	double quantizedValue = std::round((value - offset) * quantizationScale);
+	return qint16(qBound(-32767.0, quantizedValue, 32767.0));
 }
 
-void MeshFileSavePLY::SavePLY()
+void MeshFileSave::FailedToOpen()
 {
-	QFile qFile(filename);
+	QString statusText = tr("Mesh Export - Failed to open output file!");
+	emit updateProgressAndStatus(statusText, "", 1.0);
+}
 
-	bool withColor = meshConfig.contentTypes.contains(MESH_CONTENT_COLOR);
-	bool isBinary = meshConfig.fileModeType == MESH_BINARY;
+MeshFileSavePLY::MeshFileSavePLY(QString filename, structSaveMeshConfig meshConfig)
+		: MeshFileSave(filename, meshConfig)
+{
+	isBinary = meshConfig.fileModeType == MESH_BINARY;
+	headerSize = 0;
+}
 
-	double alpha = 1.0;
-	char polygonSize = 3;
+QByteArray MeshFileSavePLY::Header(quint64 vertices, quint64 faces, int paddedSize) const
+{
 	QString plyFormat = isBinary ? "binary_little_endian" : "ascii";
+	QString positionType = quantized ? "short" : "float";
 
-	if (!qFile.open(QFile::WriteOnly))
+	QByteArray header;
+	header += QString("ply\n").toLatin1();
+	header += QString("format %1 1.0\n").arg(plyFormat).toLatin1();
+	header += QString("comment Mandelbulber Exported Mesh\n").toLatin1();
+	if (quantized)
 	{
-		QString statusText = tr("Mesh Export - Failed to open output file!");
-		emit updateProgressAndStatus(statusText, "", 1.0);
-		return;
+		header += QString("comment quantized position = (x, y, z) / %1 + (%2, %3, %4)\n")
+								.arg(quantizationScale, 0, 'g', 17)
+								.arg(quantizationOffset.x, 0, 'g', 17)
+								.arg(quantizationOffset.y, 0, 'g', 17)
+								.arg(quantizationOffset.z, 0, 'g', 17)
+								.toLatin1();
 	}
-	QDataStream oB(&qFile);
-	QTextStream oT(&qFile);
-
-	// write the file header
-	oT << QString("ply\n").toLatin1();
-	oT << QString("format %1 1.0\n").arg(plyFormat).toLatin1();
-	oT << QString("comment Mandelbulber Exported Mesh\n").toLatin1();
-	oT << QString("element vertex %1\n").arg(meshData.vertices->size() / 3).toLatin1();
-	oT << QString("property double x\n").toLatin1();
-	oT << QString("property double y\n").toLatin1();
-	oT << QString("property double z\n").toLatin1();
-	oT << QString("property double s\n").toLatin1();
-	oT << QString("property double t\n").toLatin1();
+
+	QByteArray elements;
+	elements += QString("element vertex %1\n").arg(vertices).toLatin1();
+	elements += QString("property %1 x\n").arg(positionType).toLatin1();
+	elements += QString("property %1 y\n").arg(positionType).toLatin1();
+	elements += QString("property %1 z\n").arg(positionType).toLatin1();
 	if (withColor)
 	{
-		oT << QString("property uchar red\n").toLatin1();
-		oT << QString("property uchar green\n").toLatin1();
-		oT << QString("property uchar blue\n").toLatin1();
+		elements += QString("property uchar red\n").toLatin1();
+		elements += QString("property uchar green\n").toLatin1();
+		elements += QString("property uchar blue\n").toLatin1();
 	}
-	oT << QString("element face %1\n").arg(meshData.polygons->size() / 3).toLatin1();
-	oT << QString("property list uchar int vertex_index\n").toLatin1();
-	oT << QString("end_header\n").toLatin1();
-	oT.flush();
+	elements += QString("element face %1\n").arg(faces).toLatin1();
+	elements += QString("property list uchar int vertex_index\n").toLatin1();
+	elements += QString("end_header\n").toLatin1();
 
-	// write vertices
-	for (unsigned long long i = 0; i < meshData.vertices->size() / 3; i++)
+	// element counts are known only at the end, so the header is padded with a comment
+	// to a fixed size and rewritten in place when the mesh is complete
+	QByteArray padding("comment");
+	int missing = paddedSize - (header.size() + padding.size() + 1 + elements.size());
+	if (missing > 0) padding += QByteArray(missing, ' ');
+
+	return header + padding + "\n" + elements;
+}
+
+bool MeshFileSavePLY::Open()
+{
+	file.setFileName(filename);
+	facesFile.setFileTemplate(filename + ".faces.XXXXXX");
+	if (!file.open(QFile::WriteOnly) || !facesFile.open())
 	{
-		if (isBinary)
+		FailedToOpen();
+		return false;
+	}
+
+	headerSize = Header(ULLONG_MAX, ULLONG_MAX, 0).size();
+	file.write(Header(0, 0, headerSize));
+	return true;
+}
+
+void MeshFileSavePLY::AddSlab(const std::vector<double> &vertices,
+	const std::vector<long long> &polygons, const std::vector<sRGB8> &colors)
+{
+	if (!file.isOpen()) return;
+
+	const size_t numberOfVertices = vertices.size() / 3;
+	const size_t numberOfPolygons = polygons.size() / 3;
+	const bool slabWithColor = withColor && colors.size() >= numberOfVertices;
+
+	QByteArray vertexBuffer;
+	QByteArray faceBuffer;
+
+	if (isBinary)
+	{
+		const int positionSize = quantized ? 3 * sizeof(qint16) : 3 * sizeof(float);
+		const int vertexSize = positionSize + (withColor ? 3 : 0);
+		vertexBuffer.resize(int(numberOfVertices * vertexSize));
+		char *vertexPtr = vertexBuffer.data();
+
+		for (size_t i = 0; i < numberOfVertices; i++)
 		{
-			oB.writeRawData(reinterpret_cast<char *>(&meshData.vertices->at(i * 3)), sizeof(double) * 3);
-			oB.writeRawData(reinterpret_cast<char *>(&meshData.colorIndices->at(i)), sizeof(double) * 1);
-			oB.writeRawData(reinterpret_cast<char *>(&alpha), sizeof(double) * 1);
+			if (quantized)
+			{
+				qint16 position[3] = {Quantize(vertices[i * 3], quantizationOffset.x),
+					Quantize(vertices[i * 3 + 1], quantizationOffset.y),
+					Quantize(vertices[i * 3 + 2], quantizationOffset.z)};
+				memcpy(vertexPtr, position, sizeof(position));
+			}
+			else
+			{
+				float position[3] = {
+					float(vertices[i * 3]), float(vertices[i * 3 + 1]), float(vertices[i * 3 + 2])};
+				memcpy(vertexPtr, position, sizeof(position));
+			}
+			if (withColor)
+			{
+				sRGB8 colour = slabWithColor ? colors[i] : sRGB8();
+				vertexPtr[positionSize] = char(colour.R);
+				vertexPtr[positionSize + 1] = char(colour.G);
+				vertexPtr[positionSize + 2] = char(colour.B);
+			}
+			vertexPtr += vertexSize;
 		}
-		else
+
+		// uchar vertex count followed by three int indices
+		const int faceSize = 1 + 3 * sizeof(qint32);
+		faceBuffer.resize(int(numberOfPolygons * faceSize));
+		char *facePtr = faceBuffer.data();
+		for (size_t i = 0; i < numberOfPolygons; i++)
 		{
-			oT << QString("%1 %2 %3")
-							.arg(meshData.vertices->at(i * 3))
-							.arg(meshData.vertices->at(i * 3 + 1))
-							.arg(meshData.vertices->at(i * 3 + 2))
-							.toLatin1();
-			oT << QString(" %1 %2").arg(meshData.colorIndices->at(i).R).arg(alpha).toLatin1();
+			qint32 face[3] = {qint32(polygons[i * 3 + 2]), qint32(polygons[i * 3 + 1]),
+				qint32(polygons[i * 3 + 0])};
+			facePtr[0] = 3;
+			memcpy(facePtr + 1, face, sizeof(face));
+			facePtr += faceSize;
 		}
-
-		if (withColor)
+	}
+	else
+	{
+		const double offset[3] = {quantizationOffset.x, quantizationOffset.y, quantizationOffset.z};
+		for (size_t i = 0; i < numberOfVertices; i++)
 		{
-			sRGB8 colour = meshData.colorIndices->at(i);
-			if (isBinary)
+			for (int axis = 0; axis < 3; axis++)
 			{
-				oB.writeRawData((char *)&colour, sizeof(sRGB8));
+				if (axis > 0) vertexBuffer += ' ';
+				double value = vertices[i * 3 + axis];
+				if (quantized)
+					vertexBuffer += QByteArray::number(Quantize(value, offset[axis]));
+				else
+					vertexBuffer += QByteArray::number(float(value), 'g', 7);
 			}
-			else
+			if (withColor)
 			{
-				oT << QString(" %1 %2 %3").arg(colour.R).arg(colour.G).arg(colour.B).toLatin1();
+				sRGB8 colour = slabWithColor ? colors[i] : sRGB8();
+				vertexBuffer += QString(" %1 %2 %3").arg(colour.R).arg(colour.G).arg(colour.B).toLatin1();
 			}
+			vertexBuffer += '\n';
 		}
-		if (!isBinary) oT << QString("\n").toLatin1();
+
+		for (size_t i = 0; i < numberOfPolygons; i++)
+		{
+			faceBuffer += QString("3 %1 %2 %3\n")
+											.arg(polygons[i * 3 + 2])
+											.arg(polygons[i * 3 + 1])
+											.arg(polygons[i * 3 + 0])
+											.toLatin1();
+		}
+	}
+
+	file.write(vertexBuffer);
+	facesFile.write(faceBuffer);
+	vertexCount += numberOfVertices;
+	polygonCount += numberOfPolygons;
+}
+
+bool MeshFileSavePLY::Close()
+{
+	if (!file.isOpen()) return false;
+
+	emit updateProgressAndStatus(getJobName(), QString("Started"), 0.0);
+
+	// append collected faces after the last vertex
+	const qint64 chunkSize = 4 * 1024 * 1024;
+	const qint64 facesSize = facesFile.size();
+	bool result = facesFile.seek(0);
+	qint64 copied = 0;
+	while (result && copied < facesSize)
+	{
+		QByteArray chunk = facesFile.read(chunkSize);
+		if (chunk.isEmpty() || file.write(chunk) != chunk.size()) result = false;
+		copied += chunk.size();
+		emit updateProgressAndStatus(
+			getJobName(), QString("Writing faces"), double(copied) / qMax(facesSize, qint64(1)));
+	}
+	facesFile.close();
+
+	// rewrite header with final element counts
+	if (result && file.seek(0))
+		result = file.write(Header(vertexCount, polygonCount, headerSize)) == headerSize;
+	else
+		result = false;
+	file.close();
+
+	emit updateProgressAndStatus(getJobName(), QString("Finished"), 1.0);
+	return result;
+}
+
+MeshFileSaveOBJ::MeshFileSaveOBJ(QString filename, structSaveMeshConfig meshConfig)
+		: MeshFileSave(filename, meshConfig)
+{
+}
+
+bool MeshFileSaveOBJ::Open()
+{
+	file.setFileName(filename);
+	if (!file.open(QFile::WriteOnly))
+	{
+		FailedToOpen();
+		return false;
+	}
+
+	// OBJ allows faces between vertex blocks, so slabs are written directly
+	QByteArray header;
+	header += QString("# Mandelbulber Exported Mesh\n").toLatin1();
+	if (quantized)
+	{
+		header += QString("# quantized position = (x, y, z) / %1 + (%2, %3, %4)\n")
+								.arg(quantizationScale, 0, 'g', 17)
+								.arg(quantizationOffset.x, 0, 'g', 17)
+								.arg(quantizationOffset.y, 0, 'g', 17)
+								.arg(quantizationOffset.z, 0, 'g', 17)
+								.toLatin1();
 	}
+	file.write(header);
+	return true;
+}
+
+void MeshFileSaveOBJ::AddSlab(const std::vector<double> &vertices,
+	const std::vector<long long> &polygons, const std::vector<sRGB8> &colors)
+{
+	if (!file.isOpen()) return;
+
+	const size_t numberOfVertices = vertices.size() / 3;
+	const size_t numberOfPolygons = polygons.size() / 3;
+	const bool slabWithColor = withColor && colors.size() >= numberOfVertices;
 
-	// write polygons
-	for (unsigned long long i = 0; i < meshData.polygons->size(); i += 3)
+	const double offset[3] = {quantizationOffset.x, quantizationOffset.y, quantizationOffset.z};
+	QByteArray buffer;
+	for (size_t i = 0; i < numberOfVertices; i++)
 	{
-		if (isBinary)
+		buffer += 'v';
+		for (int axis = 0; axis < 3; axis++)
 		{
-			qint64 p1 = meshData.polygons->at(i + 2);
-			qint64 p2 = meshData.polygons->at(i + 1);
-			qint64 p3 = meshData.polygons->at(i + 0);
-			oB.writeRawData(reinterpret_cast<char *>(&polygonSize), sizeof(char) * 1);
-			oB.writeRawData(reinterpret_cast<char *>(&p1), sizeof(int) * 1);
-			oB.writeRawData(reinterpret_cast<char *>(&p2), sizeof(int) * 1);
-			oB.writeRawData(reinterpret_cast<char *>(&p3), sizeof(int) * 1);
+			buffer += ' ';
+			double value = vertices[i * 3 + axis];
+			if (quantized)
+				buffer += QByteArray::number(Quantize(value, offset[axis]));
+			else
+				buffer += QByteArray::number(float(value), 'g', 7);
 		}
-		else
+		if (slabWithColor)
 		{
-			oT << QString("%1 %2 %3 %4\n")
-							.arg(polygonSize)
-							.arg(meshData.polygons->at(i + 2))
-							.arg(meshData.polygons->at(i + 1))
-							.arg(meshData.polygons->at(i + 0))
-							.toLatin1();
+			// commonly supported vertex color extension (r g b in range 0-1)
+			buffer += QString(" %1 %2 %3")
+									.arg(colors[i].R / 255.0, 0, 'g', 4)
+									.arg(colors[i].G / 255.0, 0, 'g', 4)
+									.arg(colors[i].B / 255.0, 0, 'g', 4)
+									.toLatin1();
 		}
+		buffer += '\n';
 	}
-	qFile.close();
+
+	// OBJ indices are 1-based
+	for (size_t i = 0; i < numberOfPolygons; i++)
+	{
+		buffer += QString("f %1 %2 %3\n")
+								.arg(polygons[i * 3 + 2] + 1)
+								.arg(polygons[i * 3 + 1] + 1)
+								.arg(polygons[i * 3 + 0] + 1)
+								.toLatin1();
+	}
+
+	file.write(buffer);
+	vertexCount += numberOfVertices;
+	polygonCount += numberOfPolygons;
+}
+
+bool MeshFileSaveOBJ::Close()
+{
+	if (!file.isOpen()) return false;
+	bool result = file.error() == QFileDevice::NoError;
+	file.close();
+	emit updateProgressAndStatus(getJobName(), QString("Finished"), 1.0);
+	return result;
 }
@@ -31,8 +31,10 @@
  *
  * file mesh class to store different mesh file formats
  *
- * Each mesh file type derives MeshFileSave and implements the SaveMesh
- * method to store the mesh data with the corresponding file format
+ * Each mesh file type derives MeshFileSave and implements Open(), AddSlab() and Close().
+ * Marching cubes pushes the mesh slab by slab, so the complete mesh never has to be kept
+ * in memory. Polygon indices passed to AddSlab() are global (they may reference vertices
+ * from earlier slabs).
  */
 
 #ifndef MANDELBULBER2_SRC_FILE_MESH_HPP_
@@ -41,10 +43,13 @@
 #include <utility>
 #include <vector>
 
+#include <QFile>
 #include <QList>
 #include <QObject>
 #include <QString>
+#include <QTemporaryFile>
 
+#include "algebra.hpp"
 #include "color_structures.hpp"
 
 class MeshFileSave : public QObject
@@ -54,7 +59,8 @@ class MeshFileSave : public QObject
 public:
 	enum enumMeshFileType
 	{
-		MESH_FILE_TYPE_PLY = 0
+		MESH_FILE_TYPE_PLY = 0,
+		MESH_FILE_TYPE_OBJ = 1
 	};
 
 	enum enumMeshContentType
@@ -71,54 +77,66 @@ public:
 		MESH_ASCII = 1
 	};
 
+	enum enumMeshPrecisionType
+	{
+		MESH_PRECISION_FLOAT = 0,
+		// positions quantized to 16-bit integers inside the export box
+		MESH_PRECISION_INT16 = 1
+	};
+
 	struct structSaveMeshConfig
 	{
 		structSaveMeshConfig() {}
 
 		structSaveMeshConfig(enumMeshFileType _fileType, QList<enumMeshContentType> _contentTypes,
-			enumMeshFileModeType _fileModeType)
-				: fileType(_fileType), contentTypes(std::move(_contentTypes)), fileModeType(_fileModeType)
+			enumMeshFileModeType _fileModeType,
+			enumMeshPrecisionType _precisionType = MESH_PRECISION_FLOAT)
+				: fileType(_fileType),
+					contentTypes(std::move(_contentTypes)),
+					fileModeType(_fileModeType),
+					precisionType(_precisionType)
 		{
 		}
 
 		enumMeshFileType fileType{MESH_FILE_TYPE_PLY};
 		QList<enumMeshContentType> contentTypes{QList<enumMeshContentType>({})};
 		enumMeshFileModeType fileModeType{MESH_ASCII};
-	};
-
-	struct structSaveMeshData
-	{
-		structSaveMeshData()
-		{
-			vertices = nullptr;
-			polygons = nullptr;
-			colorIndices = nullptr;
-		}
+		enumMeshPrecisionType precisionType{MESH_PRECISION_FLOAT};
 
-		structSaveMeshData(std::vector<double> *_vertices, std::vector<long long> *_polygons,
-			std::vector<sRGB8> *_colorIndices)
-				: vertices(_vertices), polygons(_polygons), colorIndices(_colorIndices)
-		{
-		}
-		std::vector<double> *vertices;
-		std::vector<long long> *polygons;
-		std::vector<sRGB8> *colorIndices;
+		// box used for quantization of positions
+		CVector3 limitMin;
+		CVector3 limitMax;
 	};
 
 	static QString MeshFileExtension(enumMeshFileType meshFileType);
 	static QString MeshNameWithoutExtension(QString path);
 	static enumMeshFileType MeshFileType(QString meshFileExtension);
-	static MeshFileSave *create(
-		QString filename, structSaveMeshConfig meshConfig, structSaveMeshData meshData);
-	virtual void SaveMesh() = 0;
+	static MeshFileSave *create(QString filename, structSaveMeshConfig meshConfig);
+
+	virtual bool Open() = 0;
+	// vertices: x, y, z triplets, polygons: triangles of global vertex indices,
+	// colors: one color per vertex (can be empty if mesh is not colored)
+	virtual void AddSlab(const std::vector<double> &vertices, const std::vector<long long> &polygons,
+		const std::vector<sRGB8> &colors) = 0;
+	virtual bool Close() = 0;
 	virtual QString getJobName() = 0;
 
+	quint64 GetVertexCount() const { return vertexCount; }
+	quint64 GetPolygonCount() const { return polygonCount; }
+
 protected:
 	QString filename;
 	structSaveMeshConfig meshConfig;
-	structSaveMeshData meshData;
+	bool withColor;
+	bool quantized;
+	CVector3 quantizationOffset;
+	double quantizationScale;
+	quint64 vertexCount;
+	quint64 polygonCount;
 
-	MeshFileSave(QString filename, structSaveMeshConfig meshConfig, structSaveMeshData meshData);
+	MeshFileSave(QString filename, structSaveMeshConfig meshConfig);
+	qint16 Quantize(double value, double offset) const;
+	void FailedToOpen();
 
 signals:
 	void updateProgressAndStatus(const QString &text, const QString &progressText, double progress);
@@ -128,13 +146,36 @@ class MeshFileSavePLY : public MeshFileSave
 {
 	Q_OBJECT
 public:
-	MeshFileSavePLY(QString filename, structSaveMeshConfig meshConfig, structSaveMeshData meshData)
-			: MeshFileSave(filename, meshConfig, meshData)
-	{
-	}
-	void SaveMesh() override;
+	MeshFileSavePLY(QString filename, structSaveMeshConfig meshConfig);
+	bool Open() override;
+	void AddSlab(const std::vector<double> &vertices, const std::vector<long long> &polygons,
+		const std::vector<sRGB8> &colors) override;
+	bool Close() override;
 	QString getJobName() override { return tr("Saving %1").arg("PLY"); }
-	void SavePLY();
+
+private:
+	QByteArray Header(quint64 vertices, quint64 faces, int paddedSize) const;
+
+	bool isBinary;
+	int headerSize;
+	QFile file;
+	// faces are collected in a temporary file and appended after the last vertex
+	QTemporaryFile facesFile;
+};
+
+class MeshFileSaveOBJ : public MeshFileSave
+{
+	Q_OBJECT
+public:
+	MeshFileSaveOBJ(QString filename, structSaveMeshConfig meshConfig);
+	bool Open() override;
+	void AddSlab(const std::vector<double> &vertices, const std::vector<long long> &polygons,
+		const std::vector<sRGB8> &colors) override;
+	bool Close() override;
+	QString getJobName() override { return tr("Saving %1").arg("OBJ"); }
+
+private:
+	QFile file;
 };
 
 #endif /* MANDELBULBER2_SRC_FILE_MESH_HPP_ */
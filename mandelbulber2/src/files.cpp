@@ -485,6 +485,103 @@ std::vector<sRGBA16> LoadPNG(QString filename, int &outWidth, int &outHeight)
 	return image;
 }
 
+bool LoadPNGRows(QString filename,
+	const std::function<bool(int width, int height, int bitDepth)> &beginImage,
+	const std::function<void(int y, const sRGBA16 *row)> &storeRow)
+{
+	FILE *fp = fopen(filename.toLocal8Bit().constData(), "rb");
+	if (fp == nullptr) return false;
+
+	uchar sig[8];
+	if (fread(sig, 1, 8, fp) < 8 || !png_check_sig(sig, 8))
+	{
+		fclose(fp);
+		return false;
+	}
+
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	if (png_ptr == nullptr)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	if (info_ptr == nullptr)
+	{
+		png_destroy_read_struct(&png_ptr, nullptr, nullptr);
+		fclose(fp);
+		return false;
+	}
+
+	if (setjmp(png_jmpbuf(png_ptr)))
+	{
+		png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+		fclose(fp);
+		return false;
+	}
+
+	png_init_io(png_ptr, fp);
+	png_set_sig_bytes(png_ptr, 8);
+	png_read_info(png_ptr, info_ptr);
+
+	png_uint_32 width, height;
+	int bitDepth, colorType, interlaceType;
+	png_get_IHDR(
+		png_ptr, info_ptr, &width, &height, &bitDepth, &colorType, &interlaceType, nullptr, nullptr);
+
+	// every color type is converted to 16-bit RGBA in native byte order
+	png_set_expand(png_ptr);
+	png_set_expand_16(png_ptr);
+	png_set_gray_to_rgb(png_ptr);
+	png_set_add_alpha(png_ptr, 0xffff, PNG_FILLER_AFTER);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+	png_set_swap(png_ptr);
+#endif
+	const int passes = png_set_interlace_handling(png_ptr);
+	png_read_update_info(png_ptr, info_ptr);
+
+	if (!beginImage(int(width), int(height), bitDepth))
+	{
+		png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+		fclose(fp);
+		return false;
+	}
+
+	// interlaced image is complete only after the last pass, so it needs buffer for all rows
+	std::vector<sRGBA16> buffer(size_t(width) * (passes > 1 ? height : 1));
+
+	// buffer is not reallocated after this point, so it is still valid after longjmp
+	if (setjmp(png_jmpbuf(png_ptr)))
+	{
+		png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+		fclose(fp);
+		return false;
+	}
+
+	for (int pass = 0; pass < passes; pass++)
+	{
+		for (png_uint_32 y = 0; y < height; y++)
+		{
+			sRGBA16 *row = buffer.data() + (passes > 1 ? size_t(y) * width : 0);
+			png_read_row(png_ptr, reinterpret_cast<png_bytep>(row), nullptr);
+			if (passes == 1) storeRow(int(y), row);
+		}
+	}
+
+	if (passes > 1)
+	{
+		for (png_uint_32 y = 0; y < height; y++)
+			storeRow(int(y), buffer.data() + size_t(y) * width);
+	}
+
+	png_read_end(png_ptr, nullptr);
+	png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+	fclose(fp);
+
+	return true;
+}
+
 bool FileExists(const QString &path)
 {
 	QFileInfo check_file(path);
@@ -35,6 +35,7 @@
 #ifndef MANDELBULBER2_SRC_FILES_H_
 #define MANDELBULBER2_SRC_FILES_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -58,6 +59,13 @@ QStringList SaveImage(QString filename, ImageFileSave::enumImageFileType fileTyp
 	std::shared_ptr<cImage> image, QObject *updateReceiver = nullptr);
 std::vector<sRGBA16> LoadPNG(QString filename, int &outWidth, int &outHeight);
 
+// LoadPNGRows() decodes PNG file row by row, so the whole bitmap is never held in memory.
+// beginImage() gets image size and bit depth and can reject the image, storeRow() gets every row
+// converted to 16-bit RGBA
+bool LoadPNGRows(QString filename,
+	const std::function<bool(int width, int height, int bitDepth)> &beginImage,
+	const std::function<void(int y, const sRGBA16 *row)> &storeRow);
+
 bool FileExists(const QString &path);
 QString FilePathHelper(const QString &path, const QStringList &pathList);
 QString FilePathHelperTextures(const QString &path);
@@ -85,6 +85,7 @@ sParamRender::sParamRender(
 	cloudsLightsBoost = container->Get<double>("clouds_lights_boost");
 	cloudsPeriod = container->Get<double>("clouds_period");
 	cloudsPlaneShape = container->Get<bool>("clouds_plane_shape");
+	cloudsPrecomputedNoise = container->Get<bool>("clouds_precomputed_noise");
 	cloudsHeight = container->Get<double>("clouds_height");
 	cloudsIterations = container->Get<int>("clouds_noise_iterations");
 	cloudsOpacity = container->Get<double>("clouds_opacity");
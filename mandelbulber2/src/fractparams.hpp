@@ -106,6 +106,7 @@ struct sParamRender
 	bool cloudsDistanceMode;
 	bool cloudsEnable;
 	bool cloudsPlaneShape;
+	bool cloudsPrecomputedNoise;
 	bool cloudsSharpEdges;
 	bool constantDEThreshold;
 	bool distanceFogShadows;
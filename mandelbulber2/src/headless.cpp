@@ -88,6 +88,7 @@ void cHeadless::RenderStillImage(QString filename, QString imageFileFormat)
 	config.DisableRefresh();
 	config.DisableProgressiveRender();
 	config.EnableNetRender();
+	config.EnableFinalRender();
 
 	renderJob->Init(cRenderJob::still, config);
 	renderJob->Execute();
@@ -177,24 +178,29 @@ void cHeadless::RenderVoxel(QString voxelFormat)
 	if (samplesX > 0 && samplesY > 0 && samplesZ > 0)
 	{
 
-		if (voxelFormat == "slice")
+		if (voxelFormat == "slice" || voxelFormat == "sparse")
 		{
 			QString folderString = gPar->Get<QString>("voxel_image_path");
 			QDir folder(folderString);
-			std::unique_ptr<cVoxelExport> voxelExport(new cVoxelExport(
-				samplesX, samplesY, samplesZ, limitMin, limitMax, folder, maxIter, greyscale));
+			std::unique_ptr<cVoxelExport> voxelExport(new cVoxelExport(samplesX, samplesY, samplesZ,
+				limitMin, limitMax, folder, maxIter, greyscale, voxelFormat == "sparse"));
 			QObject::connect(voxelExport.get(),
 				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
 				SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
 			voxelExport->ProcessVolume();
 		}
-		else if (voxelFormat == "ply")
+		else if (voxelFormat == "ply" || voxelFormat == "obj")
 		{
-			QString fileString = gPar->Get<QString>("mesh_output_filename");
+			// file type is selected by command line argument, so extension has to follow it
+			MeshFileSave::enumMeshFileType meshFileType = MeshFileSave::MeshFileType(voxelFormat);
+			QString fileString =
+				MeshFileSave::MeshNameWithoutExtension(gPar->Get<QString>("mesh_output_filename")) + "."
+				+ MeshFileSave::MeshFileExtension(meshFileType);
 			QList<MeshFileSave::enumMeshContentType> meshContent({MeshFileSave::MESH_CONTENT_GEOMETRY});
 			if (gPar->Get<bool>("mesh_color")) meshContent << MeshFileSave::MESH_CONTENT_COLOR;
-			MeshFileSave::structSaveMeshConfig meshConfig(MeshFileSave::MESH_FILE_TYPE_PLY, meshContent,
-				MeshFileSave::enumMeshFileModeType(gPar->Get<int>("mesh_file_mode")));
+			MeshFileSave::structSaveMeshConfig meshConfig(meshFileType,
+				meshContent, MeshFileSave::enumMeshFileModeType(gPar->Get<int>("mesh_file_mode")),
+				MeshFileSave::enumMeshPrecisionType(gPar->Get<int>("mesh_precision")));
 
 			std::unique_ptr<cMeshExport> meshExport(new cMeshExport(
 				samplesX, samplesY, samplesZ, limitMin, limitMax, fileString, maxIter, meshConfig));
@@ -0,0 +1,117 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2021 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cImageSavingPipeline - bounded, asynchronous saving of animation frames
+ */
+
+#include "image_saving_pipeline.hpp"
+
+#include <QRunnable>
+
+#include "cimage.hpp"
+#include "files.h"
+#include "write_log.hpp"
+
+class cImageSavingTask : public QRunnable
+{
+public:
+	cImageSavingTask(cImageSavingPipeline *_pipeline, std::shared_ptr<cImage> _buffer,
+		const QString &_filename, ImageFileSave::enumImageFileType _fileType)
+			: pipeline(_pipeline), buffer(_buffer), filename(_filename), fileType(_fileType)
+	{
+		setAutoDelete(true);
+	}
+
+	void run() override
+	{
+		::SaveImage(filename, fileType, buffer, nullptr);
+		WriteLogString("cImageSavingPipeline: image saved", filename, 2);
+		pipeline->ReleaseBuffer(buffer);
+	}
+
+private:
+	cImageSavingPipeline *pipeline;
+	std::shared_ptr<cImage> buffer;
+	QString filename;
+	ImageFileSave::enumImageFileType fileType;
+};
+
+cImageSavingPipeline::cImageSavingPipeline(int numberOfThreads, int _numberOfBuffers)
+{
+	threadPool.setMaxThreadCount(qMax(1, numberOfThreads));
+	numberOfBuffers = qMax(1, _numberOfBuffers);
+	createdBuffers = 0;
+}
+
+cImageSavingPipeline::~cImageSavingPipeline()
+{
+	WaitForAll();
+}
+
+void cImageSavingPipeline::SaveImage(std::shared_ptr<cImage> image, const QString &filename,
+	ImageFileSave::enumImageFileType fileType)
+{
+	std::shared_ptr<cImage> buffer = AcquireBuffer();
+	buffer->CopyImageData(*image);
+	threadPool.start(new cImageSavingTask(this, buffer, filename, fileType));
+}
+
+void cImageSavingPipeline::WaitForAll()
+{
+	threadPool.waitForDone();
+}
+
+std::shared_ptr<cImage> cImageSavingPipeline::AcquireBuffer()
+{
+	QMutexLocker lock(&mutex);
+
+	// back-pressure: wait until one of the saving threads finishes
+	while (freeBuffers.empty() && createdBuffers >= numberOfBuffers)
+	{
+		bufferReleased.wait(&mutex);
+	}
+
+	if (!freeBuffers.empty())
+	{
+		std::shared_ptr<cImage> buffer = freeBuffers.back();
+		freeBuffers.pop_back();
+		return buffer;
+	}
+
+	createdBuffers++;
+	return std::shared_ptr<cImage>(new cImage(1, 1, true));
+}
+
+void cImageSavingPipeline::ReleaseBuffer(std::shared_ptr<cImage> buffer)
+{
+	QMutexLocker lock(&mutex);
+	freeBuffers.push_back(buffer);
+	bufferReleased.wakeOne();
+}
@@ -0,0 +1,82 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2021 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cImageSavingPipeline - bounded, asynchronous saving of animation frames
+ *
+ * Rendered frame is copied into one of a few recycled image buffers and encoded by a fixed
+ * number of saving threads, so the render loop can continue with the next frame. When all
+ * buffers are waiting for encoding, SaveImage() blocks until one of them is released. This way
+ * slow encoders (EXR, TIFF) cannot accumulate unlimited number of full resolution copies.
+ */
+
+#ifndef MANDELBULBER2_SRC_IMAGE_SAVING_PIPELINE_HPP_
+#define MANDELBULBER2_SRC_IMAGE_SAVING_PIPELINE_HPP_
+
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "file_image.hpp"
+
+// forward declarations
+class cImage;
+
+class cImageSavingPipeline
+{
+public:
+	cImageSavingPipeline(int numberOfThreads = 2, int numberOfBuffers = 3);
+	~cImageSavingPipeline();
+
+	// copies the image and queues it for saving. Blocks if all buffers are in use
+	void SaveImage(std::shared_ptr<cImage> image, const QString &filename,
+		ImageFileSave::enumImageFileType fileType);
+
+	// waits until all queued images are saved
+	void WaitForAll();
+
+private:
+	std::shared_ptr<cImage> AcquireBuffer();
+	void ReleaseBuffer(std::shared_ptr<cImage> buffer);
+
+	QThreadPool threadPool;
+	QMutex mutex;
+	QWaitCondition bufferReleased;
+	std::vector<std::shared_ptr<cImage>> freeBuffers;
+	int numberOfBuffers;
+	int createdBuffers;
+
+	friend class cImageSavingTask;
+};
+
+#endif /* MANDELBULBER2_SRC_IMAGE_SAVING_PIPELINE_HPP_ */
@@ -32,6 +32,8 @@
  * InitParams function - initialization of all parameters
  */
 
+#include <QMutex>
+
 #include "file_mesh.hpp"
 #include "files.h"
 #include "fractal.h"
@@ -51,7 +53,7 @@
 std::shared_ptr<cParameterContainer> gPar;
 
 // definition of all parameters
-void InitParams(std::shared_ptr<cParameterContainer> par)
+static void DefineParams(std::shared_ptr<cParameterContainer> par)
 {
 	using namespace parameterContainer;
 
@@ -102,6 +104,12 @@ void InitParams(std::shared_ptr<cParameterContainer> par)
 	par->addParam("keyframe_collision_thresh", 1.0e-6, 1e-15, 1.0e2, morphNone, paramStandard);
 	par->addParam("keyframe_auto_validate", true, morphNone, paramApp);
 	par->addParam("keyframe_constant_target_distance", 0.1, 1e-10, 1.0e2, morphNone, paramStandard);
+
+	// reuse of depth from previous frame (keyframe and flight animation)
+	par->addParam("anim_temporal_reprojection", false, morphNone, paramStandard);
+	par->addParam(
+		"anim_temporal_reprojection_reference_interval", 10, 1, 1000, morphNone, paramStandard);
+
 	par->addParam("show_camera_path", true, morphNone, paramApp);
 	par->addParam("show_target_path", true, morphNone, paramApp);
 	for (int i = 1; i <= 4; i++)
@@ -213,6 +221,7 @@ void InitParams(std::shared_ptr<cParameterContainer> par)
 	par->addParam("stereo_mode", int(cStereo::stereoLeftRight), morphLinear, paramStandard);
 	par->addParam("stereo_swap_eyes", false, morphLinear, paramStandard);
 	par->addParam("stereo_infinite_correction", 0.0, 0.0, 10.0, morphAkima, paramStandard);
+	par->addParam("stereo_shared_rays", false, morphNone, paramStandard);
 	par->addParam("stereo_actual_eye", int(cStereo::eyeNone), morphAkima, paramOnlyForNet);
 
 	// volume slicing
@@ -228,6 +237,7 @@ void InitParams(std::shared_ptr<cParameterContainer> par)
 		paramStandard);
 	par->addParam("voxel_show_information", true, morphLinear, paramApp);
 	par->addParam("voxel_greyscale_iterations", false, morphLinear, paramApp);
+	par->addParam("voxel_sparse", false, morphNone, paramApp);
 
 	// mesh export
 	par->addParam("mesh_output_filename",
@@ -235,6 +245,7 @@ void InitParams(std::shared_ptr<cParameterContainer> par)
 		paramStandard);
 	par->addParam("mesh_color", true, morphNone, paramApp);
 	par->addParam("mesh_file_mode", int(MeshFileSave::MESH_BINARY), morphNone, paramApp);
+	par->addParam("mesh_precision", int(MeshFileSave::MESH_PRECISION_FLOAT), morphNone, paramApp);
 
 	// foldings
 	par->addParam("box_folding", false, morphLinear, paramStandard);
@@ -332,6 +343,7 @@ void InitParams(std::shared_ptr<cParameterContainer> par)
 	par->addParam("clouds_speed", CVector3(0.0, 0.0, 0.0), morphLinear, paramStandard);
 	par->addParam("clouds_sharp_edges", false, morphLinear, paramStandard);
 	par->addParam("clouds_sharpness", 100.0, 1.0, 1e15, morphLinear, paramStandard);
+	par->addParam("clouds_precomputed_noise", false, morphNone, paramStandard);
 
 	par->addParam("hdr_blur_enabled", false, morphLinear, paramStandard);
 	par->addParam("hdr_blur_radius", 10.0, 0.0001, 1000.0, morphLinear, paramStandard);
@@ -525,6 +537,7 @@ void InitParams(std::shared_ptr<cParameterContainer> par)
 
 	par->addParam("limit_CPU_cores", get_cpu_count(), 1, get_cpu_count(), morphNone, paramApp);
 	par->addParam("maximum_texture_cache_size", 4, morphNone, paramApp);
+	par->addParam("texture_disk_cache", true, morphNone, paramApp);
 
 	par->addParam(
 		"randomizer_preview_quality", 1, morphNone, paramApp, QStringList({"low", "medium", "high"}));
@@ -604,6 +617,7 @@ void InitParams(std::shared_ptr<cParameterContainer> par)
 	par->addParam("opencl_memory_limit", 512, 1, 100000, morphNone, paramApp);
 	par->addParam("opencl_disable_build_cache", false, morphNone, paramApp);
 	par->addParam("opencl_use_fast_relaxed_math", true, morphNone, paramApp);
+	par->addParam("opencl_specialized_kernel", false, morphNone, paramApp);
 	par->addParam("opencl_job_size_multiplier", 2, morphNone, paramApp);
 	par->addParam("opencl_reserved_gpu_time", 0.1, morphNone, paramApp);
 	par->addParam("thumbnails_with_opencl", false, morphNone, paramApp);
@@ -637,7 +651,7 @@ void InitParams(std::shared_ptr<cParameterContainer> par)
 }
 
 // definition of all parameters
-void InitFractalParams(std::shared_ptr<cParameterContainer> par)
+static void DefineFractalParams(std::shared_ptr<cParameterContainer> par)
 {
 	WriteLog("Fractal parameters initialization started: " + par->GetContainerName(), 3);
 
@@ -1235,6 +1249,51 @@ void InitFractalParams(std::shared_ptr<cParameterContainer> par)
 	WriteLog("Fractal parameters initialization finished", 3);
 }
 
+// parameters are defined only once. Defaults are kept in unnamed container, so records don't
+// store any container name and the same definitions are implicitly shared by all containers
+// (e.g. fractal0 ... fractal8). Container name is resolved from the owning container.
+static void InitFromDefaults(std::shared_ptr<cParameterContainer> par,
+	void (*defineFunction)(std::shared_ptr<cParameterContainer>),
+	std::shared_ptr<const cParameterContainer> *defaults, QMutex *mutex)
+{
+	std::shared_ptr<const cParameterContainer> source;
+	{
+		QMutexLocker lock(mutex);
+		if (!*defaults)
+		{
+			std::shared_ptr<cParameterContainer> newDefaults(new cParameterContainer);
+			defineFunction(newDefaults);
+			*defaults = newDefaults;
+		}
+		source = *defaults;
+	}
+	par->AddParamsFromContainer(*source);
+}
+
+void InitParams(std::shared_ptr<cParameterContainer> par)
+{
+	static std::shared_ptr<const cParameterContainer> defaults;
+	static QMutex mutex;
+	InitFromDefaults(par, DefineParams, &defaults, &mutex);
+}
+
+void InitFractalParams(std::shared_ptr<cParameterContainer> par)
+{
+	static std::shared_ptr<const cParameterContainer> defaults;
+	static QMutex mutex;
+	InitFromDefaults(par, DefineFractalParams, &defaults, &mutex);
+}
+
+void InitParamsWithoutDefaults(std::shared_ptr<cParameterContainer> par)
+{
+	DefineParams(par);
+}
+
+void InitFractalParamsWithoutDefaults(std::shared_ptr<cParameterContainer> par)
+{
+	DefineFractalParams(par);
+}
+
 void InitPrimitiveParams(fractal::enumObjectType objectType, const QString primitiveName,
 	std::shared_ptr<cParameterContainer> par)
 {
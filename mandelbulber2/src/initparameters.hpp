@@ -44,6 +44,9 @@ extern std::shared_ptr<cParameterContainer> gPar;
 
 void InitParams(std::shared_ptr<cParameterContainer> par);
 void InitFractalParams(std::shared_ptr<cParameterContainer> par);
+// definitions evaluated again, without shared defaults (used to benchmark cold start)
+void InitParamsWithoutDefaults(std::shared_ptr<cParameterContainer> par);
+void InitFractalParamsWithoutDefaults(std::shared_ptr<cParameterContainer> par);
 void InitPrimitiveParams(fractal::enumObjectType objectType, const QString primitiveName,
 	std::shared_ptr<cParameterContainer> par);
 void DeletePrimitiveParams(fractal::enumObjectType objectType, const QString primitiveName,
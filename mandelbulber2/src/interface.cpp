@@ -44,6 +44,7 @@
 #include "camera_movement_modes.h"
 #include "camera_target.hpp"
 #include "common_math.h"
+#include "distance_query.hpp"
 #include "dof.hpp"
 #include "error_message.hpp"
 #include "fractparams.hpp"
@@ -205,7 +206,6 @@ void cInterface::ShowUi()
 	mainImage.reset(new cImage(gPar->Get<int>("image_width"), gPar->Get<int>("image_height")));
 	mainImage->CreatePreview(1.0, 800, 600, renderedImage);
 	mainImage->CompileImage();
-	mainImage->ConvertTo8bitChar();
 	mainImage->UpdatePreview();
 	mainImage->SetAsMainImage();
 	renderedImage->setMinimumSize(
@@ -754,57 +754,7 @@ void cInterface::AutoFog(std::shared_ptr<cParameterContainer> _params,
 double cInterface::GetDistanceForPoint(CVector3 point, std::shared_ptr<cParameterContainer> par,
 	std::shared_ptr<cFractalContainer> parFractal)
 {
-	std::shared_ptr<sParamRender> params(new sParamRender(par));
-	std::shared_ptr<cNineFractals> fractals(new cNineFractals(parFractal, par));
-	sDistanceIn in(point, 0, false);
-	sDistanceOut out;
-
-	bool openClEnabled = false;
-#ifdef USE_OPENCL
-	openClEnabled = par->Get<bool>("opencl_enabled") && parFractal->isUsedCustomFormula();
-
-	if (openClEnabled)
-	{
-		gOpenCl->openClEngineRenderFractal->Lock();
-		gOpenCl->openClEngineRenderFractal->SetDistanceMode();
-		gOpenCl->openClEngineRenderFractal->SetParameters(
-			par, parFractal, params, fractals, nullptr, false);
-		if (gOpenCl->openClEngineRenderFractal->LoadSourcesAndCompile(par))
-		{
-			gOpenCl->openClEngineRenderFractal->CreateKernel4Program(par);
-			gOpenCl->openClEngineRenderFractal->PreAllocateBuffers(par);
-			gOpenCl->openClEngineRenderFractal->CreateCommandQueue();
-		}
-		else
-		{
-			gOpenCl->openClEngineRenderFractal->ReleaseMemory();
-			gOpenCl->openClEngineRenderFractal->Unlock();
-			return 0.0;
-		}
-	}
-#endif
-
-	double dist;
-	if (openClEnabled)
-	{
-#ifdef USE_OPENCL
-		dist = gOpenCl->openClEngineRenderFractal->CalculateDistance(point);
-#endif
-	}
-	else
-	{
-		dist = CalculateDistance(*params, *fractals, in, &out);
-	}
-
-#ifdef USE_OPENCL
-	if (openClEnabled)
-	{
-		gOpenCl->openClEngineRenderFractal->ReleaseMemory();
-		gOpenCl->openClEngineRenderFractal->Unlock();
-	}
-#endif
-
-	return dist;
+	return gDistanceQuery.Distance(point, par, parFractal);
 }
 
 double cInterface::GetDistanceForPoint(CVector3 point) const
@@ -892,87 +842,70 @@ void cInterface::ResetView(QWidget *navigationWidget,
 	}
 
 	// calculate size of the fractal in random directions
-	double maxDist = 0.0;
-
-	std::shared_ptr<sParamRender> params(new sParamRender(parTemp));
-	std::shared_ptr<cNineFractals> fractals(new cNineFractals(parFractalContainer, parTemp));
+	// all directions are scanned together, so distances are calculated in batches
+	const int numberOfDirections = 100;
+	QVector<CVector3> directions(numberOfDirections);
+	QVector<double> scans(numberOfDirections, 100.0);
+	for (int i = 0; i < numberOfDirections; i++)
+	{
+		CVector3 direction(
+			Random(1000) / 500.0 - 1.0, Random(1000) / 500.0 - 1.0, Random(1000) / 500.0 - 1.0);
+		direction.Normalize();
+		directions[i] = direction;
+	}
 
-	bool openClEnabled = false;
-#ifdef USE_OPENCL
-	openClEnabled =
-		parTemp->Get<bool>("opencl_enabled") && parFractalContainer->isUsedCustomFormula();
+	QVector<int> activeDirections;
+	for (int i = 0; i < numberOfDirections; i++)
+		activeDirections.append(i);
 
-	if (openClEnabled)
+	// OpenCL engine is prepared only once for all scan steps
+	gDistanceQuery.BeginSession();
+	while (!activeDirections.isEmpty())
 	{
-		gOpenCl->openClEngineRenderFractal->Lock();
-		gOpenCl->openClEngineRenderFractal->SetDistanceMode();
-		gOpenCl->openClEngineRenderFractal->SetParameters(
-			parTemp, gParFractal, params, fractals, nullptr, false);
-		if (gOpenCl->openClEngineRenderFractal->LoadSourcesAndCompile(parTemp))
-		{
-			gOpenCl->openClEngineRenderFractal->CreateKernel4Program(parTemp);
-			gOpenCl->openClEngineRenderFractal->PreAllocateBuffers(parTemp);
-			gOpenCl->openClEngineRenderFractal->CreateCommandQueue();
-		}
-		else
+		cProgressText::ProgressStatusText(QObject::tr("Resetting view"),
+			QObject::tr("Fractal size calculation"),
+			1.0 - double(activeDirections.size()) / numberOfDirections, cProgressText::progress_IMAGE);
+
+		QVector<CVector3> points;
+		points.reserve(activeDirections.size());
+		for (int index : activeDirections)
+			points.append(directions[index] * scans[index]);
+
+		QVector<double> distances = gDistanceQuery.Distances(points, parTemp, parFractalContainer);
+		if (distances.size() != points.size())
 		{
-			gOpenCl->openClEngineRenderFractal->ReleaseMemory();
-			gOpenCl->openClEngineRenderFractal->Unlock();
+			// OpenCL program cannot be compiled
+			gDistanceQuery.EndSession();
 			return;
 		}
-	}
-#endif
-
-	for (int i = 0; i < 100; i++)
-	{
-		cProgressText::ProgressStatusText(QObject::tr("Resetting view"),
-			QObject::tr("Fractal size calculation"), i / 50.0, cProgressText::progress_IMAGE);
-		CVector3 direction(
-			Random(1000) / 500.0 - 1.0, Random(1000) / 500.0 - 1.0, Random(1000) / 500.0 - 1.0);
-		direction.Normalize();
-		double distStep;
-		double scan;
 
-		for (scan = 100.0; scan > 0; scan -= distStep)
+		QVector<int> stillActive;
+		for (int i = 0; i < activeDirections.size(); i++)
 		{
-			CVector3 point = direction * scan;
-			sDistanceIn in(point, 0, false);
-			sDistanceOut out;
+			int index = activeDirections[i];
+			double dist = distances[i];
+			if (dist < 0.1) continue;
 
-			double dist;
-			if (openClEnabled)
-			{
-#ifdef USE_OPENCL
-				dist = gOpenCl->openClEngineRenderFractal->CalculateDistance(point);
-#endif
-			}
-			else
-			{
-				dist = CalculateDistance(*params, *fractals, in, &out);
-			}
-			if (dist < 0.1)
-			{
-				break;
-			}
-			distStep = dist * DEFactor * 0.5;
+			double distStep = dist * DEFactor * 0.5;
 			if (distStep > 1.0) distStep = 1.0;
-			// qDebug() << "i" << i << "scan" << scan << "direction" << direction.Debug();
+			scans[index] -= distStep;
+			if (scans[index] > 0) stillActive.append(index);
 		}
+		activeDirections = stillActive;
+	}
+	gDistanceQuery.EndSession();
+
+	double maxDist = 0.0;
+	for (double scan : scans)
+	{
 		if (scan > maxDist) maxDist = scan;
 	}
+
 	cProgressText::ProgressStatusText(
 		QObject::tr("Resetting view"), QObject::tr("Done"), 1.0, cProgressText::progress_IMAGE);
 
 	double newCameraDist;
 
-#ifdef USE_OPENCL
-	if (openClEnabled)
-	{
-		gOpenCl->openClEngineRenderFractal->ReleaseMemory();
-		gOpenCl->openClEngineRenderFractal->Unlock();
-	}
-#endif
-
 	if (perspType == params::perspThreePoint)
 	{
 		newCameraDist = maxDist / fov * 2.0 * sqrt(2);
@@ -1393,6 +1326,7 @@ bool cInterface::QuitApplicationDialog()
 				gApplication->processEvents();
 			}
 
+			gUndo->StopAutosave();
 			QFile::remove(systemDirectories.GetAutosaveFile());
 
 			if (detachedWindow)
@@ -0,0 +1,370 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2021 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cKeyframeTimeline - keyframe animation compiled into per-parameter curves
+ */
+
+#include "keyframe_timeline.hpp"
+
+#include <gsl/gsl_spline.h>
+
+#include "common_math.h"
+#include "morph.hpp"
+
+void cKeyframeTimeline::Compile(const QList<cAnimationFrames::sAnimationFrame> &frames,
+	const QList<cAnimationFrames::sParameterDescription> &listOfParameters, quint64 revision)
+{
+	Clear();
+	numberOfKeyframes = frames.size();
+	compiledRevision = revision;
+
+	for (const auto &frame : frames)
+		numberOfSubFrames.push_back(frame.numberOfSubFrames);
+
+	curves.resize(listOfParameters.size());
+	for (int i = 0; i < listOfParameters.size(); i++)
+	{
+		sCurve &curve = curves[i];
+		curve.fullParameterName =
+			listOfParameters[i].containerName + "_" + listOfParameters[i].parameterName;
+
+		if (numberOfKeyframes == 0) continue;
+
+		curve.keyParameters.reserve(numberOfKeyframes);
+		for (int k = 0; k < numberOfKeyframes; k++)
+		{
+			curve.keyParameters.push_back(
+				frames.at(k).parameters.GetAsOneParameter(curve.fullParameterName));
+		}
+
+		CompileCurve(curve, curve.keyParameters[0].GetMorphType());
+	}
+
+	isCompiled = true;
+}
+
+void cKeyframeTimeline::Clear()
+{
+	curves.clear();
+	numberOfSubFrames.clear();
+	numberOfKeyframes = 0;
+	isCompiled = false;
+}
+
+void cKeyframeTimeline::CompileCurve(sCurve &curve, enumMorphType morphType)
+{
+	cOneParameter &firstKey = curve.keyParameters[0];
+	curve.valueType = firstKey.GetValueType();
+	curve.numberOfComponents = NumberOfComponents(curve.valueType);
+
+	// gradients are interpolated color by color and have to be handled by cMorph
+	if (curve.valueType == typeString && firstKey.IsGradient() && morphType != morphNone)
+	{
+		curve.compiled = false;
+		return;
+	}
+
+	curve.compiled = true;
+
+	if (curve.numberOfComponents == 0 || morphType == morphNone)
+	{
+		curve.curveType = curveConstant;
+		return;
+	}
+
+	curve.segments.resize(size_t(numberOfKeyframes) * curve.numberOfComponents);
+
+	switch (morphType)
+	{
+		case morphLinear:
+		case morphLinearAngle:
+		{
+			curve.curveType = curveLinear;
+			curve.angular = (morphType == morphLinearAngle);
+			for (int key = 0; key < numberOfKeyframes - 1; key++)
+				CompileLinearSegment(curve, key);
+			break;
+		}
+		case morphCatMullRom:
+		case morphCatMullRomAngle:
+		{
+			curve.curveType = curveCatmullRom;
+			curve.angular = (morphType == morphCatMullRomAngle);
+			for (int key = 0; key < numberOfKeyframes; key++)
+				CompileCatmullRomSegment(curve, key);
+			break;
+		}
+		case morphAkima:
+		case morphAkimaAngle:
+		case morphCubic:
+		case morphCubicAngle:
+		case morphSteffen:
+		case morphSteffenAngle:
+		{
+			curve.curveType = curveSpline;
+			curve.angular = (morphType == morphAkimaAngle || morphType == morphCubicAngle
+											 || morphType == morphSteffenAngle);
+			for (int key = 0; key < numberOfKeyframes; key++)
+				CompileSplineSegment(curve, key, morphType);
+			break;
+		}
+		default: curve.curveType = curveConstant; break;
+	}
+}
+
+void cKeyframeTimeline::CompileLinearSegment(sCurve &curve, int key)
+{
+	double v1[4], v2[4];
+	GetComponents(curve.keyParameters[key], v1);
+	GetComponents(curve.keyParameters[key + 1], v2);
+
+	for (int c = 0; c < curve.numberOfComponents; c++)
+	{
+		if (curve.angular)
+		{
+			QList<double *> vals;
+			vals << &v1[c] << &v2[c];
+			cMorph::NearestNeighbourAngle(vals);
+		}
+		sSegmentComponent &segment = curve.segments[size_t(key) * curve.numberOfComponents + c];
+		segment.a = v1[c];
+		segment.b = v2[c] - v1[c];
+	}
+}
+
+void cKeyframeTimeline::CompileCatmullRomSegment(sCurve &curve, int key)
+{
+	double v[4][4];
+	GetComponents(curve.keyParameters[ClampKey(key - 1)], v[0]);
+	GetComponents(curve.keyParameters[key], v[1]);
+	GetComponents(curve.keyParameters[ClampKey(key + 1)], v[2]);
+	GetComponents(curve.keyParameters[ClampKey(key + 2)], v[3]);
+
+	for (int c = 0; c < curve.numberOfComponents; c++)
+	{
+		double v1 = v[0][c], v2 = v[1][c], v3 = v[2][c], v4 = v[3][c];
+		if (curve.angular)
+		{
+			QList<double *> vals;
+			vals << &v1 << &v2 << &v3 << &v4;
+			cMorph::NearestNeighbourAngle(vals);
+		}
+
+		sSegmentComponent &segment = curve.segments[size_t(key) * curve.numberOfComponents + c];
+
+		// the same logarithmic mode as in cMorph::CatmullRomInterpolate()
+		if ((v1 > 0 && v2 > 0 && v3 > 0 && v4 > 0) || (v1 < 0 && v2 < 0 && v3 < 0 && v4 < 0))
+		{
+			if (v1 < 0) segment.negative = true;
+			double average = (v1 + v2 + v3 + v4) / 4.0;
+			if (average > 0)
+			{
+				double deviation = (fabs(v2 - v1) + fabs(v3 - v2) + fabs(v4 - v3)) / average;
+				if (deviation > 0.1)
+				{
+					v1 = log(fabs(v1));
+					v2 = log(fabs(v2));
+					v3 = log(fabs(v3));
+					v4 = log(fabs(v4));
+					segment.logarithmic = true;
+				}
+			}
+		}
+
+		segment.a = v2;
+		segment.b = 0.5 * (-v1 + v3);
+		segment.c = 0.5 * (2 * v1 - 5 * v2 + 4 * v3 - v4);
+		segment.d = 0.5 * (-v1 + 3 * v2 - 3 * v3 + v4);
+	}
+}
+
+void cKeyframeTimeline::CompileSplineSegment(sCurve &curve, int key, enumMorphType morphType)
+{
+	const int listSize = 6;
+	int k[listSize];
+	for (int i = 0; i < listSize; i++)
+		k[i] = ClampKey(key + i - 2);
+
+	// the same domain as in cMorph::Spline()
+	const double baseFramesPerKeyframe = double(numberOfSubFrames[k[2]]);
+	double x[listSize];
+	x[2] = 0.0;
+	x[3] = 1.0;
+	x[4] = x[3] + numberOfSubFrames[k[3]] / baseFramesPerKeyframe;
+	x[5] = x[4] + numberOfSubFrames[k[4]] / baseFramesPerKeyframe;
+	x[1] = x[2] - numberOfSubFrames[k[1]] / baseFramesPerKeyframe;
+	x[0] = x[1] - numberOfSubFrames[k[0]] / baseFramesPerKeyframe;
+
+	const gsl_interp_type *interpType;
+	switch (morphType)
+	{
+		case morphAkima:
+		case morphAkimaAngle: interpType = gsl_interp_akima; break;
+		case morphCubic:
+		case morphCubicAngle: interpType = gsl_interp_cspline; break;
+		default: interpType = gsl_interp_steffen; break;
+	}
+
+	double v[listSize][4];
+	for (int i = 0; i < listSize; i++)
+		GetComponents(curve.keyParameters[k[i]], v[i]);
+
+	gsl_spline *spline = gsl_spline_alloc(interpType, size_t(listSize));
+
+	for (int c = 0; c < curve.numberOfComponents; c++)
+	{
+		double y[listSize];
+		QList<double *> vals;
+		for (int i = 0; i < listSize; i++)
+		{
+			y[i] = v[i][c];
+			vals << &y[i];
+		}
+		if (curve.angular) cMorph::NearestNeighbourAngle(vals);
+
+		gsl_spline_init(spline, x, y, size_t(listSize));
+
+		// segment between x=0 and x=1 is a cubic polynomial, so it is fully described by value
+		// and derivatives at x=0 and value at x=1
+		sSegmentComponent &segment = curve.segments[size_t(key) * curve.numberOfComponents + c];
+		segment.a = gsl_spline_eval(spline, 0.0, nullptr);
+		segment.b = gsl_spline_eval_deriv(spline, 0.0, nullptr);
+		segment.c = gsl_spline_eval_deriv2(spline, 0.0, nullptr) * 0.5;
+		segment.d = gsl_spline_eval(spline, 1.0, nullptr) - segment.a - segment.b - segment.c;
+	}
+
+	gsl_spline_free(spline);
+}
+
+cOneParameter cKeyframeTimeline::Evaluate(int parameterIndex, int keyframe, double factor) const
+{
+	const sCurve &curve = curves[parameterIndex];
+	const cOneParameter &keyParameter = curve.keyParameters[keyframe];
+
+	if (curve.curveType == curveConstant
+			|| (curve.curveType == curveLinear && keyframe == numberOfKeyframes - 1))
+	{
+		return keyParameter;
+	}
+
+	double components[4];
+	const sSegmentComponent *segments = &curve.segments[size_t(keyframe) * curve.numberOfComponents];
+	for (int c = 0; c < curve.numberOfComponents; c++)
+	{
+		const sSegmentComponent &segment = segments[c];
+		double value = segment.a + factor * (segment.b + factor * (segment.c + factor * segment.d));
+
+		if (curve.curveType == curveCatmullRom)
+		{
+			if (segment.logarithmic) value = segment.negative ? -exp(value) : exp(value);
+			if (value > 1e20) value = 1e20;
+			if (value < -1e20) value = 1e20;
+			if (fabs(value) < 1e-20) value = 0.0;
+		}
+
+		if (curve.angular) value = LimitAngle(value);
+		components[c] = value;
+	}
+
+	cMultiVal val;
+	switch (curve.valueType)
+	{
+		case typeInt:
+		case typeDouble: val.Store(components[0]); break;
+		case typeRgb:
+			val.Store(sRGB(int(components[0]), int(components[1]), int(components[2])));
+			break;
+		case typeVector3: val.Store(CVector3(components[0], components[1], components[2])); break;
+		case typeVector4:
+			val.Store(CVector4(components[0], components[1], components[2], components[3]));
+			break;
+		default: return keyParameter;
+	}
+
+	cOneParameter interpolated = keyParameter;
+	interpolated.SetMultiVal(val, valueActual);
+	return interpolated;
+}
+
+int cKeyframeTimeline::NumberOfComponents(enumVarType type)
+{
+	switch (type)
+	{
+		case typeInt:
+		case typeDouble: return 1;
+		case typeRgb:
+		case typeVector3: return 3;
+		case typeVector4: return 4;
+		default: return 0;
+	}
+}
+
+void cKeyframeTimeline::GetComponents(const cOneParameter &parameter, double *components)
+{
+	const cMultiVal multiVal = parameter.GetMultiVal(valueActual);
+	switch (parameter.GetValueType())
+	{
+		case typeInt:
+		case typeDouble:
+		{
+			multiVal.Get(components[0]);
+			break;
+		}
+		case typeRgb:
+		{
+			sRGB color;
+			multiVal.Get(color);
+			components[0] = color.R;
+			components[1] = color.G;
+			components[2] = color.B;
+			break;
+		}
+		case typeVector3:
+		{
+			CVector3 vect;
+			multiVal.Get(vect);
+			components[0] = vect.x;
+			components[1] = vect.y;
+			components[2] = vect.z;
+			break;
+		}
+		case typeVector4:
+		{
+			CVector4 vect;
+			multiVal.Get(vect);
+			components[0] = vect.x;
+			components[1] = vect.y;
+			components[2] = vect.z;
+			components[3] = vect.w;
+			break;
+		}
+		default: break;
+	}
+}
@@ -0,0 +1,119 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2021 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cKeyframeTimeline - keyframe animation compiled into per-parameter curves
+ *
+ * For each animated parameter and each keyframe segment the interpolation (linear, Catmull-Rom
+ * or GSL spline) is fitted once and stored as cubic polynomial coefficients of the segment.
+ * Evaluation of a parameter for any frame is then O(1) and doesn't modify the object, so it
+ * can be called from many threads. Results are the same as from cMorph. Gradients are not
+ * compiled and are still interpolated by cMorph.
+ */
+
+#ifndef MANDELBULBER2_SRC_KEYFRAME_TIMELINE_HPP_
+#define MANDELBULBER2_SRC_KEYFRAME_TIMELINE_HPP_
+
+#include <vector>
+
+#include <QList>
+#include <QString>
+
+#include "animation_frames.hpp"
+#include "one_parameter.hpp"
+
+class cKeyframeTimeline
+{
+public:
+	// 'revision' is revision of cAnimationFrames for which the curves are compiled
+	void Compile(const QList<cAnimationFrames::sAnimationFrame> &frames,
+		const QList<cAnimationFrames::sParameterDescription> &listOfParameters, quint64 revision);
+	void Clear();
+	bool IsCompiledFor(quint64 revision) const
+	{
+		return isCompiled && compiledRevision == revision;
+	}
+	bool IsParameterCompiled(int parameterIndex) const { return curves[parameterIndex].compiled; }
+	const QString &GetFullParameterName(int parameterIndex) const
+	{
+		return curves[parameterIndex].fullParameterName;
+	}
+
+	// interpolated value of parameter. 'factor' is position between keyframe and next one <0,1)
+	cOneParameter Evaluate(int parameterIndex, int keyframe, double factor) const;
+
+private:
+	enum enumCurveType
+	{
+		curveConstant,
+		curveLinear,
+		curveCatmullRom,
+		curveSpline
+	};
+
+	struct sSegmentComponent
+	{
+		// value = a + b * t + c * t^2 + d * t^3
+		double a = 0.0;
+		double b = 0.0;
+		double c = 0.0;
+		double d = 0.0;
+		bool logarithmic = false;
+		bool negative = false;
+	};
+
+	struct sCurve
+	{
+		QString fullParameterName;
+		bool compiled = false;
+		bool angular = false;
+		enumCurveType curveType = curveConstant;
+		enumVarType valueType = typeNull;
+		int numberOfComponents = 0;
+		std::vector<cOneParameter> keyParameters;	// one per keyframe
+		std::vector<sSegmentComponent> segments; // [keyframe * numberOfComponents + component]
+	};
+
+	void CompileCurve(sCurve &curve, enumMorphType morphType);
+	void CompileLinearSegment(sCurve &curve, int key);
+	void CompileCatmullRomSegment(sCurve &curve, int key);
+	void CompileSplineSegment(sCurve &curve, int key, enumMorphType morphType);
+	int ClampKey(int key) const { return qBound(0, key, numberOfKeyframes - 1); }
+
+	static int NumberOfComponents(enumVarType type);
+	static void GetComponents(const cOneParameter &parameter, double *components);
+
+	std::vector<sCurve> curves;
+	std::vector<int> numberOfSubFrames;
+	int numberOfKeyframes = 0;
+	quint64 compiledRevision = 0;
+	bool isCompiled = false;
+};
+
+#endif /* MANDELBULBER2_SRC_KEYFRAME_TIMELINE_HPP_ */
@@ -72,6 +72,8 @@ cKeyframes &cKeyframes::operator=(const cKeyframes &source)
 	audioTracks = source.audioTracks;
 	keyframesIndexesTable = source.keyframesIndexesTable;
 	framesIndexesTable = source.framesIndexesTable;
+	revision = source.revision;
+	timeline = source.timeline;
 
 	return *this;
 }
@@ -82,42 +84,17 @@ cAnimationFrames::sAnimationFrame cKeyframes::GetInterpolatedFrame(int frameInde
 	Q_UNUSED(fractal);
 	int keyframe = GetKeyframeIndex(frameIndex);
 	int subIndex = GetSubIndex(frameIndex);
+	double factor = 1.0 * subIndex / GetFramesPerKeyframe(keyframe);
 
-	// if(subIndex == 0)
-	//{
-	// no need to interpolate
-	//	return GetFrame(keyframe);
-	//}
+	PrepareTimeline();
 
 	sAnimationFrame interpolated;
 
 	for (int i = 0; i < listOfParameters.size(); i++)
 	{
-		QString fullParameterName =
-			listOfParameters[i].containerName + "_" + listOfParameters[i].parameterName;
-
-		// prepare interpolator
-		if (morph.size() <= i)
-		{
-			morph.append(new cMorph());
-		}
-		for (int k = qMax(0, keyframe - 2); k <= qMin(frames.size() - 1, keyframe + 3); k++)
-		{
-			if (morph[i]->findInMorph(k) == -1)
-			{
-				morph[i]->AddData(k, frames.at(k).numberOfSubFrames,
-					frames.at(k).parameters.GetAsOneParameter(fullParameterName));
-			}
-		}
-		// interpolate each parameter
-		cOneParameter oneParameter =
-			morph[i]->Interpolate(keyframe, 1.0 * subIndex / GetFramesPerKeyframe(keyframe));
-
-		// apply audio animation
-
-		oneParameter =
-			ApplyAudioAnimation(frameIndex, oneParameter, listOfParameters[i].parameterName, params);
-		interpolated.parameters.AddParamFromOneParameter(fullParameterName, oneParameter);
+		cOneParameter oneParameter = InterpolateParameter(i, frameIndex, keyframe, factor, params);
+		interpolated.parameters.AddParamFromOneParameter(
+			timeline.GetFullParameterName(i), oneParameter);
 	}
 	return interpolated;
 }
@@ -127,17 +104,19 @@ void cKeyframes::GetInterpolatedFrameAndConsolidate(int index,
 {
 	if (index >= 0 && index < GetTotalNumberOfFrames())
 	{
-		sAnimationFrame frame = GetInterpolatedFrame(index, params, fractal);
+		int keyframe = GetKeyframeIndex(index);
+		int subIndex = GetSubIndex(index);
+		double factor = 1.0 * subIndex / GetFramesPerKeyframe(keyframe);
+
+		PrepareTimeline();
 
-		for (auto &listOfParameter : listOfParameters)
+		// values are written directly to containers without building temporary frame
+		for (int i = 0; i < listOfParameters.size(); i++)
 		{
 			std::shared_ptr<cParameterContainer> container =
-				ContainerSelector(listOfParameter.containerName, params, fractal);
-			QString parameterName = listOfParameter.parameterName;
-			cOneParameter oneParameter =
-				frame.parameters.GetAsOneParameter(listOfParameter.containerName + "_" + parameterName);
-
-			container->SetFromOneParameter(parameterName, oneParameter);
+				ContainerSelector(listOfParameters[i].containerName, params, fractal);
+			cOneParameter oneParameter = InterpolateParameter(i, index, keyframe, factor, params);
+			container->SetFromOneParameter(listOfParameters[i].parameterName, oneParameter);
 		}
 	}
 	else
@@ -147,6 +126,50 @@ void cKeyframes::GetInterpolatedFrameAndConsolidate(int index,
 	}
 }
 
+void cKeyframes::PrepareTimeline()
+{
+	// any change of keyframes invalidates compiled curves and interpolators of gradients
+	if (!timeline.IsCompiledFor(revision))
+	{
+		ClearMorphCache();
+		timeline.Compile(frames, listOfParameters, revision);
+	}
+}
+
+cOneParameter cKeyframes::InterpolateParameter(int parameterIndex, int frameIndex, int keyframe,
+	double factor, std::shared_ptr<cParameterContainer> params)
+{
+	cOneParameter oneParameter;
+
+	if (timeline.IsParameterCompiled(parameterIndex))
+	{
+		oneParameter = timeline.Evaluate(parameterIndex, keyframe, factor);
+	}
+	else
+	{
+		const QString &fullParameterName = timeline.GetFullParameterName(parameterIndex);
+
+		// prepare interpolator
+		while (morph.size() <= parameterIndex)
+		{
+			morph.append(new cMorph());
+		}
+		for (int k = qMax(0, keyframe - 2); k <= qMin(frames.size() - 1, keyframe + 3); k++)
+		{
+			if (morph[parameterIndex]->findInMorph(k) == -1)
+			{
+				morph[parameterIndex]->AddData(k, frames.at(k).numberOfSubFrames,
+					frames.at(k).parameters.GetAsOneParameter(fullParameterName));
+			}
+		}
+		oneParameter = morph[parameterIndex]->Interpolate(keyframe, factor);
+	}
+
+	// apply audio animation
+	return ApplyAudioAnimation(
+		frameIndex, oneParameter, listOfParameters[parameterIndex].parameterName, params);
+}
+
 void cKeyframes::ChangeMorphType(int parameterIndex, parameterContainer::enumMorphType morphType)
 {
 	using namespace parameterContainer;
@@ -154,6 +177,8 @@ void cKeyframes::ChangeMorphType(int parameterIndex, parameterContainer::enumMor
 	if (morphType != oldMorphType)
 	{
 		if (parameterIndex < morph.size()) morph[parameterIndex]->Clear();
+		timeline.Clear();
+		revision++;
 
 		listOfParameters[parameterIndex].morphType = morphType;
 		QString fullParameterName = listOfParameters[parameterIndex].containerName + "_"
@@ -170,20 +195,20 @@ void cKeyframes::ChangeMorphType(int parameterIndex, parameterContainer::enumMor
 void cKeyframes::AddAnimatedParameter(const QString &parameterName,
 	const cOneParameter &defaultValue, std::shared_ptr<cParameterContainer> params)
 {
-	morph.clear();
+	ClearMorphCache();
 	cAnimationFrames::AddAnimatedParameter(parameterName, defaultValue, params);
 }
 
 bool cKeyframes::AddAnimatedParameter(const QString &fullParameterName,
 	std::shared_ptr<cParameterContainer> param, std::shared_ptr<cFractalContainer> fractal)
 {
-	morph.clear();
+	ClearMorphCache();
 	return cAnimationFrames::AddAnimatedParameter(fullParameterName, param, fractal);
 }
 
 void cKeyframes::RemoveAnimatedParameter(const QString &fullParameterName)
 {
-	morph.clear();
+	ClearMorphCache();
 	cAnimationFrames::RemoveAnimatedParameter(fullParameterName);
 }
 
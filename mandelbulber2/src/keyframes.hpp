@@ -34,7 +34,8 @@
  * Handles the 2D matrix of the list of parameters / list of frames
  * and exposes functions to modify this matrix. This functionality is
  * derived from the cAnimationFrames class. Additionally this class
- * interpolates sub-frames with the help of the cMorph class.
+ * interpolates sub-frames with the help of the cKeyframeTimeline class
+ * (and cMorph class for parameters which can't be compiled).
  */
 
 #ifndef MANDELBULBER2_SRC_KEYFRAMES_HPP_
@@ -44,6 +45,7 @@
 #include <vector>
 
 #include "animation_frames.hpp"
+#include "keyframe_timeline.hpp"
 #include "morph.hpp"
 
 class cKeyframes : public cAnimationFrames
@@ -63,7 +65,12 @@ public:
 		std::shared_ptr<cFractalContainer> fractal);
 	int GetFramesPerKeyframe(int keyframeIndex) const;
 	void ChangeMorphType(int parameterIndex, parameterContainer::enumMorphType morphType);
-	void ClearMorphCache() { morph.clear(); }
+	void ClearMorphCache()
+	{
+		qDeleteAll(morph);
+		morph.clear();
+		timeline.Clear();
+	}
 	void AddAnimatedParameter(const QString &parameterName, const cOneParameter &defaultValue,
 		std::shared_ptr<cParameterContainer> params = nullptr) override;
 	bool AddAnimatedParameter(const QString &fullParameterName,
@@ -79,7 +86,12 @@ public:
 	const std::vector<int> &getFramesIndexesTable() const { return framesIndexesTable; }
 
 private:
+	void PrepareTimeline();
+	cOneParameter InterpolateParameter(int parameterIndex, int frameIndex, int keyframe,
+		double factor, std::shared_ptr<cParameterContainer> params);
+
 	QList<cMorph *> morph;
+	cKeyframeTimeline timeline;
 	std::vector<int> keyframesIndexesTable;
 	std::vector<int> framesIndexesTable;
 };
@@ -34,6 +34,9 @@
 
 #include "lights.hpp"
 
+#include <algorithm>
+#include <limits>
+
 #include "calculate_distance.hpp"
 #include "common_math.h"
 #include "fractal_container.hpp"
@@ -123,9 +126,16 @@ void cLights::Set(const std::shared_ptr<cParameterContainer> _params,
 		enumRandomLightsColoringType coloringType =
 			enumRandomLightsColoringType(_params->Get<int>("random_lights_coloring_type"));
 
-		sDistanceOut distanceOut;
 		cRandom random;
 		random.Initialize(randomSeed);
+		cRandom speculativeRandom;
+
+		const int maxTrials = 100000;
+		const int minBatchSize = qMax(systemData.numberOfThreads, 4);
+		const int maxBatchSize = 1024;
+		std::vector<CVector3> candidates(maxBatchSize);
+		std::vector<double> candidateDistances(maxBatchSize);
+		std::vector<double> radiusMultipliersAfter(maxBatchSize);
 
 		for (int i = 0; i < numberOfRandomLights; i++)
 		{
@@ -133,22 +143,59 @@ void cLights::Set(const std::shared_ptr<cParameterContainer> _params,
 			double radiusMultiplier = 1.0;
 			double distance = 0;
 			CVector3 position;
-
-			// try random positioning of light, until distance to surface satisfies
-			while (distance <= 0 || distance >= maxDistanceFromFractal * radiusMultiplier)
+			bool positioned = false;
+			int batchSize = minBatchSize;
+
+			// try random positioning of light, until distance to surface satisfies. Trials are
+			// calculated in parallel batches from a copy of random generator. Then the main generator
+			// is advanced only by the trials really used, so positions are the same as for
+			// sequential calculation
+			while (!positioned)
 			{
-				CVector3 rv;
-				rv.x = random.DoubleRandom(-1.0, 1.0);
-				rv.y = random.DoubleRandom(-1.0, 1.0);
-				rv.z = random.DoubleRandom(-1.0, 1.0);
-				position = randomLightsCenter + rv * distributionRadius * radiusMultiplier;
-
-				sDistanceIn distanceIn(position, 0.0, false);
-				distance = CalculateDistance(*params, *fractals, distanceIn, &distanceOut);
-
-				trialNumber++;
-				if (trialNumber % 100 == 0) radiusMultiplier *= 1.01;
-				if (trialNumber > 100000) break;
+				speculativeRandom.CopyStateFrom(random);
+				double multiplier = radiusMultiplier;
+				for (int k = 0; k < batchSize; k++)
+				{
+					CVector3 rv;
+					rv.x = speculativeRandom.DoubleRandom(-1.0, 1.0);
+					rv.y = speculativeRandom.DoubleRandom(-1.0, 1.0);
+					rv.z = speculativeRandom.DoubleRandom(-1.0, 1.0);
+					candidates[k] = randomLightsCenter + rv * distributionRadius * multiplier;
+					if ((trialNumber + k + 1) % 100 == 0) multiplier *= 1.01;
+					radiusMultipliersAfter[k] = multiplier;
+				}
+
+#pragma omp parallel for schedule(dynamic, 1)
+				for (int k = 0; k < batchSize; k++)
+				{
+					sDistanceIn distanceIn(candidates[k], 0.0, false);
+					sDistanceOut distanceOut;
+					candidateDistances[k] = CalculateDistance(*params, *fractals, distanceIn, &distanceOut);
+				}
+
+				int usedTrials = batchSize;
+				for (int k = 0; k < batchSize; k++)
+				{
+					const double trialDistance = candidateDistances[k];
+					const bool accepted =
+						trialDistance > 0 && trialDistance < maxDistanceFromFractal * radiusMultipliersAfter[k];
+					if (accepted || trialNumber + k + 1 > maxTrials)
+					{
+						usedTrials = k + 1;
+						position = candidates[k];
+						distance = trialDistance;
+						positioned = true;
+						break;
+					}
+				}
+
+				// advance main generator by used trials
+				for (int k = 0; k < usedTrials * 3; k++)
+					random.DoubleRandom(-1.0, 1.0);
+
+				radiusMultiplier = radiusMultipliersAfter[usedTrials - 1];
+				trialNumber += usedTrials;
+				batchSize = qMin(batchSize * 2, maxBatchSize);
 			}
 
 			sRGBFloat colour;
@@ -223,11 +270,205 @@ void cLights::Set(const std::shared_ptr<cParameterContainer> _params,
 		}
 	}
 
+	BuildLightTree();
+
 	lightsReady = true;
 
 	WriteLog("Preparation of lights finished", 2);
 }
 
+void cLights::BuildLightTree()
+{
+	lightTree.clear();
+	treeLightIndices.clear();
+	lightsOutsideTree.clear();
+
+	// only omnidirectional lights are in the tree, because contribution of them can be bounded
+	// using distance only
+	for (int i = 0; i < int(lights.size()); i++)
+	{
+		const cLight &light = lights[i];
+		if (light.enabled && light.type == cLight::lightPoint)
+			treeLightIndices.push_back(i);
+		else
+			lightsOutsideTree.push_back(i);
+	}
+
+	const int minLightsForTree = 32;
+	if (int(treeLightIndices.size()) < minLightsForTree)
+	{
+		for (int index : treeLightIndices)
+			lightsOutsideTree.push_back(index);
+		std::sort(lightsOutsideTree.begin(), lightsOutsideTree.end());
+		treeLightIndices.clear();
+		return;
+	}
+
+	lightTree.reserve(treeLightIndices.size());
+	lightTree.emplace_back();
+	BuildLightTreeNode(0, 0, int(treeLightIndices.size()));
+
+	WriteLog(QString("Light tree built: %1 lights, %2 nodes")
+						 .arg(treeLightIndices.size())
+						 .arg(lightTree.size()),
+		2);
+}
+
+void cLights::BuildLightTreeNode(int nodeIndex, int first, int count)
+{
+	const int maxLightsInLeaf = 4;
+
+	sLightTreeNode node;
+	node.firstLight = first;
+	node.numberOfLights = count;
+	node.boxMin = lights[treeLightIndices[first]].position;
+	node.boxMax = node.boxMin;
+	node.decayExponentMin = lights[treeLightIndices[first]].decayFunction + 1;
+	node.decayExponentMax = node.decayExponentMin;
+
+	for (int i = first; i < first + count; i++)
+	{
+		const cLight &light = lights[treeLightIndices[i]];
+		const CVector3 &p = light.position;
+		node.boxMin =
+			CVector3(qMin(node.boxMin.x, p.x), qMin(node.boxMin.y, p.y), qMin(node.boxMin.z, p.z));
+		node.boxMax =
+			CVector3(qMax(node.boxMax.x, p.x), qMax(node.boxMax.y, p.y), qMax(node.boxMax.z, p.z));
+		node.totalPower += LightPower(light);
+		node.decayExponentMin = qMin(node.decayExponentMin, int(light.decayFunction) + 1);
+		node.decayExponentMax = qMax(node.decayExponentMax, int(light.decayFunction) + 1);
+	}
+
+	if (count > maxLightsInLeaf)
+	{
+		// split by median along the longest axis
+		CVector3 size = node.boxMax - node.boxMin;
+		int axis = 0;
+		if (size.y > size.x && size.y >= size.z) axis = 1;
+		if (size.z > size.x && size.z > size.y) axis = 2;
+
+		const int half = count / 2;
+		std::nth_element(treeLightIndices.begin() + first, treeLightIndices.begin() + first + half,
+			treeLightIndices.begin() + first + count, [this, axis](int a, int b) {
+				const CVector3 &pa = lights[a].position;
+				const CVector3 &pb = lights[b].position;
+				return (axis == 0) ? pa.x < pb.x : (axis == 1) ? pa.y < pb.y : pa.z < pb.z;
+			});
+
+		node.firstChild = int(lightTree.size());
+		lightTree.emplace_back();
+		lightTree.emplace_back();
+		lightTree[nodeIndex] = node;
+
+		BuildLightTreeNode(node.firstChild, first, half);
+		BuildLightTreeNode(node.firstChild + 1, first + half, count - half);
+	}
+	else
+	{
+		lightTree[nodeIndex] = node;
+	}
+}
+
+float cLights::LightPower(const cLight &light)
+{
+	return light.intensity * dMax(light.color.R, light.color.G, light.color.B);
+}
+
+double cLights::DistanceToBox(const sLightTreeNode &node, const CVector3 &point)
+{
+	const double dx = qMax(qMax(node.boxMin.x - point.x, point.x - node.boxMax.x), 0.0);
+	const double dy = qMax(qMax(node.boxMin.y - point.y, point.y - node.boxMax.y), 0.0);
+	const double dz = qMax(qMax(node.boxMin.z - point.z, point.z - node.boxMax.z), 0.0);
+	return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+float cLights::NodeContributionBound(const sLightTreeNode &node, const CVector3 &point)
+{
+	const double distance = DistanceToBox(node, point);
+	if (distance <= 0.0) return std::numeric_limits<float>::max();
+
+	// the weakest decay for given distance
+	const double decay =
+		qMin(pow(distance, node.decayExponentMin), pow(distance, node.decayExponentMax));
+	return float(node.totalPower / decay);
+}
+
+float cLights::LightContributionBound(const cLight &light, const CVector3 &point)
+{
+	const float distance = (light.position - point).Length();
+	if (distance <= 0.0f) return std::numeric_limits<float>::max();
+	return LightPower(light) / light.Decay(distance);
+}
+
+double cLights::NodeImportance(const sLightTreeNode &node, const CVector3 &point)
+{
+	// estimation with 1/r^2 decay. Distance is limited by size of the node
+	const CVector3 center = (node.boxMin + node.boxMax) * 0.5;
+	const double radius2 = (node.boxMax - node.boxMin).Dot(node.boxMax - node.boxMin) * 0.25;
+	const double distance2 = (center - point).Dot(center - point);
+	return node.totalPower / qMax(qMax(distance2, radius2), 1e-30);
+}
+
+const cLight *cLights::SampleLightFromTree(
+	const CVector3 &point, double randomValue, float *probability) const
+{
+	*probability = 0.0f;
+	if (!lightsReady || lightTree.empty()) return nullptr;
+
+	double pdf = 1.0;
+	const sLightTreeNode *node = &lightTree[0];
+
+	// random value is rescaled on every level, so it can be reused for next decision
+	while (node->firstChild >= 0)
+	{
+		const sLightTreeNode &child1 = lightTree[node->firstChild];
+		const sLightTreeNode &child2 = lightTree[node->firstChild + 1];
+		const double importance1 = NodeImportance(child1, point);
+		const double importance2 = NodeImportance(child2, point);
+		const double sum = importance1 + importance2;
+		if (sum <= 0.0) return nullptr;
+
+		const double probability1 = importance1 / sum;
+		if (randomValue < probability1)
+		{
+			node = &child1;
+			pdf *= probability1;
+			randomValue = randomValue / probability1;
+		}
+		else
+		{
+			node = &child2;
+			pdf *= 1.0 - probability1;
+			randomValue = (randomValue - probability1) / (1.0 - probability1);
+		}
+		randomValue = qBound(0.0, randomValue, 0.999999999);
+	}
+
+	double importances[8];
+	double sum = 0.0;
+	for (int i = 0; i < node->numberOfLights; i++)
+	{
+		const cLight &light = lights[treeLightIndices[node->firstLight + i]];
+		const double distance2 = (light.position - point).Dot(light.position - point);
+		importances[i] = LightPower(light) / qMax(distance2, 1e-30);
+		sum += importances[i];
+	}
+	if (sum <= 0.0) return nullptr;
+
+	double accumulated = 0.0;
+	for (int i = 0; i < node->numberOfLights; i++)
+	{
+		const double lightProbability = importances[i] / sum;
+		accumulated += lightProbability;
+		if (randomValue < accumulated || i == node->numberOfLights - 1)
+		{
+			*probability = float(pdf * lightProbability);
+			return &lights[treeLightIndices[node->firstLight + i]];
+		}
+	}
+	return nullptr;
+}
+
 const cLight *cLights::GetLight(const int index) const
 {
 	if (lightsReady)
@@ -35,6 +35,7 @@
 #ifndef MANDELBULBER2_SRC_LIGHTS_HPP_
 #define MANDELBULBER2_SRC_LIGHTS_HPP_
 
+#include <limits>
 #include <memory>
 #include <vector>
 
@@ -74,7 +75,44 @@ public:
 	int IsAnyLightEnabled() const { return isAnyLight; };
 	static QList<int> GetListOfLights(std::shared_ptr<cParameterContainer> params);
 
+	// light tree is built when there is large number of point lights (e.g. random lights)
+	bool IsLightTreeUsed() const { return !lightTree.empty(); }
+	// calls function(const cLight *) for all lights which are not a part of light tree and for
+	// lights from the tree which can give bigger intensity / Decay(distance) than 'cutoff'
+	template <typename F>
+	void ForEachSignificantLight(const CVector3 &point, float cutoff, F function) const;
+	// calls function(const cLight *) for all lights which are not a part of light tree
+	template <typename F>
+	void ForEachLightOutsideTree(F function) const;
+	// chooses single light from the tree proportionally to its estimated contribution in the point.
+	// 'randomValue' has to be in range [0, 1)
+	const cLight *SampleLightFromTree(
+		const CVector3 &point, double randomValue, float *probability) const;
+
+	// lights which give less than this value are skipped when light tree is used
+	static constexpr float lightTreeCutoff = 1e-3f;
+
 private:
+	struct sLightTreeNode
+	{
+		CVector3 boxMin;
+		CVector3 boxMax;
+		float totalPower = 0.0f; // sum of intensity * max color component
+		int decayExponentMin = 1;
+		int decayExponentMax = 1;
+		int firstChild = -1; // children are stored together, -1 for leaf
+		int firstLight = 0;	 // index in treeLightIndices
+		int numberOfLights = 0;
+	};
+
+	void BuildLightTree();
+	void BuildLightTreeNode(int nodeIndex, int first, int count);
+	static float LightPower(const cLight &light);
+	static double DistanceToBox(const sLightTreeNode &node, const CVector3 &point);
+	static float NodeContributionBound(const sLightTreeNode &node, const CVector3 &point);
+	static float LightContributionBound(const cLight &light, const CVector3 &point);
+	static double NodeImportance(const sLightTreeNode &node, const CVector3 &point);
+
 	enum class enumRandomLightsColoringType
 	{
 		random = 0,
@@ -86,6 +124,9 @@ private:
 	void Copy(const cLights &);
 
 	std::vector<cLight> lights;
+	std::vector<sLightTreeNode> lightTree;
+	std::vector<int> treeLightIndices;
+	std::vector<int> lightsOutsideTree;
 	cLight dummyLight;
 	int numberOfLights;
 	bool lightsReady;
@@ -95,4 +136,48 @@ signals:
 	void updateProgressAndStatus(const QString &text, const QString &progressText, double progress);
 };
 
+template <typename F>
+void cLights::ForEachLightOutsideTree(F function) const
+{
+	if (!lightsReady) return;
+
+	for (int index : lightsOutsideTree)
+	{
+		function(&lights[index]);
+	}
+}
+
+template <typename F>
+void cLights::ForEachSignificantLight(const CVector3 &point, float cutoff, F function) const
+{
+	ForEachLightOutsideTree(function);
+
+	if (!lightsReady || lightTree.empty()) return;
+
+	// depth of the tree is limited by number of lights, so small stack is enough
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const sLightTreeNode &node = lightTree[stack[--stackSize]];
+		if (NodeContributionBound(node, point) < cutoff) continue;
+
+		if (node.firstChild < 0)
+		{
+			for (int i = 0; i < node.numberOfLights; i++)
+			{
+				const cLight &light = lights[treeLightIndices[node.firstLight + i]];
+				if (LightContributionBound(light, point) >= cutoff) function(&light);
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.firstChild;
+			stack[stackSize++] = node.firstChild + 1;
+		}
+	}
+}
+
 #endif /* MANDELBULBER2_SRC_LIGHTS_HPP_ */
@@ -74,6 +74,13 @@ int main(int argc, char *argv[])
 	// Initialization of system functions
 	InitSystem();
 
+	// time stamps of startup phases (reported with --benchmark-startup)
+	QList<QPair<QString, qint64>> startupPhases;
+	auto startupPhaseFinished = [&startupPhases](const QString &phaseName) {
+		startupPhases.append(qMakePair(phaseName, systemData.globalTimer.nsecsElapsed()));
+	};
+	startupPhaseFinished("system initialization");
+
 	// configure debug output
 	qInstallMessageHandler(myMessageOutput);
 
@@ -129,6 +136,7 @@ int main(int argc, char *argv[])
 		qCritical() << "Files/directories initialization failed";
 		return 73;
 	}
+	startupPhaseFinished("application objects and default folders");
 
 	// create internal database with parameters
 	gPar.reset(new cParameterContainer);
@@ -147,9 +155,11 @@ int main(int argc, char *argv[])
 		gParFractal->at(i)->SetContainerName(QString("fractal") + QString::number(i));
 		InitFractalParams(gParFractal->at(i));
 	}
+	startupPhaseFinished("parameter definitions");
 
 	// Define list of fractal formulas
 	DefineFractalList(&newFractalList);
+	startupPhaseFinished("fractal formula list");
 
 	// Netrender
 	gNetRender = new cNetRender(gMainInterface);
@@ -170,6 +180,7 @@ int main(int argc, char *argv[])
 	// texture cache
 	gTextureCache.reset(new cTextureCache);
 	gTextureCache->setMaxSize(gPar->Get<int>("maximum_texture_cache_size") * 1024L * 1024L);
+	gTextureCache->setDiskCacheEnabled(gPar->Get<bool>("texture_disk_cache"));
 
 	UpdateDefaultPaths();
 	if (!commandLineInterface.isNoGUI())
@@ -178,6 +189,7 @@ int main(int argc, char *argv[])
 		UpdateUISkin();
 	}
 	UpdateLanguage();
+	startupPhaseFinished("application settings");
 
 #ifdef USE_OPENCL
 	gOpenCl = new cGlobalOpenCl(gApplication);
@@ -189,6 +201,10 @@ int main(int argc, char *argv[])
 	gOpenCl->Reset();
 	gOpenCl->InitPlatfromAndDevices();
 #endif
+	startupPhaseFinished("command line and OpenCL initialization");
+
+	if (commandLineInterface.isStartupBenchmark())
+		commandLineInterface.printStartupBenchmarkAndExit(startupPhases);
 
 	if (!commandLineInterface.isNoGUI())
 	{
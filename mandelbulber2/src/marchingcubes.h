@@ -38,6 +38,7 @@
 #define MANDELBULBER2_SRC_MARCHINGCUBES_H_
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -56,12 +57,15 @@ class MarchingCubes : public QObject
 	Q_OBJECT
 
 public:
+	// called after each slab with new vertices, triangles (global vertex indices) and color indices
+	using tSlabCallback = std::function<void(const std::vector<double> &vertices,
+		const std::vector<long long> &polygons, const std::vector<double> &colorIndices)>;
+
 	MarchingCubes(std::shared_ptr<const cParameterContainer> paramsContainer,
 		std::shared_ptr<const cFractalContainer> fractalContainer, std::shared_ptr<sParamRender> params,
 		std::shared_ptr<cNineFractals> fractals, std::shared_ptr<sRenderData> renderData, int numx,
 		int numy, int numz, const CVector3 &lower, const CVector3 &upper, double dist_thresh,
-		bool *stop, std::vector<double> &vertices, std::vector<long long> &polygons,
-		std::vector<double> &colorIndices);
+		bool *stop, tSlabCallback slabReady);
 
 	~MarchingCubes() override { FreeBuffers(); }
 
@@ -110,12 +114,19 @@ private:
 	bool coloredMesh;
 
 	bool *stop;
-	std::vector<double> &vertices;
-	std::vector<long long> &polygons;
-	std::vector<double> &colorIndices;
+	tSlabCallback slabReady;
+
+	// mesh data of the current slab only
+	std::vector<double> vertices;
+	std::vector<long long> polygons;
+	std::vector<double> colorIndices;
+	long long vertexOffset;
+	quint64 polygonCount;
 
 	void calculateVoxelPlane(int i);
 
+	void flushSlab();
+
 	void calculateEdges(int i);
 
 	double getDistance(double x, double y, double z, double *colorIndex) const;
@@ -321,6 +321,18 @@ void cMaterial::setParameters(int _id, const std::shared_ptr<cParameterContainer
 	fresnelReflectance = materialParam->Get<bool>(Name("fresnel_reflectance", id));
 	useColorsFromPalette = materialParam->Get<bool>(Name("use_colors_from_palette", id));
 
+	// gradients are sampled for every shaded point, so they are baked into lookup tables
+	if (useColorsFromPalette)
+	{
+		if (surfaceGradientEnable) gradientSurface.BakeLookupTable(false);
+		if (specularGradientEnable) gradientSpecular.BakeLookupTable(false);
+		if (diffuseGradientEnable) gradientDiffuse.BakeLookupTable(false);
+		if (luminosityGradientEnable) gradientLuminosity.BakeLookupTable(false);
+		if (roughnessGradientEnable) gradientRoughness.BakeLookupTable(false);
+		if (reflectanceGradientEnable) gradientReflectance.BakeLookupTable(false);
+		if (transparencyGradientEnable) gradientTransparency.BakeLookupTable(false);
+	}
+
 	useColorTexture = materialParam->Get<bool>(Name("use_color_texture", id));
 	useDiffusionTexture = materialParam->Get<bool>(Name("use_diffusion_texture", id));
 	useLuminosityTexture = materialParam->Get<bool>(Name("use_luminosity_texture", id));
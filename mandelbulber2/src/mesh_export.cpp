@@ -127,16 +127,54 @@ void cMeshExport::ProcessVolume()
 
 	progressText.ResetTimer();
 
-	std::vector<double> vertices;
-	std::vector<long long> polygons;
-	std::vector<double> colorIndices;
+	// mesh is streamed to the file slab by slab
+	meshConfig.limitMin = limitMin;
+	meshConfig.limitMax = limitMax;
+	std::unique_ptr<MeshFileSave> meshFileSave(MeshFileSave::create(outputFileName, meshConfig));
+	if (!meshFileSave)
+	{
+		emit finished();
+		return;
+	}
+	QObject::connect(meshFileSave.get(), &MeshFileSave::updateProgressAndStatus, this,
+		&cMeshExport::signalUpdateProgressAndStatus);
+	if (!meshFileSave->Open())
+	{
+		emit finished();
+		return;
+	}
+
+	cColorGradient gradient;
+	gradient.SetColorsFromString(gPar->Get<QString>("mat1_surface_color_gradient"));
+	double colorSpeed = gPar->Get<double>("mat1_coloring_speed");
+	double colorOffset = gPar->Get<double>("mat1_coloring_palette_offset");
+	bool coloredMesh = meshConfig.contentTypes.contains(MeshFileSave::MESH_CONTENT_COLOR);
+	std::vector<sRGB8> colorsRGB;
+
+	auto slabReady = [&](const std::vector<double> &vertices, const std::vector<long long> &polygons,
+										 const std::vector<double> &colorIndices)
+	{
+		colorsRGB.clear();
+		if (coloredMesh)
+		{
+			colorsRGB.reserve(colorIndices.size());
+			for (double colorIndice : colorIndices)
+			{
+				double nrCol = fmod(fabs(colorIndice), 248.0 * 256.0); // kept for compatibility
+				double colorPosition = fmod(nrCol / 256.0 / 10.0 * colorSpeed + colorOffset, 1.0);
+				sRGB color = gradient.GetColor(colorPosition, false);
+				colorsRGB.emplace_back(uchar(color.R), uchar(color.G), uchar(color.B));
+			}
+		}
+		meshFileSave->AddSlab(vertices, polygons, colorsRGB);
+	};
 
 	WriteLog("Starting marching cubes...", 2);
 	MarchingCubes *marchingCube;
 	try
 	{
 		marchingCube = new MarchingCubes(gPar, gParFractal, params, fractals, renderData, w, h, l,
-			limitMin, limitMax, dist_thresh, &stop, vertices, polygons, colorIndices);
+			limitMin, limitMax, dist_thresh, &stop, slabReady);
 	}
 	catch (std::bad_alloc &ba)
 	{
@@ -144,6 +182,7 @@ void cMeshExport::ProcessVolume()
 													 + ", maybe required mesh dimension to big?";
 		qCritical() << errorMessage;
 		emit signalUpdateProgressAndStatus(errorMessage, "Error occured", 0.0);
+		meshFileSave->Close();
 		emit finished();
 		return;
 	}
@@ -165,27 +204,7 @@ void cMeshExport::ProcessVolume()
 
 	WriteLog("Marching cubes done.", 2);
 
-	std::vector<sRGB8> colorsRGB;
-	cColorGradient gradient;
-	gradient.SetColorsFromString(gPar->Get<QString>("mat1_surface_color_gradient"));
-	double colorSpeed = gPar->Get<double>("mat1_coloring_speed");
-	double colorOffset = gPar->Get<double>("mat1_coloring_palette_offset");
-
-	for (double colorIndice : colorIndices)
-	{
-		double nrCol = fmod(fabs(colorIndice), 248.0 * 256.0); // kept for compatibility
-		double colorPosition = fmod(nrCol / 256.0 / 10.0 * colorSpeed + colorOffset, 1.0);
-		sRGB color = gradient.GetColor(colorPosition, false);
-		sRGB8 color8(uchar(color.R), uchar(color.G), uchar(color.B));
-		colorsRGB.push_back(color8);
-	}
-
-	// Save to file
-	MeshFileSave::structSaveMeshData meshData(&vertices, &polygons, &colorsRGB);
-	MeshFileSave *meshFileSave = MeshFileSave::create(outputFileName, meshConfig, meshData);
-	QObject::connect(meshFileSave, &MeshFileSave::updateProgressAndStatus, this,
-		&cMeshExport::signalUpdateProgressAndStatus);
-	meshFileSave->SaveMesh();
+	meshFileSave->Close();
 
 	QString statusText;
 	if (stop)
@@ -193,7 +212,7 @@ void cMeshExport::ProcessVolume()
 	else
 		statusText = tr("Mesh Export finished - Processed %1 layers and got %2 polygons")
 									 .arg(w)
-									 .arg(polygons.size() / 3);
+									 .arg(meshFileSave->GetPolygonCount());
 	emit signalUpdateProgressAndStatus(statusText, progressText.getText(1.0), 1.0);
 	emit finished();
 }
@@ -282,6 +282,24 @@ QString cNetRender::GetFileFromNetRender(QString requiredFileName, int frameInde
 {
 	// this method need to be thread safe!
 
+	// textures of the current job are kept in persistent cache addressed by content hash
+	if (!requiredFileName.contains('%'))
+	{
+		QString cachedTexture = netRenderClient->GetCachedTextureFileName(requiredFileName);
+		if (!cachedTexture.isEmpty())
+		{
+			if (QFile::exists(cachedTexture)
+					|| netRenderClient->RequestTextureFromServer(requiredFileName))
+			{
+				return cachedTexture;
+			}
+
+			// texture was not received or its content doesn't match the job
+			WriteLog(QString("NetRender - cannot get texture %1 from server").arg(requiredFileName), 1);
+			return QString();
+		}
+	}
+
 	QCryptographicHash hashCrypt(QCryptographicHash::Md4);
 	hashCrypt.addData(requiredFileName.toLocal8Bit());
 	if (requiredFileName.contains('%'))
@@ -35,7 +35,9 @@
 #include "netrender_client.hpp"
 
 #include <QAbstractSocket>
+#include <QCryptographicHash>
 #include <QHostInfo>
+#include <QSaveFile>
 
 #include "animation_flight.hpp"
 #include "animation_keyframes.hpp"
@@ -70,8 +72,8 @@ CNetRenderClient::CNetRenderClient(QObject *parent) : QObject(parent)
 		&CNetRenderClient::SendFileDataChunk);
 	connect(
 		this, &CNetRenderClient::AddFileToSender, fileSender, &cNetRenderFileSender::AddFileToQueue);
-	connect(
-		this, &CNetRenderClient::AckReceived, fileSender, &cNetRenderFileSender::AcknowledgeReceived);
+	connect(this, &CNetRenderClient::FileAckReceived, fileSender,
+		&cNetRenderFileSender::AcknowledgeReceived);
 	connect(this, &CNetRenderClient::SignalRequestFileFromServer, this,
 		&CNetRenderClient::SlotRequestFileFromServer, Qt::QueuedConnection);
 }
@@ -161,6 +163,8 @@ void CNetRenderClient::ServerDisconnected()
 
 	gMainInterface->stopRequest = true;
 
+	fileSender->ConnectionLost();
+
 	// if reconnect timer is null, the client has been disabled
 	if (reconnectTimer) reconnectTimer->start();
 
@@ -191,11 +195,60 @@ void CNetRenderClient::SendStatusToServer(netRenderStatus status)
 
 QByteArray *CNetRenderClient::GetTexture(const QString &textureName, int frameNo)
 {
-	const QList<QString> keys = textures.keys();
+	QMutexLocker lock(&texturesMutex);
+	const QList<QString> keys = textureHashes.keys();
 	QString animatedTextureName = AnimatedFileName(textureName, frameNo, &keys);
+
+	// textures are loaded from persistent cache on first use
+	if (!textures.contains(animatedTextureName) && textureHashes.contains(animatedTextureName))
+	{
+		QString fileInCache =
+			CachedTextureFileName(textureHashes.value(animatedTextureName), animatedTextureName);
+		if (!QFile::exists(fileInCache))
+		{
+			lock.unlock();
+			RequestTextureFromServer(animatedTextureName);
+			lock.relock();
+		}
+
+		QFile file(fileInCache);
+		if (file.open(QIODevice::ReadOnly))
+		{
+			textures.insert(animatedTextureName, file.readAll());
+			file.close();
+		}
+	}
 	return &textures[animatedTextureName];
 }
 
+QString CNetRenderClient::GetCachedTextureFileName(const QString &textureName)
+{
+	// called from texture loading threads while a new job can replace the hashes
+	QMutexLocker lock(&texturesMutex);
+	return CachedTextureFileName(textureHashes.value(textureName), textureName);
+}
+
+QString CNetRenderClient::CachedTextureFileName(
+	const QByteArray &hash, const QString &textureName)
+{
+	if (hash.isEmpty()) return QString();
+
+	return systemDirectories.GetNetrenderTextureCacheFolder() + QDir::separator()
+				 + QString::fromLatin1(hash) + "." + QFileInfo(textureName).suffix();
+}
+
+bool CNetRenderClient::RequestTextureFromServer(const QString &textureName)
+{
+	QMutexLocker lock(&texturesMutex);
+	QByteArray hash = textureHashes.value(textureName);
+	lock.unlock();
+	if (hash.isEmpty()) return false;
+
+	// texture is addressed by its content, so server can send it regardless of its local path
+	return RequestFileFromServer(
+		QString("HASH[%1]%2").arg(QString::fromLatin1(hash), textureName), -1);
+}
+
 // send rendered lines
 void CNetRenderClient::SendRenderedLines(
 	const QList<int> &lineNumbers, const QList<QByteArray> &lines)
@@ -225,6 +278,7 @@ void CNetRenderClient::ProcessData()
 		case netRenderCmd_RENDER: ProcessRequestRender(inMsg); break;
 		case netRenderCmd_SETUP: ProcessRequestSetup(inMsg); break;
 		case netRenderCmd_ACK: ProcessRequestAck(inMsg); break;
+		case netRenderCmd_FILE_ACK: ProcessRequestFileAck(inMsg); break;
 		case netRenderCmd_KICK_AND_KILL: ProcessRequestKickAndKill(inMsg); break;
 		case netRenderCmd_ANIM_FLIGHT: ProcessRequestRenderAnimation(inMsg); break;
 		case netRenderCmd_ANIM_KEY: ProcessRequestRenderAnimation(inMsg); break;
@@ -246,7 +300,13 @@ void CNetRenderClient::ProcessRequestVersion(sMessage *inMsg)
 	buffer.resize(size);
 	stream.readRawData(buffer.data(), size);
 	serverName = QString::fromUtf8(buffer.data(), buffer.size());
-	if (cNetRenderTransport::CompareMajorVersion(serverVersion, cNetRenderTransport::version()))
+
+	// servers older than protocol versioning don't send it
+	qint32 serverProtocolVersion = 0;
+	if (!stream.atEnd()) stream >> serverProtocolVersion;
+
+	if (cNetRenderTransport::CompareMajorVersion(serverVersion, cNetRenderTransport::version())
+			&& serverProtocolVersion == cNetRenderTransport::protocolVersion())
 	{
 		QString connectionMsg =
 			"NetRender - version matches (" + QString::number(cNetRenderTransport::version()) + ")";
@@ -268,21 +328,28 @@ void CNetRenderClient::ProcessRequestVersion(sMessage *inMsg)
 		QString machineName = QHostInfo::localHostName();
 		outStream << qint32(machineName.toUtf8().size());
 		outStream.writeRawData(machineName.toUtf8().data(), machineName.toUtf8().size());
+		outStream << qint32(cNetRenderTransport::protocolVersion());
 		emit changeClientStatus(netRenderSts_READY);
 		WriteLog(
 			QString("NetRender - ProcessData(), command VERSION, version %1").arg(serverVersion), 2);
 	}
 	else
 	{
-		cErrorMessage::showMessage(tr("NetRender - version mismatch!\n")
-																 + tr("Client version: %1\n").arg(cNetRenderTransport::version())
-																 + tr("Server version: %1").arg(serverVersion),
+		cErrorMessage::showMessage(
+			tr("NetRender - version mismatch!\n")
+				+ tr("Client version: %1 (protocol %2)\n")
+						.arg(cNetRenderTransport::version())
+						.arg(cNetRenderTransport::protocolVersion())
+				+ tr("Server version: %1 (protocol %2)").arg(serverVersion).arg(serverProtocolVersion),
 			cErrorMessage::errorMessage, gMainInterface->mainWindow);
 
 		outMsg.command = netRenderCmd_BAD;
 	}
 
 	cNetRenderTransport::SendData(clientSocket, outMsg, actualId);
+
+	// continue sending of files interrupted by lost connection
+	if (outMsg.command == netRenderCmd_WORKER) fileSender->ConnectionRestored();
 }
 
 void CNetRenderClient::ProcessRequestStop(sMessage *inMsg)
@@ -321,8 +388,11 @@ void CNetRenderClient::ProcessRequestJob(sMessage *inMsg)
 		WriteLog(QString("NetRender - ProcessData(), command JOB, settings size: %1").arg(size), 2);
 		WriteLog(QString("NetRender - ProcessData(), command JOB, settings: %1").arg(settingsText), 2);
 
-		// getting textures from server
+		// getting references to textures. Texture data is taken from persistent cache or requested
+		// from server when the texture is used for the first time
+		QMutexLocker lock(&texturesMutex);
 		textures.clear();
+		textureHashes.clear();
 
 		qint32 numberOfTextures;
 		stream >> numberOfTextures;
@@ -331,7 +401,8 @@ void CNetRenderClient::ProcessRequestJob(sMessage *inMsg)
 							 .arg(numberOfTextures),
 			2);
 
-		// read textures
+		// read texture names and hashes
+		int texturesInCache = 0;
 		for (int i = 0; i < numberOfTextures; i++)
 		{
 			qint32 sizeOfName;
@@ -344,19 +415,39 @@ void CNetRenderClient::ProcessRequestJob(sMessage *inMsg)
 				bufferForName.resize(sizeOfName);
 				stream.readRawData(bufferForName.data(), sizeOfName);
 				textureName = QString::fromUtf8(bufferForName);
-				WriteLog(
-					QString("NetRender - ProcessData(), command JOB, texture name: %1").arg(textureName), 2);
 			}
 
-			stream >> size;
-			WriteLog(QString("NetRender - ProcessData(), command JOB, texture size: %1").arg(size), 2);
-			if (size > 0)
+			qint32 sizeOfHash;
+			stream >> sizeOfHash;
+			QByteArray hash;
+			if (sizeOfHash > 0)
 			{
-				buffer.resize(size);
-				stream.readRawData(buffer.data(), size);
+				hash.resize(sizeOfHash);
+				stream.readRawData(hash.data(), sizeOfHash);
 			}
-			textures.insert(textureName, buffer);
+
+			qint64 textureSize;
+			stream >> textureSize;
+
+			if (hash.isEmpty()) continue; // texture not available on server
+
+			textureHashes.insert(textureName, hash);
+			bool inCache = QFileInfo(CachedTextureFileName(hash, textureName)).size() == textureSize;
+			if (inCache) texturesInCache++;
+
+			WriteLog(QString("NetRender - ProcessData(), command JOB, texture name: %1, hash: %2, "
+											 "size: %3, in cache: %4")
+								 .arg(textureName, QString::fromLatin1(hash))
+								 .arg(textureSize)
+								 .arg(inCache),
+				2);
 		}
+		lock.unlock();
+
+		WriteLog(QString("NetRender - ProcessData(), command JOB, textures found in cache: %1 of %2")
+							 .arg(texturesInCache)
+							 .arg(numberOfTextures),
+			2);
 
 		cSettings parSettings(cSettings::formatCondensedText);
 		parSettings.BeQuiet(true);
@@ -457,6 +548,20 @@ void CNetRenderClient::ProcessRequestAck(sMessage *inMsg)
 	}
 }
 
+void CNetRenderClient::ProcessRequestFileAck(sMessage *inMsg)
+{
+	WriteLog("NetRender - ProcessData(), command FILE_ACK", 2);
+	if (inMsg->id == actualId)
+	{
+		QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+		qint32 receivedChunks;
+		qint32 status;
+		stream >> receivedChunks;
+		stream >> status;
+		emit FileAckReceived(receivedChunks, status);
+	}
+}
+
 void CNetRenderClient::ProcessRequestKickAndKill(sMessage *inMsg)
 {
 	Q_UNUSED(inMsg);
@@ -641,31 +746,57 @@ void CNetRenderClient::ProcessRequestReceivedFile(sMessage *inMsg)
 			buffer.resize(fileSize);
 			stream.readRawData(buffer.data(), fileSize);
 
-			QCryptographicHash hashCrypt(QCryptographicHash::Md4);
-			hashCrypt.addData(requestedFileName.toLocal8Bit());
-			if (frameIndexForRequestedFile >= 0)
+			QString fileInCache;
+			if (requestedFileName.left(5) == "HASH[")
 			{
-				QString stringFrameNumber = QString::number(frameIndexForRequestedFile);
-				hashCrypt.addData(stringFrameNumber.toLocal8Bit());
+				// texture requested by content hash goes to persistent cache after verification
+				QString textureName = requestedFileName.mid(requestedFileName.indexOf(']') + 1);
+				QString hash = requestedFileName.mid(5, requestedFileName.indexOf(']') - 5);
+				QCryptographicHash hashCrypt(QCryptographicHash::Sha1);
+				hashCrypt.addData(buffer);
+				if (hashCrypt.result().toHex() == hash.toLatin1())
+				{
+					fileInCache = CachedTextureFileName(hash.toLatin1(), textureName);
+				}
+				else
+				{
+					WriteLog(QString("NetRender SEND_REQ_FILE: wrong hash of received texture %1")
+										 .arg(textureName),
+						1);
+				}
 			}
-			QByteArray hash = hashCrypt.result();
-			QString hashString = hash.toHex();
-			QString fileInCache = systemDirectories.GetNetrenderFolder() + QDir::separator() + hashString
-														+ "." + QFileInfo(requestedFileName).suffix();
-
-			QFile file(fileInCache);
-			if (file.open(QIODevice::WriteOnly))
+			else
 			{
-				file.write(buffer);
-				file.close();
-				fileReceived = true;
+				QCryptographicHash hashCrypt(QCryptographicHash::Md4);
+				hashCrypt.addData(requestedFileName.toLocal8Bit());
+				if (frameIndexForRequestedFile >= 0)
+				{
+					QString stringFrameNumber = QString::number(frameIndexForRequestedFile);
+					hashCrypt.addData(stringFrameNumber.toLocal8Bit());
+				}
+				QByteArray hash = hashCrypt.result();
+				QString hashString = hash.toHex();
+				fileInCache = systemDirectories.GetNetrenderFolder() + QDir::separator() + hashString + "."
+											+ QFileInfo(requestedFileName).suffix();
 			}
-			else
+
+			if (!fileInCache.isEmpty())
 			{
-				WriteLog(
-					QString("NetRender SEND_REQ_FILE: cannot open file %1 for writing %1").arg(fileInCache),
-					1);
+				// written atomically, so other render threads never see a partial file
+				QSaveFile file(fileInCache);
+				if (file.open(QIODevice::WriteOnly))
+				{
+					file.write(buffer);
+					receivedFileStored = file.commit();
+				}
+				else
+				{
+					WriteLog(QString("NetRender SEND_REQ_FILE: cannot open file %1 for writing")
+										 .arg(fileInCache),
+						1);
+				}
 			}
+			fileReceived = true;
 		}
 		else
 		{
@@ -697,7 +828,8 @@ void CNetRenderClient::ConfirmRenderedFrame(int frameIndex, int sizeOfToDoList)
 	cNetRenderTransport::SendData(clientSocket, msg, actualId);
 }
 
-void CNetRenderClient::SendFileHeader(qint64 fileSize, QString nameWithoutPath)
+void CNetRenderClient::SendFileHeader(
+	qint64 fileSize, qint64 lastModified, QString nameWithoutPath)
 {
 	sMessage msg;
 	msg.command = netRenderCmd_SEND_FILE_HEADER;
@@ -706,6 +838,7 @@ void CNetRenderClient::SendFileHeader(qint64 fileSize, QString nameWithoutPath)
 	stream << qint64(fileSize);
 	stream << qint32(nameWithoutPath.toUtf8().size());
 	stream.writeRawData(nameWithoutPath.toUtf8().data(), nameWithoutPath.toUtf8().size());
+	stream << qint64(lastModified);
 
 	WriteLog(
 		QString("NetRender - SendFileHeader(), name %1 size %2").arg(nameWithoutPath).arg(fileSize), 2);
@@ -731,8 +864,9 @@ void CNetRenderClient::SendFileDataChunk(int chunkIndex, QByteArray data)
 	cNetRenderTransport::SendData(clientSocket, msg, actualId);
 }
 
-void CNetRenderClient::RequestFileFromServer(QString filename, int frameIndex)
+bool CNetRenderClient::RequestFileFromServer(QString filename, int frameIndex)
 {
+	receivedFileStored = false;
 	emit SignalRequestFileFromServer(filename, frameIndex);
 	QElapsedTimer timerForTimeOut;
 	timerForTimeOut.start();
@@ -741,7 +875,9 @@ void CNetRenderClient::RequestFileFromServer(QString filename, int frameIndex)
 		Wait(10);
 		gApplication->processEvents();
 	}
+	const bool stored = fileReceived && receivedFileStored;
 	fileReceived = false;
+	return stored;
 }
 
 void CNetRenderClient::SlotRequestFileFromServer(QString filename, int frameIndex)
@@ -38,6 +38,8 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 
+#include <QMutex>
+
 #include "netrender_transport.hpp"
 
 // forward declarations
@@ -65,8 +67,13 @@ public:
 	QString GetServerName() const { return serverName; }
 	// notify server that frame was just rendered
 	void ConfirmRenderedFrame(int frameIndex, int sizeOfToDoList);
-	// request for file from server
-	void RequestFileFromServer(QString filename, int frameIndex);
+	// request for file from server. Returns false if file was not received or not stored
+	bool RequestFileFromServer(QString filename, int frameIndex);
+	// file name of texture in persistent cache (empty if texture is not a part of the job)
+	QString GetCachedTextureFileName(const QString &textureName);
+	// request for texture which is missing in persistent cache. Returns false if texture was not
+	// received or its content doesn't match the hash
+	bool RequestTextureFromServer(const QString &textureName);
 
 private slots:
 	// try to connect to server
@@ -76,7 +83,7 @@ private slots:
 	// received data from server
 	void ReceiveFromServer();
 	// send file header
-	void SendFileHeader(qint64 fileSize, QString nameWithoutPath);
+	void SendFileHeader(qint64 fileSize, qint64 lastModified, QString nameWithoutPath);
 	// send file data chunk
 	void SendFileDataChunk(int chunkIndex, QByteArray data);
 	// request for file from server
@@ -89,6 +96,8 @@ signals:
 	void ToDoListArrived(QList<int> done);
 	// confirmation of data receive
 	void AckReceived();
+	// confirmation of file data receive with number of chunks stored by the server
+	void FileAckReceived(int receivedChunks, int status);
 	// the status of the client has changed to this new status
 	void changeClientStatus(netRenderStatus status);
 	// notify about the current status
@@ -104,6 +113,8 @@ signals:
 
 private:
 	void ProcessData();
+	// file name in persistent cache for given content hash of texture
+	static QString CachedTextureFileName(const QByteArray &hash, const QString &textureName);
 
 	// Process methods
 	void ProcessRequestVersion(sMessage *inMsg);
@@ -113,6 +124,7 @@ private:
 	void ProcessRequestRender(sMessage *inMsg);
 	void ProcessRequestSetup(sMessage *inMsg);
 	void ProcessRequestAck(sMessage *inMsg);
+	void ProcessRequestFileAck(sMessage *inMsg);
 	void ProcessRequestKickAndKill(sMessage *inMsg);
 	void ProcessRequestRenderAnimation(sMessage *inMsg);
 	void ProcessRequestFramesToDo(sMessage *inMsg);
@@ -129,9 +141,12 @@ private:
 	QVector<int> startingPositions;
 	QList<int> framesToRender;
 	QMap<QString, QByteArray> textures;
+	QMap<QString, QByteArray> textureHashes; // content hashes of textures used by current job
+	QMutex texturesMutex;
 	cNetRenderFileSender *fileSender;
 
 	bool fileReceived = false;
+	bool receivedFileStored = false;
 	QString requestedFileName;
 	int frameIndexForRequestedFile = -1;
 };
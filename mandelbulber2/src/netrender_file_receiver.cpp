@@ -36,15 +36,18 @@
 
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
 
 #include "initparameters.hpp"
+#include "netrender_transport.hpp"
 #include "system_directories.hpp"
 
 cNetRenderFileReceiver::cNetRenderFileReceiver(QObject *parent) : QObject(parent) {}
 
 cNetRenderFileReceiver::~cNetRenderFileReceiver() = default;
 
-void cNetRenderFileReceiver::ReceiveHeader(int clientIndex, qint64 _size, QString _fileName)
+int cNetRenderFileReceiver::ReceiveHeader(
+	int clientIndex, qint64 _size, qint64 _lastModified, QString _fileName)
 {
 	if (!fileInfos.contains(clientIndex)) fileInfos.insert(clientIndex, sFileInfo());
 
@@ -65,12 +68,27 @@ void cNetRenderFileReceiver::ReceiveHeader(int clientIndex, qint64 _size, QStrin
 	QString fullFilePath =
 		systemDirectories.GetNetrenderFolder() + QDir::separator() + dirName + fileName;
 
+	// resume transfer interrupted by lost connection. File with the same name could be
+	// rendered again in the meantime, so the modification time of the source has to match too
+	if (partialFiles.contains(fullFilePath))
+	{
+		sFileInfo partialFile = partialFiles[fullFilePath];
+		if (partialFile.fileSize == _size && partialFile.lastModified == _lastModified
+				&& QFileInfo(fullFilePath).size() == partialFile.chunkIndex * CHUNK_SIZE)
+		{
+			partialFile.resendRequested = false;
+			fileInfos[clientIndex] = partialFile;
+			return partialFile.chunkIndex;
+		}
+	}
+
 	QFile file(fullFilePath);
 	if (file.open(QIODevice::WriteOnly))
 	{
 		sFileInfo fileInfo;
 
 		fileInfo.fileSize = _size;
+		fileInfo.lastModified = _lastModified;
 		fileInfo.receivingStarted = true;
 		fileInfo.dirName = dirName;
 		fileInfo.chunkIndex = 0;
@@ -78,6 +96,7 @@ void cNetRenderFileReceiver::ReceiveHeader(int clientIndex, qint64 _size, QStrin
 		fileInfo.fullFilePathInCache = fullFilePath;
 
 		fileInfos[clientIndex] = fileInfo;
+		partialFiles[fullFilePath] = fileInfo;
 
 		file.close();
 	}
@@ -85,10 +104,14 @@ void cNetRenderFileReceiver::ReceiveHeader(int clientIndex, qint64 _size, QStrin
 	{
 		qCritical() << "Can't open file for write to NetRender cache " << fullFilePath;
 	}
+	return 0;
 }
 
-void cNetRenderFileReceiver::ReceiveChunk(int clientIndex, int chunkIndex, QByteArray data)
+int cNetRenderFileReceiver::ReceiveChunk(
+	int clientIndex, int chunkIndex, QByteArray data, int *status)
 {
+	*status = netRenderFileAck_OK;
+
 	if (fileInfos.contains(clientIndex))
 	{
 		sFileInfo fileInfo = fileInfos[clientIndex];
@@ -101,20 +124,28 @@ void cNetRenderFileReceiver::ReceiveChunk(int clientIndex, int chunkIndex, QByte
 			{
 				QFile file(fileInfo.fullFilePathInCache);
 
+				bool written = false;
 				if (file.open(QIODevice::Append))
 				{
-					file.write(data);
+					written = file.write(data) == data.size();
 					file.close();
+					if (!written) file.resize(fileInfo.chunkIndex * CHUNK_SIZE);
+				}
+
+				if (written)
+				{
 					fileInfo.chunkIndex++;
+					fileInfo.resendRequested = false;
 				}
 				else
 				{
-					qCritical() << "Can't open file for write to NetRender cache "
-											<< fileInfo.fullFilePathInCache;
+					qCritical() << "Can't write file to NetRender cache " << fileInfo.fullFilePathInCache;
+					fileInfo.resendRequested = true;
+					*status = netRenderFileAck_RESEND;
 				}
 
 				// last chunk
-				if (bytesLeft == expectedChunkSize)
+				if (written && bytesLeft == expectedChunkSize)
 				{
 					fileInfo.receivingStarted = false;
 
@@ -145,17 +176,34 @@ void cNetRenderFileReceiver::ReceiveChunk(int clientIndex, int chunkIndex, QByte
 			else
 			{
 				qCritical() << "ReceiveChunk(): Wrong chunk size" << data.size() << expectedChunkSize;
+				fileInfo.resendRequested = true;
+				*status = netRenderFileAck_RESEND;
 			}
 		}
-		else
+		else if (chunkIndex > fileInfo.chunkIndex + 1)
 		{
-			qCritical() << "ReceiveChunk(): Wrong chunk index" << chunkIndex;
+			// some chunk is missing. Sender is asked only once, next chunks already sent are dropped
+			if (!fileInfo.resendRequested)
+			{
+				qCritical() << "ReceiveChunk(): Wrong chunk index" << chunkIndex;
+				fileInfo.resendRequested = true;
+				*status = netRenderFileAck_RESEND;
+			}
 		}
 
 		fileInfos[clientIndex] = fileInfo;
+
+		if (fileInfo.receivingStarted)
+			partialFiles[fileInfo.fullFilePathInCache] = fileInfo;
+		else
+			partialFiles.remove(fileInfo.fullFilePathInCache);
+
+		return fileInfo.chunkIndex;
 	}
 	else
 	{
 		qCritical() << "ReceiveChunk(): Unknown client index" << clientIndex;
+		*status = netRenderFileAck_RESEND_HEADER;
+		return 0;
 	}
 }
@@ -48,9 +48,11 @@ public:
 	cNetRenderFileReceiver(QObject *parent = nullptr);
 	~cNetRenderFileReceiver() override;
 
-public slots:
-	void ReceiveHeader(int clientIndex, qint64 size, QString fileName);
-	void ReceiveChunk(int clientIndex, int chunkIndex, QByteArray data);
+	// returns number of chunks of this file already received (for resuming of transfer)
+	int ReceiveHeader(int clientIndex, qint64 size, qint64 lastModified, QString fileName);
+	// returns number of chunks of actual file received so far. 'status' is set to one of
+	// netRenderFileAckStatus values and tells the sender if chunks have to be sent again
+	int ReceiveChunk(int clientIndex, int chunkIndex, QByteArray data, int *status);
 
 private:
 	struct sFileInfo
@@ -59,11 +61,16 @@ private:
 		QString fullFilePathInCache;
 		QString dirName;
 		qint64 fileSize;
+		qint64 lastModified = 0; // modification time of the source file, identifies its content
 		int chunkIndex = 0;
 		bool receivingStarted = false;
+		bool resendRequested = false; // chunks are dropped until the requested one comes
 	};
 
 	QMap<int, sFileInfo> fileInfos;
+
+	// not completed files, kept for resuming transfer after reconnection of client
+	QMap<QString, sFileInfo> partialFiles;
 };
 
 #endif /* MANDELBULBER2_SRC_NETRENDER_FILE_RECEIVER_HPP_ */
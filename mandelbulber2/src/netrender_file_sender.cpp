@@ -35,33 +35,114 @@
 
 #include "netrender_file_sender.hpp"
 
-#include <cmath>
-
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
 
+#include "netrender_transport.hpp"
 #include "system_directories.hpp"
 
+class cNetRenderFileReadTask : public QRunnable
+{
+public:
+	cNetRenderFileReadTask(cNetRenderFileSender *_sender, const QString &_fileName, int _transferId,
+		int _chunkIndex, qint64 _offset, qint64 _size)
+			: sender(_sender),
+				fileName(_fileName),
+				transferId(_transferId),
+				chunkIndex(_chunkIndex),
+				offset(_offset),
+				size(_size)
+	{
+		setAutoDelete(true);
+	}
+
+	void run() override
+	{
+		QByteArray data;
+		QFile file(fileName);
+		if (file.open(QIODevice::ReadOnly) && file.seek(offset))
+		{
+			data = file.read(size);
+		}
+		QMetaObject::invokeMethod(sender, "slotChunkRead", Qt::QueuedConnection,
+			Q_ARG(int, transferId), Q_ARG(int, chunkIndex), Q_ARG(QByteArray, data));
+	}
+
+private:
+	cNetRenderFileSender *sender;
+	QString fileName;
+	int transferId;
+	int chunkIndex;
+	qint64 offset;
+	qint64 size;
+};
+
 cNetRenderFileSender::cNetRenderFileSender(QObject *parent) : QObject(parent)
 {
 	actualFileSize = 0;
-	actualChunkIndex = 0;
+	actualFileLastModified = 0;
 	actualNumberOfChunks = 0;
+	nextChunkToSend = 1;
+	nextChunkToRead = 1;
+	acknowledgedChunks = 0;
+	actualTransferId = 0;
 	sendingInProgress = false;
-	lastChunk = false;
+	headerAcknowledged = false;
+	connected = false;
+
+	// chunks are read sequentially
+	readThreadPool.setMaxThreadCount(1);
+
+	ackTimer.setSingleShot(true);
+	ackTimer.setInterval(ACK_TIMEOUT);
+	connect(&ackTimer, &QTimer::timeout, this, &cNetRenderFileSender::slotAckTimeout);
 }
 
 void cNetRenderFileSender::ClearState()
 {
 	fileQueue.clear();
 	actualFileName.clear();
+	actualHeaderName.clear();
 	actualFileSize = 0;
 	actualNumberOfChunks = 0;
+	readChunks.clear();
+	actualTransferId++;
 	sendingInProgress = false;
-	lastChunk = false;
+	headerAcknowledged = false;
+	connected = false;
+	ackTimer.stop();
+}
+
+cNetRenderFileSender::~cNetRenderFileSender()
+{
+	readThreadPool.clear();
+	readThreadPool.waitForDone();
+}
+
+void cNetRenderFileSender::ConnectionLost()
+{
+	// chunks in flight are lost. The server will report how many of them were stored
+	connected = false;
+	headerAcknowledged = false;
+	ackTimer.stop();
+}
+
+void cNetRenderFileSender::ConnectionRestored()
+{
+	connected = true;
+	if (sendingInProgress) SendHeader();
 }
 
-cNetRenderFileSender::~cNetRenderFileSender() = default;
+void cNetRenderFileSender::SendHeader()
+{
+	headerAcknowledged = false;
+	emit NetRenderSendHeader(actualFileSize, actualFileLastModified, actualHeaderName);
+	ackTimer.start();
+}
 
 void cNetRenderFileSender::AddFileToQueue(QString filename)
 {
@@ -69,87 +150,113 @@ void cNetRenderFileSender::AddFileToQueue(QString filename)
 
 	if (!sendingInProgress)
 	{
-		QString filenameToSend = fileQueue.dequeue();
-		sendFileOverNetrender(filenameToSend);
+		SendNextFile();
 	}
 }
 
-void cNetRenderFileSender::AcknowledgeReceived()
+void cNetRenderFileSender::AcknowledgeReceived(int receivedChunks, int status)
 {
-	if (sendingInProgress)
+	if (!sendingInProgress) return;
+
+	ackTimer.stop();
+
+	if (status == netRenderFileAck_RESEND_HEADER)
 	{
-		if (lastChunk)
-		{
-			// if file finished and there is more to send...
-			if (fileQueue.size() > 0)
-			{
-				//...then send next file
-				QString filenameToSend = fileQueue.dequeue();
-				sendFileOverNetrender(filenameToSend);
-			}
-			else
-			{
-				// else wait for new file in queue
-				sendingInProgress = false;
-			}
-		}
-		else
+		// server lost information about the file. The answer for header will tell where to continue
+		SendHeader();
+		return;
+	}
+
+	if (!headerAcknowledged)
+	{
+		// acknowledge of header contains number of chunks already stored by the server
+		headerAcknowledged = true;
+		acknowledgedChunks = receivedChunks;
+		if (nextChunkToSend != receivedChunks + 1)
 		{
-			SendDataChunk();
+			ResetReading(receivedChunks + 1);
 		}
 	}
+	else if (status == netRenderFileAck_RESEND)
+	{
+		// server couldn't store the next chunk and drops all chunks after it, so they are sent again
+		acknowledgedChunks = receivedChunks;
+		ResetReading(receivedChunks + 1);
+	}
+	else
+	{
+		acknowledgedChunks = qMax(acknowledgedChunks, qint64(receivedChunks));
+	}
+
+	if (acknowledgedChunks >= actualNumberOfChunks)
+	{
+		// delete file when is no longer needed
+		QFile::remove(actualFileName);
+		SendNextFile();
+	}
+	else
+	{
+		FillWindow();
+	}
+}
+
+void cNetRenderFileSender::SendNextFile()
+{
+	sendingInProgress = false;
+	while (!sendingInProgress && fileQueue.size() > 0)
+	{
+		QString filenameToSend = fileQueue.dequeue();
+		sendFileOverNetrender(filenameToSend);
+	}
 }
 
 void cNetRenderFileSender::sendFileOverNetrender(const QString &fileName)
 {
-	int fileSize = QFile(fileName).size();
+	QFileInfo fileInfo(fileName);
+	qint64 fileSize = fileInfo.size();
 
 	if (fileSize > 0)
 	{
-		actualFile.setFileName(fileName);
+		actualFileName = fileName;
+		actualFileSize = fileSize;
+		actualFileLastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+		actualNumberOfChunks = (fileSize + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		acknowledgedChunks = 0;
+		sendingInProgress = true;
+		headerAcknowledged = false;
 
-		if (actualFile.open(QIODevice::ReadOnly))
-		{
-			actualFileName = fileName;
-			actualFileSize = fileSize;
-			actualNumberOfChunks = ceil(fileSize / cNetRenderFileSender::CHUNK_SIZE);
-			actualChunkIndex = 0;
-			sendingInProgress = true;
-			lastChunk = false;
-
-			// qDebug() << "fileName" << fileName;
-
-			// extract name of folder for image layers
-			QString nameWithoutNetRenderFolder = fileName;
-			nameWithoutNetRenderFolder.remove(systemDirectories.GetNetrenderFolder() + QDir::separator());
-			//			qDebug() << "systemData.GetNetrenderFolder() + QDir::separator()"
-			//							 << systemData.GetNetrenderFolder() + QDir::separator();
-			//			qDebug() << "nameWithoutNetRenderFolder" << nameWithoutNetRenderFolder;
-
-			QString onlyFileName = QFileInfo(fileName).fileName();
-			// qDebug() << "onlyFileName" << onlyFileName;
-
-			QString separateFolderName = nameWithoutNetRenderFolder;
-			separateFolderName.remove(onlyFileName);
-			// qDebug() << "separateFolderName" << separateFolderName;
-
-			// encapsulation of name of folder
-			QString fileNameForHeader = onlyFileName;
-			if (separateFolderName.length() > 1)
-			{
-				separateFolderName = separateFolderName.mid(0, separateFolderName.length() - 1);
-				// qDebug() << "separateFolderName2" << separateFolderName;
-				fileNameForHeader = QString("DIR[%1]%2").arg(separateFolderName).arg(onlyFileName);
-				// qDebug() << "fileNameForHeader" << fileNameForHeader;
-			}
-
-			emit NetRenderSendHeader(fileSize, fileNameForHeader);
-		}
-		else
+		// qDebug() << "fileName" << fileName;
+
+		// extract name of folder for image layers
+		QString nameWithoutNetRenderFolder = fileName;
+		nameWithoutNetRenderFolder.remove(systemDirectories.GetNetrenderFolder() + QDir::separator());
+		//			qDebug() << "systemData.GetNetrenderFolder() + QDir::separator()"
+		//							 << systemData.GetNetrenderFolder() + QDir::separator();
+		//			qDebug() << "nameWithoutNetRenderFolder" << nameWithoutNetRenderFolder;
+
+		QString onlyFileName = QFileInfo(fileName).fileName();
+		// qDebug() << "onlyFileName" << onlyFileName;
+
+		QString separateFolderName = nameWithoutNetRenderFolder;
+		separateFolderName.remove(onlyFileName);
+		// qDebug() << "separateFolderName" << separateFolderName;
+
+		// encapsulation of name of folder
+		QString fileNameForHeader = onlyFileName;
+		if (separateFolderName.length() > 1)
 		{
-			qCritical() << "Cannot open file to send via NetRender" << fileName;
-			sendingInProgress = false;
+			separateFolderName = separateFolderName.mid(0, separateFolderName.length() - 1);
+			// qDebug() << "separateFolderName2" << separateFolderName;
+			fileNameForHeader = QString("DIR[%1]%2").arg(separateFolderName).arg(onlyFileName);
+			// qDebug() << "fileNameForHeader" << fileNameForHeader;
 		}
+		actualHeaderName = fileNameForHeader;
+
+		// first chunks are read while waiting for acknowledge of header
+		ResetReading(1);
+
+		// if not connected, header will be sent after reconnection
+		if (connected) SendHeader();
 	}
 	else
 	{
@@ -158,27 +265,64 @@ void cNetRenderFileSender::sendFileOverNetrender(const QString &fileName)
 	}
 }
 
-void cNetRenderFileSender::SendDataChunk()
+void cNetRenderFileSender::ResetReading(qint64 firstChunk)
 {
-	if (actualFile.isOpen())
-	{
-		qint64 bytesLeft = actualFileSize - actualChunkIndex * cNetRenderFileSender::CHUNK_SIZE;
-		qint64 bytesToRead = qMin(cNetRenderFileSender::CHUNK_SIZE, bytesLeft);
-		QByteArray data = actualFile.read(bytesToRead);
-		actualChunkIndex++;
-		emit NetRenderSendChunk(actualChunkIndex, data);
+	// results of reads which are still in progress will be ignored
+	actualTransferId++;
+	readChunks.clear();
+	nextChunkToSend = firstChunk;
+	nextChunkToRead = firstChunk;
+	FillWindow();
+}
 
-		if (bytesLeft == bytesToRead)
+void cNetRenderFileSender::FillWindow()
+{
+	if (connected && headerAcknowledged)
+	{
+		while (nextChunkToSend <= actualNumberOfChunks
+					 && nextChunkToSend - 1 - acknowledgedChunks < WINDOW_SIZE
+					 && readChunks.contains(nextChunkToSend))
 		{
-			lastChunk = true;
-			actualFile.close();
-			// delete file when is no longer needed
-			actualFile.remove();
+			emit NetRenderSendChunk(int(nextChunkToSend), readChunks.take(nextChunkToSend));
+			nextChunkToSend++;
 		}
+
+		// waiting for acknowledge of sent chunks
+		if (nextChunkToSend - 1 > acknowledgedChunks && !ackTimer.isActive()) ackTimer.start();
 	}
-	else
+
+	while (nextChunkToRead <= actualNumberOfChunks && nextChunkToRead < nextChunkToSend + READ_AHEAD)
 	{
-		qCritical() << "File is no longer open" << actualFileName;
-		sendingInProgress = false;
+		qint64 offset = (nextChunkToRead - 1) * CHUNK_SIZE;
+		qint64 size = qMin(CHUNK_SIZE, actualFileSize - offset);
+		readThreadPool.start(new cNetRenderFileReadTask(
+			this, actualFileName, actualTransferId, int(nextChunkToRead), offset, size));
+		nextChunkToRead++;
 	}
 }
+
+void cNetRenderFileSender::slotChunkRead(int transferId, int chunkIndex, QByteArray data)
+{
+	if (transferId != actualTransferId || !sendingInProgress) return;
+
+	qint64 expectedSize = qMin(CHUNK_SIZE, actualFileSize - (chunkIndex - 1) * CHUNK_SIZE);
+	if (data.size() != expectedSize)
+	{
+		qCritical() << "Cannot read file to send via NetRender" << actualFileName;
+		actualTransferId++;
+		SendNextFile();
+		return;
+	}
+
+	if (chunkIndex >= nextChunkToSend) readChunks.insert(chunkIndex, data);
+	FillWindow();
+}
+
+void cNetRenderFileSender::slotAckTimeout()
+{
+	if (!sendingInProgress || !connected) return;
+
+	qWarning() << "NetRender - no acknowledge of file transfer, sending header again"
+						 << actualFileName;
+	SendHeader();
+}
@@ -31,45 +31,75 @@
  *
  * NetrenderFileSender class - watches for transmissable files on the client to
  * send to the server
+ *
+ * Files are sent in chunks. Up to WINDOW_SIZE chunks are sent before the server acknowledges
+ * them, and next chunks are read from disk in advance by a separate thread. After reconnecting
+ * to the server the header is sent again and the transfer continues from the last chunk
+ * which the server has stored. Chunks which the server couldn't store are reported back
+ * (netRenderFileAck_RESEND) and sent again. If the server doesn't answer for ACK_TIMEOUT,
+ * the header is sent again to synchronize the state of the transfer.
  */
 
 #ifndef MANDELBULBER2_SRC_NETRENDER_FILE_SENDER_HPP_
 #define MANDELBULBER2_SRC_NETRENDER_FILE_SENDER_HPP_
 
-#include <QFile>
+#include <QByteArray>
+#include <QMap>
 #include <QObject>
 #include <QQueue>
 #include <QString>
+#include <QThreadPool>
+#include <QTimer>
 
 class cNetRenderFileSender : public QObject
 {
 	Q_OBJECT
 	const qint64 CHUNK_SIZE = 1024 * 1024;
+	const qint64 WINDOW_SIZE = 8;	 // chunks sent without acknowledge
+	const qint64 READ_AHEAD = 16; // chunks read from disk in advance
+	const int ACK_TIMEOUT = 30000; // ms without acknowledge before header is sent again
 
 public:
 	cNetRenderFileSender(QObject *parent = nullptr);
 	~cNetRenderFileSender() override;
 	void ClearState();
+	void ConnectionLost();
+	void ConnectionRestored();
 
 public slots:
 	void AddFileToQueue(QString filename);
-	void AcknowledgeReceived();
+	void AcknowledgeReceived(int receivedChunks, int status);
+
+private slots:
+	void slotChunkRead(int transferId, int chunkIndex, QByteArray data);
+	void slotAckTimeout();
 
 private:
 	void sendFileOverNetrender(const QString &file);
-	void SendDataChunk(); // after acknowledge
+	void SendNextFile();
+	void FillWindow();
+	void ResetReading(qint64 firstChunk);
+	void SendHeader();
 
 	QQueue<QString> fileQueue;
 	QString actualFileName;
+	QString actualHeaderName;
 	qint64 actualFileSize;
+	qint64 actualFileLastModified;
 	qint64 actualNumberOfChunks;
-	qint64 actualChunkIndex;
+	qint64 nextChunkToSend;
+	qint64 nextChunkToRead;
+	qint64 acknowledgedChunks;
+	QMap<qint64, QByteArray> readChunks;
+	int actualTransferId;
 	bool sendingInProgress;
-	bool lastChunk;
-	QFile actualFile;
+	bool headerAcknowledged;
+	bool connected;
+	QThreadPool readThreadPool;
+	QTimer ackTimer;
 
 signals:
-	void NetRenderSendHeader(qint64 size, QString filename);
+	void NetRenderSendHeader(qint64 size, qint64 lastModified, QString filename);
 	void NetRenderSendChunk(int chunkIndex, QByteArray data);
 };
 
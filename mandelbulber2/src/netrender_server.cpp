@@ -35,6 +35,8 @@
 #include "netrender_server.hpp"
 
 #include <QAbstractSocket>
+#include <QCryptographicHash>
+#include <QFileInfo>
 #include <QHostInfo>
 
 #include "error_message.hpp"
@@ -59,10 +61,6 @@ cNetRenderServer::cNetRenderServer(QObject *parent) : QObject(parent)
 	portNo = 0;
 	fileReceiver = new cNetRenderFileReceiver(this);
 	connect(this, &cNetRenderServer::NewClient, this, &cNetRenderServer::SendVersionToClient);
-	connect(this, &cNetRenderServer::ReceivedFileHeader, fileReceiver,
-		&cNetRenderFileReceiver::ReceiveHeader);
-	connect(
-		this, &cNetRenderServer::ReceivedFileData, fileReceiver, &cNetRenderFileReceiver::ReceiveChunk);
 }
 
 cNetRenderServer::~cNetRenderServer()
@@ -305,31 +303,35 @@ void cNetRenderServer::SetCurrentJob(std::shared_ptr<const cParameterContainer>
 		// send number of textures
 		stream << qint32(listOfTextures.size());
 
-		// write textures (from files)
+		// write texture references. Only content hashes are sent. Clients keep textures in
+		// persistent cache and request missing ones using REQ_FILE command
+		texturesByHash.clear();
 		for (int i = 0; i < listOfTextures.size(); i++)
 		{
+			QByteArray textureName = listOfTextures[i].toUtf8();
+
 			// send length of texture name
-			stream << qint32(listOfTextures[i].toUtf8().size());
+			stream << qint32(textureName.size());
 
 			// send texture name
-			stream.writeRawData(listOfTextures[i].toUtf8(), listOfTextures[i].length());
+			stream.writeRawData(textureName.data(), textureName.size());
 
-			QFile file(listOfTextures[i]);
-			if (file.open(QIODevice::ReadOnly))
+			QByteArray hash = GetTextureHash(listOfTextures[i]);
+			if (!hash.isEmpty())
 			{
-				QByteArray buffer = file.readAll();
-				// send size of file
-				stream << qint32(buffer.size());
-				// send file content
-				stream.writeRawData(buffer.data(), buffer.size());
-				continue;
+				texturesByHash.insert(hash, listOfTextures[i]);
 			}
 			else
 			{
 				qCritical() << "Cannot send texture using NetRender. File:" << listOfTextures[i];
 			}
 
-			stream << qint32(0); // empty entry
+			// send content hash (empty if file cannot be read)
+			stream << qint32(hash.size());
+			stream.writeRawData(hash.data(), hash.size());
+
+			// send size of file
+			stream << qint64(hash.isEmpty() ? 0 : QFileInfo(listOfTextures[i]).size());
 		}
 
 		for (int i = 0; i < GetClientCount(); i++)
@@ -345,6 +347,39 @@ void cNetRenderServer::SetCurrentJob(std::shared_ptr<const cParameterContainer>
 	}
 }
 
+QByteArray cNetRenderServer::GetTextureHash(const QString &fileName)
+{
+	QFileInfo fileInfo(fileName);
+	if (!fileInfo.exists()) return QByteArray();
+
+	// hashing is repeated only if file has been modified
+	auto it = textureHashCache.constFind(fileInfo.absoluteFilePath());
+	if (it != textureHashCache.constEnd() && it->size == fileInfo.size()
+			&& it->lastModified == fileInfo.lastModified())
+	{
+		return it->hash;
+	}
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+	QCryptographicHash hashCrypt(QCryptographicHash::Sha1);
+	hashCrypt.addData(&file);
+	file.close();
+
+	sTextureHash textureHash;
+	textureHash.size = fileInfo.size();
+	textureHash.lastModified = fileInfo.lastModified();
+	textureHash.hash = hashCrypt.result().toHex();
+	textureHashCache.insert(fileInfo.absoluteFilePath(), textureHash);
+
+	WriteLog(QString("NetRender - texture %1 hash %2")
+						 .arg(fileName, QString::fromLatin1(textureHash.hash)),
+		3);
+
+	return textureHash.hash;
+}
+
 void cNetRenderServer::SetCurrentAnimation(std::shared_ptr<const cParameterContainer> settings,
 	std::shared_ptr<const cFractalContainer> fractal, bool isFlight)
 {
@@ -431,8 +466,6 @@ void cNetRenderServer::ProcessRequestFrameDone(sMessage *inMsg, int index, QTcpS
 
 void cNetRenderServer::ProcessRequestWorker(sMessage *inMsg, int index, QTcpSocket *socket)
 {
-	Q_UNUSED(socket);
-
 	QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
 	qint32 clientWorkerCount;
 	stream >> clientWorkerCount;
@@ -444,6 +477,23 @@ void cNetRenderServer::ProcessRequestWorker(sMessage *inMsg, int index, QTcpSock
 	stream.readRawData(buffer.data(), size);
 	clients[index].name = QString::fromUtf8(buffer.data(), buffer.size());
 
+	// clients older than protocol versioning accept the server only by program version
+	qint32 clientProtocolVersion = 0;
+	if (!stream.atEnd()) stream >> clientProtocolVersion;
+	if (clientProtocolVersion != cNetRenderTransport::protocolVersion())
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("NetRender - Client protocol version mismatch!\n Client address:")
+				+ socket->peerAddress().toString(),
+			cErrorMessage::errorMessage, gMainInterface->mainWindow);
+		clients[index].status = netRenderSts_ERROR;
+		emit ClientsChangedRow(index);
+
+		// client is removed by ClientDisconnected(), after processing of this message
+		QMetaObject::invokeMethod(socket, "disconnectFromHost", Qt::QueuedConnection);
+		return;
+	}
+
 	if (GetClient(index).status == netRenderSts_NEW) clients[index].status = netRenderSts_READY;
 	WriteLog("NetRender - new Client #" + QString::number(index) + "(" + GetClient(index).name + " - "
 						 + GetClient(index).socket->peerAddress().toString() + ")",
@@ -545,19 +595,18 @@ void cNetRenderServer::ProcessRequestFrameFileHeader(sMessage *inMsg, int index,
 			fileName = QString::fromUtf8(bufferForName);
 		}
 
+		qint64 lastModified;
+		stream >> lastModified;
+
 		WriteLog(QString("NetRender - ProcessRequestFileHeader(), command SEND_FILE_HEADER, fileSize "
 										 "%1, fileName %2")
 							 .arg(fileSize)
 							 .arg(fileName),
 			2);
 
-		emit ReceivedFileHeader(index, fileSize, fileName);
-
-		// send acknowledge
-		sMessage outMsg;
-		outMsg.id = actualId;
-		outMsg.command = netRenderCmd_ACK;
-		cNetRenderTransport::SendData(GetClient(index).socket, outMsg, actualId);
+		// acknowledge contains number of chunks already received (resumed transfer)
+		int receivedChunks = fileReceiver->ReceiveHeader(index, fileSize, lastModified, fileName);
+		SendFileAck(index, receivedChunks, netRenderFileAck_OK);
 	}
 	else
 	{
@@ -591,13 +640,9 @@ void cNetRenderServer::ProcessRequestFrameFileDataChunk(
 							 .arg(chunkSize),
 			2);
 
-		emit ReceivedFileData(index, chunkIndex, chunkData);
-
-		// send acknowledge
-		sMessage outMsg;
-		outMsg.id = actualId;
-		outMsg.command = netRenderCmd_ACK;
-		cNetRenderTransport::SendData(GetClient(index).socket, outMsg, actualId);
+		int status;
+		int receivedChunks = fileReceiver->ReceiveChunk(index, chunkIndex, chunkData, &status);
+		SendFileAck(index, receivedChunks, status);
 	}
 	else
 	{
@@ -605,6 +650,17 @@ void cNetRenderServer::ProcessRequestFrameFileDataChunk(
 	}
 }
 
+void cNetRenderServer::SendFileAck(int index, int receivedChunks, int status)
+{
+	sMessage outMsg;
+	outMsg.id = actualId;
+	outMsg.command = netRenderCmd_FILE_ACK;
+	QDataStream stream(&outMsg.payload, QIODevice::WriteOnly);
+	stream << qint32(receivedChunks);
+	stream << qint32(status);
+	cNetRenderTransport::SendData(GetClient(index).socket, outMsg, actualId);
+}
+
 void cNetRenderServer::ProcessRequestFile(sMessage *inMsg, int index, QTcpSocket *socket)
 {
 	Q_UNUSED(socket);
@@ -636,11 +692,20 @@ void cNetRenderServer::ProcessRequestFile(sMessage *inMsg, int index, QTcpSocket
 		outMsg.id = actualId;
 		outMsg.command = netRenderCmd_SEND_REQ_FILE;
 
-		if (frameIndex >= 0)
+		if (fileName.left(5) == "HASH[")
 		{
-			fileName = AnimatedFileName(fileName, frameIndex);
+			// texture requested by content hash
+			QByteArray hash = fileName.mid(5, fileName.indexOf(']') - 5).toLatin1();
+			fileName = texturesByHash.value(hash);
+		}
+		else
+		{
+			if (frameIndex >= 0)
+			{
+				fileName = AnimatedFileName(fileName, frameIndex);
+			}
+			fileName = FilePathHelperTextures(fileName);
 		}
-		fileName = FilePathHelperTextures(fileName);
 
 		bool failure = false;
 		if (QFile::exists(fileName))
@@ -766,6 +831,7 @@ void cNetRenderServer::SendVersionToClient(int index)
 	QString machineName = QHostInfo::localHostName();
 	stream << qint32(machineName.toUtf8().size());
 	stream.writeRawData(machineName.toUtf8().data(), machineName.toUtf8().size());
+	stream << qint32(cNetRenderTransport::protocolVersion());
 	cNetRenderTransport::SendData(GetClient(index).socket, msg, actualId);
 }
 
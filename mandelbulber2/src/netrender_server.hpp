@@ -35,6 +35,7 @@
 #ifndef MANDELBULBER2_SRC_NETRENDER_SERVER_HPP_
 #define MANDELBULBER2_SRC_NETRENDER_SERVER_HPP_
 
+#include <QDateTime>
 #include <QTcpServer>
 #include <QTcpSocket>
 
@@ -102,8 +103,6 @@ signals:
 	// send data of newly rendered lines to cRenderer
 	void NewLinesArrived(QList<int> lineNumbers, QList<QByteArray> lines);
 	void FinishedFrame(int clientIndex, int frameIndex, int sizeOfDoDoList);
-	void ReceivedFileHeader(int index, qint64 fileSize, QString fileName);
-	void ReceivedFileData(int index, int chunkIndex, QByteArray chunkData);
 
 private:
 	// process received data and send response if needed
@@ -120,6 +119,16 @@ private:
 	void ProcessRequestFrameFileHeader(sMessage *inMsg, int index, QTcpSocket *socket);
 	void ProcessRequestFrameFileDataChunk(sMessage *inMsg, int index, QTcpSocket *socket);
 	void ProcessRequestFile(sMessage *inMsg, int index, QTcpSocket *socket);
+	void SendFileAck(int index, int receivedChunks, int status);
+	// content hash of texture file (hex encoded), cached by file size and modification time
+	QByteArray GetTextureHash(const QString &fileName);
+
+	struct sTextureHash
+	{
+		qint64 size;
+		QDateTime lastModified;
+		QByteArray hash;
+	};
 
 	QList<sClient> clients;
 	sClient nullClient; // dummy client for fail-safe purposes
@@ -128,6 +137,8 @@ private:
 	sMessage msgCurrentJob;
 	qint32 actualId;
 	cNetRenderFileReceiver *fileReceiver;
+	QMap<QString, sTextureHash> textureHashCache;
+	QMap<QByteArray, QString> texturesByHash; // textures of current job
 
 public:
 	const QStringList listOfAppSettingToTransfer = {"opencl_mode", "color_enabled", "alpha_enabled",
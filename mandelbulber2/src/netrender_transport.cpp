@@ -38,6 +38,7 @@
 #include <QDataStream>
 
 #include "lzo_compression.h"
+#include "trace.hpp"
 #include "write_log.hpp"
 
 bool cNetRenderTransport::SendData(QTcpSocket *socket, sMessage msg, qint32 id)
@@ -53,6 +54,8 @@ bool cNetRenderTransport::SendData(QTcpSocket *socket, sMessage msg, qint32 id)
 	if (!socket) return false;
 	if (socket->state() != QAbstractSocket::ConnectedState) return false;
 
+	cScopedTrace trace("data send", "netrender");
+
 	QByteArray byteArray;
 	QDataStream socketWriteStream(&byteArray, QIODevice::ReadWrite);
 
@@ -120,6 +123,7 @@ bool cNetRenderTransport::ReceiveData(QTcpSocket *socket, sMessage *msg)
 	if (socket->bytesAvailable() < (sMessage::crcSize() + msg->size)) return false;
 
 	// full payload available, read to buffer
+	cScopedTrace trace("data receive", "netrender");
 	std::vector<char> buffer(msg->size);
 	socketReadStream.readRawData(buffer.data(), msg->size);
 	msg->payload.append(buffer.data(), msg->size);
@@ -67,7 +67,8 @@ enum netCommandServer
 	netRenderCmd_ANIM_KEY = 13,		 /* sending of settings and start rendering of keyframe animation */
 	netRenderCmd_ANIM_FLIGHT = 14, /* sending of settings and start rendering of flight animation */
 	netRenderCmd_SEND_REQ_FILE = 18, /* send file requested by client (e.g. texture)*/
-	netRenderCmd_FRAMES_TODO = 20		 /* send list of frames to do next */
+	netRenderCmd_FRAMES_TODO = 20,	 /* send list of frames to do next */
+	netRenderCmd_FILE_ACK = 21			 /* acknowledge receiving of file header or chunk of file data */
 };
 
 /* these commands are send from the client to the server */
@@ -93,6 +94,14 @@ enum netRenderStatus
 	netRenderSts_ERROR = 5			 /* error occurred */
 };
 
+/* status sent with netRenderCmd_FILE_ACK */
+enum netRenderFileAckStatus
+{
+	netRenderFileAck_OK = 0,						/* header or chunk stored */
+	netRenderFileAck_RESEND = 1,				/* chunk not stored, send again chunks after acknowledged */
+	netRenderFileAck_RESEND_HEADER = 2 /* server doesn't know the file, send header again */
+};
+
 struct sMessage
 {
 	sMessage() {}
@@ -129,6 +138,9 @@ public:
 	static bool CompareMajorVersion(qint32 version1, qint32 version2);
 	// the numeric and comparable version of the mandelbulber instance
 	static int version() { return 1000L * MANDELBULBER_VERSION; }
+	// version of message formats, has to be equal on both sides. Increase it on every change
+	// of payload of any command
+	static int protocolVersion() { return 3; }
 };
 
 #endif /* MANDELBULBER2_SRC_NETRENDER_TRANSPORT_HPP_ */
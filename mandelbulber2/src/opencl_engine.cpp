@@ -40,13 +40,20 @@
 #include <sstream>
 
 #include <QCryptographicHash>
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
 
 #include "error_message.hpp"
 #include "opencl_hardware.h"
 #include "parameters.hpp"
+#include "system.hpp"
+#include "system_directories.hpp"
+#include "trace.hpp"
 #include "write_log.hpp"
 
 cOpenClEngine::cOpenClEngine(cOpenClHardware *_hardware) : QObject(_hardware), hardware(_hardware)
@@ -57,6 +64,9 @@ cOpenClEngine::cOpenClEngine(cOpenClHardware *_hardware) : QObject(_hardware), h
 	kernelCreated = false;
 	locked = false;
 	useBuildCache = true;
+#ifdef USE_OPENCL
+	programsLoadedFromCache = 0;
+#endif
 	useFastRelaxedMath = false;
 
 	clKernels.append(std::shared_ptr<cl::Kernel>());
@@ -92,6 +102,8 @@ bool cOpenClEngine::checkErr(cl_int err, QString functionName)
 
 bool cOpenClEngine::Build(const QByteArray &programString, QString *errorText, bool quiet)
 {
+	cScopedTrace trace("kernel build", "opencl");
+
 	if (hardware->getClDevices().size() > 0 && hardware->getEnabledDevices().size() > 0)
 	{
 		// calculating hash code of the program
@@ -125,55 +137,90 @@ bool cOpenClEngine::Build(const QByteArray &programString, QString *errorText, b
 			cl::Program::Sources sources;
 			sources.emplace_back(programString.constData(), size_t(programString.length()));
 
+			std::string buildParams =
+				"-w -cl-single-precision-constant -cl-denorms-are-zero -cl-mad-enable";
+
+			if (useFastRelaxedMath) buildParams += " -cl-fast-relaxed-math";
+
+			buildParams.append(" -DOPENCL_KERNEL_CODE");
+
+			buildParams += definesCollector.toUtf8().constData();
+
+			WriteLogString("Build parameters", buildParams.c_str(), 2);
+
 			// creating cl::Program
 			cl_int err = 0;
 
-			// Creates a program from source strings and Context.
+			// Programs are created from binaries stored in persistent cache if possible.
+			// Otherwise program is created from source strings and Context.
 			// Context initialized with support for multiple devices.
 			// Therefore cl::Program initialized with device vector
-			// Does not compile or link the program.
 
 			clPrograms.clear();
-			for (int d = 0; d < hardware->getEnabledDevices().size(); d++)
+			QList<cl::Device *> enabledDevices = hardware->getEnabledDevices();
+			QStringList cacheFileNames;
+			QList<bool> loadedFromCache;
+
+			// program string contains only #include lines, so contents of included files are part
+			// of the key of cached binaries
+			const QByteArray hashSources = hashProgram + IncludedFilesHash(programString);
+
+			programsLoadedFromCache = 0;
+			for (int d = 0; d < enabledDevices.size(); d++)
 			{
-				clPrograms.append(
-					std::shared_ptr<cl::Program>(new cl::Program(*hardware->getContext(d), sources, &err)));
+				cacheFileNames.append(ProgramCacheFileName(hashSources, buildParams, *enabledDevices[d]));
+				loadedFromCache.append(
+					useBuildCache && LoadProgramBinary(d, cacheFileNames[d], buildParams));
+				if (loadedFromCache[d])
+				{
+					programsLoadedFromCache++;
+				}
+				else
+				{
+					clPrograms.append(
+						std::shared_ptr<cl::Program>(new cl::Program(*hardware->getContext(d), sources, &err)));
+					if (!checkErr(err, "cl::Program()")) break;
+				}
 			}
+			programCacheFileNames = cacheFileNames;
 
-			if (checkErr(err, "cl::Program()"))
+			if (err == CL_SUCCESS)
 			{
-				std::string buildParams =
-					"-w -cl-single-precision-constant -cl-denorms-are-zero -cl-mad-enable";
-
-				if (useFastRelaxedMath) buildParams += " -cl-fast-relaxed-math";
-
-				buildParams.append(" -DOPENCL_KERNEL_CODE");
-
-				buildParams += definesCollector.toUtf8().constData();
-
-				WriteLogString("Build parameters", buildParams.c_str(), 2);
-
 				// cl::Program::Build (compiles and links) a multi-device program executable
 				// compiles and links for multiple devices simultaneously
 
-				QList<cl::Device *> enabledDevices = hardware->getEnabledDevices();
-				for (int d = 0; d < hardware->getEnabledDevices().size(); d++)
+				bool buildSucceeded = true;
+				for (int d = 0; d < enabledDevices.size(); d++)
 				{
+					if (loadedFromCache[d])
+					{
+						WriteLog(QString("Device #%1: OpenCl program loaded from cache").arg(d), 2);
+						continue;
+					}
+
 					std::vector<cl::Device> oneDevice;
 					oneDevice.push_back(*enabledDevices[d]);
 
 					err = clPrograms[d]->build(oneDevice, buildParams.c_str());
+					if (checkErr(err, "program->build()"))
+					{
+						SaveProgramBinary(d, cacheFileNames[d]);
+					}
+					else
+					{
+						buildSucceeded = false;
+					}
 				}
 
-				if (checkErr(err, "program->build()"))
+				if (buildSucceeded)
 				{
 					WriteLog("OpenCl kernel program successfully compiled", 2);
 
-					for (int d = 0; d < hardware->getEnabledDevices().size(); d++)
+					for (int d = 0; d < enabledDevices.size(); d++)
 					{
 						std::vector<size_t> sizes;
 						err = clPrograms[d]->getInfo(CL_PROGRAM_BINARY_SIZES, &sizes);
-						WriteLogInt("Program size", sizes[d], 2);
+						if (!sizes.empty()) WriteLogInt("Program size", int(sizes[0]), 2);
 					}
 					return true;
 				}
@@ -231,6 +278,146 @@ bool cOpenClEngine::Build(const QByteArray &programString, QString *errorText, b
 	}
 }
 
+QString cOpenClEngine::ProgramCacheFileName(
+	const QByteArray &programHash, const std::string &buildParams, const cl::Device &device)
+{
+	// binary is valid only for the same source, program version, build parameters, device and driver
+	QCryptographicHash hashCrypt(QCryptographicHash::Sha1);
+	hashCrypt.addData(programHash);
+	hashCrypt.addData(MANDELBULBER_VERSION_STRING);
+	hashCrypt.addData(buildParams.c_str(), int(buildParams.size()));
+	hashCrypt.addData(device.getInfo<CL_DEVICE_NAME>().c_str());
+	hashCrypt.addData(device.getInfo<CL_DEVICE_VENDOR>().c_str());
+	hashCrypt.addData(device.getInfo<CL_DEVICE_VERSION>().c_str());
+	hashCrypt.addData(device.getInfo<CL_DRIVER_VERSION>().c_str());
+
+	return systemDirectories.GetOpenCLProgramCacheFolder() + QDir::separator()
+				 + QString(hashCrypt.result().toHex()) + ".bin";
+}
+
+QByteArray cOpenClEngine::IncludedFilesHash(const QByteArray &programString)
+{
+	QCryptographicHash hashCrypt(QCryptographicHash::Sha1);
+	QSet<QString> visitedFiles;
+	AddIncludedFilesToHash(programString, QString(), &hashCrypt, &visitedFiles);
+	return hashCrypt.result();
+}
+
+void cOpenClEngine::AddIncludedFilesToHash(const QByteArray &source, const QString &baseDir,
+	QCryptographicHash *hash, QSet<QString> *visitedFiles)
+{
+	static const QRegularExpression includeRegex("^\\s*#\\s*include\\s*\"([^\"]+)\"",
+		QRegularExpression::MultilineOption);
+
+	QRegularExpressionMatchIterator it = includeRegex.globalMatch(QString::fromUtf8(source));
+	while (it.hasNext())
+	{
+		QString includedFile = it.next().captured(1);
+		if (QFileInfo(includedFile).isRelative() && !baseDir.isEmpty())
+			includedFile = baseDir + QDir::separator() + includedFile;
+
+		// headers which are not found are only used by host code
+		QFileInfo fileInfo(includedFile);
+		const QString canonicalPath = fileInfo.canonicalFilePath();
+		if (canonicalPath.isEmpty() || visitedFiles->contains(canonicalPath)) continue;
+		visitedFiles->insert(canonicalPath);
+
+		QFile file(canonicalPath);
+		if (!file.open(QIODevice::ReadOnly)) continue;
+		const QByteArray content = file.readAll();
+		file.close();
+
+		hash->addData(canonicalPath.toUtf8());
+		hash->addData(content);
+		AddIncludedFilesToHash(content, fileInfo.absolutePath(), hash, visitedFiles);
+	}
+}
+
+bool cOpenClEngine::LoadProgramBinary(
+	int deviceIndex, const QString &fileName, const std::string &buildParams)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) return false;
+	QByteArray binary = file.readAll();
+
+	// mark file as recently used (for eviction of old binaries)
+	file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+	file.close();
+
+	std::vector<cl::Device> oneDevice;
+	oneDevice.push_back(*hardware->getEnabledDevices().at(deviceIndex));
+
+	cl::Program::Binaries binaries;
+	binaries.push_back(std::make_pair(binary.constData(), size_t(binary.size())));
+
+	cl_int err = 0;
+	std::vector<cl_int> binaryStatus;
+	std::shared_ptr<cl::Program> program(
+		new cl::Program(*hardware->getContext(deviceIndex), oneDevice, binaries, &binaryStatus, &err));
+
+	if (err == CL_SUCCESS && !binaryStatus.empty() && binaryStatus[0] == CL_SUCCESS)
+	{
+		// program created from binary still has to be built (linked) for the device
+		err = program->build(oneDevice, buildParams.c_str());
+	}
+	else if (err == CL_SUCCESS)
+	{
+		err = CL_INVALID_BINARY;
+	}
+
+	if (err != CL_SUCCESS)
+	{
+		WriteLogString("Cached OpenCL program binary cannot be used", fileName, 1);
+		QFile::remove(fileName);
+		return false;
+	}
+
+	clPrograms.append(program);
+	return true;
+}
+
+void cOpenClEngine::SaveProgramBinary(int deviceIndex, const QString &fileName)
+{
+	cl_int err = 0;
+	std::vector<std::vector<unsigned char>> binaries =
+		clPrograms[deviceIndex]->getInfo<CL_PROGRAM_BINARIES>(&err);
+	if (!checkErr(err, "program->getInfo(CL_PROGRAM_BINARIES)") || binaries.empty()
+			|| binaries[0].empty())
+		return;
+
+	QSaveFile file(fileName);
+	if (file.open(QIODevice::WriteOnly))
+	{
+		file.write(reinterpret_cast<const char *>(binaries[0].data()), qint64(binaries[0].size()));
+		if (file.commit())
+		{
+			WriteLogString("OpenCL program binary saved in cache", fileName, 2);
+		}
+	}
+
+	EvictProgramCache();
+}
+
+void cOpenClEngine::EvictProgramCache()
+{
+	// keep total size of cached binaries under the limit, removing least recently used first
+	const qint64 maxCacheSize = 512LL * 1024 * 1024;
+
+	QDir dir(systemDirectories.GetOpenCLProgramCacheFolder());
+	QFileInfoList files = dir.entryInfoList(QStringList("*.bin"), QDir::Files, QDir::Time);
+
+	qint64 totalSize = 0;
+	for (const QFileInfo &fileInfo : files)
+	{
+		totalSize += fileInfo.size();
+		if (totalSize > maxCacheSize)
+		{
+			WriteLogString("Old OpenCL program binary removed from cache", fileInfo.fileName(), 2);
+			QFile::remove(fileInfo.absoluteFilePath());
+		}
+	}
+}
+
 bool cOpenClEngine::CreateKernel4Program(std::shared_ptr<const cParameterContainer> params)
 {
 	if (programsLoaded)
@@ -553,12 +740,13 @@ void cOpenClEngine::ReleaseMemory()
 
 bool cOpenClEngine::WriteBuffersToQueue()
 {
+	// writes are not blocking. Queue is synchronized once after all buffers of the device
 	for (int d = 0; d < inputBuffers.size(); d++)
 	{
 		for (auto &inputBuffer : inputBuffers[d])
 		{
 			cl_int err = clQueues[d]->enqueueWriteBuffer(
-				*inputBuffer.clPtr, CL_TRUE, 0, inputBuffer.size(), inputBuffer.ptr.get());
+				*inputBuffer.clPtr, CL_FALSE, 0, inputBuffer.size(), inputBuffer.ptr.get());
 			if (!checkErr(err, "CommandQueue::enqueueWriteBuffer(...) for " + inputBuffer.name))
 			{
 				emit showErrorMessage(QObject::tr("Cannot enqueue writing OpenCL %1").arg(inputBuffer.name),
@@ -580,7 +768,7 @@ bool cOpenClEngine::WriteBuffersToQueue()
 	{
 		for (auto &inputAndOutputBuffer : inputAndOutputBuffers[d])
 		{
-			cl_int err = clQueues[d]->enqueueWriteBuffer(*inputAndOutputBuffer.clPtr, CL_TRUE, 0,
+			cl_int err = clQueues[d]->enqueueWriteBuffer(*inputAndOutputBuffer.clPtr, CL_FALSE, 0,
 				inputAndOutputBuffer.size(), inputAndOutputBuffer.ptr.get());
 			if (!checkErr(err, "CommandQueue::enqueueWriteBuffer(...) for " + inputAndOutputBuffer.name))
 			{
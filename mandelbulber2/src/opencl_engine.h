@@ -38,8 +38,11 @@
 #include <memory>
 #include <utility>
 
+#include <QCryptographicHash>
 #include <QElapsedTimer>
 #include <QMutex>
+#include <QSet>
+#include <QStringList>
 
 #include "error_message.hpp"
 #include "include_header_wrapper.hpp"
@@ -89,6 +92,9 @@ public:
 	bool CreateCommandQueue();
 	void SetUseBuildCache(bool useCache) { useBuildCache = useCache; }
 	void SetUseFastRelaxedMath(bool usefastMath) { useFastRelaxedMath = usefastMath; }
+	// information about persistent cache of program binaries used by the last build
+	QStringList GetProgramCacheFileNames() const { return programCacheFileNames; }
+	int GetNumberOfProgramsLoadedFromCache() const { return programsLoadedFromCache; }
 	void ReleaseMemory();
 	bool AssignParametersToKernel(int deviceIndex);
 	virtual bool AssignParametersToKernelAdditional(uint argIterator, int deviceIndex)
@@ -102,6 +108,16 @@ protected:
 	virtual QString GetKernelName() = 0;
 	static bool checkErr(cl_int err, QString functionName);
 	bool Build(const QByteArray &programString, QString *errorText, bool quiet);
+	// persistent cache of compiled program binaries
+	static QString ProgramCacheFileName(
+		const QByteArray &programHash, const std::string &buildParams, const cl::Device &device);
+	// hash of contents of all files included by the program (recursively)
+	static QByteArray IncludedFilesHash(const QByteArray &programString);
+	static void AddIncludedFilesToHash(const QByteArray &source, const QString &baseDir,
+		QCryptographicHash *hash, QSet<QString> *visitedFiles);
+	bool LoadProgramBinary(int deviceIndex, const QString &fileName, const std::string &buildParams);
+	void SaveProgramBinary(int deviceIndex, const QString &fileName);
+	static void EvictProgramCache();
 	bool CreateKernels();
 	void InitOptimalJob(std::shared_ptr<const cParameterContainer> params);
 	void UpdateOptimalJobStart(quint64 pixelsLeft);
@@ -136,6 +152,10 @@ private:
 	bool useFastRelaxedMath;
 	QByteArray lastProgramHash;
 	QByteArray lastBuildParametersHash;
+#ifdef USE_OPENCL
+	QStringList programCacheFileNames;
+	int programsLoadedFromCache;
+#endif
 
 signals:
 	void showErrorMessage(QString, cErrorMessage::enumMessageType, QWidget *);
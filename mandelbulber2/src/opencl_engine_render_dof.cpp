@@ -128,8 +128,6 @@ bool cOpenClEngineRenderDOF::RenderDOF(const sParamRender *paramRender,
 
 		if (image->IsPreview())
 		{
-			WriteLog("image->ConvertTo8bit()", 2);
-			image->ConvertTo8bitChar();
 			WriteLog("image->UpdatePreview()", 2);
 			image->UpdatePreview();
 			WriteLog("image->GetImageWidget()->update()", 2);
@@ -201,6 +201,11 @@ void cOpenClEngineRenderFractal::CreateListOfIncludes(const QStringList &clHeade
 		// fake lights based on orbit traps - shapes
 		AddInclude(programEngine, openclEnginePath + "orbit_trap_shape.cl");
 	}
+	// fractal parameters as constants for specialized kernel
+	if (useSpecializedKernel && !meshExportMode && !distanceMode)
+	{
+		programEngine.append(CreateSpecializedFractalData());
+	}
 	// compute fractal
 	AddInclude(programEngine, openclEnginePath + "compute_fractal.cl");
 	if (!distanceMode)
@@ -309,6 +314,39 @@ void cOpenClEngineRenderFractal::LoadSourceWithMainEngine(
 	programEngine.append(hashText.toUtf8());
 }
 
+QByteArray cOpenClEngineRenderFractal::CreateSpecializedFractalData() const
+{
+	// Formula parameters and hybrid sequence are stored as bytes of the same structures which are
+	// normally passed in constant buffer. Compiler can fold them and eliminate unused branches.
+	QByteArray code("#define SPECIALIZED_FRACTAL\n");
+	code += CreateConstantUnion("specializedFractals", "sFractalCl fractal[NUMBER_OF_FRACTALS]",
+		reinterpret_cast<const char *>(constantInBuffer->fractal),
+		sizeof(sFractalCl) * NUMBER_OF_FRACTALS);
+	code += CreateConstantUnion("specializedSequence", "sClFractalSequence sequence",
+		reinterpret_cast<const char *>(&constantInBuffer->sequence), sizeof(sClFractalSequence));
+
+	WriteLogInt("Specialized OpenCL kernel - size of constant data", int(code.size()), 2);
+	return code;
+}
+
+QByteArray cOpenClEngineRenderFractal::CreateConstantUnion(
+	const QString &name, const QString &member, const char *data, size_t size)
+{
+	QByteArray code;
+	code += QString("__constant union\n{\n\tuchar bytes[%1];\n\t%2;\n} %3 = {{")
+						.arg(size)
+						.arg(member, name)
+						.toUtf8();
+	for (size_t i = 0; i < size; i++)
+	{
+		if (i % 32 == 0) code += "\n";
+		code += QByteArray::number(uchar(data[i]));
+		if (i + 1 < size) code += ",";
+	}
+	code += "}};\n";
+	return code;
+}
+
 bool cOpenClEngineRenderFractal::LoadSourcesAndCompile(
 	std::shared_ptr<const cParameterContainer> params, QString *compilerErrorOutput)
 {
@@ -354,6 +392,10 @@ bool cOpenClEngineRenderFractal::LoadSourcesAndCompile(
 		return false;
 	}
 
+	// specialization applies only to one build. Next renders use generic kernel again, which
+	// is then taken from memory or from the program binary cache
+	useSpecializedKernel = false;
+
 	SetUseBuildCache(!params->Get<bool>("opencl_disable_build_cache"));
 	SetUseFastRelaxedMath(params->Get<bool>("opencl_use_fast_relaxed_math"));
 
@@ -1015,8 +1057,10 @@ void cOpenClEngineRenderFractal::RegisterInputOutputBuffers(
 	}
 	else if (distanceMode)
 	{
-		// buffer for distances
-		outputBuffers[0] << sClInputOutputBuffer(sizeof(cl_float), 1, "distance-buffer");
+		// buffers for points and distances
+		inputBuffers[0] << sClInputOutputBuffer(sizeof(cl_float4), distanceBatchSize, "points-buffer");
+		outputBuffers[0] << sClInputOutputBuffer(
+			sizeof(cl_float), distanceBatchSize, "distance-buffer");
 	}
 	else
 	{
@@ -1161,6 +1205,8 @@ void cOpenClEngineRenderFractal::CreateThreadsForOpenCLWorkers(int numberOfOpenC
 		workers[d]->setClQueue(clQueues[d]);
 		workers[d]->setInputAndOutputBuffers(inputAndOutputBuffers[0]); // 0 because not used
 		workers[d]->setOutputBuffers(outputBuffers[d]);
+		// output buffer is the kernel argument which follows input buffers
+		workers[d]->setOutputBufferArgIndex(d < inputBuffers.size() ? inputBuffers[d].size() : 0);
 		workers[d]->setOutputQueue(outputQueue);
 		workers[d]->setMaxMonteCarloSamples(numberOfSamples);
 		workers[d]->setAntiAliasingDepth(antiAliasingDepth);
@@ -1246,7 +1292,6 @@ int cOpenClEngineRenderFractal::PeriodicRefreshOfTiles(int lastRefreshTime,
 	image->CompileImage(&lastRenderedRects);
 	if (image->IsPreview())
 	{
-		image->ConvertTo8bitCharFromList(&lastRenderedRects);
 		image->UpdatePreview(&lastRenderedRects);
 		sendRenderedTilesList(listOfRenderedTilesData);
 		updateImage();
@@ -1267,7 +1312,6 @@ void cOpenClEngineRenderFractal::FinallRefreshOfImage(
 	image->CompileImage(&lastRenderedRects);
 	if (image->IsPreview())
 	{
-		image->ConvertTo8bitCharFromList(&lastRenderedRects);
 		image->UpdatePreview(&lastRenderedRects);
 		updateImage();
 	}
@@ -1960,11 +2004,11 @@ bool cOpenClEngineRenderFractal::AssignParametersToKernelAdditional(
 
 	if (distanceMode)
 	{
-		err = clKernels.at(deviceIndex)->setArg(argIterator++, pointToCalculateDistance); // random seed
-		if (!checkErr(err, "kernel->setArg(4, pointToCalculateDistance)"))
+		err = clKernels.at(deviceIndex)->setArg(argIterator++, numberOfPointsToCalculate);
+		if (!checkErr(err, "kernel->setArg(4, numberOfPointsToCalculate)"))
 		{
 			emit showErrorMessage(QObject::tr("Cannot set OpenCL argument for %1")
-															.arg(QObject::tr("pointToCalculateDistance")),
+															.arg(QObject::tr("numberOfPointsToCalculate")),
 				cErrorMessage::errorMessage, nullptr);
 			return false;
 		}
@@ -2236,23 +2280,51 @@ bool cOpenClEngineRenderFractal::Render(std::vector<double> *distances, std::vec
 
 float cOpenClEngineRenderFractal::CalculateDistance(CVector3 point)
 {
-	pointToCalculateDistance = {{cl_float(point.x), cl_float(point.y), cl_float(point.z)}};
+	QVector<double> distances;
+	if (!CalculateDistances(QVector<CVector3>() << point, &distances)) return 0.0f;
+	return float(distances[0]);
+}
 
-	// writing data to queue
-	if (!WriteBuffersToQueue()) return false;
+bool cOpenClEngineRenderFractal::CalculateDistances(
+	const QVector<CVector3> &points, QVector<double> *distances)
+{
+	distances->resize(points.size());
 
-	// assign parameters to kernel
-	if (!AssignParametersToKernel(0)) return false;
+	cl_float4 *clPoints =
+		reinterpret_cast<cl_float4 *>(inputBuffers[0][inputDistancePointsIndex].ptr.get());
+	const cl_float *clDistances =
+		reinterpret_cast<cl_float *>(outputBuffers[0][outputMeshDistancesIndex].ptr.get());
 
-	// processing queue
-	if (!ProcessQueue(0, 0, 1, 1)) return false;
+	// points are sent in chunks which fit into preallocated buffers
+	for (int first = 0; first < points.size(); first += distanceBatchSize)
+	{
+		int count = qMin(distanceBatchSize, points.size() - first);
+		for (int i = 0; i < count; i++)
+		{
+			const CVector3 &point = points[first + i];
+			clPoints[i] = {{cl_float(point.x), cl_float(point.y), cl_float(point.z), 0.0f}};
+		}
+		numberOfPointsToCalculate = count;
 
-	if (!ReadBuffersFromQueue()) return false;
+		// writing data to queue
+		if (!WriteBuffersToQueue()) return false;
 
-	float distance =
-		(reinterpret_cast<cl_float *>(outputBuffers[0][outputMeshDistancesIndex].ptr.get()))[0];
+		// assign parameters to kernel
+		if (!AssignParametersToKernel(0)) return false;
 
-	return distance;
+		optimalJob.stepSizeX = count;
+		optimalJob.stepSizeY = 1;
+
+		// processing queue
+		if (!ProcessQueue(0, 0, count, 1)) return false;
+
+		if (!ReadBuffersFromQueue()) return false;
+
+		for (int i = 0; i < count; i++)
+			(*distances)[first + i] = clDistances[i];
+	}
+
+	return true;
 }
 
 void cOpenClEngineRenderFractal::SetMeshExportParameters(const sClMeshExport *meshParams)
@@ -100,6 +100,8 @@ public:
 	bool RenderMulti(std::shared_ptr<cImage> image, bool *stopRequest, sRenderData *renderData);
 	// calculate distance using OpenCL
 	float CalculateDistance(CVector3 point);
+	// calculate distances for many points, up to distanceBatchSize points per kernel launch
+	bool CalculateDistances(const QVector<CVector3> &points, QVector<double> *distances);
 
 	// render 2D slice with fractal
 	bool Render(std::vector<double> *distances, std::vector<double> *colors,
@@ -113,6 +115,8 @@ public:
 	void ReleaseMemory();
 	size_t CalcNeededMemory() override;
 	void SetMeshExportParameters(const sClMeshExport *meshParams);
+	// next build bakes fractal parameters into the program (used only for final renders)
+	void SetUseSpecializedKernel(bool useSpecialized) { useSpecializedKernel = useSpecialized; }
 
 	static inline sRGBFloat clFloat3TosRGBFloat(const cl_float3 &clPixel)
 	{
@@ -124,6 +128,8 @@ private:
 	const int outputMeshDistancesIndex = 0;
 	const int outputMeshColorsIndex = 1;
 	const int outputMeshIterationsIndex = 2;
+	const int inputDistancePointsIndex = 0;
+	static const int distanceBatchSize = 1024;
 
 	QString GetKernelName() override;
 
@@ -133,6 +139,9 @@ private:
 		std::shared_ptr<const cParameterContainer> params, const QString &openclEnginePath,
 		QByteArray &programEngine);
 	void LoadSourceWithMainEngine(const QString &openclEnginePath, QByteArray &programEngine);
+	QByteArray CreateSpecializedFractalData() const;
+	static QByteArray CreateConstantUnion(
+		const QString &name, const QString &member, const char *data, size_t size);
 	void SetParametersForDistanceEstimationMethod(cNineFractals *fractals, sParamRender *paramRender);
 	void CreateListOfUsedFormulas(
 		cNineFractals *fractals, std::shared_ptr<const cFractalContainer> fractalContainer);
@@ -196,8 +205,9 @@ private:
 	bool autoRefreshMode;
 	bool monteCarlo;
 	bool meshExportMode;
-	cl_float3 pointToCalculateDistance;
+	cl_int numberOfPointsToCalculate;
 	bool distanceMode;
+	bool useSpecializedKernel = false;
 	bool useOptionalImageChannels;
 	double reservedGpuTime;
 
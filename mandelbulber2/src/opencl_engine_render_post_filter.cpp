@@ -340,8 +340,6 @@ bool cOpenClEngineRenderPostFilter::Render(std::shared_ptr<cImage> image, bool *
 
 			if (image->IsPreview())
 			{
-				WriteLog("image->ConvertTo8bit()", 2);
-				image->ConvertTo8bitChar();
 				WriteLog("image->UpdatePreview()", 2);
 				image->UpdatePreview();
 				WriteLog("image->GetImageWidget()->update()", 2);
@@ -84,10 +84,21 @@ void cOpenClScheduler::ReserveTile(int tileIndex, int monteCarloIteration)
 }
 
 int cOpenClScheduler::GetNextTileToRender(int lastTile, int monteCarloIteration)
+{
+	MarkTileDone(lastTile, monteCarloIteration);
+	return ReserveNextTile(lastTile, monteCarloIteration);
+}
+
+void cOpenClScheduler::MarkTileDone(int tileIndex, int monteCarloIteration)
 {
 	lock.lock();
+	tiles[tileIndex].done = monteCarloIteration; // done at n MC iteration
+	lock.unlock();
+}
 
-	tiles[lastTile].done = monteCarloIteration; // done at n MC iteration
+int cOpenClScheduler::ReserveNextTile(int lastTile, int monteCarloIteration)
+{
+	lock.lock();
 
 	int nextTile = -1; //-1 if nothing more to do
 
@@ -57,6 +57,9 @@ public:
 	bool IsTileEnabled(int tileIndex) { return tiles[tileIndex].enabled; }
 	void Clear();
 	int GetNextTileToRender(int lastTile, int monteCarloIteration);
+	// separate steps of GetNextTileToRender() for tiles which are still processed asynchronously
+	void MarkTileDone(int tileIndex, int monteCarloIteration);
+	int ReserveNextTile(int lastTile, int monteCarloIteration);
 	bool AllDone(int monteCarloIteration);
 
 	const QList<QPoint> *getTileSequence() const { return tileSequence; }
@@ -95,29 +95,28 @@ void cOpenClWorkerThread::ProcessRenderingLoop()
 		return;
 	}
 
-	QElapsedTimer openclProcessingTime;
-	qint64 openclprocessingTimeNanoSeconds = 0;
+	if (!AllocatePipelineBuffers())
+	{
+		emit finished();
+		finishedWithSuccess = false;
+		return;
+	}
 
 	int actualAADepth = 0;
 	int actualAARepeatIndex = 0;
+	int slotIndex = 0;
 
 	for (int monteCarloLoop = 1; monteCarloLoop <= maxMonteCarloSamples; monteCarloLoop++)
 	{
 		scheduler->ReserveTile(startTile, monteCarloLoop);
 
-		for (int tile = startTile; !scheduler->AllDone(monteCarloLoop);
-				 tile = scheduler->GetNextTileToRender(tile, monteCarloLoop))
+		int tile = startTile;
+		while (tile >= 0 && !scheduler->AllDone(monteCarloLoop))
 		{
-			if (tile < 0) break;
-			if (!scheduler->IsTileEnabled(tile)) continue;
-
-			// refresh parameters (needed to update random seed)
-			engine->AssignParametersToKernel(deviceIndex);
-
-			// TODO calculation of aa depth and index
-			if (isFullEngine)
+			if (!scheduler->IsTileEnabled(tile))
 			{
-				AddAntiAliasingParameters(actualAADepth, actualAARepeatIndex);
+				tile = scheduler->GetNextTileToRender(tile, monteCarloLoop);
+				continue;
 			}
 
 			quint64 gridX = scheduler->getTileSequence()->at(tile).x();
@@ -134,6 +133,7 @@ void cOpenClWorkerThread::ProcessRenderingLoop()
 
 			if (*stopRequest || systemData.globalStopRequest)
 			{
+				AbortPipeline();
 				emit finished();
 				finishedWithSuccess = false;
 				return;
@@ -141,58 +141,50 @@ void cOpenClWorkerThread::ProcessRenderingLoop()
 
 			if (jobX < imageWidth && jobY < imageHeight)
 			{
-				openclProcessingTime.restart();
-				int result = ProcessClQueue(jobX, jobY, pixelsLeftX, pixelsLeftY);
-				if (!result)
+				// the slot is reused, so the tile rendered previously in it has to be handed over first
+				sPipelineSlot &slot = pipelineSlots[slotIndex];
+				if (slot.pending && !CompleteSlot(slot))
 				{
+					AbortPipeline();
 					emit finished();
 					finishedWithSuccess = false;
 					return;
 				}
 
-				result = engine->ReadBuffersFromQueue(deviceIndex);
-				if (!result)
+				// refresh parameters (needed to update random seed)
+				engine->AssignParametersToKernel(deviceIndex);
+
+				// TODO calculation of aa depth and index
+				if (isFullEngine)
 				{
+					AddAntiAliasingParameters(actualAADepth, actualAARepeatIndex);
+				}
+
+				slot.output.jobX = jobX;
+				slot.output.jobY = jobY;
+				slot.output.gridX = gridX;
+				slot.output.gridY = gridY;
+				slot.output.tileIndex = tile;
+				slot.output.jobWidth = jobWidth;
+				slot.output.jobHeight = jobHeight;
+				slot.output.monteCarloLoop = monteCarloLoop;
+				slot.output.aaDepth = actualAADepth;
+
+				if (!ProcessClQueue(&slot, jobX, jobY, pixelsLeftX, pixelsLeftY))
+				{
+					AbortPipeline();
 					emit finished();
 					finishedWithSuccess = false;
 					return;
 				}
+				slotIndex = (slotIndex + 1) % pipelineSlots.size();
 
-				//				qDebug() << "finished tile" << tile << gridX << gridY << jobX << jobY << jobWidth
-				//								 << jobHeight;
-
-				openclprocessingTimeNanoSeconds = openclProcessingTime.nsecsElapsed();
-
-				quint64 outputItemSize = outputBuffers.at(outputIndex).itemSize;
-				quint64 outputItemlength = outputBuffers.at(outputIndex).length;
-				cOpenCLWorkerOutputQueue::sClDataBuffer dataBuffer(outputItemSize, outputItemlength);
-
-				char *startPtr = outputBuffers.at(outputIndex).ptr.get();
-				char *endPtr = startPtr + outputBuffers.at(outputIndex).size();
-				dataBuffer.data.assign(startPtr, endPtr);
-
-				cOpenCLWorkerOutputQueue::sClSingleOutput outputDataForQueue;
-				outputDataForQueue.jobX = jobX;
-				outputDataForQueue.jobY = jobY;
-				outputDataForQueue.gridX = gridX;
-				outputDataForQueue.gridY = gridY;
-				outputDataForQueue.tileIndex = tile;
-				outputDataForQueue.jobWidth = jobWidth;
-				outputDataForQueue.jobHeight = jobHeight;
-				outputDataForQueue.monteCarloLoop = monteCarloLoop;
-				outputDataForQueue.aaDepth = actualAADepth;
-				outputDataForQueue.outputBuffers.append(dataBuffer);
-
-				outputQueue->AddToQueue(&outputDataForQueue);
-
-				// reserve GPU time for the system
-				if (reservedGpuTime > 0.0)
-				{
-					unsigned long int waitTime =
-						reservedGpuTime * openclprocessingTimeNanoSeconds / 1000.0 / 100.0;
-					if (waitTime == 0) waitTime = 1;
-					thread()->usleep(waitTime);
-				}
+				// tile will be marked as done when its data is read back
+				tile = scheduler->ReserveNextTile(tile, monteCarloLoop);
+			}
+			else
+			{
+				tile = scheduler->GetNextTileToRender(tile, monteCarloLoop);
 			}
 
 			// slow down to reduce length of queue
@@ -203,6 +195,15 @@ void cOpenClWorkerThread::ProcessRenderingLoop()
 			}
 		} // next tile
 
+		// hand over tiles which are still in the pipeline
+		if (!FinishPipeline(slotIndex))
+		{
+			AbortPipeline();
+			emit finished();
+			finishedWithSuccess = false;
+			return;
+		}
+
 		if (*stopRequest || systemData.globalStopRequest)
 		{
 			emit finished();
@@ -227,16 +228,60 @@ void cOpenClWorkerThread::ProcessRenderingLoop()
 	emit finished();
 }
 
+bool cOpenClWorkerThread::AllocatePipelineBuffers()
+{
+	pipelineSlots.clear();
+
+	// first slot uses output buffer allocated by the engine
+	const sClInputOutputBuffer &outputBuffer = outputBuffers.at(outputIndex);
+	pipelineSlots.append(sPipelineSlot(outputBuffer));
+
+	// when GPU time is reserved for the system, tiles are not overlapped
+	int numberOfSlots = (reservedGpuTime > 0.0) ? 1 : pipelineDepth;
+
+	cl_int err = 0;
+	cl::Context context = clQueue->getInfo<CL_QUEUE_CONTEXT>(&err);
+	if (!checkErr(err, "CommandQueue::getInfo(CL_QUEUE_CONTEXT)")) return false;
+
+	for (int i = 1; i < numberOfSlots; i++)
+	{
+		sClInputOutputBuffer buffer(outputBuffer.itemSize, outputBuffer.length, outputBuffer.name);
+		buffer.ptr.reset(new char[buffer.size()], sClInputOutputBuffer::Deleter);
+		buffer.clPtr.reset(new cl::Buffer(
+			context, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, buffer.size(), buffer.ptr.get(), &err));
+		if (!checkErr(err, "new cl::Buffer(...) for " + buffer.name))
+		{
+			emit showErrorMessage(QObject::tr("OpenCL %1 cannot be created!").arg(buffer.name),
+				cErrorMessage::errorMessage, nullptr);
+			return false;
+		}
+		pipelineSlots.append(sPipelineSlot(buffer));
+	}
+	return true;
+}
+
 bool cOpenClWorkerThread::ProcessClQueue(
-	quint64 jobX, quint64 jobY, quint64 pixelsLeftX, quint64 pixelsLeftY)
+	sPipelineSlot *slot, quint64 jobX, quint64 jobY, quint64 pixelsLeftX, quint64 pixelsLeftY)
 {
 	size_t stepSizeX = optimalStepX;
 	if (pixelsLeftX < stepSizeX) stepSizeX = pixelsLeftX;
 	size_t stepSizeY = optimalStepY;
 	if (pixelsLeftY < stepSizeY) stepSizeY = pixelsLeftY;
 
-	cl_int err = clQueue->enqueueNDRangeKernel(
-		*clKernel, cl::NDRange(jobX, jobY), cl::NDRange(stepSizeX, stepSizeY), cl::NullRange);
+	slot->timer.restart();
+
+	// kernel writes to output buffer of the slot (arguments are captured at enqueue time)
+	cl_int err = clKernel->setArg(outputBufferArgIndex, *slot->buffer.clPtr);
+	if (!checkErr(err, "kernel->setArg() for " + slot->buffer.name))
+	{
+		emit showErrorMessage(QObject::tr("Cannot set OpenCL argument for %1").arg(slot->buffer.name),
+			cErrorMessage::errorMessage, nullptr);
+		return false;
+	}
+
+	std::vector<cl::Event> kernelEvent(1);
+	err = clQueue->enqueueNDRangeKernel(*clKernel, cl::NDRange(jobX, jobY),
+		cl::NDRange(stepSizeX, stepSizeY), cl::NullRange, nullptr, &kernelEvent[0]);
 	if (!checkErr(err, "CommandQueue::enqueueNDRangeKernel()"))
 	{
 		emit showErrorMessage(
@@ -244,9 +289,85 @@ bool cOpenClWorkerThread::ProcessClQueue(
 		return false;
 	}
 
+	// non-blocking read chained to the kernel. It is waited for when the slot is reused
+	err = clQueue->enqueueReadBuffer(*slot->buffer.clPtr, CL_FALSE, 0, slot->buffer.size(),
+		slot->buffer.ptr.get(), &kernelEvent, &slot->readEvent);
+	if (!checkErr(err, "CommandQueue::enqueueReadBuffer() for " + slot->buffer.name))
+	{
+		emit showErrorMessage(
+			QObject::tr("Cannot enqueue reading OpenCL buffers %1").arg(slot->buffer.name),
+			cErrorMessage::errorMessage, nullptr);
+		return false;
+	}
+
+	clQueue->flush();
+	slot->pending = true;
+
+	return true;
+}
+
+bool cOpenClWorkerThread::CompleteSlot(sPipelineSlot &slot)
+{
+	cl_int err = slot.readEvent.wait();
+	slot.pending = false;
+	if (!checkErr(err, "cl::Event::wait() - read buffers"))
+	{
+		emit showErrorMessage(
+			QObject::tr("Cannot finish reading OpenCL output buffers\nCalculation probably took too "
+									"long and triggered timeout error in graphics driver."),
+			cErrorMessage::errorMessage, nullptr);
+		return false;
+	}
+
+	qint64 openclprocessingTimeNanoSeconds = slot.timer.nsecsElapsed();
+
+	//				qDebug() << "finished tile" << tile << gridX << gridY << jobX << jobY << jobWidth
+	//								 << jobHeight;
+
+	cOpenCLWorkerOutputQueue::sClDataBuffer dataBuffer(slot.buffer.itemSize, slot.buffer.length);
+
+	char *startPtr = slot.buffer.ptr.get();
+	char *endPtr = startPtr + slot.buffer.size();
+	dataBuffer.data.assign(startPtr, endPtr);
+
+	slot.output.outputBuffers.clear();
+	slot.output.outputBuffers.append(dataBuffer);
+
+	outputQueue->AddToQueue(&slot.output);
+	scheduler->MarkTileDone(int(slot.output.tileIndex), slot.output.monteCarloLoop);
+
+	// reserve GPU time for the system
+	if (reservedGpuTime > 0.0)
+	{
+		unsigned long int waitTime = reservedGpuTime * openclprocessingTimeNanoSeconds / 1000.0 / 100.0;
+		if (waitTime == 0) waitTime = 1;
+		thread()->usleep(waitTime);
+	}
+
+	return true;
+}
+
+bool cOpenClWorkerThread::FinishPipeline(int nextSlotIndex)
+{
+	// the oldest tile is in the slot which would be used next
+	for (int i = 0; i < pipelineSlots.size(); i++)
+	{
+		sPipelineSlot &slot = pipelineSlots[(nextSlotIndex + i) % pipelineSlots.size()];
+		if (slot.pending && !CompleteSlot(slot)) return false;
+	}
 	return true;
 }
 
+void cOpenClWorkerThread::AbortPipeline()
+{
+	// buffers can be released only when there are no pending reads
+	clQueue->finish();
+	for (sPipelineSlot &slot : pipelineSlots)
+	{
+		slot.pending = false;
+	}
+}
+
 bool cOpenClWorkerThread::AddAntiAliasingParameters(int actualDepth, int repeatIndex)
 {
 	CVector2<float> offset;
@@ -39,14 +39,15 @@
 
 #include <memory>
 
+#include <QElapsedTimer>
 #include <QObject>
 
 #include "algebra.hpp"
 #include "error_message.hpp"
 #include "include_header_wrapper.hpp"
 #include "opencl_input_output_buffer.h"
+#include "opencl_worker_output_queue.h"
 
-class cOpenCLWorkerOutputQueue;
 class cOpenClScheduler;
 class cOpenClEngine;
 
@@ -85,10 +86,28 @@ public:
 	}
 	void setStopRequest(bool *stopRequest) { this->stopRequest = stopRequest; }
 	void setReservedGpuTime(double reservedGpuTime) { this->reservedGpuTime = reservedGpuTime; }
+	void setOutputBufferArgIndex(int argIndex) { this->outputBufferArgIndex = argIndex; }
 	bool wasFishedWithSuccess() { return finishedWithSuccess; }
 
 private:
-	bool ProcessClQueue(quint64 jobX, quint64 jobY, quint64 pixelsLeftX, quint64 pixelsLeftY);
+	// one stage of the tile pipeline: output buffer and the tile which is rendered into it
+	struct sPipelineSlot
+	{
+		sPipelineSlot(const sClInputOutputBuffer &buffer) : buffer(buffer) {}
+		sClInputOutputBuffer buffer;
+		cl::Event readEvent;
+		bool pending{false};
+		cOpenCLWorkerOutputQueue::sClSingleOutput output;
+		QElapsedTimer timer;
+	};
+
+	bool AllocatePipelineBuffers();
+	bool ProcessClQueue(
+		sPipelineSlot *slot, quint64 jobX, quint64 jobY, quint64 pixelsLeftX, quint64 pixelsLeftY);
+	// wait for data of the slot and hand it over to output queue
+	bool CompleteSlot(sPipelineSlot &slot);
+	bool FinishPipeline(int nextSlotIndex);
+	void AbortPipeline();
 	static bool checkErr(cl_int err, QString functionName);
 	bool AddAntiAliasingParameters(int actualDepth, int repeatIndex);
 
@@ -102,6 +121,11 @@ private:
 	bool *stopRequest;
 
 	const int outputIndex = 0;
+	int outputBufferArgIndex = 0;
+
+	// number of tiles which can be processed concurrently (kernel of one while reading another)
+	static const int pipelineDepth = 2;
+	QList<sPipelineSlot> pipelineSlots;
 
 	cOpenClEngine *engine;
 
@@ -0,0 +1,153 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * ZlibCompressParallel() - compression of big buffers into single zlib stream using all cores.
+ * Data is divided into strips which are deflated independently (with last 32kB of previous strip
+ * as dictionary) and joined with sync flush markers, like in pigz
+ */
+
+#include "parallel_deflate.hpp"
+
+#include <algorithm>
+
+#include <zlib.h>
+
+#include "system.hpp"
+
+namespace
+{
+const size_t stripSize = 512 * 1024;
+const size_t dictionaryMaxSize = 32768;
+} // namespace
+
+bool DeflateStrip(const unsigned char *data, size_t size, int level,
+	const unsigned char *dictionary, size_t dictionarySize, bool last, bool rawDeflate,
+	std::vector<unsigned char> *output)
+{
+	z_stream stream = {};
+	if (deflateInit2(&stream, level, Z_DEFLATED, rawDeflate ? -MAX_WBITS : MAX_WBITS, 8,
+				Z_DEFAULT_STRATEGY)
+			!= Z_OK)
+		return false;
+
+	if (dictionary && dictionarySize > 0)
+	{
+		if (deflateSetDictionary(&stream, dictionary, uInt(dictionarySize)) != Z_OK)
+		{
+			deflateEnd(&stream);
+			return false;
+		}
+	}
+
+	// additional space for sync flush marker
+	output->resize(deflateBound(&stream, uLong(size)) + 16);
+	stream.next_in = const_cast<unsigned char *>(data);
+	stream.avail_in = uInt(size);
+
+	const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+	size_t written = 0;
+	int result;
+	do
+	{
+		if (written == output->size()) output->resize(output->size() * 2);
+		stream.next_out = output->data() + written;
+		stream.avail_out = uInt(output->size() - written);
+		result = deflate(&stream, flush);
+		written = output->size() - stream.avail_out;
+	} while (result == Z_OK && (last || stream.avail_out == 0));
+
+	deflateEnd(&stream);
+	output->resize(written);
+
+	return last ? result == Z_STREAM_END : (result == Z_OK || result == Z_BUF_ERROR);
+}
+
+bool ZlibCompressParallel(const unsigned char *data, size_t size, int level,
+	std::vector<unsigned char> *output, const std::function<void(double)> &progress)
+{
+	if (level == Z_DEFAULT_COMPRESSION) level = 6;
+
+	const size_t numberOfStrips = std::max(size_t(1), (size + stripSize - 1) / stripSize);
+	const size_t stripsInBatch = size_t(std::max(1, get_cpu_count()));
+
+	// zlib header with compression level bits
+	const int levelFlag = (level < 2) ? 0 : (level < 6) ? 1 : (level == 6) ? 2 : 3;
+	const unsigned cmf = 0x78;
+	unsigned flg = unsigned(levelFlag) << 6;
+	flg += 31 - ((cmf << 8) + flg) % 31;
+
+	output->clear();
+	output->reserve(size / 2);
+	output->push_back(static_cast<unsigned char>(cmf));
+	output->push_back(static_cast<unsigned char>(flg));
+
+	uLong checksum = adler32(0L, Z_NULL, 0);
+
+	std::vector<std::vector<unsigned char>> compressedStrips(stripsInBatch);
+	std::vector<uLong> stripChecksums(stripsInBatch);
+	std::vector<char> stripResults(stripsInBatch);
+
+	// strips are processed in batches to keep memory usage low and to report progress
+	for (size_t batchStart = 0; batchStart < numberOfStrips; batchStart += stripsInBatch)
+	{
+		const size_t batchSize = std::min(stripsInBatch, numberOfStrips - batchStart);
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = 0; i < int(batchSize); i++)
+		{
+			const size_t strip = batchStart + i;
+			const size_t start = strip * stripSize;
+			const size_t length = std::min(stripSize, size - start);
+			const size_t dictionarySize = std::min(dictionaryMaxSize, start);
+
+			stripResults[i] = DeflateStrip(data + start, length, level, data + start - dictionarySize,
+				dictionarySize, strip == numberOfStrips - 1, true, &compressedStrips[i]);
+			stripChecksums[i] = adler32(adler32(0L, Z_NULL, 0), data + start, uInt(length));
+		}
+
+		for (size_t i = 0; i < batchSize; i++)
+		{
+			if (!stripResults[i]) return false;
+			const size_t start = (batchStart + i) * stripSize;
+			const size_t length = std::min(stripSize, size - start);
+			output->insert(output->end(), compressedStrips[i].begin(), compressedStrips[i].end());
+			checksum = adler32_combine(checksum, stripChecksums[i], z_off_t(length));
+		}
+
+		if (progress) progress(double(batchStart + batchSize) / numberOfStrips);
+	}
+
+	// adler32 checksum in big endian order
+	for (int shift = 24; shift >= 0; shift -= 8)
+		output->push_back(static_cast<unsigned char>((checksum >> shift) & 0xFF));
+
+	return true;
+}
@@ -47,9 +47,17 @@
 
 using namespace parameterContainer;
 
+std::atomic<quint64> cParameterContainer::revisionCounter(0);
+
 cParameterContainer::cParameterContainer()
 {
 	myMap.clear();
+	revision = NextRevision();
+}
+
+quint64 cParameterContainer::NextRevision()
+{
+	return ++revisionCounter;
 }
 
 cParameterContainer::~cParameterContainer()
@@ -63,6 +71,7 @@ cParameterContainer &cParameterContainer::operator=(const cParameterContainer &p
 
 	myMap = par.myMap;
 	containerName = par.containerName;
+	revision = par.revision.load();
 	return *this;
 }
 
@@ -72,6 +81,7 @@ void cParameterContainer::addParam(QString name, T defaultVal, enumMorphType mor
 	enumParameterType parType, QStringList enumLookup)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	cOneParameter newRecord;
 	newRecord.Set(defaultVal, valueDefault);
@@ -116,6 +126,7 @@ void cParameterContainer::addParam(QString name, T defaultVal, T minVal, T maxVa
 	enumMorphType morphType, enumParameterType parType)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	cOneParameter newRecord;
 	newRecord.Set(defaultVal, valueDefault);
@@ -152,6 +163,7 @@ void cParameterContainer::addParam(QString name, int index, T defaultVal, enumMo
 	enumParameterType parType, QStringList enumLookup)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	if (index >= 0)
 	{
@@ -199,6 +211,7 @@ void cParameterContainer::addParam(QString name, int index, T defaultVal, T minV
 	enumMorphType morphType, enumParameterType parType)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	if (index >= 0)
 	{
@@ -242,6 +255,7 @@ template <class T>
 void cParameterContainer::Set(QString name, T val)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	QMap<QString, cOneParameter>::iterator it;
 	it = myMap.find(name);
@@ -267,6 +281,7 @@ template <class T>
 void cParameterContainer::Set(QString name, int index, T val)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	if (index >= 0)
 	{
@@ -441,6 +456,7 @@ void cParameterContainer::Copy(
 	QString name, std::shared_ptr<const cParameterContainer> sourceContainer)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	QMap<QString, cOneParameter>::const_iterator itSource;
 	QMap<QString, cOneParameter>::iterator itDest;
@@ -472,6 +488,50 @@ QList<QString> cParameterContainer::GetListOfParameters() const
 	return list;
 }
 
+QList<QString> cParameterContainer::GetListOfDifferences(const cParameterContainer &other) const
+{
+	QList<QString> list;
+	if (&other == this) return list;
+
+	QMutexLocker lock(&m_lock);
+	QMutexLocker lockOther(&other.m_lock);
+
+	// containers which were not modified since copying still share the same data
+	if (myMap.isSharedWith(other.myMap)) return list;
+
+	// both maps are sorted by key, so they can be compared in one pass
+	auto it = myMap.constBegin();
+	auto itOther = other.myMap.constBegin();
+	while (it != myMap.constEnd() || itOther != other.myMap.constEnd())
+	{
+		if (itOther == other.myMap.constEnd()
+				|| (it != myMap.constEnd() && it.key() < itOther.key()))
+		{
+			list.append(it.key()); // parameter missing in other container
+			++it;
+		}
+		else if (it == myMap.constEnd() || itOther.key() < it.key())
+		{
+			list.append(itOther.key()); // parameter missing in this container
+			++itOther;
+		}
+		else
+		{
+			const cOneParameter &param = it.value();
+			const cOneParameter &paramOther = itOther.value();
+			if (param.GetValueType() != paramOther.GetValueType()
+					|| param.GetMorphType() != paramOther.GetMorphType()
+					|| !(param.GetMultiVal(valueActual) == paramOther.GetMultiVal(valueActual)))
+			{
+				list.append(it.key());
+			}
+			++it;
+			++itOther;
+		}
+	}
+	return list;
+}
+
 void cParameterContainer::PrintListOfParameters() const
 {
 	QString parametersOutput = "Non-Default Parameters for Rendered Example Settings\n";
@@ -547,6 +607,7 @@ bool cParameterContainer::isDefaultValue(QString name) const
 void cParameterContainer::ResetAllToDefault(const QStringList &exclude)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	QMap<QString, cOneParameter>::iterator it = myMap.begin();
 	while (it != myMap.end())
@@ -578,6 +639,7 @@ bool cParameterContainer::IfExists(const QString &name) const
 void cParameterContainer::DeleteParameter(const QString &name)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	QMap<QString, cOneParameter>::iterator it;
 	it = myMap.find(name);
@@ -601,6 +663,7 @@ cOneParameter cParameterContainer::GetAsOneParameter(QString name) const
 	if (it != myMap.end())
 	{
 		val = it.value();
+		if (val.GetOriginalContainerName().isEmpty()) val.SetOriginalContainerName(containerName);
 	}
 	else
 	{
@@ -613,6 +676,7 @@ cOneParameter cParameterContainer::GetAsOneParameter(QString name) const
 void cParameterContainer::SetFromOneParameter(QString name, const cOneParameter &parameter)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	QMap<QString, cOneParameter>::iterator it;
 	it = myMap.find(name);
@@ -631,6 +695,7 @@ void cParameterContainer::SetFromOneParameter(QString name, const cOneParameter
 void cParameterContainer::AddParamFromOneParameter(QString name, const cOneParameter &parameter)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	if (myMap.find(name) != myMap.end())
 	{
@@ -644,6 +709,43 @@ void cParameterContainer::AddParamFromOneParameter(QString name, const cOneParam
 	}
 }
 
+void cParameterContainer::AddParamsFromContainer(const cParameterContainer &source)
+{
+	QMap<QString, cOneParameter> sourceMap;
+	QString sourceName;
+	{
+		QMutexLocker sourceLock(&source.m_lock);
+		sourceMap = source.myMap;
+		sourceName = source.containerName;
+	}
+
+	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
+
+	if (myMap.isEmpty() && (sourceName.isEmpty() || sourceName == containerName))
+	{
+		// implicitly shared copy. Data is duplicated only when modified. Records of unnamed container
+		// have empty container name which is resolved in GetAsOneParameter()
+		myMap = sourceMap;
+	}
+	else
+	{
+		for (auto it = sourceMap.constBegin(); it != sourceMap.constEnd(); ++it)
+		{
+			if (myMap.contains(it.key()))
+			{
+				qWarning() << "addParam(): element '" << it.key() << "' already existed";
+			}
+			else
+			{
+				cOneParameter record = it.value();
+				record.SetOriginalContainerName(containerName);
+				myMap.insert(it.key(), record);
+			}
+		}
+	}
+}
+
 // FIXME: This code need to be moved to the better place (e.g. to separate .cpp and .h files)
 // cParameterContainer is general container and should not be specialized
 QMap<QString, QString> cParameterContainer::getImageMeta()
@@ -691,6 +793,7 @@ QMap<QString, QString> cParameterContainer::getImageMeta()
 void cParameterContainer::SetAsGradient(QString name)
 {
 	QMutexLocker lock(&m_lock);
+	revision = NextRevision();
 
 	QMap<QString, cOneParameter>::iterator it;
 	it = myMap.find(name);
@@ -35,6 +35,7 @@
 #ifndef MANDELBULBER2_SRC_PARAMETERS_HPP_
 #define MANDELBULBER2_SRC_PARAMETERS_HPP_
 
+#include <atomic>
 #include <memory>
 
 #include <QMap>
@@ -49,7 +50,7 @@ public:
 	cParameterContainer();
 
 	cParameterContainer(const cParameterContainer &par)
-			: myMap(par.myMap), containerName(par.containerName)
+			: myMap(par.myMap), containerName(par.containerName), revision(par.revision.load())
 	{
 	}
 
@@ -90,12 +91,16 @@ public:
 	cOneParameter GetAsOneParameter(QString name) const;
 	void SetFromOneParameter(QString name, const cOneParameter &parameter);
 	void AddParamFromOneParameter(QString name, const cOneParameter &parameter);
+	// adds all parameters defined in source container (used for shared default definitions)
+	void AddParamsFromContainer(const cParameterContainer &source);
 
 	enumVarType GetVarType(QString name) const;
 	enumParameterType GetParameterType(QString name) const;
 	bool isDefaultValue(QString name) const;
 	void Copy(QString name, std::shared_ptr<const cParameterContainer> sourceContainer);
 	QList<QString> GetListOfParameters() const;
+	// names of parameters which were added, removed or have different value than in other container
+	QList<QString> GetListOfDifferences(const cParameterContainer &other) const;
 	int GetCount() const { return myMap.count(); }
 	void PrintListOfParameters() const;
 	void ResetAllToDefault(const QStringList &exclude = QStringList());
@@ -105,9 +110,12 @@ public:
 	void DeleteParameter(const QString &name);
 	QMap<QString, QString> getImageMeta();
 	void SetAsGradient(QString name);
+	// changes every time any parameter is added, modified or removed
+	quint64 GetRevision() const { return revision; }
 
 private:
 	static QString nameWithIndex(QString *str, int index);
+	static quint64 NextRevision();
 
 	static bool compareStrings(const QString &p1, const QString &p2)
 	{
@@ -117,8 +125,11 @@ private:
 	// std::map container
 	QMap<QString, cOneParameter> myMap;
 	QString containerName;
+	std::atomic<quint64> revision;
 
 	mutable QMutex m_lock;
+
+	static std::atomic<quint64> revisionCounter;
 };
 
 extern template void cParameterContainer::addParam<double>(QString name, double defaultVal,
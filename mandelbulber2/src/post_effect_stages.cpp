@@ -0,0 +1,232 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cPostEffectStages - keeps output of screen space post effects between runs
+ */
+
+#include "post_effect_stages.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "cimage.hpp"
+#include "fractparams.hpp"
+
+cPostEffectStages::cPostEffectStages(cImage *_image) : image(_image)
+{
+	width = 0;
+	height = 0;
+	tilesX = 0;
+	tilesY = 0;
+}
+
+void cPostEffectStages::CheckSize()
+{
+	int imageWidth = int(image->GetWidth());
+	int imageHeight = int(image->GetHeight());
+	if (imageWidth == width && imageHeight == height) return;
+
+	width = imageWidth;
+	height = imageHeight;
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	Invalidate();
+}
+
+void cPostEffectStages::Invalidate()
+{
+	for (sStage &stage : stages)
+	{
+		stage.valid = false;
+		stage.settings.clear();
+		stage.output.clear();
+		stage.output.shrink_to_fit();
+		stage.dirtyTiles.assign(size_t(tilesX) * tilesY, 1);
+	}
+}
+
+void cPostEffectStages::MarkDirtyTiles(sStage &stage, const cRegion<int> &region) const
+{
+	int tileX1 = std::max(region.x1, 0) / tileSize;
+	int tileY1 = std::max(region.y1, 0) / tileSize;
+	int tileX2 = std::min((region.x2 + tileSize - 1) / tileSize, tilesX);
+	int tileY2 = std::min((region.y2 + tileSize - 1) / tileSize, tilesY);
+
+	for (int ty = tileY1; ty < tileY2; ty++)
+	{
+		for (int tx = tileX1; tx < tileX2; tx++)
+		{
+			stage.dirtyTiles[size_t(ty) * tilesX + tx] = 1;
+		}
+	}
+}
+
+void cPostEffectStages::MarkDirty(const cRegion<int> &region)
+{
+	CheckSize();
+	for (sStage &stage : stages)
+	{
+		MarkDirtyTiles(stage, region);
+	}
+}
+
+cPostEffectStages::enumStageState cPostEffectStages::PrepareStage(
+	enumStage stage, const QString &settings, int halo, cRegion<int> *dirtyRegion)
+{
+	CheckSize();
+	const sStage &actualStage = stages[stage];
+	if (!actualStage.valid || actualStage.settings != settings) return stageInvalid;
+
+	// bounding box of dirty tiles
+	int tileX1 = tilesX;
+	int tileY1 = tilesY;
+	int tileX2 = -1;
+	int tileY2 = -1;
+	for (int ty = 0; ty < tilesY; ty++)
+	{
+		for (int tx = 0; tx < tilesX; tx++)
+		{
+			if (actualStage.dirtyTiles[size_t(ty) * tilesX + tx])
+			{
+				tileX1 = std::min(tileX1, tx);
+				tileY1 = std::min(tileY1, ty);
+				tileX2 = std::max(tileX2, tx);
+				tileY2 = std::max(tileY2, ty);
+			}
+		}
+	}
+	if (tileX2 < 0) return stageUpToDate;
+
+	// extended by halo of the effect
+	int x1 = std::max(tileX1 * tileSize - halo, 0);
+	int y1 = std::max(tileY1 * tileSize - halo, 0);
+	int x2 = std::min((tileX2 + 1) * tileSize + halo, width);
+	int y2 = std::min((tileY2 + 1) * tileSize + halo, height);
+	dirtyRegion->Set(x1, y1, x2, y2);
+	return stagePartial;
+}
+
+void cPostEffectStages::RestoreOutput(enumStage stage, const cRegion<int> *keepRegion) const
+{
+	const sStage &actualStage = stages[stage];
+	std::vector<sRGBFloat> &postImage = image->GetPostImageFloat();
+	if (!actualStage.valid || actualStage.output.size() != postImage.size()) return;
+
+	if (!keepRegion)
+	{
+		postImage = actualStage.output;
+		return;
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		auto first = actualStage.output.begin() + qint64(y) * width;
+		auto last = first + width;
+		auto firstDest = postImage.begin() + qint64(y) * width;
+
+		if (y < keepRegion->y1 || y >= keepRegion->y2)
+		{
+			std::copy(first, last, firstDest);
+		}
+		else
+		{
+			std::copy(first, first + keepRegion->x1, firstDest);
+			std::copy(first + keepRegion->x2, last, firstDest + keepRegion->x2);
+		}
+	}
+}
+
+void cPostEffectStages::StoreOutput(
+	enumStage stage, const QString &settings, const cRegion<int> *changedRegion)
+{
+	CheckSize();
+	sStage &actualStage = stages[stage];
+	actualStage.output = image->GetPostImageFloat();
+	actualStage.settings = settings;
+	actualStage.valid = true;
+	std::fill(actualStage.dirtyTiles.begin(), actualStage.dirtyTiles.end(), 0);
+
+	// output of this stage is input of next stages
+	for (int i = stage + 1; i < numberOfStages; i++)
+	{
+		if (changedRegion)
+			MarkDirtyTiles(stages[i], *changedRegion);
+		else
+			std::fill(stages[i].dirtyTiles.begin(), stages[i].dirtyTiles.end(), 1);
+	}
+}
+
+void cPostEffectStages::InvalidateStage(enumStage stage)
+{
+	for (int i = stage; i < numberOfStages; i++)
+	{
+		stages[i].valid = false;
+		stages[i].settings.clear();
+		stages[i].output.clear();
+		stages[i].output.shrink_to_fit();
+		std::fill(stages[i].dirtyTiles.begin(), stages[i].dirtyTiles.end(), 1);
+	}
+}
+
+QString cPostEffectStages::SSAOSettings(const sParamRender &params, bool splitStereo)
+{
+	return QString("SSAO %1 %2 %3 %4 %5 %6 %7 %8 %9")
+		.arg(double(params.ambientOcclusion), 0, 'g', 16)
+		.arg(params.ambientOcclusionQuality)
+		.arg(double(params.ambientOcclusionColor.R), 0, 'g', 16)
+		.arg(double(params.ambientOcclusionColor.G), 0, 'g', 16)
+		.arg(double(params.ambientOcclusionColor.B), 0, 'g', 16)
+		.arg(int(params.SSAO_random_mode))
+		.arg(params.fov, 0, 'g', 16)
+		.arg(int(params.perspectiveType))
+		.arg(int(splitStereo));
+}
+
+QString cPostEffectStages::DOFSettings(
+	const sParamRender &params, bool splitStereo, const QString &previousStages)
+{
+	// output depends also on settings of previous stages
+	return QString("DOF %1 %2 %3 %4 %5 %6 | %7")
+		.arg(params.DOFRadius, 0, 'g', 16)
+		.arg(params.DOFFocus, 0, 'g', 16)
+		.arg(params.DOFNumberOfPasses)
+		.arg(params.DOFBlurOpacity, 0, 'g', 16)
+		.arg(params.DOFMaxRadius, 0, 'g', 16)
+		.arg(int(splitStereo))
+		.arg(previousStages);
+}
+
+int cPostEffectStages::DOFHalo(const sParamRender &params)
+{
+	// DOF has two phases, each reaching up to DOFMaxRadius: gathering of pre-blurred image and
+	// scattering of it, so output pixel depends on input pixels within 2 * DOFMaxRadius
+	return 2 * (int(ceil(params.DOFMaxRadius)) + 1);
+}
@@ -0,0 +1,116 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cPostEffectStages - keeps output of screen space post effects (SSAO, DOF) between runs
+ * together with map of tiles which have changed since. Post effects are recalculated only in
+ * dirty tiles extended by halo needed by given effect, or in whole image if effect settings
+ * have changed.
+ */
+
+#ifndef MANDELBULBER2_SRC_POST_EFFECT_STAGES_HPP_
+#define MANDELBULBER2_SRC_POST_EFFECT_STAGES_HPP_
+
+#include <vector>
+
+#include <QString>
+
+#include "color_structures.hpp"
+#include "region.hpp"
+
+// forward declarations
+class cImage;
+struct sParamRender;
+
+class cPostEffectStages
+{
+public:
+	enum enumStage
+	{
+		stageSSAO = 0,
+		stageDOF = 1,
+		numberOfStages = 2
+	};
+
+	enum enumStageState
+	{
+		stageInvalid,
+		stageUpToDate,
+		stagePartial
+	};
+
+	cPostEffectStages(cImage *_image);
+
+	// rendered image has been changed in given region
+	void MarkDirty(const cRegion<int> &region);
+	void Invalidate();
+
+	// checks if stored output is valid for given settings: stageInvalid - whole image has to be
+	// processed, stageUpToDate - stored output can be used, stagePartial - stored output can be
+	// used after processing of 'dirtyRegion' (bounding box of dirty tiles extended by halo)
+	enumStageState PrepareStage(
+		enumStage stage, const QString &settings, int halo, cRegion<int> *dirtyRegion);
+	// copies stored output to post image, except pixels inside 'keepRegion'
+	void RestoreOutput(enumStage stage, const cRegion<int> *keepRegion = nullptr) const;
+	// stores actual post image as output of stage. 'changedRegion' is passed to next stages as
+	// dirty (nullptr - whole image)
+	void StoreOutput(
+		enumStage stage, const QString &settings, const cRegion<int> *changedRegion = nullptr);
+	void InvalidateStage(enumStage stage);
+
+	static QString SSAOSettings(const sParamRender &params, bool splitStereo);
+	static QString DOFSettings(
+		const sParamRender &params, bool splitStereo, const QString &previousStages);
+	static int SSAOHalo(int width) { return width / 2 + 1; }
+	static int DOFHalo(const sParamRender &params);
+
+private:
+	struct sStage
+	{
+		QString settings;
+		std::vector<sRGBFloat> output;
+		std::vector<char> dirtyTiles;
+		bool valid{false};
+	};
+
+	void CheckSize();
+	void MarkDirtyTiles(sStage &stage, const cRegion<int> &region) const;
+
+	static const int tileSize = 64;
+
+	cImage *image;
+	sStage stages[numberOfStages];
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+};
+
+#endif /* MANDELBULBER2_SRC_POST_EFFECT_STAGES_HPP_ */
@@ -61,6 +61,11 @@ double cRandom::Random(double min, double max, double resolution) const
 	return min + resolution * Random(n);
 }
 
+void cRandom::CopyStateFrom(const cRandom &other) const
+{
+	gsl_rng_memcpy(gBaseRand, other.gBaseRand);
+}
+
 // generates random number with more precision
 // works with range / resolution < unsigned long long MAX
 double cRandom::DoubleRandom(double min, double max) const
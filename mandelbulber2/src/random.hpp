@@ -52,6 +52,8 @@ public:
 	int Random(unsigned long max) const;
 	double Random(double min, double max, double resolution) const;
 	double DoubleRandom(double min, double max) const;
+	// copies state of other generator, so both will generate the same sequence
+	void CopyStateFrom(const cRandom &other) const;
 
 private:
 	gsl_rng *gBaseRand;
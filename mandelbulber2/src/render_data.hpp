@@ -36,6 +36,7 @@
 #define MANDELBULBER2_SRC_RENDER_DATA_HPP_
 
 #include <map>
+#include <vector>
 
 #include <QDebug>
 
@@ -79,10 +80,31 @@ struct sRenderData
 	QVector<int> netRenderStartingPositions;
 	cRenderingConfiguration configuration;
 
+	enum enumObjectFlags
+	{
+		objectHasDisplacement = 1,
+		objectFractalize = 2,
+		objectSubsurface = 4
+	};
+
 	std::map<int, cMaterial> materials; // 'int' is an ID
 	QVector<cObjectData> objectData;
 	cStereo stereo;
 
+	// start distances of primary rays reprojected from previous animation frame (can be nullptr)
+	const float *temporalStartDistances{nullptr};
+
+	// dense tables indexed by objectId, built by ValidateObjects(). They are used in distance
+	// estimation and shaders instead of searching 'materials' map for each sample
+	std::vector<cMaterial *> objectMaterials;
+	std::vector<int> objectFlags;
+
+	cMaterial *GetObjectMaterial(int objectId) const { return objectMaterials[objectId]; }
+	bool ObjectHasFlag(int objectId, enumObjectFlags flag) const
+	{
+		return objectFlags[objectId] & flag;
+	}
+
 	void ValidateObjects()
 	{
 		for (cObjectData &object : objectData)
@@ -111,6 +133,26 @@ struct sRenderData
 				object.materialId = substituteMaterialId;
 			}
 		}
+
+		BuildObjectLookupTables();
+	}
+
+	void BuildObjectLookupTables()
+	{
+		objectMaterials.resize(objectData.size());
+		objectFlags.resize(objectData.size());
+
+		for (int i = 0; i < objectData.size(); i++)
+		{
+			cMaterial *material = &materials.at(objectData[i].materialId);
+			objectMaterials[i] = material;
+
+			int flags = 0;
+			if (material->displacementTexture.IsLoaded()) flags |= objectHasDisplacement;
+			if (material->textureFractalize) flags |= objectFractalize;
+			if (material->subsurfaceScattering) flags |= objectSubsurface;
+			objectFlags[i] = flags;
+		}
 	}
 };
 
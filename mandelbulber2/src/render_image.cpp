@@ -43,6 +43,7 @@
 #include "fractparams.hpp"
 #include "global_data.hpp"
 #include "netrender.hpp"
+#include "post_effect_stages.hpp"
 #include "post_effect_hdr_blur.h"
 #include "progress_text.hpp"
 #include "render_data.hpp"
@@ -51,6 +52,7 @@
 #include "scheduler.hpp"
 #include "stereo.h"
 #include "system_data.hpp"
+#include "trace.hpp"
 #include "wait.hpp"
 #include "write_log.hpp"
 
@@ -143,7 +145,6 @@ void cRenderer::TerminateRendering()
 {
 	scheduler->Stop();
 	image->CompileImage();
-	image->ConvertTo8bitChar();
 	if (data->configuration.UseImageRefresh())
 	{
 		image->SetFastPreview(true);
@@ -192,7 +193,6 @@ QSet<int> cRenderer::UpdateImageDuringRendering(QList<int> &listToRefresh, QList
 		}
 	}
 	image->CompileImage(&listToRefresh);
-	image->ConvertTo8bitChar();
 	if (data->configuration.UseImageRefresh())
 	{
 		image->SetFastPreview(true);
@@ -288,6 +288,7 @@ void cRenderer::SendRenderedLinesToNetRenderAfterRendering(QList<int> listToSend
 
 void cRenderer::RenderSSAO()
 {
+	cScopedTrace trace("SSAO");
 	cRenderSSAO rendererSSAO(params, data, image);
 	connect(&rendererSSAO, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)),
 		this, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
@@ -314,6 +315,7 @@ void cRenderer::RenderSSAO()
 
 void cRenderer::RenderDOF()
 {
+	cScopedTrace trace("DOF");
 	cPostRenderingDOF dof(image);
 	connect(&dof, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
 		SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
@@ -344,6 +346,7 @@ void cRenderer::RenderDOF()
 
 void cRenderer::RenderHDRBlur()
 {
+	cScopedTrace trace("HDR blur");
 	std::unique_ptr<cPostEffectHdrBlur> hdrBlur(new cPostEffectHdrBlur(image));
 	hdrBlur->SetParameters(params->hdrBlurRadius, params->hdrBlurIntensity);
 	connect(hdrBlur.get(), SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)),
@@ -353,6 +356,7 @@ void cRenderer::RenderHDRBlur()
 
 bool cRenderer::RenderImage()
 {
+	cScopedTrace trace("image rendering");
 	WriteLog("cRenderer::RenderImage()", 2);
 
 	if (image->IsAllocated())
@@ -496,15 +500,29 @@ bool cRenderer::RenderImage()
 		if (!((gNetRender->IsClient() && !gNetRender->IsAnimation())
 					&& data->configuration.UseNetRender()))
 		{
+			// outputs of main image are kept for RefreshPostEffects()
+			cPostEffectStages *postEffectStages =
+				image->IsMainImage() ? image->GetPostEffectStages() : nullptr;
+			bool splitStereo = data->stereo.isEnabled()
+												 && (data->stereo.GetMode() == cStereo::stereoLeftRight
+														 || data->stereo.GetMode() == cStereo::stereoTopBottom);
+			QString ssaoSettings;
+
 			if (params->ambientOcclusionEnabled
 					&& params->ambientOcclusionMode == params::AOModeScreenSpace)
 			{
 				RenderSSAO();
+				ssaoSettings = cPostEffectStages::SSAOSettings(*params, splitStereo);
+				if (postEffectStages && !*data->stopRequest)
+					postEffectStages->StoreOutput(cPostEffectStages::stageSSAO, ssaoSettings);
 			}
 			if (params->DOFEnabled && !*data->stopRequest && !params->DOFMonteCarlo
 					&& !systemData.globalStopRequest)
 			{
 				RenderDOF();
+				if (postEffectStages && !*data->stopRequest)
+					postEffectStages->StoreOutput(cPostEffectStages::stageDOF,
+						cPostEffectStages::DOFSettings(*params, splitStereo, ssaoSettings));
 			}
 
 			if (params->hdrBlurEnabled)
@@ -521,7 +539,6 @@ bool cRenderer::RenderImage()
 		{
 			image->SetFastPreview(*data->stopRequest || data->configuration.GetMaxRenderTime() < 1e49);
 
-			WriteLog("image->ConvertTo8bit()", 2);
 			image->ConvertTo8bitChar();
 			WriteLog("image->UpdatePreview()", 2);
 			image->UpdatePreview();
@@ -53,6 +53,7 @@
 #include "opencl_engine_render_ssao.h"
 #include "opencl_global.h"
 #include "post_effect_hdr_blur.h"
+#include "post_effect_stages.hpp"
 #include "progress_text.hpp"
 #include "render_data.hpp"
 #include "render_image.hpp"
@@ -60,6 +61,8 @@
 #include "rendering_configuration.hpp"
 #include "stereo.h"
 #include "system_data.hpp"
+#include "temporal_reprojection.hpp"
+#include "trace.hpp"
 #include "write_log.hpp"
 
 cRenderJob::cRenderJob(const std::shared_ptr<cParameterContainer> _params,
@@ -161,6 +164,16 @@ bool cRenderJob::Init(enumMode _mode, const cRenderingConfiguration &config)
 	// FIXME: option for optionalNormal (denoiser)
 	imageOptional.optionalNormalWorld = true;
 
+	// world positions of previous frame are needed to reproject depth to the next frame
+	temporalReprojection.reset();
+	if ((mode == keyframeAnim || mode == flightAnim)
+			&& paramsContainer->Get<bool>("anim_temporal_reprojection"))
+	{
+		temporalReprojection.reset(new cTemporalReprojection(
+			paramsContainer->Get<int>("anim_temporal_reprojection_reference_interval")));
+		imageOptional.optionalWorld = true;
+	}
+
 	emit updateProgressAndStatus(
 		QObject::tr("Initialization"), QObject::tr("Setting up image buffers"), 0.0);
 	// gApplication->processEvents();
@@ -243,6 +256,8 @@ bool cRenderJob::InitImage(int w, int h, const sImageOptional &optional)
 
 void cRenderJob::LoadTextures(int frameNo, const cRenderingConfiguration &config)
 {
+	cScopedTrace trace("texture loading");
+
 	//	if (gNetRender->IsClient() && renderData->configuration.UseNetRender())
 	//	{
 	//		// get received textures from NetRender buffer
@@ -282,6 +297,7 @@ void cRenderJob::LoadTextures(int frameNo, const cRenderingConfiguration &config
 
 void cRenderJob::PrepareData()
 {
+	cScopedTrace trace("data preparation");
 	WriteLog("Init renderData", 2);
 	renderData->rendererID = id;
 
@@ -325,6 +341,7 @@ void cRenderJob::PrepareData()
 	// assign stop handler
 	renderData->stopRequest = stopRequest;
 
+	cScopedTrace traceMaterials("materials and lights");
 	CreateMaterialsMap(paramsContainer, &renderData->materials, loadTextures,
 		renderData->configuration.UseIgnoreErrors(), renderData->configuration.UseNetRender());
 
@@ -356,6 +373,11 @@ bool cRenderJob::Execute()
 
 	PrepareData();
 
+	renderData->stereo.DisableSharedRays();
+
+	// rendered region has to be post-processed again
+	if (image->IsMainImage()) image->GetPostEffectStages()->MarkDirty(renderData->screenRegion);
+
 	if (!paramsContainer->Get<bool>("opencl_enabled") || !gOpenCl
 			|| cOpenClEngineRenderFractal::enumClRenderEngineMode(
 					 paramsContainer->Get<int>("opencl_mode"))
@@ -382,12 +404,18 @@ bool cRenderJob::Execute()
 			WriteLog("cRenderJob::Execute(void): running jobs = " + QString::number(runningJobs), 2);
 
 			// move parameters from containers to structures
+			cScopedTrace traceParameters("parameter build");
 			std::shared_ptr<sParamRender> params(
 				new sParamRender(paramsContainer, &renderData->objectData));
 			std::shared_ptr<cNineFractals> fractals(new cNineFractals(fractalContainer, paramsContainer));
+			traceParameters.Finish();
 
 			renderData->ValidateObjects();
 
+			// one eye's hits seed the other eye's rays. Buffers are kept for the second pass
+			if (repeat == 0 && UseSharedStereoRays(*params, twoPassStereo))
+				renderData->stereo.PrepareSharedRays(CVector2<int>(width, height));
+
 			// recalculation of some parameters;
 			params->resolution = 1.0 / image->GetHeight();
 			ReduceDetail();
@@ -400,6 +428,14 @@ bool cRenderJob::Execute()
 			renderData->statistics.Reset();
 			renderData->statistics.usedDEType = fractals->GetDETypeString();
 
+			renderData->temporalStartDistances = nullptr;
+			if (temporalReprojection && noOfRepeats == 1)
+			{
+				if (temporalReprojection->PrepareFrame(*paramsContainer, *fractalContainer, *params,
+							*renderData, int(image->GetWidth()), int(image->GetHeight())))
+					renderData->temporalStartDistances = temporalReprojection->GetStartDistances();
+			}
+
 			// create and execute renderer
 			std::unique_ptr<cRenderer> renderer(new cRenderer(params, fractals, renderData, image));
 
@@ -412,6 +448,15 @@ bool cRenderJob::Execute()
 
 			result = renderer->RenderImage();
 
+			renderData->temporalStartDistances = nullptr;
+			if (temporalReprojection)
+			{
+				if (result && noOfRepeats == 1)
+					temporalReprojection->StoreFrame(*paramsContainer, *fractalContainer, image);
+				else
+					temporalReprojection->Reset();
+			}
+
 			if (twoPassStereo && repeat == 0) renderData->stereo.StoreImageInBuffer(image);
 		}
 	}
@@ -432,9 +477,11 @@ bool cRenderJob::Execute()
 			SetupStereoEyes(repeat, twoPassStereo);
 
 			// move parameters from containers to structures
+			cScopedTrace traceParameters("parameter build");
 			std::shared_ptr<sParamRender> params(
 				new sParamRender(paramsContainer, &renderData->objectData));
 			std::shared_ptr<cNineFractals> fractals(new cNineFractals(fractalContainer, paramsContainer));
+			traceParameters.Finish();
 
 			renderData->ValidateObjects();
 
@@ -572,6 +619,19 @@ int cRenderJob::GetNumberOfRepeatsOfStereoLoop(bool *twoPassStereo)
 	return noOfRepeats;
 }
 
+bool cRenderJob::UseSharedStereoRays(const sParamRender &params, bool twoPassStereo) const
+{
+	if (!renderData->stereo.isEnabled() || !paramsContainer->Get<bool>("stereo_shared_rays"))
+		return false;
+
+	// in single pass red/cyan mode both eyes are rendered pixel by pixel, so lines of the other eye
+	// are never complete
+	if (renderData->stereo.GetMode() == cStereo::stereoRedCyan && !twoPassStereo) return false;
+
+	// with volumetric effects rays have to start from the camera
+	return cTemporalReprojection::CanPrimaryRaysStartAhead(params, *renderData);
+}
+
 void cRenderJob::SetupStereoEyes(int repeat, bool twoPassStereo)
 {
 	// stereo rendering with SSAO or DOF (2 passes)
@@ -668,6 +728,7 @@ void cRenderJob::InitStatistics(const cNineFractals *fractals)
 bool cRenderJob::RenderFractalWithOpenCl(std::shared_ptr<sParamRender> params,
 	std::shared_ptr<cNineFractals> fractals, cProgressText *progressText)
 {
+	cScopedTrace trace("fractal rendering", "opencl");
 	bool result = false;
 	connect(gOpenCl->openClEngineRenderFractal, SIGNAL(updateStatistics(cStatistics)), this,
 		SIGNAL(updateStatistics(cStatistics)), Qt::UniqueConnection);
@@ -685,6 +746,11 @@ bool cRenderJob::RenderFractalWithOpenCl(std::shared_ptr<sParamRender> params,
 
 	gOpenCl->openClEngineRenderFractal->Lock();
 	progressText->ResetTimer();
+	// final still images can use kernel with constant fractal parameters. Animations and
+	// interactive renders keep generic kernel, so changes of parameters don't need recompilation
+	gOpenCl->openClEngineRenderFractal->SetUseSpecializedKernel(
+		renderData->configuration.IsFinalRender() && mode == still
+		&& paramsContainer->Get<bool>("opencl_specialized_kernel"));
 	gOpenCl->openClEngineRenderFractal->SetParameters(
 		paramsContainer, fractalContainer, params, fractals, renderData, false);
 	if (gOpenCl->openClEngineRenderFractal->LoadSourcesAndCompile(paramsContainer))
@@ -716,6 +782,7 @@ void cRenderJob::RenderSSAOWithOpenCl(std::shared_ptr<sParamRender> params,
 						 paramsContainer->Get<int>("opencl_mode"))
 						 != cOpenClEngineRenderFractal::clRenderEngineTypeFast)
 		{
+			cScopedTrace trace("SSAO", "opencl");
 			connect(gOpenCl->openClEngineRenderSSAO, SIGNAL(updateImage()), this, SIGNAL(updateImage()));
 			connect(gOpenCl->openClEngineRenderSSAO,
 				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
@@ -756,8 +823,6 @@ void cRenderJob::RenderSSAOWithOpenCl(std::shared_ptr<sParamRender> params,
 
 					if (image->IsPreview())
 					{
-						WriteLog("image->ConvertTo8bit()", 2);
-						image->ConvertTo8bitChar();
 						WriteLog("image->UpdatePreview()", 2);
 						image->UpdatePreview();
 						WriteLog("image->GetImageWidget()->update()", 2);
@@ -810,6 +875,7 @@ void cRenderJob::RenderPostFiltersWithOpenCl(std::shared_ptr<sParamRender> param
 
 				if (skip) continue;
 
+				cScopedTrace trace("post filter", "opencl");
 				gOpenCl->openclEngineRenderPostFilter->Lock();
 				gOpenCl->openclEngineRenderPostFilter->SetParameters(
 					params.get(), region, cOpenClEngineRenderPostFilter::enumPostEffectType(i));
@@ -845,6 +911,7 @@ void cRenderJob::RenderDOFWithOpenCl(std::shared_ptr<sParamRender> params, bool
 	{
 		if (params->DOFEnabled && !params->DOFMonteCarlo)
 		{
+			cScopedTrace trace("DOF", "opencl");
 			connect(gOpenCl->openclEngineRenderDOF, SIGNAL(updateImage()), this, SIGNAL(updateImage()));
 			connect(gOpenCl->openclEngineRenderDOF,
 				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
@@ -1009,6 +1076,11 @@ void cRenderJob::RefreshPostEffects()
 		paramsContainer->Set("image_height", int(image->GetHeight()));
 
 		*stopRequest = false;
+
+		// outputs of SSAO and DOF are reused if their settings and input haven't changed
+		cPostEffectStages *postEffectStages = image->GetPostEffectStages();
+		QString ssaoSettings;
+
 		if (paramsContainer->Get<bool>("ambient_occlusion_enabled")
 				&& paramsContainer->Get<int>("ambient_occlusion_mode") == params::AOModeScreenSpace)
 		{
@@ -1050,16 +1122,48 @@ void cRenderJob::RefreshPostEffects()
 				std::shared_ptr<sRenderData> data(new sRenderData());
 				data->stopRequest = stopRequest;
 				data->screenRegion = cRegion<int>(0, 0, image->GetWidth(), image->GetHeight());
-				cRenderSSAO rendererSSAO(params, data, image);
-				QObject::connect(&rendererSSAO,
-					SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
-					SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
-				connect(&rendererSSAO, SIGNAL(updateImage()), imageWidget, SLOT(update()));
+				ssaoSettings = cPostEffectStages::SSAOSettings(*params, false);
+
+				// SSAO samples z-buffer up to half of image width from the pixel
+				cRegion<int> dirtyRegion;
+				cPostEffectStages::enumStageState state = postEffectStages->PrepareStage(
+					cPostEffectStages::stageSSAO, ssaoSettings,
+					cPostEffectStages::SSAOHalo(int(image->GetWidth())), &dirtyRegion);
 
-				rendererSSAO.RenderSSAO();
+				if (state != cPostEffectStages::stageInvalid)
+					postEffectStages->RestoreOutput(cPostEffectStages::stageSSAO);
+
+				if (state != cPostEffectStages::stageUpToDate)
+				{
+					cRenderSSAO rendererSSAO(params, data, image);
+					QObject::connect(&rendererSSAO,
+						SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
+						SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
+					connect(&rendererSSAO, SIGNAL(updateImage()), imageWidget, SLOT(update()));
+
+					if (state == cPostEffectStages::stagePartial)
+					{
+						// only whole lines can be processed
+						dirtyRegion.Set(0, dirtyRegion.y1, int(image->GetWidth()), dirtyRegion.y2);
+						QList<int> lines;
+						for (int y = dirtyRegion.y1; y < dirtyRegion.y2; y++)
+							lines.append(y);
+						image->NullPostEffect(&lines);
+						rendererSSAO.RenderSSAO(&lines);
+					}
+					else
+					{
+						rendererSSAO.RenderSSAO();
+					}
+
+					if (*stopRequest)
+						postEffectStages->InvalidateStage(cPostEffectStages::stageSSAO);
+					else
+						postEffectStages->StoreOutput(cPostEffectStages::stageSSAO, ssaoSettings,
+							state == cPostEffectStages::stagePartial ? &dirtyRegion : nullptr);
+				}
 
 				image->CompileImage();
-				image->ConvertTo8bitChar();
 				image->UpdatePreview();
 				if (image->GetImageWidget()) image->GetImageWidget()->update();
 			}
@@ -1082,15 +1186,56 @@ void cRenderJob::RefreshPostEffects()
 			else
 			{
 				sParamRender params(paramsContainer);
-				// cRenderingConfiguration config;
-				cPostRenderingDOF dof(image);
-				connect(&dof, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)),
-					this, SIGNAL(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
-				connect(&dof, SIGNAL(updateImage()), imageWidget, SLOT(update()));
-				cRegion<int> screenRegion(0, 0, image->GetWidth(), image->GetHeight());
-				dof.Render(screenRegion,
-					params.DOFRadius * (image->GetWidth() + image->GetHeight()) / 2000.0, params.DOFFocus,
-					params.DOFNumberOfPasses, params.DOFBlurOpacity, params.DOFMaxRadius, stopRequest);
+				QString dofSettings = cPostEffectStages::DOFSettings(params, false, ssaoSettings);
+				int halo = cPostEffectStages::DOFHalo(params);
+				cRegion<int> dirtyRegion;
+				cPostEffectStages::enumStageState state = postEffectStages->PrepareStage(
+					cPostEffectStages::stageDOF, dofSettings, halo, &dirtyRegion);
+
+				if (state == cPostEffectStages::stageUpToDate)
+				{
+					postEffectStages->RestoreOutput(cPostEffectStages::stageDOF);
+				}
+				else
+				{
+					// cRenderingConfiguration config;
+					cPostRenderingDOF dof(image);
+					connect(&dof,
+						SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
+						SIGNAL(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
+					connect(&dof, SIGNAL(updateImage()), imageWidget, SLOT(update()));
+					cRegion<int> screenRegion(0, 0, image->GetWidth(), image->GetHeight());
+
+					// pixels in dirty region need also input pixels from their neighbourhood (halo covers
+					// both phases of DOF, so it is at least 2 * DOFMaxRadius)
+					cRegion<int> processedRegion = screenRegion;
+					if (state == cPostEffectStages::stagePartial)
+					{
+						processedRegion.Set(qMax(dirtyRegion.x1 - halo, 0), qMax(dirtyRegion.y1 - halo, 0),
+							qMin(dirtyRegion.x2 + halo, screenRegion.x2),
+							qMin(dirtyRegion.y2 + halo, screenRegion.y2));
+					}
+
+					dof.Render(processedRegion,
+						params.DOFRadius * (image->GetWidth() + image->GetHeight()) / 2000.0, params.DOFFocus,
+						params.DOFNumberOfPasses, params.DOFBlurOpacity, params.DOFMaxRadius, stopRequest);
+
+					if (*stopRequest)
+					{
+						postEffectStages->InvalidateStage(cPostEffectStages::stageDOF);
+					}
+					else if (state == cPostEffectStages::stagePartial)
+					{
+						// outside of dirty region the stored result is still valid
+						postEffectStages->RestoreOutput(cPostEffectStages::stageDOF, &dirtyRegion);
+						postEffectStages->StoreOutput(cPostEffectStages::stageDOF, dofSettings, &dirtyRegion);
+						image->CompileImage();
+					}
+					else
+					{
+						postEffectStages->StoreOutput(cPostEffectStages::stageDOF, dofSettings);
+					}
+				}
 			}
 		}
 
@@ -1170,8 +1315,6 @@ void cRenderJob::RefreshPostEffects()
 		}
 
 		image->CompileImage();
-
-		image->ConvertTo8bitChar();
 		image->UpdatePreview();
 		if (image->GetImageWidget()) image->GetImageWidget()->update();
 	}
@@ -1197,8 +1340,6 @@ void cRenderJob::RefreshImageAdjustments()
 
 		image->SetImageParameters(imageAdjustments);
 		image->CompileImage();
-
-		image->ConvertTo8bitChar();
 		image->UpdatePreview();
 		if (image->GetImageWidget()) image->GetImageWidget()->update();
 	}
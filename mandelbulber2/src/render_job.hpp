@@ -59,6 +59,7 @@ class cNineFractals;
 class cRenderer;
 class cProgressText;
 struct sParamRender;
+class cTemporalReprojection;
 
 class cRenderJob : public QObject
 {
@@ -104,6 +105,7 @@ private:
 	QStringList CreateListOfUsedTextures() const;
 	int GetNumberOfRepeatsOfStereoLoop(bool *twoPassStereo);
 	void SetupStereoEyes(int repeat, bool twoPassStereo);
+	bool UseSharedStereoRays(const sParamRender &params, bool twoPassStereo) const;
 	void InitNetRender();
 	void InitStatistics(const cNineFractals *fractals);
 	void ConnectUpdateSinalsSlots(const cRenderer *renderer);
@@ -135,6 +137,7 @@ private:
 	int width;
 	QWidget *imageWidget;
 	std::shared_ptr<sRenderData> renderData;
+	std::unique_ptr<cTemporalReprojection> temporalReprojection;
 	bool *stopRequest;
 	bool canUseNetRender;
 
@@ -238,6 +238,7 @@ bool cRenderQueue::RenderStill(const cQueue::structQueueItem &queueItem)
 		config.DisableRefresh();
 	}
 	config.EnableNetRender();
+	config.EnableFinalRender();
 	renderJob->Init(cRenderJob::still, config);
 
 	gQueue->stopRequest = false;
@@ -38,6 +38,7 @@
 #include "calculate_distance.hpp"
 #include "camera_target.hpp"
 #include "cimage.hpp"
+#include "cloud_noise_volume.hpp"
 #include "common_math.h"
 #include "compute_fractal.hpp"
 #include "fractparams.hpp"
@@ -51,6 +52,7 @@
 #include "stereo.h"
 #include "system_data.hpp"
 #include "texture.hpp"
+#include "trace.hpp"
 
 cRenderWorker::cRenderWorker(std::shared_ptr<const sParamRender> _params,
 	std::shared_ptr<const cNineFractals> _fractal, std::shared_ptr<sThreadData> _threadData,
@@ -81,6 +83,7 @@ cRenderWorker::~cRenderWorker()
 void cRenderWorker::doWork()
 {
 	// here will be rendering thread
+	cScopedTrace trace("render worker");
 	int width = image->GetWidth();
 	int height = image->GetHeight();
 	double aspectRatio = double(width) / height;
@@ -91,6 +94,9 @@ void cRenderWorker::doWork()
 	bool antiAliasing = params->antialiasingEnabled;
 	int antiAliasingSize = params->antialiasingSize;
 
+	// hit distance of one stereo eye is a starting point for the other one (not with DOF jitter)
+	bool sharedStereoRays = data->stereo.AreRaysShared() && !monteCarlo;
+
 	if (data->stereo.isEnabled() && (params->perspectiveType != params::perspEquirectangular))
 		aspectRatio = data->stereo.ModifyAspectRatio(aspectRatio);
 
@@ -100,6 +106,8 @@ void cRenderWorker::doWork()
 		PrepareAOVectors();
 
 	perlinNoise.reset(new cPerlinNoiseOctaves(params->cloudsRandomSeed));
+	if (params->cloudsEnable && params->cloudsPrecomputedNoise)
+		cloudNoiseVolume = cCloudNoiseVolume::GetVolume(params->cloudsRandomSeed);
 
 	// init of scheduler
 	cScheduler *scheduler = threadData->scheduler.get();
@@ -298,6 +306,20 @@ void cRenderWorker::doWork()
 					rayMarchingIn.direction = direction;
 					rayMarchingIn.maxScan = params->viewDistanceMax;
 					rayMarchingIn.minScan = 0; // params->viewDistanceMin;
+					if (data->temporalStartDistances)
+					{
+						rayMarchingIn.minScan = CheckStartDistance(
+							data->temporalStartDistances[size_t(ys) * image->GetWidth() + xs], startRay,
+							direction);
+					}
+					else if (sharedStereoRays)
+					{
+						rayMarchingIn.minScan =
+							CheckStartDistance(data->stereo.GetSharedRayStart(screenPoint, stereoEye,
+																	 params->stereoEyeDistance, params->stereoInfiniteCorrection,
+																	 params->fov, params->perspectiveType),
+								startRay, direction);
+					}
 					rayMarchingIn.start = startRay;
 					rayMarchingIn.invertMode = false;
 					recursionIn.rayMarchingIn = rayMarchingIn;
@@ -318,6 +340,8 @@ void cRenderWorker::doWork()
 					objectColour = recursionOut.objectColour;
 					depth = recursionOut.rayMarchingOut.depth;
 					if (!recursionOut.found) depth = 1e20;
+					if (sharedStereoRays)
+						data->stereo.StoreSharedRayDistance(screenPoint, stereoEye, depth, recursionOut.found);
 					opacity = recursionOut.fogOpacity;
 					normal = recursionOut.normal;
 					worldPositionRGB.R = recursionOut.rayMarchingOut.point.x;
@@ -604,6 +628,23 @@ double cRenderWorker::CalcDistThresh(CVector3 point) const
 	return distThresh;
 }
 
+// start distance of primary ray estimated from previous frame or from the other stereo eye.
+// It is used only if distance estimation confirms that there is no surface at the starting point
+double cRenderWorker::CheckStartDistance(
+	double startDistance, const CVector3 &start, const CVector3 &direction) const
+{
+	if (startDistance <= 0.0) return 0.0;
+
+	CVector3 point = start + direction * startDistance;
+	double distThresh = CalcDistThresh(point);
+	sDistanceIn distanceIn(point, distThresh, false);
+	sDistanceOut distanceOut;
+	double dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
+	if (dist < distThresh) return 0.0;
+
+	return startDistance;
+}
+
 // calculation of "voxel" size
 double cRenderWorker::CalcDelta(CVector3 point) const
 {
@@ -832,8 +873,7 @@ cRenderWorker::sRayRecursionOut cRenderWorker::RayRecursion(
 			shaderInputData.stepBuff = inOut.rayMarchingInOut.stepBuff;
 			shaderInputData.invertMode = rayStack[rayIndex].in.calcInside;
 			shaderInputData.objectId = rayMarchingOut.objectId;
-			cObjectData objectData = data->objectData[shaderInputData.objectId];
-			shaderInputData.material = &data->materials[objectData.materialId];
+			shaderInputData.material = data->GetObjectMaterial(shaderInputData.objectId);
 
 			float reflect = shaderInputData.material->reflectance;
 			float transparent = shaderInputData.material->transparencyOfSurface;
@@ -1063,8 +1103,7 @@ cRenderWorker::sRayRecursionOut cRenderWorker::RayRecursion(
 			shaderInputData.stepBuff = inOut.rayMarchingInOut.stepBuff;
 			shaderInputData.invertMode = rayStack[rayIndex].in.calcInside;
 			shaderInputData.objectId = rayMarchingOut.objectId;
-			cObjectData objectData = data->objectData[shaderInputData.objectId];
-			shaderInputData.material = &data->materials[objectData.materialId];
+			shaderInputData.material = data->GetObjectMaterial(shaderInputData.objectId);
 
 			shaderInputData.normal = recursionOut.normal;
 
@@ -54,6 +54,7 @@ struct sParamRender;
 class cNineFractals;
 class cScheduler;
 class cPerlinNoiseOctaves;
+class cCloudNoiseVolume;
 
 #define MAX_RAYMARCHING 10000
 
@@ -219,6 +220,8 @@ private:
 	void RayMarching(sRayMarchingIn &in, sRayMarchingInOut *inOut, sRayMarchingOut *out) const;
 	double CalcDistThresh(CVector3 point) const;
 	double CalcDelta(CVector3 point) const;
+	double CheckStartDistance(
+		double startDistance, const CVector3 &start, const CVector3 &direction) const;
 	static double IterOpacity(
 		double step, double iters, double maxN, double trim, double trimHigh, double opacitySp);
 	double CloudOpacity(
@@ -291,6 +294,7 @@ private:
 	std::vector<sRayStack> rayStack;
 	std::vector<sVectorsAround> AOVectorsAround;
 	std::unique_ptr<cPerlinNoiseOctaves> perlinNoise;
+	std::shared_ptr<const cCloudNoiseVolume> cloudNoiseVolume;
 
 public slots:
 	void doWork();
@@ -46,6 +46,7 @@ cRenderingConfiguration::cRenderingConfiguration()
 	enableMultiThread = true;
 	enableIgnoreErrors = false;
 	forceFastPreview = false;
+	finalRender = false;
 	refreshRate = 1000;
 	maxRenderTime = 1e50;
 }
@@ -48,6 +48,7 @@ public:
 	void EnableIgnoreErrors() { enableIgnoreErrors = true; }
 	void SetMaxRenderTime(double _maxRenderTime) { maxRenderTime = _maxRenderTime; }
 	void ForceFastPreview() { forceFastPreview = true; }
+	void EnableFinalRender() { finalRender = true; }
 
 	bool UseNetRender() const;
 	bool UseImageRefresh() const;
@@ -56,6 +57,7 @@ public:
 	bool UseRenderTimeEffects() const;
 	bool UseIgnoreErrors() const;
 	bool UseForcedFastPreview() const;
+	bool IsFinalRender() const { return finalRender; }
 	int GetNumberOfThreads() const;
 	double GetMaxRenderTime() const { return maxRenderTime; }
 	int GetRefreshRate() const;
@@ -67,6 +69,7 @@ private:
 	bool enableMultiThread;
 	bool enableIgnoreErrors;
 	bool forceFastPreview;
+	bool finalRender; // image is rendered to be saved, not interactively
 	double maxRenderTime;
 	int refreshRate;
 };
@@ -0,0 +1,153 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2021 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSettingsWriter - writing of settings files in background thread
+ */
+
+#include "settings_writer.hpp"
+
+#include <QDebug>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include "animation_frames.hpp"
+#include "fractal_container.hpp"
+#include "keyframes.hpp"
+#include "parameters.hpp"
+#include "settings.hpp"
+#include "write_log.hpp"
+
+class cSettingsWriterTask : public QRunnable
+{
+public:
+	cSettingsWriterTask(cSettingsWriter *_writer) : writer(_writer) { setAutoDelete(true); }
+
+	void run() override { writer->ProcessQueue(); }
+
+private:
+	cSettingsWriter *writer;
+};
+
+cSettingsWriter::cSettingsWriter()
+{
+	threadPool.setMaxThreadCount(1);
+	workerActive = false;
+}
+
+cSettingsWriter::~cSettingsWriter()
+{
+	WaitForDone();
+}
+
+cSettingsWriter::sSnapshot cSettingsWriter::CreateSnapshot(
+	std::shared_ptr<const cParameterContainer> par, std::shared_ptr<const cFractalContainer> fractal,
+	std::shared_ptr<const cAnimationFrames> frames, std::shared_ptr<const cKeyframes> keyframes)
+{
+	sSnapshot snapshot;
+	if (par) snapshot.par.reset(new cParameterContainer(*par));
+	if (fractal) snapshot.fractal.reset(new cFractalContainer(*fractal));
+
+	// only frames and list of parameters are copied. Interpolation caches are not needed to
+	// create settings text
+	if (frames)
+	{
+		snapshot.frames.reset(new cAnimationFrames());
+		snapshot.frames->Override(frames->GetFrames(), frames->GetListOfParameters());
+	}
+	if (keyframes)
+	{
+		snapshot.keyframes.reset(new cKeyframes());
+		snapshot.keyframes->Override(keyframes->GetFrames(), keyframes->GetListOfParameters());
+	}
+	return snapshot;
+}
+
+void cSettingsWriter::Write(const QString &filename, const sSnapshot &snapshot)
+{
+	QMutexLocker lock(&mutex);
+
+	if (!queue.contains(filename)) queueOrder.append(filename);
+	queue.insert(filename, snapshot);
+
+	if (!workerActive)
+	{
+		workerActive = true;
+		threadPool.start(new cSettingsWriterTask(this));
+	}
+}
+
+void cSettingsWriter::WaitForDone()
+{
+	threadPool.waitForDone();
+}
+
+void cSettingsWriter::ProcessQueue()
+{
+	while (true)
+	{
+		QString filename;
+		sSnapshot snapshot;
+		{
+			QMutexLocker lock(&mutex);
+			if (queueOrder.isEmpty())
+			{
+				workerActive = false;
+				return;
+			}
+			filename = queueOrder.takeFirst();
+			snapshot = queue.take(filename);
+		}
+
+		WriteLogString("cSettingsWriter: writing settings started", filename, 2);
+
+		cSettings parSettings(cSettings::formatCondensedText);
+		parSettings.CreateText(snapshot.par, snapshot.fractal, snapshot.frames, snapshot.keyframes);
+
+		QSaveFile qFile(filename);
+		bool result = false;
+		if (qFile.open(QIODevice::WriteOnly))
+		{
+			QTextStream outStream(&qFile);
+			outStream << parSettings.GetSettingsText();
+			outStream.flush();
+			result = qFile.commit();
+		}
+
+		if (result)
+		{
+			WriteLogString("cSettingsWriter: settings written", filename, 2);
+		}
+		else
+		{
+			qWarning() << "cSettingsWriter: settings file not saved" << filename << qFile.errorString();
+		}
+	}
+}
@@ -0,0 +1,94 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2021 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSettingsWriter - writing of settings files in background thread
+ *
+ * Snapshots of parameter containers are cheap (containers are implicitly shared), so they can
+ * be taken in GUI thread and converted to text and written to disk by a single worker thread.
+ * If a new snapshot for the same file is queued before the previous one was written, only the
+ * newest one is saved. Files are replaced atomically, so crash during writing cannot leave
+ * corrupted autosave or undo files.
+ */
+
+#ifndef MANDELBULBER2_SRC_SETTINGS_WRITER_HPP_
+#define MANDELBULBER2_SRC_SETTINGS_WRITER_HPP_
+
+#include <memory>
+
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+
+// forward declarations
+class cParameterContainer;
+class cFractalContainer;
+class cAnimationFrames;
+class cKeyframes;
+
+class cSettingsWriter
+{
+public:
+	struct sSnapshot
+	{
+		std::shared_ptr<cParameterContainer> par;
+		std::shared_ptr<cFractalContainer> fractal;
+		std::shared_ptr<cAnimationFrames> frames;
+		std::shared_ptr<cKeyframes> keyframes;
+	};
+
+	cSettingsWriter();
+	~cSettingsWriter();
+
+	// makes shallow copies of containers which are safe to be used by other thread
+	static sSnapshot CreateSnapshot(std::shared_ptr<const cParameterContainer> par,
+		std::shared_ptr<const cFractalContainer> fractal,
+		std::shared_ptr<const cAnimationFrames> frames, std::shared_ptr<const cKeyframes> keyframes);
+
+	// queues writing of snapshot. Replaces not yet written snapshot for the same file
+	void Write(const QString &filename, const sSnapshot &snapshot);
+
+	// waits until all queued files are written
+	void WaitForDone();
+
+private:
+	void ProcessQueue();
+
+	QThreadPool threadPool;
+	QMutex mutex;
+	QMap<QString, sSnapshot> queue;
+	QList<QString> queueOrder;
+	bool workerActive;
+
+	friend class cSettingsWriterTask;
+};
+
+#endif /* MANDELBULBER2_SRC_SETTINGS_WRITER_HPP_ */
@@ -31,34 +31,51 @@
  *
  * cRenderWorker::AuxLightsShader method - calculates shading for auxiliary light sources
  */
+#include "common_math.h"
 #include "fractparams.hpp"
 #include "light.h"
+#include "lights.hpp"
 #include "render_data.hpp"
 #include "render_worker.hpp"
 
 sRGBAfloat cRenderWorker::AuxLightsShader(const sShaderInputData &input, sRGBAfloat surfaceColor,
 	sGradientsCollection *gradients, sRGBAfloat *specularOut, sRGBAfloat *outShadow) const
 {
-
-	int numberOfLights = data->lights.GetNumberOfLights();
 	sRGBAfloat shadeAuxSum;
 	sRGBAfloat specularAuxSum;
-	for (int i = 0; i < numberOfLights; i++)
-	{
-		const cLight *light = data->lights.GetLight(i);
+
+	auto shadeLight = [&](const cLight *light, float weight) {
 		if (light->enabled)
 		{
 			sRGBAfloat specularAuxOutTemp;
 			sRGBAfloat shadeAux =
 				LightShading(input, surfaceColor, light, gradients, &specularAuxOutTemp, outShadow);
-			shadeAuxSum.R += shadeAux.R;
-			shadeAuxSum.G += shadeAux.G;
-			shadeAuxSum.B += shadeAux.B;
-			specularAuxSum.R += specularAuxOutTemp.R;
-			specularAuxSum.G += specularAuxOutTemp.G;
-			specularAuxSum.B += specularAuxOutTemp.B;
+			shadeAuxSum.R += shadeAux.R * weight;
+			shadeAuxSum.G += shadeAux.G * weight;
+			shadeAuxSum.B += shadeAux.B * weight;
+			specularAuxSum.R += specularAuxOutTemp.R * weight;
+			specularAuxSum.G += specularAuxOutTemp.G * weight;
+			specularAuxSum.B += specularAuxOutTemp.B * weight;
 		}
+	};
+
+	if (params->DOFMonteCarlo && data->lights.IsLightTreeUsed())
+	{
+		// in Monte Carlo mode only one light from the tree is calculated per sample
+		data->lights.ForEachLightOutsideTree([&](const cLight *light) { shadeLight(light, 1.0f); });
+
+		float probability;
+		const cLight *light =
+			data->lights.SampleLightFromTree(input.point, Random(1000000) / 1000001.0, &probability);
+		if (light && probability > 0.0f) shadeLight(light, 1.0f / probability);
+	}
+	else
+	{
+		// intensity of light in LightShading() is multiplied by 100/6
+		data->lights.ForEachSignificantLight(input.point, cLights::lightTreeCutoff * 6.0f / 100.0f,
+			[&](const cLight *light) { shadeLight(light, 1.0f); });
 	}
+
 	*specularOut = specularAuxSum;
 	return shadeAuxSum;
 }
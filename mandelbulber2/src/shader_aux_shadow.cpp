@@ -108,9 +108,7 @@ sRGBAfloat cRenderWorker::AuxShadow(
 		double dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut);
 		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
 
-		cObjectData &objectData = data->objectData[distanceOut.objectId];
-		cMaterial *material = &data->materials[objectData.materialId];
-		goThrough = material->subsurfaceScattering;
+		goThrough = data->ObjectHasFlag(distanceOut.objectId, sRenderData::objectSubsurface);
 
 		bool limitsReached = false;
 		if (params->limitsEnabled)
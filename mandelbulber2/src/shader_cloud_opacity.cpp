@@ -34,6 +34,7 @@
 
 #include <algorithm>
 
+#include "cloud_noise_volume.hpp"
 #include "common_math.h"
 #include "fractparams.hpp"
 #include "perlin_noise_octaves.h"
@@ -78,10 +79,21 @@ double cRenderWorker::CloudOpacity(
 	double distToCloud = distToGeometry;
 	if (h > 0)
 	{
-		double opacity = perlinNoise->normalizedOctaveNoise3D_0_1(point2.x / params->cloudsPeriod,
-			point2.y / params->cloudsPeriod, point2.z / params->cloudsPeriod,
-			params->cloudsSpeed.x * params->frameNo, params->cloudsSpeed.y * params->frameNo,
-			params->cloudsSpeed.z * params->frameNo, params->cloudsIterations);
+		double opacity;
+		if (cloudNoiseVolume)
+		{
+			opacity = cloudNoiseVolume->normalizedOctaveNoise3D_0_1(point2.x / params->cloudsPeriod,
+				point2.y / params->cloudsPeriod, point2.z / params->cloudsPeriod,
+				params->cloudsSpeed.x * params->frameNo, params->cloudsSpeed.y * params->frameNo,
+				params->cloudsSpeed.z * params->frameNo, params->cloudsIterations);
+		}
+		else
+		{
+			opacity = perlinNoise->normalizedOctaveNoise3D_0_1(point2.x / params->cloudsPeriod,
+				point2.y / params->cloudsPeriod, point2.z / params->cloudsPeriod,
+				params->cloudsSpeed.x * params->frameNo, params->cloudsSpeed.y * params->frameNo,
+				params->cloudsSpeed.z * params->frameNo, params->cloudsIterations);
+		}
 
 		distToCloud = fabs(1.0 - opacity - params->cloudsDensity) * 0.2 * params->cloudsPeriod
 									* params->cloudsDEMultiplier;
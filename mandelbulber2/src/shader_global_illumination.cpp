@@ -121,8 +121,7 @@ sRGBFloat cRenderWorker::GlobalIlumination(
 			sRGBFloat iridescence;
 			sRGBAfloat outShadow;
 
-			cObjectData objectData = data->objectData[inputCopy.objectId];
-			inputCopy.material = &data->materials[objectData.materialId];
+			inputCopy.material = data->GetObjectMaterial(inputCopy.objectId);
 
 			// letting colors from textures (before normal map shader)
 			if (inputCopy.material->colorTexture.IsLoaded())
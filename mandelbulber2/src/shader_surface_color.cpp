@@ -74,7 +74,7 @@ sRGBAfloat cRenderWorker::SurfaceColour(
 
 				if (input.material->surfaceGradientEnable)
 				{
-					colour = input.material->gradientSurface.GetColorFloat(colorPosition, false);
+					colour = input.material->gradientSurface.GetColorFloatBaked(colorPosition);
 					// TODO - smooth mode for gradient
 					gradients->surface = colour;
 				}
@@ -87,37 +87,36 @@ sRGBAfloat cRenderWorker::SurfaceColour(
 
 				if (input.material->specularGradientEnable)
 				{
-					gradients->specular =
-						input.material->gradientSpecular.GetColorFloat(colorPosition, false);
+					gradients->specular = input.material->gradientSpecular.GetColorFloatBaked(colorPosition);
 				}
 
 				if (input.material->diffuseGradientEnable)
 				{
-					gradients->diffuse = input.material->gradientDiffuse.GetColorFloat(colorPosition, false);
+					gradients->diffuse = input.material->gradientDiffuse.GetColorFloatBaked(colorPosition);
 				}
 
 				if (input.material->luminosityGradientEnable)
 				{
 					gradients->luminosity =
-						input.material->gradientLuminosity.GetColorFloat(colorPosition, false);
+						input.material->gradientLuminosity.GetColorFloatBaked(colorPosition);
 				}
 
 				if (input.material->roughnessGradientEnable)
 				{
 					gradients->roughness =
-						input.material->gradientRoughness.GetColorFloat(colorPosition, false);
+						input.material->gradientRoughness.GetColorFloatBaked(colorPosition);
 				}
 
 				if (input.material->reflectanceGradientEnable)
 				{
 					gradients->reflectance =
-						input.material->gradientReflectance.GetColorFloat(colorPosition, false);
+						input.material->gradientReflectance.GetColorFloatBaked(colorPosition);
 				}
 
 				if (input.material->transparencyGradientEnable)
 				{
 					gradients->trasparency =
-						input.material->gradientTransparency.GetColorFloat(colorPosition, false);
+						input.material->gradientTransparency.GetColorFloatBaked(colorPosition);
 				}
 			}
 			else
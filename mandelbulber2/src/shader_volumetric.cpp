@@ -279,99 +279,115 @@ sRGBAfloat cRenderWorker::VolumetricShader(
 		sRGBAfloat totalLights(0.0, 0.0, 0.0, 0.0);
 		sRGBAfloat totalLightsClouds(0.0, 0.0, 0.0, 0.0);
 
-		for (int i = 0; i < data->lights.GetNumberOfLights(); i++)
-		{
-			if (data->lights.IsAnyLightEnabled())
-			{
-				const cLight *light = data->lights.GetLight(i);
-				if (light->enabled)
-				{
-					bool shadowNeeded = false;
-					bool lightNeeded = false;
-
-					if (light->volumetric)
-					{
-						shadowNeeded = true;
-						lightNeeded = true;
-					}
+		auto volumetricLight = [&](const cLight *light, float weight) {
+			if (!light->enabled) return;
 
-					if (params->iterFogEnabled && iterFogOpacity > 0.0)
-					{
-						lightNeeded = true;
-						if (params->iterFogShadows) shadowNeeded = true;
-					}
+			bool shadowNeeded = false;
+			bool lightNeeded = false;
 
-					if (params->cloudsEnable && cloudsOpacity > 0.0)
-					{
-						lightNeeded = true;
-						if (params->cloudsCastShadows) shadowNeeded = true;
-					}
+			if (light->volumetric)
+			{
+				shadowNeeded = true;
+				lightNeeded = true;
+			}
 
-					if (params->distanceFogShadows && distFogOpacity > 0.0)
-					{
-						lightNeeded = true;
-						shadowNeeded = true;
-					}
+			if (params->iterFogEnabled && iterFogOpacity > 0.0)
+			{
+				lightNeeded = true;
+				if (params->iterFogShadows) shadowNeeded = true;
+			}
 
-					if (!light->castShadows) shadowNeeded = false;
+			if (params->cloudsEnable && cloudsOpacity > 0.0)
+			{
+				lightNeeded = true;
+				if (params->cloudsCastShadows) shadowNeeded = true;
+			}
 
-					if (lightNeeded)
-					{
-						double distanceLight = 0.0;
-						CVector3 lightVectorTemp = light->CalculateLightVector(
-							point, input2.delta, params->resolution, params->viewDistanceMax, distanceLight);
+			if (params->distanceFogShadows && distFogOpacity > 0.0)
+			{
+				lightNeeded = true;
+				shadowNeeded = true;
+			}
 
-						float lightIntensity;
-						if (light->type == cLight::lightDirectional)
-							lightIntensity = light->intensity;
-						else
-							lightIntensity = light->intensity / light->Decay(distanceLight) * 4.0;
+			if (!light->castShadows) shadowNeeded = false;
 
-						sRGBFloat textureColor(0.0, 0.0, 0.0);
-						lightIntensity *= light->CalculateCone(lightVectorTemp, textureColor);
+			if (lightNeeded)
+			{
+				double distanceLight = 0.0;
+				CVector3 lightVectorTemp = light->CalculateLightVector(
+					point, input2.delta, params->resolution, params->viewDistanceMax, distanceLight);
+
+				float lightIntensity;
+				if (light->type == cLight::lightDirectional)
+					lightIntensity = light->intensity;
+				else
+					lightIntensity = light->intensity / light->Decay(distanceLight) * 4.0;
+
+				sRGBFloat textureColor(0.0, 0.0, 0.0);
+				lightIntensity *= light->CalculateCone(lightVectorTemp, textureColor);
+				lightIntensity *= weight;
+
+				sRGBAfloat lightShadow(0.0, 0.0, 0.0, 0.0);
+				if (shadowNeeded)
+				{
+					if (lightIntensity > 1e-3)
+						lightShadow = AuxShadow(input2, light, distanceLight, lightVectorTemp);
+					else
+						lightShadow = sRGBAfloat();
+				}
 
-						sRGBAfloat lightShadow(0.0, 0.0, 0.0, 0.0);
-						if (shadowNeeded)
-						{
-							if (lightIntensity > 1e-3)
-								lightShadow = AuxShadow(input2, light, distanceLight, lightVectorTemp);
-							else
-								lightShadow = sRGBAfloat();
-						}
+				sRGBFloat calculatedLight(0.0, 0.0, 0.0);
+				calculatedLight.R = light->color.R * lightIntensity * textureColor.R;
+				calculatedLight.G = light->color.G * lightIntensity * textureColor.G;
+				calculatedLight.B = light->color.B * lightIntensity * textureColor.B;
 
-						sRGBFloat calculatedLight(0.0, 0.0, 0.0);
-						calculatedLight.R = light->color.R * lightIntensity * textureColor.R;
-						calculatedLight.G = light->color.G * lightIntensity * textureColor.G;
-						calculatedLight.B = light->color.B * lightIntensity * textureColor.B;
+				totalLightsWithShadows.R += calculatedLight.R * lightShadow.R;
+				totalLightsWithShadows.G += calculatedLight.G * lightShadow.G;
+				totalLightsWithShadows.B += calculatedLight.B * lightShadow.B;
 
-						totalLightsWithShadows.R += calculatedLight.R * lightShadow.R;
-						totalLightsWithShadows.G += calculatedLight.G * lightShadow.G;
-						totalLightsWithShadows.B += calculatedLight.B * lightShadow.B;
+				totalLights.R += calculatedLight.R;
+				totalLights.G += calculatedLight.G;
+				totalLights.B += calculatedLight.B;
 
-						totalLights.R += calculatedLight.R;
-						totalLights.G += calculatedLight.G;
-						totalLights.B += calculatedLight.B;
+				double shadeClouds = clamp(-lightVectorTemp.Dot(deltaCloud), 0.0, 1.0);
+				totalLightsClouds.R += calculatedLight.R * shadeClouds;
+				totalLightsClouds.G += calculatedLight.G * shadeClouds;
+				totalLightsClouds.B += calculatedLight.B * shadeClouds;
 
-						double shadeClouds = clamp(-lightVectorTemp.Dot(deltaCloud), 0.0, 1.0);
-						totalLightsClouds.R += calculatedLight.R * shadeClouds;
-						totalLightsClouds.G += calculatedLight.G * shadeClouds;
-						totalLightsClouds.B += calculatedLight.B * shadeClouds;
+				if (light->volumetric)
+				{
+					output.R +=
+						calculatedLight.R * light->volumetricVisibility * lightShadow.R * float(step);
+					output.G +=
+						calculatedLight.G * light->volumetricVisibility * lightShadow.G * float(step);
+					output.B +=
+						calculatedLight.B * light->volumetricVisibility * lightShadow.B * float(step);
+					output.A +=
+						lightShadow.A * float(step) * lightIntensity * light->volumetricVisibility;
+				}
+			} // if light needed
+		};
 
-						if (light->volumetric)
-						{
-							output.R +=
-								calculatedLight.R * light->volumetricVisibility * lightShadow.R * float(step);
-							output.G +=
-								calculatedLight.G * light->volumetricVisibility * lightShadow.G * float(step);
-							output.B +=
-								calculatedLight.B * light->volumetricVisibility * lightShadow.B * float(step);
-							output.A +=
-								lightShadow.A * float(step) * lightIntensity * light->volumetricVisibility;
-						}
-					} // if light needed
-				}		// if light enabled
-			}			// if any light enabled
-		}				// next light
+		if (data->lights.IsAnyLightEnabled())
+		{
+			if (params->DOFMonteCarlo && data->lights.IsLightTreeUsed())
+			{
+				// in Monte Carlo mode only one light from the tree is calculated per step
+				data->lights.ForEachLightOutsideTree(
+					[&](const cLight *light) { volumetricLight(light, 1.0f); });
+
+				float probability;
+				const cLight *light =
+					data->lights.SampleLightFromTree(point, Random(1000000) / 1000001.0, &probability);
+				if (light && probability > 0.0f) volumetricLight(light, 1.0f / probability);
+			}
+			else
+			{
+				// intensity of light is multiplied by 4 in volumetric shader
+				data->lights.ForEachSignificantLight(point, cLights::lightTreeCutoff / 4.0f,
+					[&](const cLight *light) { volumetricLight(light, 1.0f); });
+			}
+		}
 
 		sRGBAfloat AO(0.0, 0.0, 0.0, 0.0);
 
@@ -0,0 +1,242 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSparseVolumeFile - writer and reader of sparse narrow band distance volume
+ */
+
+#include "sparse_volume_file.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include <QDebug>
+#include <QtGlobal>
+
+#include "write_log.hpp"
+
+cSparseVolumeFile::cSparseVolumeFile(const QString &fileName)
+{
+	file.setFileName(fileName);
+	w = h = l = 0;
+	bandWidth = 0.0;
+	brickCount = 0;
+	tileCount = 0;
+}
+
+cSparseVolumeFile::~cSparseVolumeFile()
+{
+	if (file.isOpen()) Close();
+}
+
+bool cSparseVolumeFile::Open(
+	int _w, int _h, int _l, CVector3 _limitMin, CVector3 _limitMax, double _bandWidth)
+{
+	w = _w;
+	h = _h;
+	l = _l;
+	limitMin = _limitMin;
+	limitMax = _limitMax;
+	bandWidth = _bandWidth;
+	brickCount = 0;
+	tileCount = 0;
+
+	if (!file.open(QFile::WriteOnly))
+	{
+		qCritical() << "Cannot write to file " << file.fileName();
+		return false;
+	}
+	WriteHeader();
+	return true;
+}
+
+void cSparseVolumeFile::WriteHeader()
+{
+	QByteArray header("MBSV", 4);
+	auto append = [&header](const void *data, int size)
+	{ header.append(static_cast<const char *>(data), size); };
+
+	const qint32 version = 1;
+	const qint32 size = brickSize;
+	const qint32 dimensions[3] = {w, h, l};
+	const double limits[6] = {
+		limitMin.x, limitMin.y, limitMin.z, limitMax.x, limitMax.y, limitMax.z};
+	const quint64 counts[2] = {brickCount, tileCount};
+
+	append(&version, sizeof(version));
+	append(&size, sizeof(size));
+	append(dimensions, sizeof(dimensions));
+	append(limits, sizeof(limits));
+	append(&bandWidth, sizeof(bandWidth));
+	append(counts, sizeof(counts));
+	file.write(header);
+}
+
+void cSparseVolumeFile::WriteRecordHeader(int x, int y, int z, enumRecordType type)
+{
+	char record[3 * sizeof(qint32) + 1];
+	const qint32 coordinates[3] = {x, y, z};
+	memcpy(record, coordinates, sizeof(coordinates));
+	record[sizeof(coordinates)] = char(type);
+	file.write(record, sizeof(record));
+}
+
+void cSparseVolumeFile::AddBrick(int x, int y, int z, const float *distances)
+{
+	qint16 values[brickVoxels];
+	const float scale = float(32767.0 / bandWidth);
+	for (int i = 0; i < brickVoxels; i++)
+	{
+		float value = std::round(distances[i] * scale);
+		values[i] = qint16(qBound(-32767.0f, value, 32767.0f));
+	}
+
+	WriteRecordHeader(x, y, z, recordBrick);
+	file.write(reinterpret_cast<const char *>(values), sizeof(values));
+	brickCount++;
+}
+
+void cSparseVolumeFile::AddInteriorTile(int x, int y, int z)
+{
+	WriteRecordHeader(x, y, z, recordInteriorTile);
+	tileCount++;
+}
+
+bool cSparseVolumeFile::Close()
+{
+	if (!file.isOpen()) return false;
+
+	// update counters in header
+	bool result = file.seek(0);
+	if (result) WriteHeader();
+	result = result && file.error() == QFileDevice::NoError;
+	file.close();
+
+	WriteLogString("Sparse volume saved", file.fileName(), 2);
+	WriteLogInt("Sparse volume - number of bricks", int(brickCount), 2);
+	return result;
+}
+
+bool cSparseVolumeFile::Load(const QString &fileName, sSparseVolume *volume)
+{
+	QFile inputFile(fileName);
+	if (!inputFile.open(QFile::ReadOnly))
+	{
+		qCritical() << "Cannot read file " << fileName;
+		return false;
+	}
+	const QByteArray data = inputFile.readAll();
+	inputFile.close();
+
+	qint64 position = 0;
+	auto read = [&data, &position](void *destination, qint64 size)
+	{
+		if (position + size > data.size()) return false;
+		memcpy(destination, data.constData() + position, size_t(size));
+		position += size;
+		return true;
+	};
+
+	char magic[4];
+	qint32 version = 0;
+	qint32 size = 0;
+	qint32 dimensions[3];
+	double limits[6];
+	double band = 0.0;
+	quint64 counts[2];
+
+	bool result = read(magic, sizeof(magic)) && memcmp(magic, "MBSV", 4) == 0;
+	result = result && read(&version, sizeof(version)) && version == 1;
+	result = result && read(&size, sizeof(size)) && size == brickSize;
+	result = result && read(dimensions, sizeof(dimensions)) && read(limits, sizeof(limits))
+					 && read(&band, sizeof(band)) && read(counts, sizeof(counts));
+	if (!result)
+	{
+		qCritical() << "Wrong header of sparse volume file " << fileName;
+		return false;
+	}
+
+	volume->w = dimensions[0];
+	volume->h = dimensions[1];
+	volume->l = dimensions[2];
+	volume->limitMin = CVector3(limits[0], limits[1], limits[2]);
+	volume->limitMax = CVector3(limits[3], limits[4], limits[5]);
+	volume->bandWidth = band;
+	volume->bricks.clear();
+	volume->tiles.clear();
+
+	const float scale = float(band / 32767.0);
+	while (position < data.size())
+	{
+		qint32 coordinates[3];
+		char type = 0;
+		if (!read(coordinates, sizeof(coordinates)) || !read(&type, sizeof(type)))
+		{
+			result = false;
+			break;
+		}
+
+		if (type == recordInteriorTile)
+		{
+			volume->tiles.push_back({coordinates[0], coordinates[1], coordinates[2]});
+		}
+		else if (type == recordBrick)
+		{
+			qint16 values[brickVoxels];
+			if (!read(values, sizeof(values)))
+			{
+				result = false;
+				break;
+			}
+			sSparseVolumeBrick brick;
+			brick.x = coordinates[0];
+			brick.y = coordinates[1];
+			brick.z = coordinates[2];
+			brick.distances.resize(brickVoxels);
+			for (int i = 0; i < brickVoxels; i++)
+				brick.distances[i] = values[i] * scale;
+			volume->bricks.push_back(std::move(brick));
+		}
+		else
+		{
+			result = false;
+			break;
+		}
+	}
+
+	if (!result || volume->bricks.size() != counts[0] || volume->tiles.size() != counts[1])
+	{
+		qCritical() << "Sparse volume file " << fileName << " is damaged";
+		return false;
+	}
+
+	return true;
+}
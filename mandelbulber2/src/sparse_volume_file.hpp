@@ -0,0 +1,121 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSparseVolumeFile - writer and reader of sparse narrow band distance volume (brick layout
+ * similar to VDB)
+ *
+ * File layout (little endian):
+ *   header: "MBSV", version, brick size, volume size (w, h, l), limitMin, limitMax,
+ *           band width, number of voxel bricks, number of interior tiles
+ *   records ordered by brick z, y, x:
+ *     int32 x, y, z (brick coordinates), uint8 type
+ *     type 0 - interior tile (whole brick inside the fractal, no data)
+ *     type 1 - brick with brickSize^3 int16 values (x changes fastest),
+ *              distance = value * band / 32767
+ * Bricks which are not stored are outside of the fractal (distance >= band). Distance estimation
+ * doesn't give distances inside the fractal, so inside voxels are stored as -band
+ */
+
+#ifndef MANDELBULBER2_SRC_SPARSE_VOLUME_FILE_HPP_
+#define MANDELBULBER2_SRC_SPARSE_VOLUME_FILE_HPP_
+
+#include <vector>
+
+#include <QFile>
+#include <QString>
+
+#include "algebra.hpp"
+
+struct sSparseVolumeBrick
+{
+	int x, y, z;
+	std::vector<float> distances;
+};
+
+struct sSparseVolumeTile
+{
+	int x, y, z;
+};
+
+struct sSparseVolume
+{
+	int w = 0;
+	int h = 0;
+	int l = 0;
+	CVector3 limitMin;
+	CVector3 limitMax;
+	double bandWidth = 0.0;
+	std::vector<sSparseVolumeBrick> bricks;
+	std::vector<sSparseVolumeTile> tiles;
+};
+
+class cSparseVolumeFile
+{
+public:
+	static const int brickSize = 8;
+	static const int brickVoxels = brickSize * brickSize * brickSize;
+
+	enum enumRecordType
+	{
+		recordInteriorTile = 0,
+		recordBrick = 1
+	};
+
+	cSparseVolumeFile(const QString &fileName);
+	~cSparseVolumeFile();
+
+	bool Open(int w, int h, int l, CVector3 limitMin, CVector3 limitMax, double bandWidth);
+	// distances has brickVoxels values, x changes fastest
+	void AddBrick(int x, int y, int z, const float *distances);
+	void AddInteriorTile(int x, int y, int z);
+	bool Close();
+
+	// reads whole volume. Distances are quantized, so they differ from written ones by up to
+	// bandWidth / 65534
+	static bool Load(const QString &fileName, sSparseVolume *volume);
+
+	quint64 GetBrickCount() const { return brickCount; }
+	quint64 GetTileCount() const { return tileCount; }
+
+private:
+	void WriteHeader();
+	void WriteRecordHeader(int x, int y, int z, enumRecordType type);
+
+	QFile file;
+	int w, h, l;
+	CVector3 limitMin;
+	CVector3 limitMax;
+	double bandWidth;
+	quint64 brickCount;
+	quint64 tileCount;
+};
+
+#endif /* MANDELBULBER2_SRC_SPARSE_VOLUME_FILE_HPP_ */
@@ -34,6 +34,8 @@
 
 #include "stereo.h"
 
+#include <cfloat>
+
 #include "cimage.hpp"
 cStereo::cStereo()
 {
@@ -290,3 +292,106 @@ void cStereo::ForceEye(enumEye eye)
 {
 	forceEye = eye;
 }
+
+void cStereo::PrepareSharedRays(CVector2<int> imageResolution)
+{
+	sharedRays.reset(new sSharedRays);
+
+	// corresponding pixels of both eyes have the same coordinates within eye region
+	CVector2<int> &eyeResolution = sharedRays->eyeResolution;
+	eyeResolution = imageResolution;
+	if (stereoMode == stereoLeftRight) eyeResolution.x /= 2;
+	if (stereoMode == stereoTopBottom) eyeResolution.y /= 2;
+
+	const size_t numberOfLines = size_t(eyeResolution.y) * 2;
+	sharedRays->distances = std::vector<std::atomic<float>>(numberOfLines * eyeResolution.x);
+	sharedRays->lineMinDistances = std::vector<std::atomic<float>>(numberOfLines);
+	sharedRays->lineRenderedPixels = std::vector<std::atomic<int>>(numberOfLines);
+	for (std::atomic<float> &lineMin : sharedRays->lineMinDistances)
+		lineMin.store(FLT_MAX, std::memory_order_relaxed);
+}
+
+int cStereo::SharedRayIndex(CVector2<int> pixel, enumEye eye) const
+{
+	int x = pixel.x % sharedRays->eyeResolution.x;
+	return SharedLineIndex(pixel.y, eye) * sharedRays->eyeResolution.x + x;
+}
+
+int cStereo::SharedLineIndex(int y, enumEye eye) const
+{
+	return int(eye) * sharedRays->eyeResolution.y + y % sharedRays->eyeResolution.y;
+}
+
+double cStereo::GetSharedRayStart(CVector2<int> pixel, enumEye eye, double eyeDistance,
+	double infiniteCorrection, double fov, params::enumPerspectiveType perspType) const
+{
+	if (eye == eyeNone) return 0.0;
+
+	const CVector2<int> &eyeResolution = sharedRays->eyeResolution;
+	const enumEye otherEye = (eye == eyeLeft) ? eyeRight : eyeLeft;
+	const CVector2<int> eyePixel(pixel.x % eyeResolution.x, pixel.y % eyeResolution.y);
+
+	// because of parallax the other eye sees the point hit by this ray shifted horizontally by
+	// disparity (in the same line), and its distance from the other eye is not bigger than
+	// distance + baseline. Any point which is visible in this line is at least at line minimum of
+	// the other eye - baseline, so it limits the disparity. The line has to be fully rendered
+	const int lineIndex = SharedLineIndex(eyePixel.y, otherEye);
+	if (sharedRays->lineRenderedPixels[lineIndex].load(std::memory_order_acquire) < eyeResolution.x)
+		return 0.0;
+	const double lineMinDistance =
+		sharedRays->lineMinDistances[lineIndex].load(std::memory_order_relaxed);
+
+	// eyes are shifted by eyeDistance from the camera in opposite directions
+	const double baseline = 2.0 * eyeDistance;
+	const double nearestDistance = lineMinDistance - baseline;
+	if (nearestDistance <= 0.0) return 0.0;
+
+	double pixelAngle = fov / eyeResolution.y;
+	if (perspType == params::perspEquirectangular) pixelAngle *= 0.5;
+	const double disparity =
+		baseline / nearestDistance / pixelAngle + fabs(infiniteCorrection) * 0.2 / pixelAngle;
+	const int maxRadius = 64;
+	if (disparity >= maxRadius) return 0.0;
+	const int radius = int(ceil(disparity)) + 1;
+
+	// corresponding point can be out of the image
+	if (eyePixel.x - radius < 0 || eyePixel.x + radius >= eyeResolution.x) return 0.0;
+
+	double distance = FLT_MAX;
+	for (int x = eyePixel.x - radius; x <= eyePixel.x + radius; x++)
+	{
+		const int index = SharedRayIndex(CVector2<int>(x, eyePixel.y), otherEye);
+		distance = qMin(distance, double(sharedRays->distances[index].load(std::memory_order_relaxed)));
+	}
+	if (distance >= FLT_MAX) return 0.0;
+
+	const double safetyFactor = 0.9;
+	return qMax(0.0, (distance - baseline) * safetyFactor);
+}
+
+void cStereo::StoreSharedRayDistance(
+	CVector2<int> pixel, enumEye eye, double distance, bool found) const
+{
+	if (eye == eyeNone) return;
+
+	// with antialiasing pixel is rendered many times, so minimum is kept
+	const float value = found ? qBound(FLT_MIN, float(distance), FLT_MAX) : FLT_MAX;
+	std::atomic<float> &pixelDistance = sharedRays->distances[SharedRayIndex(pixel, eye)];
+	float previous = pixelDistance.load(std::memory_order_relaxed);
+	while ((previous == 0.0f || value < previous)
+				 && !pixelDistance.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+	{
+	}
+
+	const int lineIndex = SharedLineIndex(pixel.y, eye);
+	std::atomic<float> &lineMin = sharedRays->lineMinDistances[lineIndex];
+	float previousMin = lineMin.load(std::memory_order_relaxed);
+	while (value < previousMin
+				 && !lineMin.compare_exchange_weak(previousMin, value, std::memory_order_relaxed))
+	{
+	}
+
+	// first store of the pixel
+	if (previous == 0.0f)
+		sharedRays->lineRenderedPixels[lineIndex].fetch_add(1, std::memory_order_release);
+}
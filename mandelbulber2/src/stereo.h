@@ -35,6 +35,7 @@
 #ifndef MANDELBULBER2_SRC_STEREO_H_
 #define MANDELBULBER2_SRC_STEREO_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -90,6 +91,14 @@ public:
 	void SwapEyes() { swapped = true; }
 	bool AreSwapped() const { return swapped; }
 
+	// shared rays: hit distance of one eye is used as a starting distance for the other eye
+	void PrepareSharedRays(CVector2<int> imageResolution);
+	void DisableSharedRays() { sharedRays.reset(); }
+	bool AreRaysShared() const { return sharedRays != nullptr; }
+	double GetSharedRayStart(CVector2<int> pixel, enumEye eye, double eyeDistance,
+		double infiniteCorrection, double fov, params::enumPerspectiveType perspType) const;
+	void StoreSharedRayDistance(CVector2<int> pixel, enumEye eye, double distance, bool found) const;
+
 private:
 	bool swapped;
 	enumStereoMode stereoMode;
@@ -97,6 +106,20 @@ private:
 	int imageBufferWidth;
 	int imageBufferHeight;
 	enumEye forceEye;
+
+	// distances for both eyes, written concurrently by rendering threads
+	struct sSharedRays
+	{
+		CVector2<int> eyeResolution;
+		// 0 - not rendered yet, FLT_MAX - nothing was hit
+		std::vector<std::atomic<float>> distances;
+		// minimum distance and number of rendered pixels for each line of each eye
+		std::vector<std::atomic<float>> lineMinDistances;
+		std::vector<std::atomic<int>> lineRenderedPixels;
+	};
+	int SharedRayIndex(CVector2<int> pixel, enumEye eye) const;
+	int SharedLineIndex(int y, enumEye eye) const;
+	std::shared_ptr<sSharedRays> sharedRays;
 };
 
 #endif /* MANDELBULBER2_SRC_STEREO_H_ */
@@ -306,14 +306,18 @@ bool CreateDefaultFolders()
 	result &= CreateFolder(systemDirectories.GetThumbnailsFolder());
 	result &= CreateFolder(systemDirectories.GetToolbarFolder());
 	result &= CreateFolder(systemDirectories.GetHttpCacheFolder());
+	result &= CreateFolder(systemDirectories.GetTextureCacheFolder());
+	result &= CreateFolder(systemDirectories.GetAudioFFTCacheFolder());
 	result &= CreateFolder(systemDirectories.GetCustomWindowStateFolder());
 	result &= CreateFolder(systemDirectories.GetSettingsFolder());
 	result &= CreateFolder(systemDirectories.GetSlicesFolder());
 	result &= CreateFolder(systemDirectories.GetMaterialsFolder());
 	result &= CreateFolder(systemDirectories.GetAnimationFolder());
 	result &= CreateFolder(systemDirectories.GetNetrenderFolder());
+	result &= CreateFolder(systemDirectories.GetNetrenderTextureCacheFolder());
 	result &= CreateFolder(systemDirectories.GetGradientsFolder());
 	result &= CreateFolder(systemDirectories.GetOpenCLTempFolder());
+	result &= CreateFolder(systemDirectories.GetOpenCLProgramCacheFolder());
 	result &= CreateFolder(systemDirectories.GetOpenCLCustomFormulasFolder());
 	result &= CreateFolder(systemDirectories.GetUndoFolder());
 	result &= CreateFolder(systemDirectories.GetHistoryFolder());
@@ -360,6 +364,9 @@ bool CreateDefaultFolders()
 	ClearNetRenderCache();
 	DeleteOldChache(systemDirectories.GetThumbnailsFolder(), 90);
 	DeleteOldChache(systemDirectories.GetHttpCacheFolder(), 10);
+	DeleteOldChache(systemDirectories.GetTextureCacheFolder(), 10);
+	DeleteOldChache(systemDirectories.GetNetrenderTextureCacheFolder(), 30);
+	DeleteOldChache(systemDirectories.GetAudioFFTCacheFolder(), 30);
 
 	return result;
 }
@@ -468,10 +475,14 @@ void myMessageOutput(QtMsgType type, const QMessageLogContext &context, const QS
 				context.line, context.function);
 			text = QString("Fatal: ") + QString(localMsg.constData()) + " (" + context.file + ":"
 						 + QString::number(context.line) + ", " + context.function;
-			abort();
 			break;
 	}
-	WriteLog(text, 1);
+
+	// critical messages often precede a crash, so they have to be stored before continuing
+	if (type == QtCriticalMsg || type == QtFatalMsg)
+		WriteLogSynchronous(text, 1);
+	else
+		WriteLog(text, 1);
 
 	if (type == QtFatalMsg) abort();
 }
@@ -59,6 +59,8 @@ struct sSystemDirectories
 	QString GetQueueFolder() const { return dataDirectoryHidden + "queue"; }
 	QString GetToolbarFolder() const { return dataDirectoryHidden + "toolbar"; }
 	QString GetHttpCacheFolder() const { return dataDirectoryHidden + "httpCache"; }
+	QString GetTextureCacheFolder() const { return dataDirectoryHidden + "textureCache"; }
+	QString GetAudioFFTCacheFolder() const { return dataDirectoryHidden + "audioFFTCache"; }
 	QString GetCustomWindowStateFolder() const { return dataDirectoryHidden + "customWindowState"; }
 	QString GetQueueFractlistFile() const { return dataDirectoryHidden + "queue.fractlist"; }
 	QString GetThumbnailsFolder() const { return dataDirectoryHidden + "thumbnails"; }
@@ -66,7 +68,12 @@ struct sSystemDirectories
 	QString GetRecentFilesListFile() const { return dataDirectoryHidden + "files.recent"; }
 	QString GetResolutionPresetsFile() const { return dataDirectoryHidden + "resolutionPresets.ini"; }
 	QString GetNetrenderFolder() const { return dataDirectoryHidden + "netrender"; }
+	QString GetNetrenderTextureCacheFolder() const
+	{
+		return dataDirectoryHidden + "netrenderTextureCache";
+	}
 	QString GetOpenCLTempFolder() const { return dataDirectoryHidden + "openclTemp"; }
+	QString GetOpenCLProgramCacheFolder() const { return dataDirectoryHidden + "openclProgramCache"; }
 	QString GetOpenCLCustomFormulasFolder() const { return dataDirectoryHidden + "customFormulas"; }
 	QString GetUndoFolder() const { return dataDirectoryHidden + "undo"; }
 	QString GetHistoryFileName() const;
@@ -0,0 +1,354 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTemporalReprojection - reuses depth of previous animation frame as starting distance of
+ * primary rays
+ */
+
+#include "temporal_reprojection.hpp"
+
+#include <cfloat>
+
+#include "camera_target.hpp"
+#include "cimage.hpp"
+#include "fractal_container.hpp"
+#include "fractparams.hpp"
+#include "light.h"
+#include "parameters.hpp"
+#include "projection_3d.hpp"
+#include "render_data.hpp"
+#include "write_log.hpp"
+
+cTemporalReprojection::cTemporalReprojection(int _referenceInterval)
+		: referenceInterval(_referenceInterval)
+{
+	previousMinDepth = 0.0f;
+	previousWidth = 0;
+	previousHeight = 0;
+	framesSinceReference = 0;
+	active = false;
+	validating = false;
+	disabled = false;
+}
+
+void cTemporalReprojection::Reset()
+{
+	previousParams.reset();
+	previousFractals.reset();
+	previousWorld.clear();
+	previousHit.clear();
+	startDistances.clear();
+	previousMinDepth = 0.0f;
+	previousWidth = 0;
+	previousHeight = 0;
+	framesSinceReference = 0;
+	active = false;
+	validating = false;
+	// 'disabled' is kept. Failed validation is valid for the whole animation
+}
+
+bool cTemporalReprojection::IsSupported(const sParamRender &paramRender, const sRenderData &data)
+{
+	// projection is inverted only for three-point perspective
+	if (paramRender.perspectiveType != params::perspThreePoint) return false;
+	if (paramRender.legacyCoordinateSystem) return false;
+
+	// rays don't start from the camera position
+	if (data.stereo.isEnabled() || paramRender.DOFMonteCarlo) return false;
+
+	// each client renders only part of image lines
+	if (data.configuration.UseNetRender()) return false;
+
+	return CanPrimaryRaysStartAhead(paramRender, data);
+}
+
+bool cTemporalReprojection::CanPrimaryRaysStartAhead(
+	const sParamRender &paramRender, const sRenderData &data)
+{
+	// volumetric effects are integrated along the whole ray from the camera
+	if (paramRender.glowEnabled || paramRender.fogEnabled || paramRender.iterFogEnabled
+			|| paramRender.cloudsEnable || paramRender.volFogEnabled || paramRender.fakeLightsEnabled)
+		return false;
+
+	for (int i = 0; i < data.lights.GetNumberOfLights(); i++)
+	{
+		const cLight *light = data.lights.GetLight(i);
+		if (light->enabled && (light->volumetric || light->visibility > 0.0f)) return false;
+	}
+
+	return true;
+}
+
+bool cTemporalReprojection::EqualContainers(const cParameterContainer &params,
+	const cParameterContainer &previous, const QStringList &ignoredParameters)
+{
+	QList<QString> list = params.GetListOfParameters();
+	if (list.size() != previous.GetListOfParameters().size()) return false;
+
+	for (const QString &name : list)
+	{
+		if (ignoredParameters.contains(name)) continue;
+		if (!previous.IfExists(name)) return false;
+
+		cMultiVal value = params.GetAsOneParameter(name).GetMultiVal(valueActual);
+		cMultiVal previousValue = previous.GetAsOneParameter(name).GetMultiVal(valueActual);
+		if (!value.isEqual(previousValue)) return false;
+	}
+	return true;
+}
+
+bool cTemporalReprojection::OnlyCameraChanged(
+	const cParameterContainer &params, const cParameterContainer &previous)
+{
+	// these parameters don't change geometry of the scene
+	static const QStringList cameraParameters = {"camera", "target", "camera_top",
+		"camera_rotation", "camera_distance_to_target", "fov"};
+	static const QStringList cameraAndFrameParameters = QStringList(cameraParameters) << "frame_no";
+
+	return EqualContainers(params, previous,
+		DependsOnFrameNumber(params) ? cameraParameters : cameraAndFrameParameters);
+}
+
+bool cTemporalReprojection::DependsOnFrameNumber(const cParameterContainer &params)
+{
+	for (const QString &name : params.GetListOfParameters())
+	{
+		// animated water surface
+		if (name.startsWith("primitive_water") && name.endsWith("_enabled"))
+		{
+			const QString prefix = name.left(name.lastIndexOf("_enabled"));
+			if (params.Get<bool>(name) && params.Get<double>(prefix + "_anim_speed") != 0.0)
+				return true;
+		}
+
+		// sequences of textures (e.g. displacement maps), see AnimatedFileName()
+		if (name.contains("file_") && params.GetAsOneParameter(name).GetValueType() == typeString
+				&& params.Get<QString>(name).contains('%'))
+			return true;
+	}
+	return false;
+}
+
+bool cTemporalReprojection::PrepareFrame(const cParameterContainer &params,
+	const cFractalContainer &fractals, const sParamRender &paramRender, const sRenderData &data,
+	int width, int height)
+{
+	active = false;
+	validating = false;
+
+	if (disabled || !previousParams || previousWidth != width || previousHeight != height)
+		return false;
+
+	if (!IsSupported(paramRender, data)) return false;
+
+	if (!OnlyCameraChanged(params, *previousParams)) return false;
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+	{
+		if (!EqualContainers(*fractals.at(i), *previousFractals->at(i), QStringList())) return false;
+	}
+
+	// world positions are stored as floats, so their error grows with distance from the origin.
+	// At deep zoom it can be bigger than the safety margin of start distances
+	const double positionError = FLT_EPSILON * (paramRender.camera.Length() + previousMinDepth);
+	const double minRelativeDepth = 100.0;
+	if (previousMinDepth < minRelativeDepth * positionError)
+	{
+		WriteLog("cTemporalReprojection::PrepareFrame(): depth too small for float precision", 2);
+		return false;
+	}
+
+	// maximum parallax (in pixels) caused by camera movement. Splatted samples have no occlusion
+	// information, so near depth discontinuities within this radius rays start from the camera
+	const CVector3 previousCamera = previousParams->Get<CVector3>("camera");
+	const double cameraShift = (paramRender.camera - previousCamera).Length();
+	const double pixelAngle = paramRender.fov / height;
+	const double parallax = cameraShift / previousMinDepth / pixelAngle;
+	const int maxSearchRadius = 8;
+	if (parallax > maxSearchRadius)
+	{
+		WriteLog("cTemporalReprojection::PrepareFrame(): camera movement too big", 2);
+		return false;
+	}
+	const int searchRadius = qMax(1, int(ceil(parallax)));
+
+	// the same rotation matrix as in cRenderWorker::PrepareMainVectors()
+	cCameraTarget cameraTarget(paramRender.camera, paramRender.target, paramRender.topVector);
+	CVector3 viewAngle = cameraTarget.GetRotation();
+	CRotationMatrix mRot;
+	mRot.RotateZ(viewAngle.x);
+	mRot.RotateX(viewAngle.y);
+	mRot.RotateY(viewAngle.z);
+	mRot.RotateZ(-paramRender.sweetSpotHAngle);
+	mRot.RotateX(paramRender.sweetSpotVAngle);
+	CRotationMatrix mRotInv = mRot.Transpose();
+
+	// splatting of previous surface points into the new view (nearest one wins)
+	const float unknown = 1e20f;
+	std::vector<float> splat(size_t(width) * height, unknown);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			size_t index = size_t(y) * width + x;
+			if (!previousHit[index]) continue;
+
+			sRGBFloat world = previousWorld[index];
+			CVector3 point(world.R, world.G, world.B);
+			CVector3 screenPoint = InvProjection3D(point, paramRender.camera, mRotInv,
+				paramRender.perspectiveType, paramRender.fov, width, height);
+			if (screenPoint.z <= 0.0) continue;
+
+			int sx = int(floor(screenPoint.x + 0.5));
+			int sy = int(floor(screenPoint.y + 0.5));
+			if (sx < 0 || sx >= width || sy < 0 || sy >= height) continue;
+
+			float &target = splat[size_t(sy) * width + sx];
+			target = qMin(target, float(screenPoint.z));
+		}
+	}
+
+	// pixels without any sample start from the camera. Minimum of 3x3 neighbourhood covers holes
+	// between splatted samples. Pixels close to depth discontinuities (silhouettes which could
+	// uncover or cover something because of parallax) also start from the camera
+	const float safetyFactor = 0.9f;
+	const float discontinuityRatio = 1.5f;
+	startDistances.assign(size_t(width) * height, 0.0f);
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = searchRadius; y < height - searchRadius; y++)
+	{
+		for (int x = searchRadius; x < width - searchRadius; x++)
+		{
+			if (splat[size_t(y) * width + x] >= unknown) continue;
+
+			float minDistance = unknown;
+			for (int dy = -1; dy <= 1; dy++)
+			{
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					minDistance = qMin(minDistance, splat[size_t(y + dy) * width + x + dx]);
+				}
+			}
+
+			bool discontinuity = false;
+			for (int dy = -searchRadius; dy <= searchRadius && !discontinuity; dy++)
+			{
+				for (int dx = -searchRadius; dx <= searchRadius; dx++)
+				{
+					const float distance = splat[size_t(y + dy) * width + x + dx];
+					if (distance < unknown && distance > minDistance * discontinuityRatio)
+					{
+						discontinuity = true;
+						break;
+					}
+				}
+			}
+			if (discontinuity) continue;
+
+			startDistances[size_t(y) * width + x] = minDistance * safetyFactor;
+		}
+	}
+
+	// every n-th frame is rendered from scratch to avoid accumulation of errors. Its depth is
+	// compared with predicted start distances in StoreFrame()
+	if (framesSinceReference + 1 >= referenceInterval)
+	{
+		validating = true;
+		return false;
+	}
+
+	active = true;
+	WriteLog("cTemporalReprojection::PrepareFrame(): using start distances from previous frame", 2);
+	return true;
+}
+
+void cTemporalReprojection::StoreFrame(const cParameterContainer &params,
+	const cFractalContainer &fractals, std::shared_ptr<cImage> image)
+{
+	if (validating)
+	{
+		// predicted start distance behind the surface means that ray-marching would skip something
+		const int width = int(image->GetWidth());
+		const int height = int(image->GetHeight());
+		long long overshoots = 0;
+		for (int y = 0; y < height && startDistances.size() == size_t(width) * height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				const float start = startDistances[size_t(y) * width + x];
+				if (start > 0.0f && start > image->GetPixelZBuffer(x, y)) overshoots++;
+			}
+		}
+		if (overshoots > 0)
+		{
+			WriteLog(QString("cTemporalReprojection::StoreFrame(): reprojection disabled. Predicted "
+											 "start distances were behind the surface in %1 pixels of reference frame")
+								 .arg(overshoots),
+				1);
+			disabled = true;
+		}
+	}
+
+	if (active)
+		framesSinceReference++;
+	else
+		framesSinceReference = 0;
+	active = false;
+	validating = false;
+
+	if (!image->GetImageOptional()->optionalWorld)
+	{
+		Reset();
+		return;
+	}
+
+	previousParams.reset(new cParameterContainer(params));
+	previousFractals.reset(new cFractalContainer(fractals));
+
+	previousWidth = int(image->GetWidth());
+	previousHeight = int(image->GetHeight());
+	size_t size = size_t(previousWidth) * previousHeight;
+	previousWorld.resize(size);
+	previousHit.resize(size);
+	previousMinDepth = 1e20f;
+
+	for (int y = 0; y < previousHeight; y++)
+	{
+		for (int x = 0; x < previousWidth; x++)
+		{
+			size_t index = size_t(y) * previousWidth + x;
+			const float depth = image->GetPixelZBuffer(x, y);
+			previousWorld[index] = image->GetPixelWorld(x, y);
+			previousHit[index] = depth < 1e19f;
+			if (previousHit[index]) previousMinDepth = qMin(previousMinDepth, depth);
+		}
+	}
+}
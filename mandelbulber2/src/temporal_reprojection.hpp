@@ -0,0 +1,100 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTemporalReprojection - reuses depth of previous animation frame as starting distance of
+ * primary rays. World positions of the previous frame are projected into the new camera view and
+ * the nearest distance found around each pixel is used as a conservative start of ray-marching.
+ * It is used only when just camera parameters changed between frames. Every
+ * anim_temporal_reference_interval frames a reference frame is rendered from scratch and compared
+ * with the prediction. Reprojection is disabled for the rest of the animation if any predicted
+ * start was behind the surface (e.g. sub-pixel features which were not visible in previous frame).
+ */
+
+#ifndef MANDELBULBER2_SRC_TEMPORAL_REPROJECTION_HPP_
+#define MANDELBULBER2_SRC_TEMPORAL_REPROJECTION_HPP_
+
+#include <memory>
+#include <vector>
+
+#include <QStringList>
+
+#include "color_structures.hpp"
+
+// forward declarations
+class cImage;
+class cParameterContainer;
+class cFractalContainer;
+struct sParamRender;
+struct sRenderData;
+
+class cTemporalReprojection
+{
+public:
+	cTemporalReprojection(int referenceInterval);
+
+	// prepares start distances for new frame. Returns true if frame can use reprojection
+	bool PrepareFrame(const cParameterContainer &params, const cFractalContainer &fractals,
+		const sParamRender &paramRender, const sRenderData &data, int width, int height);
+	// keeps world positions of rendered frame for next one
+	void StoreFrame(const cParameterContainer &params, const cFractalContainer &fractals,
+		std::shared_ptr<cImage> image);
+	void Reset();
+
+	// start distances for each pixel (0 - no information), nullptr if not active
+	const float *GetStartDistances() const { return active ? startDistances.data() : nullptr; }
+
+	static bool IsSupported(const sParamRender &paramRender, const sRenderData &data);
+	// false if primary rays have to be marched from the camera (volumetric effects)
+	static bool CanPrimaryRaysStartAhead(const sParamRender &paramRender, const sRenderData &data);
+
+private:
+	static bool OnlyCameraChanged(
+		const cParameterContainer &params, const cParameterContainer &previous);
+	static bool DependsOnFrameNumber(const cParameterContainer &params);
+	static bool EqualContainers(const cParameterContainer &params,
+		const cParameterContainer &previous, const QStringList &ignoredParameters);
+
+	std::shared_ptr<cParameterContainer> previousParams;
+	std::shared_ptr<cFractalContainer> previousFractals;
+	std::vector<sRGBFloat> previousWorld;
+	std::vector<char> previousHit;
+	std::vector<float> startDistances;
+	float previousMinDepth;
+	int previousWidth;
+	int previousHeight;
+	int referenceInterval;
+	int framesSinceReference;
+	bool active;
+	bool validating; // start distances of reference frame are predicted only for validation
+	bool disabled;
+};
+
+#endif /* MANDELBULBER2_SRC_TEMPORAL_REPROJECTION_HPP_ */
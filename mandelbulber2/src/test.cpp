@@ -46,11 +46,13 @@
 #include "interface.hpp"
 #include "keyframes.hpp"
 #include "netrender.hpp"
+#include "opencl_engine_render_ssao.h"
 #include "opencl_global.h"
 #include "opencl_hardware.h"
 #include "render_job.hpp"
 #include "rendering_configuration.hpp"
 #include "settings.hpp"
+#include "sparse_volume_file.hpp"
 #include "system_directories.hpp"
 #include "write_log.hpp"
 
@@ -584,3 +586,102 @@ void Test::renderImageSave() const
 		}
 	}
 }
+
+void Test::openClProgramCache() const
+{
+	// can be run with CPU implementation of OpenCL (e.g. pocl)
+#ifdef USE_OPENCL
+	if (!gOpenCl || !gOpenCl->openClHardware->ContextCreated()
+			|| gOpenCl->openClHardware->getEnabledDevices().isEmpty())
+	{
+		QSKIP("OpenCL device is not available");
+	}
+
+	cOpenClEngineRenderSSAO *engine = gOpenCl->openClEngineRenderSSAO;
+	engine->Lock();
+	struct sUnlockAtExit
+	{
+		cOpenClEngine *engine;
+		~sUnlockAtExit() { engine->Unlock(); }
+	} unlockAtExit{engine};
+	engine->SetUseBuildCache(true);
+
+	// first build stores binaries in the cache (or loads them if they already exist)
+	engine->Reset();
+	QVERIFY2(engine->LoadSourcesAndCompile(gPar), "OpenCL program build failed.");
+	const QStringList cacheFiles = engine->GetProgramCacheFileNames();
+	QVERIFY2(!cacheFiles.isEmpty(), "no cache file names.");
+	for (const QString &cacheFile : cacheFiles)
+		QVERIFY2(QFileInfo::exists(cacheFile), "program binary was not stored in cache.");
+
+	// second build has to be loaded from the cache
+	engine->Reset();
+	QVERIFY2(engine->LoadSourcesAndCompile(gPar), "OpenCL program build failed.");
+	QVERIFY2(engine->GetNumberOfProgramsLoadedFromCache() == cacheFiles.size(),
+		"program was not loaded from cache.");
+
+	// corrupted binary has to be rebuilt and replaced
+	const QByteArray corruptedBinary("corrupted program binary");
+	QFile file(cacheFiles.first());
+	QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+	file.write(corruptedBinary);
+	file.close();
+
+	engine->Reset();
+	QVERIFY2(engine->LoadSourcesAndCompile(gPar), "OpenCL program rebuild failed.");
+	QVERIFY2(engine->GetNumberOfProgramsLoadedFromCache() == cacheFiles.size() - 1,
+		"corrupted program binary was loaded from cache.");
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	QVERIFY2(file.readAll() != corruptedBinary, "corrupted program binary was not replaced.");
+	file.close();
+#else
+	QSKIP("compiled without OpenCL support");
+#endif
+}
+
+void Test::sparseVolumeFile() const
+{
+	const QString fileName = testFolder() + QDir::separator() + "volume.mbsv";
+	const CVector3 limitMin(-1.0, -2.0, -3.0);
+	const CVector3 limitMax(1.0, 2.0, 3.0);
+	const double bandWidth = 0.25;
+
+	std::vector<float> distances(cSparseVolumeFile::brickVoxels);
+	for (int i = 0; i < cSparseVolumeFile::brickVoxels; i++)
+		distances[i] = float(bandWidth * (i - cSparseVolumeFile::brickVoxels / 2) / 256.0);
+
+	{
+		cSparseVolumeFile volumeFile(fileName);
+		QVERIFY2(volumeFile.Open(20, 17, 9, limitMin, limitMax, bandWidth), "cannot open file.");
+		volumeFile.AddInteriorTile(0, 0, 0);
+		volumeFile.AddBrick(1, 0, 0, distances.data());
+		volumeFile.AddBrick(2, 1, 1, distances.data());
+		volumeFile.AddInteriorTile(2, 2, 1);
+		QVERIFY2(volumeFile.Close(), "cannot write file.");
+	}
+
+	sSparseVolume volume;
+	QVERIFY2(cSparseVolumeFile::Load(fileName, &volume), "cannot read file.");
+	QVERIFY(volume.w == 20 && volume.h == 17 && volume.l == 9);
+	QVERIFY(volume.limitMin == limitMin && volume.limitMax == limitMax);
+	QVERIFY(volume.bandWidth == bandWidth);
+	QVERIFY(volume.bricks.size() == 2 && volume.tiles.size() == 2);
+	QVERIFY(volume.tiles[0].x == 0 && volume.tiles[0].y == 0 && volume.tiles[0].z == 0);
+	QVERIFY(volume.tiles[1].x == 2 && volume.tiles[1].y == 2 && volume.tiles[1].z == 1);
+	QVERIFY(volume.bricks[0].x == 1 && volume.bricks[0].y == 0 && volume.bricks[0].z == 0);
+	QVERIFY(volume.bricks[1].x == 2 && volume.bricks[1].y == 1 && volume.bricks[1].z == 1);
+
+	// values are quantized to 16 bits
+	const float tolerance = float(bandWidth / 32767.0);
+	for (const sSparseVolumeBrick &brick : volume.bricks)
+	{
+		QVERIFY(brick.distances.size() == distances.size());
+		for (size_t i = 0; i < distances.size(); i++)
+			QVERIFY2(qAbs(brick.distances[i] - distances[i]) <= tolerance, "wrong distance.");
+	}
+
+	// truncated file is reported as damaged
+	QFile file(fileName);
+	QVERIFY(file.resize(file.size() - 10));
+	QVERIFY2(!cSparseVolumeFile::Load(fileName, &volume), "damaged file was accepted.");
+}
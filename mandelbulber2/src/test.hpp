@@ -79,6 +79,8 @@ private slots:
 	void testKeyframeWrapper() const;
 	void renderSimpleWrapper() const;
 	void testImageSaveWrapper() const;
+	void openClProgramCache() const;
+	void sparseVolumeFile() const;
 };
 
 #endif /* MANDELBULBER2_SRC_TEST_HPP_ */
@@ -31,7 +31,7 @@
  *
  * cTexture class - simple bitmap container with pixel interpolation
  *
- * This class holds an sRGB8 *bitmap to store texture information. The class
+ * This class holds a shared cTextureTiles object to store texture information. The class
  * can be initialized by loading an image file, or by loading a QByteArray (network).
  * Pixel(...) gets the pixel at a given point. The image data is MipMap-ped and
  * bicubic interpolated to give a "smooth" result.
@@ -41,7 +41,6 @@
 #include "texture.hpp"
 
 #include <memory>
-#include <QCache>
 
 #include "common_math.h"
 #include "error_message.hpp"
@@ -79,141 +78,105 @@ cTexture::cTexture(
 	if (cTexture *textureFromCache = gTextureCache->GetTexture(filename))
 	{
 		*this = *textureFromCache;
+		WriteLogString("Loading texture - finished", filename, 3);
+		return;
 	}
-	else
-	{
 
-		// try to load image if it's PNG format (this one supports 16-bit depth images)
-		WriteLogString("Loading texture - LoadPNG()", filename, 3);
-		std::vector<sRGBA16> bitmap16 = LoadPNG(filename, width, height);
-		if (!bitmap16.empty())
+	// already converted texture can be mapped directly from disk cache without decoding
+	QString diskCacheFile;
+	if (gTextureCache->IsDiskCacheEnabled())
+	{
+		diskCacheFile = cTextureTiles::DiskCacheFileName(filename, mode == useMipmaps);
+		if (!diskCacheFile.isEmpty())
 		{
-			bitmapFloat.resize(bitmap16.size());
-			for (quint64 i = 0; i < bitmap16.size(); i++)
+			tiles = cTextureTiles::LoadFromDiskCache(diskCacheFile);
+			if (tiles)
 			{
-				sRGBFloat pixel(
-					bitmap16[i].R / 65536.0f, bitmap16[i].G / 65536.0f, bitmap16[i].B / 65536.0f);
-				bitmapFloat[i] = pixel;
+				width = tiles->Width();
+				height = tiles->Height();
+				loaded = true;
+				originalFileName = filename;
+				gTextureCache->AddToCache(this);
+				WriteLogString("Loading texture - finished", filename, 3);
+				return;
 			}
-			bitmap16.clear();
 		}
+	}
 
-		// check if it is Radiance HDR image
+	const bool withMipmaps = mode == useMipmaps;
+	std::shared_ptr<cTextureTiles> newTiles;
+
+	// try to load image if it's PNG format (this one supports 16-bit depth images). Rows are
+	// stored in tiles while decoding, so the whole bitmap is never held in memory
+	WriteLogString("Loading texture - LoadPNGRows()", filename, 3);
+	const bool pngLoaded = LoadPNGRows(
+		filename,
+		[&](int pngWidth, int pngHeight, int bitDepth) {
+			width = pngWidth;
+			height = pngHeight;
+			const cTextureTiles::enumTileFormat format =
+				(bitDepth > 8) ? cTextureTiles::format16bit : cTextureTiles::format8bit;
+			newTiles = cTextureTiles::BeginCreate(width, height, format, withMipmaps);
+			return true;
+		},
+		[&](int y, const sRGBA16 *row) {
+			for (int x = 0; x < width; x++)
+			{
+				const sRGBFloat pixel(row[x].R / 65535.0f, row[x].G / 65535.0f, row[x].B / 65535.0f);
+				newTiles->StoreBaseTexel(x, y, pixel);
+			}
+		});
+	if (!pngLoaded) newTiles.reset();
+
+	// check if it is Radiance HDR image
+	if (!newTiles)
+	{
 		std::unique_ptr<cRadianceHDR> radiance(new cRadianceHDR());
 		if (radiance->Init(filename, &width, &height))
 		{
+			std::vector<sRGBFloat> bitmapFloat;
 			radiance->Load(&bitmapFloat);
-			loaded = true;
-		}
-
-		// if not, try to use Qt image loader
-		if (bitmapFloat.empty())
-		{
-			WriteLogString("Loading texture - loading using QImage", filename, 3);
-			QImage qImage;
-			qImage.load(filename);
-			qImage = qImage.convertToFormat(QImage::Format_RGB888);
-			if (!qImage.isNull())
+			if (!bitmapFloat.empty())
 			{
-				width = qImage.width();
-				height = qImage.height();
-				bitmapFloat.resize(width * height);
-				for (int y = 0; y < height; y++)
-				{
-					sRGB8 *line = reinterpret_cast<sRGB8 *>(qImage.scanLine(y));
-					for (int x = 0; x < width; x++)
-					{
-						const sRGBFloat pixel(line[x].R / 256.0f, line[x].G / 256.0f, line[x].B / 256.0f);
-						bitmapFloat[x + y * width] = pixel;
-					}
-				}
+				newTiles =
+					cTextureTiles::BeginCreate(width, height, cTextureTiles::formatHalfFloat, withMipmaps);
+				StoreBitmapInTiles(bitmapFloat.data(), newTiles.get());
 			}
 		}
+	}
 
-		if (!bitmapFloat.empty())
-		{
-			loaded = true;
-			originalFileName = filename;
-			if (mode == useMipmaps)
-			{
-				WriteLogString("Loading texture - CreateMipMaps()", filename, 3);
-				CreateMipMaps();
-			}
-
-			ComputeHDRBItmap();
-
-			gTextureCache->AddToCache(this);
-		}
-		else
-		{
-			if (!beQuiet && !useNetRender)
-				gErrorMessage->showMessageFromOtherThread(
-					QObject::tr("Can't load texture!\n") + filename, cErrorMessage::errorMessage);
-			width = defaultSize;
-			height = defaultSize;
-			loaded = false;
-			bitmapFloat.resize(defaultSize * defaultSize);
-			std::fill(bitmapFloat.begin(), bitmapFloat.end(), sRGBFloat(1.0, 1.0, 1.0));
-			bitmapHDR.resize(defaultSize * defaultSize);
-			std::fill(bitmapHDR.begin(), bitmapHDR.end(), sRGBA8(255, 255, 255, 255));
-		}
+	// if not, try to use Qt image loader
+	if (!newTiles)
+	{
+		WriteLogString("Loading texture - loading using QImage", filename, 3);
+		QImage qImage;
+		qImage.load(filename);
+		qImage = qImage.convertToFormat(QImage::Format_RGB888);
+		if (!qImage.isNull()) newTiles = TilesFromQImage(qImage, withMipmaps);
 	}
 
-	WriteLogString("Loading texture - finished", filename, 3);
-}
+	if (newTiles)
+	{
+		loaded = true;
+		originalFileName = filename;
 
-// copy constructor
-cTexture::cTexture(const cTexture &tex)
-{
-	width = tex.width;
-	height = tex.height;
-	loaded = tex.loaded;
-	bitmapFloat = tex.bitmapFloat;
-	bitmapHDR = tex.bitmapHDR;
-	originalFileName = tex.originalFileName;
-	mipmaps = tex.mipmaps;
-	mipmapSizes = tex.mipmapSizes;
-}
+		// small textures are not worth to be stored on disk
+		if (qint64(width) * height < diskCacheMinimumPixels) diskCacheFile.clear();
 
-// move cotructor
-cTexture::cTexture(cTexture &&other)
-{
-	width = other.width;
-	height = other.height;
-	loaded = other.loaded;
-	bitmapFloat = std::move(other.bitmapFloat);
-	bitmapHDR = std::move(other.bitmapHDR);
-	originalFileName = std::move(other.originalFileName);
-	mipmaps = std::move(other.mipmaps);
-	mipmapSizes = std::move(other.mipmapSizes);
-}
+		WriteLogString("Loading texture - FinishCreate()", filename, 3);
+		tiles = cTextureTiles::FinishCreate(newTiles, diskCacheFile);
 
-cTexture &cTexture::operator=(const cTexture &tex)
-{
-	width = tex.width;
-	height = tex.height;
-	loaded = tex.loaded;
-	bitmapFloat = tex.bitmapFloat;
-	bitmapHDR = tex.bitmapHDR;
-	originalFileName = tex.originalFileName;
-	mipmaps = tex.mipmaps;
-	mipmapSizes = tex.mipmapSizes;
-
-	return *this;
-}
+		gTextureCache->AddToCache(this);
+	}
+	else
+	{
+		if (!beQuiet && !useNetRender)
+			gErrorMessage->showMessageFromOtherThread(
+				QObject::tr("Can't load texture!\n") + filename, cErrorMessage::errorMessage);
+		CreateDefaultTiles();
+	}
 
-cTexture &cTexture::operator=(cTexture &&other)
-{
-	width = other.width;
-	height = other.height;
-	loaded = other.loaded;
-	bitmapFloat = std::move(other.bitmapFloat);
-	bitmapHDR = std::move(other.bitmapHDR);
-	originalFileName = std::move(other.originalFileName);
-	mipmaps = std::move(other.mipmaps);
-	mipmapSizes = std::move(other.mipmapSizes);
-
-	return *this;
+	WriteLogString("Loading texture - finished", filename, 3);
 }
 
 void cTexture::FromQByteArray(QByteArray *buffer, enumUseMipmaps mode)
@@ -224,51 +187,68 @@ void cTexture::FromQByteArray(QByteArray *buffer, enumUseMipmaps mode)
 
 	if (!qImage.isNull())
 	{
-		width = qImage.width();
-		height = qImage.height();
-		bitmapFloat.resize(width * height);
-		for (int y = 0; y < height; y++)
-		{
-			sRGB8 *line = reinterpret_cast<sRGB8 *>(qImage.scanLine(y));
-			for (int x = 0; x < width; x++)
-			{
-				const sRGBFloat pixel(line[x].R / 256.0f, line[x].G / 256.0f, line[x].B / 256.0f);
-				bitmapFloat[x + y * width] = pixel;
-			}
-		}
-
 		loaded = true;
-
-		if (mode == useMipmaps)
-		{
-			CreateMipMaps();
-		}
-
-		ComputeHDRBItmap();
+		tiles = cTextureTiles::FinishCreate(TilesFromQImage(qImage, mode == useMipmaps));
 	}
 	else
 	{
 		cErrorMessage::showMessage(
 			QObject::tr("Can't load texture from QByteArray!\n"), cErrorMessage::errorMessage);
-		width = defaultSize;
-		height = defaultSize;
-		loaded = false;
-		bitmapFloat.resize(defaultSize * defaultSize);
-		std::fill(bitmapFloat.begin(), bitmapFloat.end(), sRGBFloat(1.0, 1.0, 1.0));
-		bitmapHDR.resize(defaultSize * defaultSize);
-		std::fill(bitmapHDR.begin(), bitmapHDR.end(), sRGBA8(255, 255, 255, 255));
+		CreateDefaultTiles();
 	}
 }
 
 cTexture::cTexture()
 {
+	CreateDefaultTiles();
+}
+
+std::shared_ptr<cTextureTiles> cTexture::TilesFromQImage(const QImage &qImage, bool withMipmaps)
+{
+	width = qImage.width();
+	height = qImage.height();
+	std::shared_ptr<cTextureTiles> newTiles =
+		cTextureTiles::BeginCreate(width, height, cTextureTiles::format8bit, withMipmaps);
+
+	// scan lines are stored directly in tiles without intermediate float bitmap
+#pragma omp parallel for
+	for (int y = 0; y < height; y++)
+	{
+		const sRGB8 *line = reinterpret_cast<const sRGB8 *>(qImage.constScanLine(y));
+		for (int x = 0; x < width; x++)
+		{
+			const sRGBFloat pixel(line[x].R / 255.0f, line[x].G / 255.0f, line[x].B / 255.0f);
+			newTiles->StoreBaseTexel(x, y, pixel);
+		}
+	}
+	return newTiles;
+}
+
+void cTexture::StoreBitmapInTiles(const sRGBFloat *bitmapFloat, cTextureTiles *newTiles) const
+{
+#pragma omp parallel for
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			newTiles->StoreBaseTexel(x, y, bitmapFloat[x + size_t(y) * width]);
+		}
+	}
+}
+
+void cTexture::CreateDefaultTiles()
+{
+	// white texture is the same for all instances, so it is created only once
+	static const std::shared_ptr<const cTextureTiles> defaultTiles = []() {
+		std::vector<sRGBFloat> white(defaultSize * defaultSize, sRGBFloat(1.0, 1.0, 1.0));
+		return cTextureTiles::Create(
+			white.data(), defaultSize, defaultSize, cTextureTiles::formatHalfFloat, false);
+	}();
+
 	width = defaultSize;
 	height = defaultSize;
 	loaded = false;
-	bitmapFloat.resize(defaultSize * defaultSize);
-	std::fill(bitmapFloat.begin(), bitmapFloat.end(), sRGBFloat(1.0, 1.0, 1.0));
-	bitmapHDR.resize(defaultSize * defaultSize);
-	std::fill(bitmapHDR.begin(), bitmapHDR.end(), sRGBA8(255, 255, 255, 255));
+	tiles = defaultTiles;
 }
 
 // read pixel
@@ -301,45 +281,30 @@ sRGBFloat cTexture::Pixel(CVector2<float> point, float pixelSize) const
 	return MipMap(point.x, point.y, pixelSize);
 }
 
-sRGBFloat cTexture::LinearInterpolation(float x, float y) const
-{
-	sRGBFloat color;
-	const int ix = int(x);
-	const int iy = int(y);
-	const float rx = x - int(x);
-	const float ry = y - int(y);
-	const sRGBFloat k1 = bitmapFloat[iy * width + ix];
-	const sRGBFloat k2 = bitmapFloat[iy * width + ix + 1];
-	const sRGBFloat k3 = bitmapFloat[(iy + 1) * width + ix];
-	const sRGBFloat k4 = bitmapFloat[(iy + 1) * width + ix + 1];
-	color.R = (k1.R * (1.0f - rx) * (1.0f - ry) + k2.R * rx * (1.0f - ry) + k3.R * (1.0f - rx) * ry
-						 + k4.R * (rx * ry));
-	color.G = (k1.G * (1.0f - rx) * (1.0f - ry) + k2.G * rx * (1.0f - ry) + k3.G * (1.0f - rx) * ry
-						 + k4.G * (rx * ry));
-	color.B = (k1.B * (1.0f - rx) * (1.0f - ry) + k2.B * rx * (1.0f - ry) + k3.B * (1.0f - rx) * ry
-						 + k4.B * (rx * ry));
-	return color;
-}
-
-sRGBFloat cTexture::BicubicInterpolation(float x, float y, const sRGBFloat *bitm, int w, int h)
+sRGBFloat cTexture::BicubicInterpolation(float x, float y, int level) const
 {
+	const int w = tiles->Width(level);
+	const int h = tiles->Height(level);
 	const int ix = int(x);
 	const int iy = int(y);
 	const float rx = x - ix;
 	const float ry = y - iy;
 
+	// wrapping is done once per row and column instead of for each of 16 taps
+	int xIndex[4], yIndex[4];
+	for (int i = 0; i < 4; i++)
+	{
+		xIndex[i] = WrapInt(ix + i - 1, w);
+		yIndex[i] = WrapInt(iy + i - 1, h);
+	}
+
 	float R[4][4], G[4][4], B[4][4];
 
 	for (int yy = 0; yy < 4; yy++)
 	{
 		for (int xx = 0; xx < 4; xx++)
 		{
-			int ixx = ix + xx - 1;
-			int iyy = iy + yy - 1;
-			ixx = (ixx + w) % w;
-			iyy = (iyy + h) % h;
-			const int address2 = ixx + iyy * w;
-			const sRGBFloat pixel = bitm[address2];
+			const sRGBFloat pixel = tiles->Texel(level, xIndex[xx], yIndex[yy]);
 			R[xx][yy] = pixel.R;
 			G[xx][yy] = pixel.G;
 			B[xx][yy] = pixel.B;
@@ -350,11 +315,8 @@ sRGBFloat cTexture::BicubicInterpolation(float x, float y, const sRGBFloat *bitm
 	float dG = bicubicInterpolate(G, rx, ry);
 	float dB = bicubicInterpolate(B, rx, ry);
 	if (dR < 0.0f) dR = 0.0f;
-	// if (dR > 65535) dR = 65535;
 	if (dG < 0.0f) dG = 0.0f;
-	// if (dG > 65535) dG = 65535;
 	if (dB < 0.0f) dB = 0.0f;
-	// if (dB > 65535) dB = 65535;
 
 	return sRGBFloat(dR, dG, dB);
 }
@@ -406,44 +368,31 @@ CVector3 cTexture::NormalMap(
 sRGBFloat cTexture::MipMap(float x, float y, float pixelSize) const
 {
 	pixelSize /= float(max(width, height));
-	if (mipmaps.size() > 0 && pixelSize > 0)
+	const int numberOfMipmaps = tiles->NumberOfLevels() - 1;
+	if (numberOfMipmaps > 0 && pixelSize > 0)
 	{
 		if (pixelSize < 1e-20f) pixelSize = 1e-20f;
-		float dMipLayer = -log(pixelSize) / log(2.0f);
+		float dMipLayer = -log2f(pixelSize);
 		if (dMipLayer < 0) dMipLayer = 0;
-		if (dMipLayer + 1 >= mipmaps.size() - 1) dMipLayer = mipmaps.size() - 1;
+		if (dMipLayer + 1 >= numberOfMipmaps - 1) dMipLayer = numberOfMipmaps - 1;
 
 		const int layerBig = int(dMipLayer);
 		const int layerSmall = int(dMipLayer + 1);
-		const float sizeMultipleBig = pow(2.0f, float(layerBig));
-		const float sizeMultipleSmall = pow(2.0f, float(layerSmall));
 		const float trans = dMipLayer - layerBig;
 		const float transN = 1.0f - trans;
 
-		const sRGBFloat *bigBitmap, *smallBitmap;
-		CVector2<int> bigBitmapSize, smallBitmapSize;
-		if (layerBig >= 0 && layerBig <= mipmaps.length() && layerSmall >= 0
-				&& layerSmall <= mipmaps.length())
+		if (layerBig >= 0 && layerSmall <= numberOfMipmaps)
 		{
-			if (layerBig == 0)
-			{
-				bigBitmap = bitmapFloat.data();
-				smallBitmap = mipmaps[layerSmall - 1].data();
-				bigBitmapSize.x = width;
-				bigBitmapSize.y = height;
-				smallBitmapSize = mipmapSizes[layerSmall - 1];
-			}
-			else
-			{
-				bigBitmap = mipmaps[layerBig - 1].data();
-				smallBitmap = mipmaps[layerSmall - 1].data();
-				bigBitmapSize = mipmapSizes[layerBig - 1];
-				smallBitmapSize = mipmapSizes[layerSmall - 1];
-			}
-			const sRGBFloat pixelFromBig = BicubicInterpolation(
-				x / sizeMultipleBig, y / sizeMultipleBig, bigBitmap, bigBitmapSize.x, bigBitmapSize.y);
-			const sRGBFloat pixelFromSmall = BicubicInterpolation(x / sizeMultipleSmall,
-				y / sizeMultipleSmall, smallBitmap, smallBitmapSize.x, smallBitmapSize.y);
+			const float sizeMultipleBig = ldexpf(1.0f, layerBig);
+			const sRGBFloat pixelFromBig =
+				BicubicInterpolation(x / sizeMultipleBig, y / sizeMultipleBig, layerBig);
+
+			// at integer layer (e.g. clamped to the first or last one) the smaller layer has no weight
+			if (trans == 0.0f) return pixelFromBig;
+
+			const float sizeMultipleSmall = ldexpf(1.0f, layerSmall);
+			const sRGBFloat pixelFromSmall =
+				BicubicInterpolation(x / sizeMultipleSmall, y / sizeMultipleSmall, layerSmall);
 
 			sRGBFloat pixel;
 			pixel.R = float(pixelFromSmall.R * trans + pixelFromBig.R * transN);
@@ -458,86 +407,47 @@ sRGBFloat cTexture::MipMap(float x, float y, float pixelSize) const
 	}
 	else
 	{
-		return BicubicInterpolation(x, y, bitmapFloat.data(), width, height);
-	}
-}
-
-void cTexture::CreateMipMaps()
-{
-	int prevW = width;
-	int prevH = height;
-	int w = width / 2;
-	int h = height / 2;
-	sRGBFloat *prevBitmap = bitmapFloat.data();
-	while (w > 0 && h > 0)
-	{
-		QVector<sRGBFloat> newMipmapV(w * h);
-		sRGBFloat *newMipmap = newMipmapV.data();
-
-		for (int y = 0; y < h; y++)
-		{
-			for (int x = 0; x < w; x++)
-			{
-				sRGBFloat newPixel;
-				const sRGBFloat p1 = prevBitmap[WrapInt(x * 2, prevW) + WrapInt(y * 2, prevH) * prevW];
-				const sRGBFloat p2 = prevBitmap[WrapInt(x * 2 + 1, prevW) + WrapInt(y * 2, prevH) * prevW];
-				const sRGBFloat p3 = prevBitmap[WrapInt(x * 2, prevW) + WrapInt(y * 2 + 1, prevH) * prevW];
-				const sRGBFloat p4 =
-					prevBitmap[WrapInt(x * 2 + 1, prevW) + WrapInt(y * 2 + 1, prevH) * prevW];
-				newPixel.R = (p1.R + p2.R + p3.R + p4.R) / 4.0f;
-				newPixel.G = (p1.G + p2.G + p3.G + p4.G) / 4.0f;
-				newPixel.B = (p1.B + p2.B + p3.B + p4.B) / 4.0f;
-				newMipmap[x + y * w] = newPixel;
-			}
-		}
-		mipmapSizes.append(CVector2<int>(w, h));
-		mipmaps.append(newMipmapV);
-		prevH = h;
-		prevW = w;
-		w /= 2;
-		h /= 2;
-		prevBitmap = mipmaps.last().data();
+		return BicubicInterpolation(x, y, 0);
 	}
 }
 
 size_t cTexture::GetMemorySize() const
 {
-	size_t totalSize = bitmapFloat.size() * sizeof(sRGBFloat);
-	for (const auto &mipmap : mipmaps)
-	{
-		totalSize += mipmap.size() * sizeof(sRGBFloat);
-	}
-	return totalSize;
+	return tiles->GetMemorySize();
 }
 
-void cTexture::ComputeHDRBItmap()
+std::vector<sRGBA8> cTexture::GetHDRBitmap() const
 {
-	bitmapHDR.resize(bitmapFloat.size());
+	std::vector<sRGBA8> bitmapHDR(size_t(width) * height);
 
-	for (size_t i = 0; i < bitmapFloat.size(); i++)
+	for (int y = 0; y < height; y++)
 	{
-		sRGBA8 pixel8;
-
-		sRGBFloat pixel = bitmapFloat[i];
-		// hdre color compression
-		float v = pixel.R; // max rgb value
-		if (v < pixel.G) v = pixel.G;
-		if (v < pixel.B) v = pixel.B;
-		if (v < 1e-32f)
-		{
-			pixel8 = sRGBA8(0, 0, 0, 0);
-		}
-		else
+		for (int x = 0; x < width; x++)
 		{
-			int exponent;
-			int value = frexpf(v, &exponent) * 256.0f / v;
-			uchar r = uchar(value * pixel.R);
-			uchar g = uchar(value * pixel.G);
-			uchar b = uchar(value * pixel.B);
-			uchar e = uchar(exponent + 128);
-
-			pixel8 = sRGBA8(r, g, b, e);
+			sRGBA8 pixel8;
+
+			sRGBFloat pixel = FastPixel(x, y);
+			// hdre color compression
+			float v = pixel.R; // max rgb value
+			if (v < pixel.G) v = pixel.G;
+			if (v < pixel.B) v = pixel.B;
+			if (v < 1e-32f)
+			{
+				pixel8 = sRGBA8(0, 0, 0, 0);
+			}
+			else
+			{
+				int exponent;
+				int value = frexpf(v, &exponent) * 256.0f / v;
+				uchar r = uchar(value * pixel.R);
+				uchar g = uchar(value * pixel.G);
+				uchar b = uchar(value * pixel.B);
+				uchar e = uchar(exponent + 128);
+
+				pixel8 = sRGBA8(r, g, b, e);
+			}
+			bitmapHDR[x + size_t(y) * width] = pixel8;
 		}
-		bitmapHDR[i] = pixel8;
 	}
+	return bitmapHDR;
 }
@@ -31,26 +31,28 @@
  *
  * cTexture class - simple bitmap container with pixel interpolation
  *
- * This class holds an sRGB8 *bitmap to store texture information. The class
+ * This class holds a shared cTextureTiles object to store texture information. The class
  * can be initialized by loading an image file, or by loading a QByteArray (network).
  * Pixel(...) gets the pixel at a given point. The image data is MipMap-ped and
- * bicubic interpolated to give a "smooth" result.
+ * bicubic interpolated to give a "smooth" result. Copying of cTexture is cheap, because
+ * tiles are shared between all copies.
  * more information on Mipmaps:  https://en.wikipedia.org/wiki/Mipmap
  */
 
 #ifndef MANDELBULBER2_SRC_TEXTURE_HPP_
 #define MANDELBULBER2_SRC_TEXTURE_HPP_
 
+#include <memory>
 #include <vector>
 
 #include <QByteArray>
-#include <QList>
 #include <QString>
-#include <QVector>
-#include <QCache>
 
 #include "algebra.hpp"
 #include "color_structures.hpp"
+#include "texture_tiles.hpp"
+
+class QImage;
 
 class cTexture
 {
@@ -63,17 +65,17 @@ public:
 
 	cTexture(QString filename, enumUseMipmaps mode, int frameNo, bool beQuiet, bool useNetRender);
 	cTexture();
-	cTexture(const cTexture &tex);
-	cTexture &operator=(const cTexture &tex);
-	cTexture &operator=(cTexture &&tex);
-	cTexture(cTexture &&other);
+	cTexture(const cTexture &tex) = default;
+	cTexture &operator=(const cTexture &tex) = default;
+	cTexture &operator=(cTexture &&tex) = default;
+	cTexture(cTexture &&other) = default;
 
 	~cTexture() = default;
 	int Height() const { return height; }
 	int Width() const { return width; }
 	sRGBFloat Pixel(float x, float y, float pixelSize = 0.0) const;
 	sRGBFloat Pixel(CVector2<float> point, float pixelSize = 0.0) const;
-	inline sRGBFloat FastPixel(int x, int y) const { return bitmapFloat[x + y * width]; }
+	inline sRGBFloat FastPixel(int x, int y) const { return tiles->Texel(0, x, y); }
 	bool IsLoaded() const { return loaded; }
 	QString GetFileName() const { return originalFileName; }
 	void FromQByteArray(QByteArray *buffer, enumUseMipmaps mode);
@@ -81,25 +83,23 @@ public:
 	CVector3 NormalMap(
 		CVector2<float> point, float bump, bool invertGreen, float pixelSize = 0.0) const;
 	size_t GetMemorySize() const;
-	const std::vector<sRGBA8> &GetHDRBitmap() const { return bitmapHDR; }
+	std::vector<sRGBA8> GetHDRBitmap() const;
 
 private:
-	sRGBFloat LinearInterpolation(float x, float y) const;
-	static sRGBFloat BicubicInterpolation(float x, float y, const sRGBFloat *_bitmap, int w, int h);
+	sRGBFloat BicubicInterpolation(float x, float y, int level) const;
 	sRGBFloat MipMap(float x, float y, float pixelSize) const;
-	void CreateMipMaps();
-	static int WrapInt(int a, int size) { return (a + size) % size; }
-	void ComputeHDRBItmap();
-	std::vector<sRGBFloat> bitmapFloat;
-	std::vector<sRGBA8> bitmapHDR;
+	std::shared_ptr<cTextureTiles> TilesFromQImage(const QImage &qImage, bool withMipmaps);
+	void StoreBitmapInTiles(const sRGBFloat *bitmapFloat, cTextureTiles *newTiles) const;
+	void CreateDefaultTiles();
+	static int WrapInt(int a, int size) { return (a % size + size) % size; }
+	std::shared_ptr<const cTextureTiles> tiles;
 	int width;
 	int height;
 	bool loaded;
 	QString originalFileName;
-	QList<QVector<sRGBFloat>> mipmaps;
-	QList<CVector2<int>> mipmapSizes;
 
 	static const int defaultSize = 5;
+	static const int diskCacheMinimumPixels = 1024 * 1024;
 };
 
 #endif /* MANDELBULBER2_SRC_TEXTURE_HPP_ */
@@ -12,6 +12,7 @@ std::shared_ptr<cTextureCache> gTextureCache;
 
 cTextureCache::cTextureCache()
 {
+	diskCacheEnabled = true;
 
 	cache.setMaxCost(4096 * 1024);
 }
@@ -11,6 +11,7 @@
 #include <QCache>
 #include <QMutex>
 #include <QString>
+#include <atomic>
 #include <memory>
 
 class cTexture;
@@ -22,11 +23,17 @@ public:
 	~cTextureCache();
 
 	void setMaxSize(size_t _maxSize);
+	void setDiskCacheEnabled(bool enabled) { diskCacheEnabled = enabled; }
+	bool IsDiskCacheEnabled() const { return diskCacheEnabled; }
 	void AddToCache(cTexture *tex);
 	cTexture *GetTexture(const QString &requestedFileName);
 
+	// cached textures share their tiles with all copies, so the cache holds only light handles
 	QCache<QString, cTexture> cache;
 	QMutex mutex;
+
+private:
+	std::atomic<bool> diskCacheEnabled;
 };
 
 extern std::shared_ptr<cTextureCache> gTextureCache;
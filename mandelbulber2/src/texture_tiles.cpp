@@ -0,0 +1,378 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2021 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTextureTiles class - immutable, tiled storage of texture pixels and all mip levels
+ */
+
+#include "texture_tiles.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "system_directories.hpp"
+#include "write_log.hpp"
+
+struct sTextureTilesHeader
+{
+	char magic[4];
+	quint32 version;
+	quint32 format;
+	quint32 withMipmaps;
+	quint32 width;
+	quint32 height;
+};
+
+static const char textureTilesMagic[4] = {'M', 'B', 'T', 'X'};
+static const quint32 textureTilesVersion = 2;
+
+const std::vector<float> cTextureTiles::halfToFloatTable = cTextureTiles::CreateHalfToFloatTable();
+
+cTextureTiles::~cTextureTiles() = default;
+
+std::shared_ptr<const cTextureTiles> cTextureTiles::Create(const sRGBFloat *bitmap, int width,
+	int height, enumTileFormat format, bool withMipmaps, const QString &diskCacheFile)
+{
+	std::shared_ptr<cTextureTiles> tiles = BeginCreate(width, height, format, withMipmaps);
+
+#pragma omp parallel for
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			tiles->StoreBaseTexel(x, y, bitmap[x + size_t(y) * width]);
+		}
+	}
+
+	return FinishCreate(tiles, diskCacheFile);
+}
+
+std::shared_ptr<cTextureTiles> cTextureTiles::BeginCreate(
+	int width, int height, enumTileFormat format, bool withMipmaps)
+{
+	std::shared_ptr<cTextureTiles> tiles(new cTextureTiles);
+	tiles->PrepareLayout(width, height, format, withMipmaps);
+	tiles->ownedData.resize(tiles->dataSize, 0);
+	tiles->data = tiles->ownedData.data();
+	return tiles;
+}
+
+std::shared_ptr<const cTextureTiles> cTextureTiles::FinishCreate(
+	std::shared_ptr<cTextureTiles> tiles, const QString &diskCacheFile)
+{
+	uchar *dataToWrite = tiles->ownedData.data();
+
+	// every mip level is computed from previous one
+	for (int level = 1; level < tiles->NumberOfLevels(); level++)
+	{
+		const int prevW = tiles->levels[level - 1].width;
+		const int prevH = tiles->levels[level - 1].height;
+		const int w = tiles->levels[level].width;
+		const int h = tiles->levels[level].height;
+
+#pragma omp parallel for
+		for (int y = 0; y < h; y++)
+		{
+			const int y1 = (y * 2) % prevH;
+			const int y2 = (y * 2 + 1) % prevH;
+			for (int x = 0; x < w; x++)
+			{
+				const int x1 = (x * 2) % prevW;
+				const int x2 = (x * 2 + 1) % prevW;
+				const sRGBFloat p1 = tiles->Texel(level - 1, x1, y1);
+				const sRGBFloat p2 = tiles->Texel(level - 1, x2, y1);
+				const sRGBFloat p3 = tiles->Texel(level - 1, x1, y2);
+				const sRGBFloat p4 = tiles->Texel(level - 1, x2, y2);
+				sRGBFloat newPixel;
+				newPixel.R = (p1.R + p2.R + p3.R + p4.R) / 4.0f;
+				newPixel.G = (p1.G + p2.G + p3.G + p4.G) / 4.0f;
+				newPixel.B = (p1.B + p2.B + p3.B + p4.B) / 4.0f;
+				tiles->StoreTexel(level, x, y, newPixel, dataToWrite);
+			}
+		}
+	}
+
+	if (!diskCacheFile.isEmpty() && tiles->WriteDiskCache(diskCacheFile))
+	{
+		EvictDiskCache();
+		std::shared_ptr<const cTextureTiles> mappedTiles = LoadFromDiskCache(diskCacheFile);
+		if (mappedTiles) return mappedTiles;
+	}
+
+	return tiles;
+}
+
+std::shared_ptr<const cTextureTiles> cTextureTiles::LoadFromDiskCache(const QString &diskCacheFile)
+{
+	std::unique_ptr<QFile> file(new QFile(diskCacheFile));
+	if (!file->open(QIODevice::ReadOnly)) return nullptr;
+
+	sTextureTilesHeader header;
+	if (file->read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header))
+		return nullptr;
+
+	if (memcmp(header.magic, textureTilesMagic, sizeof(textureTilesMagic)) != 0
+			|| header.version != textureTilesVersion || header.format > formatHalfFloat
+			|| header.width == 0 || header.height == 0)
+	{
+		WriteLogString("cTextureTiles: invalid texture cache file", diskCacheFile, 1);
+		return nullptr;
+	}
+
+	std::shared_ptr<cTextureTiles> tiles(new cTextureTiles);
+	tiles->PrepareLayout(
+		int(header.width), int(header.height), enumTileFormat(header.format), header.withMipmaps);
+
+	const qint64 expectedSize = qint64(tiles->HeaderSize() + tiles->dataSize);
+	if (file->size() != expectedSize)
+	{
+		WriteLogString("cTextureTiles: wrong size of texture cache file", diskCacheFile, 1);
+		return nullptr;
+	}
+
+	uchar *mappedData = file->map(0, expectedSize);
+	if (!mappedData)
+	{
+		WriteLogString("cTextureTiles: cannot map texture cache file", diskCacheFile, 1);
+		return nullptr;
+	}
+
+	tiles->data = mappedData + tiles->HeaderSize();
+	tiles->mappedFile = std::move(file);
+
+	// mark file as recently used (for eviction of old files)
+	tiles->mappedFile->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+	WriteLogString("cTextureTiles: texture mapped from disk cache", diskCacheFile, 2);
+	return tiles;
+}
+
+QString cTextureTiles::DiskCacheFileName(const QString &textureFile, bool withMipmaps)
+{
+	QFileInfo fileInfo(textureFile);
+	if (!fileInfo.exists()) return QString();
+
+	// file modification time and size are part of the key, so cache is never stale
+	QCryptographicHash hashCrypt(QCryptographicHash::Sha1);
+	hashCrypt.addData(fileInfo.absoluteFilePath().toUtf8());
+	hashCrypt.addData(QByteArray::number(fileInfo.size()));
+	hashCrypt.addData(QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch()));
+	hashCrypt.addData(QByteArray::number(int(withMipmaps)));
+	hashCrypt.addData(QByteArray::number(textureTilesVersion));
+
+	return systemDirectories.GetTextureCacheFolder() + QDir::separator()
+				 + hashCrypt.result().toHex() + ".tiles";
+}
+
+void cTextureTiles::PrepareLayout(int width, int height, enumTileFormat _format, bool withMipmaps)
+{
+	format = _format;
+	bytesPerTexel = (format == format8bit) ? 3 : 6;
+
+	const size_t tileBytes = size_t(tileSize) * tileSize * size_t(bytesPerTexel);
+
+	levels.clear();
+	dataSize = 0;
+	int w = width;
+	int h = height;
+	while (w > 0 && h > 0)
+	{
+		sLevel level;
+		level.width = w;
+		level.height = h;
+		level.tilesX = (w + tileMask) >> tileShift;
+		level.tilesY = (h + tileMask) >> tileShift;
+		level.offset = dataSize;
+		levels.push_back(level);
+		dataSize += size_t(level.tilesX) * size_t(level.tilesY) * tileBytes;
+
+		if (!withMipmaps) break;
+		w /= 2;
+		h /= 2;
+	}
+}
+
+void cTextureTiles::StoreTexel(
+	int level, int x, int y, const sRGBFloat &pixel, uchar *dataToWrite) const
+{
+	const sLevel &lev = levels[level];
+	const size_t tileIndex = size_t(y >> tileShift) * size_t(lev.tilesX) + size_t(x >> tileShift);
+	const size_t texelIndex =
+		(tileIndex << (2 * tileShift)) + size_t(((y & tileMask) << tileShift) + (x & tileMask));
+	uchar *ptr = dataToWrite + lev.offset + texelIndex * size_t(bytesPerTexel);
+
+	switch (format)
+	{
+		case format8bit:
+		{
+			ptr[0] = uchar(qBound(0, int(pixel.R * 255.0f + 0.5f), 255));
+			ptr[1] = uchar(qBound(0, int(pixel.G * 255.0f + 0.5f), 255));
+			ptr[2] = uchar(qBound(0, int(pixel.B * 255.0f + 0.5f), 255));
+			break;
+		}
+		case format16bit:
+		{
+			quint16 *ptr16 = reinterpret_cast<quint16 *>(ptr);
+			ptr16[0] = quint16(qBound(0, int(pixel.R * 65535.0f + 0.5f), 65535));
+			ptr16[1] = quint16(qBound(0, int(pixel.G * 65535.0f + 0.5f), 65535));
+			ptr16[2] = quint16(qBound(0, int(pixel.B * 65535.0f + 0.5f), 65535));
+			break;
+		}
+		case formatHalfFloat:
+		{
+			quint16 *ptr16 = reinterpret_cast<quint16 *>(ptr);
+			ptr16[0] = FloatToHalf(pixel.R);
+			ptr16[1] = FloatToHalf(pixel.G);
+			ptr16[2] = FloatToHalf(pixel.B);
+			break;
+		}
+	}
+}
+
+size_t cTextureTiles::HeaderSize() const
+{
+	// header is padded to keep tiles aligned to cache lines in mapped file
+	return 64;
+}
+
+bool cTextureTiles::WriteDiskCache(const QString &diskCacheFile) const
+{
+	// QSaveFile writes to temporary file and renames it, so other processes never see partial file
+	QSaveFile file(diskCacheFile);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		WriteLogString("cTextureTiles: cannot create texture cache file", diskCacheFile, 1);
+		return false;
+	}
+
+	QByteArray headerBuffer(int(HeaderSize()), 0);
+	sTextureTilesHeader *header = reinterpret_cast<sTextureTilesHeader *>(headerBuffer.data());
+	memcpy(header->magic, textureTilesMagic, sizeof(textureTilesMagic));
+	header->version = textureTilesVersion;
+	header->format = quint32(format);
+	header->withMipmaps = quint32(levels.size() > 1);
+	header->width = quint32(levels[0].width);
+	header->height = quint32(levels[0].height);
+	file.write(headerBuffer);
+
+	const char *dataToWrite = reinterpret_cast<const char *>(data);
+	const size_t chunkSize = 64 * 1024 * 1024;
+	for (size_t offset = 0; offset < dataSize; offset += chunkSize)
+	{
+		const qint64 length = qint64(std::min(chunkSize, dataSize - offset));
+		if (file.write(dataToWrite + offset, length) != length)
+		{
+			WriteLogString("cTextureTiles: cannot write texture cache file", diskCacheFile, 1);
+			file.cancelWriting();
+			return false;
+		}
+	}
+
+	return file.commit();
+}
+
+void cTextureTiles::EvictDiskCache()
+{
+	// keep total size of cached textures under the limit, removing least recently used first.
+	// The newest file was just written, so it is always kept
+	const qint64 maxCacheSize = 4LL * 1024 * 1024 * 1024;
+
+	QDir dir(systemDirectories.GetTextureCacheFolder());
+	QFileInfoList files = dir.entryInfoList(QStringList("*.tiles"), QDir::Files, QDir::Time);
+
+	qint64 totalSize = 0;
+	for (int i = 0; i < files.size(); i++)
+	{
+		totalSize += files[i].size();
+		if (i > 0 && totalSize > maxCacheSize)
+		{
+			WriteLogString("cTextureTiles: old texture removed from cache", files[i].fileName(), 2);
+			QFile::remove(files[i].absoluteFilePath());
+		}
+	}
+}
+
+quint16 cTextureTiles::FloatToHalf(float value)
+{
+	quint32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const quint32 sign = (bits >> 16) & 0x8000;
+	const int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+	quint32 mantissa = bits & 0x7fffff;
+
+	if (exponent <= 0)
+	{
+		// denormalized half or zero
+		if (exponent < -10) return quint16(sign);
+		mantissa = (mantissa | 0x800000) >> (1 - exponent);
+		return quint16(sign | ((mantissa + 0x1000) >> 13));
+	}
+	else if (exponent >= 31)
+	{
+		// NaN stays NaN, infinity and too big numbers are clamped to maximum half value
+		if (((bits >> 23) & 0xff) == 0xff && mantissa != 0) return quint16(sign | 0x7e00);
+		return quint16(sign | 0x7bff);
+	}
+	else
+	{
+		quint32 half = sign | (quint32(exponent) << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000) half++; // rounding can carry to exponent and it is still correct
+		if ((half & 0x7fff) >= 0x7c00) half = sign | 0x7bff;
+		return quint16(half);
+	}
+}
+
+std::vector<float> cTextureTiles::CreateHalfToFloatTable()
+{
+	std::vector<float> table(65536);
+	for (int i = 0; i < 65536; i++)
+	{
+		const int exponent = (i >> 10) & 0x1f;
+		const int mantissa = i & 0x3ff;
+		float value;
+		if (exponent == 0)
+			value = ldexpf(float(mantissa), -24);
+		else if (exponent == 31)
+			value = (mantissa != 0) ? std::numeric_limits<float>::quiet_NaN()
+															: std::numeric_limits<float>::infinity();
+		else
+			value = ldexpf(float(mantissa + 1024), exponent - 25);
+
+		table[i] = (i & 0x8000) ? -value : value;
+	}
+	return table;
+}
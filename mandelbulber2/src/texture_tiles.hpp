@@ -0,0 +1,153 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2021 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTextureTiles class - immutable, tiled storage of texture pixels and all mip levels
+ *
+ * Pixels are stored in 64x64 tiles with 8-bit, 16-bit or half-float channels, so a 16K texture
+ * takes a fraction of the memory of a full float bitmap. Converted textures are written to
+ * a disk cache and memory-mapped, so the operating system page cache holds only the tiles which
+ * are really sampled. The object is never modified after creation, so one instance is shared
+ * (through std::shared_ptr) by all cTexture copies, materials and render threads without locks.
+ */
+
+#ifndef MANDELBULBER2_SRC_TEXTURE_TILES_HPP_
+#define MANDELBULBER2_SRC_TEXTURE_TILES_HPP_
+
+#include <memory>
+#include <vector>
+
+#include <QFile>
+#include <QString>
+
+#include "color_structures.hpp"
+
+class cTextureTiles
+{
+public:
+	enum enumTileFormat
+	{
+		format8bit = 0,
+		format16bit = 1,
+		formatHalfFloat = 2
+	};
+
+	static const int tileShift = 6;
+	static const int tileSize = 1 << tileShift;
+	static const int tileMask = tileSize - 1;
+
+	// creates tiles from float bitmap. If diskCacheFile is not empty, tiles are stored in this
+	// file and memory-mapped
+	static std::shared_ptr<const cTextureTiles> Create(const sRGBFloat *bitmap, int width,
+		int height, enumTileFormat format, bool withMipmaps, const QString &diskCacheFile = QString());
+
+	// incremental creation, used while decoding image files: BeginCreate() allocates all levels,
+	// StoreBaseTexel() fills level 0 and FinishCreate() computes mip levels and writes the disk cache
+	static std::shared_ptr<cTextureTiles> BeginCreate(
+		int width, int height, enumTileFormat format, bool withMipmaps);
+	void StoreBaseTexel(int x, int y, const sRGBFloat &pixel)
+	{
+		StoreTexel(0, x, y, pixel, ownedData.data());
+	}
+	static std::shared_ptr<const cTextureTiles> FinishCreate(
+		std::shared_ptr<cTextureTiles> tiles, const QString &diskCacheFile = QString());
+
+	// maps previously converted texture. Returns nullptr if file doesn't exist or is not valid
+	static std::shared_ptr<const cTextureTiles> LoadFromDiskCache(const QString &diskCacheFile);
+
+	// name of the disk cache file for given texture file
+	static QString DiskCacheFileName(const QString &textureFile, bool withMipmaps);
+
+	~cTextureTiles();
+
+	int NumberOfLevels() const { return int(levels.size()); }
+	int Width(int level = 0) const { return levels[level].width; }
+	int Height(int level = 0) const { return levels[level].height; }
+	bool IsMemoryMapped() const { return mappedFile != nullptr; }
+	size_t GetMemorySize() const { return dataSize; }
+
+	// pixel from given mip level. Coordinates have to be already wrapped to level size
+	inline sRGBFloat Texel(int level, int x, int y) const
+	{
+		const sLevel &lev = levels[level];
+		const size_t tileIndex = size_t(y >> tileShift) * size_t(lev.tilesX) + size_t(x >> tileShift);
+		const size_t texelIndex =
+			(tileIndex << (2 * tileShift)) + size_t(((y & tileMask) << tileShift) + (x & tileMask));
+		const uchar *ptr = data + lev.offset + texelIndex * size_t(bytesPerTexel);
+
+		switch (format)
+		{
+			case format8bit: return sRGBFloat(ptr[0] / 255.0f, ptr[1] / 255.0f, ptr[2] / 255.0f);
+			case format16bit:
+			{
+				const quint16 *ptr16 = reinterpret_cast<const quint16 *>(ptr);
+				return sRGBFloat(ptr16[0] / 65535.0f, ptr16[1] / 65535.0f, ptr16[2] / 65535.0f);
+			}
+			case formatHalfFloat:
+			{
+				const quint16 *ptr16 = reinterpret_cast<const quint16 *>(ptr);
+				return sRGBFloat(HalfToFloat(ptr16[0]), HalfToFloat(ptr16[1]), HalfToFloat(ptr16[2]));
+			}
+		}
+		return sRGBFloat();
+	}
+
+	static quint16 FloatToHalf(float value);
+	static inline float HalfToFloat(quint16 value) { return halfToFloatTable[value]; }
+
+private:
+	struct sLevel
+	{
+		int width;
+		int height;
+		int tilesX;
+		int tilesY;
+		size_t offset;
+	};
+
+	cTextureTiles() = default;
+	void PrepareLayout(int width, int height, enumTileFormat _format, bool withMipmaps);
+	void StoreTexel(int level, int x, int y, const sRGBFloat &pixel, uchar *dataToWrite) const;
+	size_t HeaderSize() const;
+	bool WriteDiskCache(const QString &diskCacheFile) const;
+	static void EvictDiskCache();
+
+	static std::vector<float> CreateHalfToFloatTable();
+	static const std::vector<float> halfToFloatTable;
+
+	std::vector<sLevel> levels;
+	enumTileFormat format = format8bit;
+	int bytesPerTexel = 3;
+	size_t dataSize = 0;
+	std::vector<uchar> ownedData;
+	std::unique_ptr<QFile> mappedFile;
+	const uchar *data = nullptr;
+};
+
+#endif /* MANDELBULBER2_SRC_TEXTURE_TILES_HPP_ */
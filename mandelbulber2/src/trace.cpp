@@ -0,0 +1,187 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTrace - collects timing spans of main render phases and exports them in Chrome
+ * trace event format (chrome://tracing, ui.perfetto.dev)
+ */
+
+#include "trace.hpp"
+
+#include <cstdlib>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+
+#include "system_data.hpp"
+#include "write_log.hpp"
+
+std::atomic<bool> cTrace::enabled(false);
+
+namespace
+{
+struct sTraceSpan
+{
+	const char *name;
+	const char *category;
+	qint64 startNs;
+	qint64 endNs;
+	int threadId;
+};
+
+struct sTraceData
+{
+	QMutex mutex;
+	QString fileName;
+	QVector<sTraceSpan> spans;
+	QMap<Qt::HANDLE, int> threadIds;
+	QVector<QString> threadNames;
+	bool exportRegistered = false;
+};
+
+sTraceData &TraceData()
+{
+	static sTraceData data;
+	return data;
+}
+
+void ExportAtExit()
+{
+	// runs before destruction of TraceData() and before WriteLogShutdown(), because both were
+	// created / registered earlier. Covers also runs finished by exit()
+	if (cTrace::IsEnabled()) cTrace::Export();
+}
+} // namespace
+
+void cTrace::Enable(const QString &fileName)
+{
+	sTraceData &data = TraceData();
+	QMutexLocker lock(&data.mutex);
+	data.fileName = fileName;
+	enabled.store(true);
+	WriteLogString("Render phase trace enabled", fileName, 2);
+	if (!data.exportRegistered)
+	{
+		data.exportRegistered = true;
+		atexit(ExportAtExit);
+	}
+}
+
+qint64 cTrace::Now()
+{
+	return systemData.globalTimer.nsecsElapsed();
+}
+
+void cTrace::AddSpan(const char *name, const char *category, qint64 startNs, qint64 endNs)
+{
+	if (!IsEnabled()) return;
+
+	sTraceData &data = TraceData();
+	const Qt::HANDLE threadHandle = QThread::currentThreadId();
+
+	QMutexLocker lock(&data.mutex);
+	int threadId = data.threadIds.value(threadHandle, -1);
+	if (threadId >= 0)
+	{
+		// thread handles are reused by new worker threads
+		const QString threadName = QThread::currentThread()->objectName();
+		if (!threadName.isEmpty()) data.threadNames[threadId] = threadName;
+	}
+	else
+	{
+		threadId = data.threadNames.size();
+		data.threadIds.insert(threadHandle, threadId);
+		QString threadName = QThread::currentThread()->objectName();
+		if (threadName.isEmpty())
+		{
+			QCoreApplication *application = QCoreApplication::instance();
+			const bool isMainThread =
+				application && QThread::currentThread() == application->thread();
+			threadName = isMainThread ? QString("main") : QString("thread %1").arg(threadId);
+		}
+		data.threadNames.append(threadName);
+	}
+	data.spans.append(sTraceSpan{name, category, startNs, endNs, threadId});
+}
+
+bool cTrace::Export()
+{
+	sTraceData &data = TraceData();
+	QMutexLocker lock(&data.mutex);
+	if (data.fileName.isEmpty()) return false;
+
+	const qint64 pid = QCoreApplication::applicationPid();
+	QJsonArray events;
+
+	for (int i = 0; i < data.threadNames.size(); i++)
+	{
+		QJsonObject event;
+		event["name"] = "thread_name";
+		event["ph"] = "M";
+		event["pid"] = pid;
+		event["tid"] = i;
+		event["args"] = QJsonObject{{"name", data.threadNames[i]}};
+		events.append(event);
+	}
+
+	for (const sTraceSpan &span : data.spans)
+	{
+		QJsonObject event;
+		event["name"] = span.name;
+		event["cat"] = span.category;
+		event["ph"] = "X";
+		event["ts"] = span.startNs / 1000.0;
+		event["dur"] = (span.endNs - span.startNs) / 1000.0;
+		event["pid"] = pid;
+		event["tid"] = span.threadId;
+		events.append(event);
+	}
+
+	QJsonObject root;
+	root["traceEvents"] = events;
+	root["displayTimeUnit"] = "ms";
+
+	QSaveFile file(data.fileName);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		qCritical() << "Cannot write trace file" << data.fileName;
+		return false;
+	}
+	file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+	return file.commit();
+}
@@ -0,0 +1,81 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2020 Mandelbulber Team        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTrace - collects timing spans of main render phases and exports them in Chrome
+ * trace event format (chrome://tracing, ui.perfetto.dev)
+ */
+
+#ifndef MANDELBULBER2_SRC_TRACE_HPP_
+#define MANDELBULBER2_SRC_TRACE_HPP_
+
+#include <atomic>
+
+#include <QString>
+
+class cTrace
+{
+public:
+	// starts collecting of spans. Trace is written to the file at Export() or at exit
+	static void Enable(const QString &fileName);
+	static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+	static qint64 Now();
+	static void AddSpan(const char *name, const char *category, qint64 startNs, qint64 endNs);
+	static bool Export();
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+// adds span from construction to destruction (or Finish()) of the object
+class cScopedTrace
+{
+public:
+	explicit cScopedTrace(const char *_name, const char *_category = "render")
+			: name(_name), category(_category), startNs(cTrace::IsEnabled() ? cTrace::Now() : -1)
+	{
+	}
+	~cScopedTrace() { Finish(); }
+	cScopedTrace(const cScopedTrace &) = delete;
+	cScopedTrace &operator=(const cScopedTrace &) = delete;
+
+	void Finish()
+	{
+		if (startNs >= 0) cTrace::AddSpan(name, category, startNs, cTrace::Now());
+		startNs = -1;
+	}
+
+private:
+	const char *name;
+	const char *category;
+	qint64 startNs;
+};
+
+#endif /* MANDELBULBER2_SRC_TRACE_HPP_ */
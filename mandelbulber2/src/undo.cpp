@@ -36,6 +36,9 @@
  * The buffer is a simple LIFO buffer which holds the parameter entries.
  * (A Store() invocation while Undo-ed in the list will truncate to the current level
  * and append the new entry. The Redo entries will be lost.)
+ * Each entry holds only the parameters which were changed since the previous entry (with values
+ * before and after change). Every state is also written in background to the undo folder, so
+ * the history is available after restarting the application.
  */
 
 #include "undo.h"
@@ -45,6 +48,7 @@
 #include <QTimer>
 
 #include "error_message.hpp"
+#include "fractal_enums.h"
 #include "initparameters.hpp"
 #include "settings.hpp"
 #include "system_directories.hpp"
@@ -77,6 +81,10 @@ cUndo::cUndo(QObject *parent) : QObject(parent)
 	timer = new QTimer(this);
 	timer->setSingleShot(true);
 	connect(timer, &QTimer::timeout, this, &cUndo::slotDelayedStore);
+
+	autosaveTimer = new QTimer(this);
+	autosaveTimer->setSingleShot(true);
+	connect(autosaveTimer, &QTimer::timeout, this, &cUndo::slotAutosave);
 }
 
 cUndo::~cUndo() = default;
@@ -85,35 +93,21 @@ void cUndo::Store(std::shared_ptr<cParameterContainer> par,
 	std::shared_ptr<cFractalContainer> parFractal, std::shared_ptr<cAnimationFrames> frames,
 	std::shared_ptr<cKeyframes> keyframes)
 {
-	// autosave
-	WriteLog("Autosave store started", 2);
-	cSettings parSettings(cSettings::formatCondensedText);
-
-	//useg gloabl variables to always save animations
-	parSettings.CreateText(gPar, gParFractal, gAnimFrames, gKeyframes);
-	parSettings.SaveToFile(systemDirectories.GetAutosaveFile());
-
-	WriteLog("Autosave finished", 2);
-
 	WriteLog("cUndo::Store() started", 2);
-	*tempRecord.mainParams = *par;
-	*tempRecord.fractParams = *parFractal;
-
-	if (frames)
-	{
-		*tempRecord.animationFrames = *frames;
-		tempRecord.hasFrames = true;
-	}
 
-	if (keyframes)
-	{
-		*tempRecord.animationKeyframes = *keyframes;
-		tempRecord.hasKeyframes = true;
-	}
-	tempRecord.isLoaded = true;
+	// containers are implicitly shared, so snapshot doesn't copy any parameter data
+	cSettingsWriter::sSnapshot snapshot =
+		cSettingsWriter::CreateSnapshot(par, parFractal, frames, keyframes);
+	tempSnapshot.par = snapshot.par;
+	tempSnapshot.fractal = snapshot.fractal;
+	if (frames) tempSnapshot.frames = snapshot.frames;
+	if (keyframes) tempSnapshot.keyframes = snapshot.keyframes;
 
 	timer->start(500);
 
+	// autosave is written at most once per second, regardless of number of changes
+	if (!autosaveTimer->isActive()) autosaveTimer->start(1000);
+
 	WriteLog("cUndo::Store() finished", 2);
 }
 
@@ -121,59 +115,35 @@ bool cUndo::Undo(std::shared_ptr<cParameterContainer> par,
 	std::shared_ptr<cFractalContainer> parFractal, std::shared_ptr<cAnimationFrames> frames,
 	std::shared_ptr<cKeyframes> keyframes, bool *refreshFrames, bool *refreshKeyframes)
 {
-	if (level > 1)
+	if (level > 1 && undoBuffer.length() >= level)
 	{
-		sUndoRecord record;
-		if (undoBuffer.length() >= level)
+		const sUndoRecord &currentRecord = undoBuffer.at(level - 1);
+		if (currentRecord.hasChanges && baseline.par)
 		{
-			level--;
-			fileIndex = (fileIndex - 1 + 100) % 100;
-			record = undoBuffer.at(level - 1);
-
-			if (!record.isLoaded)
-			{
-				// if record in not in memory then load from settings stored in undo folder
-				QString undoFilename = systemDirectories.GetUndoFolder() + QDir::separator()
-															 + QString("undo_%1.fract").arg(fileIndex, 2, 10, QChar('0'));
-
-				if (QFile::exists(undoFilename))
-				{
-					*record.mainParams = *par;
-					*record.fractParams = *parFractal;
-					cSettings parSettings(cSettings::formatCondensedText);
-					parSettings.LoadFromFile(undoFilename);
-					if (parSettings.Decode(record.mainParams, record.fractParams, record.animationFrames,
-								record.animationKeyframes))
-					{
-						record.isLoaded = true;
-						undoBuffer[level - 1] = record;
-					}
-				}
-				else
-				{
-					cErrorMessage::showMessage(
-						QObject::tr("Missing undo data in disk cache"), cErrorMessage::warningMessage);
-					return false;
-				}
-			}
-
-			if (record.isLoaded)
+			*par = *baseline.par;
+			*parFractal = *baseline.fractal;
+			ApplyChanges(currentRecord.changes, false, par, parFractal);
+		}
+		else
+		{
+			int previousFileIndex = (fileIndex - 2 + 100) % 100;
+			if (!undoBuffer.at(level - 2).isLoaded
+					&& !LoadRecord(level - 2, previousFileIndex, par, parFractal))
 			{
-				*par = *record.mainParams;
-				*parFractal = *record.fractParams;
-				if (frames && record.hasFrames)
-				{
-					*frames = *record.animationFrames;
-					*refreshFrames = true;
-				}
-				if (keyframes && record.hasKeyframes)
-				{
-					*keyframes = *record.animationKeyframes;
-					keyframes->RegenerateAudioTracks(par);
-					*refreshKeyframes = true;
-				}
+				cErrorMessage::showMessage(
+					QObject::tr("Missing undo data in disk cache"), cErrorMessage::warningMessage);
+				return false;
 			}
+			*par = *undoBuffer.at(level - 2).snapshot.par;
+			*parFractal = *undoBuffer.at(level - 2).snapshot.fractal;
 		}
+
+		level--;
+		fileIndex = (fileIndex - 1 + 100) % 100;
+
+		ApplyAnimation(undoBuffer.at(level - 1), par, frames, keyframes, refreshFrames,
+			refreshKeyframes);
+		UpdateBaseline(par, parFractal);
 		return true;
 	}
 	else
@@ -189,31 +159,30 @@ bool cUndo::Redo(std::shared_ptr<cParameterContainer> par,
 {
 	if (level < undoBuffer.size())
 	{
-		sUndoRecord record;
-		record = undoBuffer.at(level);
-		level++;
-		fileIndex = (fileIndex + 1 + 100) % 100;
-		if (record.isLoaded)
+		const sUndoRecord &nextRecord = undoBuffer.at(level);
+		if (nextRecord.hasChanges && baseline.par)
 		{
-			*par = *record.mainParams;
-			*parFractal = *record.fractParams;
-			if (frames && record.hasFrames)
-			{
-				*frames = *record.animationFrames;
-				*refreshFrames = true;
-			}
-			if (keyframes && record.hasKeyframes)
-			{
-				*keyframes = *record.animationKeyframes;
-				keyframes->RegenerateAudioTracks(par);
-				*refreshKeyframes = true;
-			}
-			return true;
+			*par = *baseline.par;
+			*parFractal = *baseline.fractal;
+			ApplyChanges(nextRecord.changes, true, par, parFractal);
+		}
+		else if (nextRecord.isLoaded)
+		{
+			*par = *nextRecord.snapshot.par;
+			*parFractal = *nextRecord.snapshot.fractal;
 		}
 		else
 		{
 			return false;
 		}
+
+		level++;
+		fileIndex = (fileIndex + 1 + 100) % 100;
+
+		ApplyAnimation(undoBuffer.at(level - 1), par, frames, keyframes, refreshFrames,
+			refreshKeyframes);
+		UpdateBaseline(par, parFractal);
+		return true;
 	}
 	else
 	{
@@ -222,25 +191,52 @@ bool cUndo::Redo(std::shared_ptr<cParameterContainer> par,
 	}
 }
 
+void cUndo::StopAutosave()
+{
+	autosaveTimer->stop();
+	settingsWriter.WaitForDone();
+}
+
+void cUndo::slotAutosave()
+{
+	WriteLog("Autosave started", 2);
+
+	// use global variables to always save animations
+	settingsWriter.Write(systemDirectories.GetAutosaveFile(),
+		cSettingsWriter::CreateSnapshot(gPar, gParFractal, gAnimFrames, gKeyframes));
+}
+
 void cUndo::slotDelayedStore()
 {
-	WriteLog("Autosave delayed store started", 2);
+	WriteLog("cUndo::slotDelayedStore() started", 2);
 
-	cSettings parSettings(cSettings::formatCondensedText);
-	parSettings.CreateText(tempRecord.mainParams, tempRecord.fractParams, tempRecord.animationFrames,
-		tempRecord.animationKeyframes);
-	parSettings.SaveToFile(systemDirectories.GetUndoFolder() + QDir::separator()
-												 + QString("undo_%1.fract").arg(fileIndex, 2, 10, QChar('0')));
+	if (!tempSnapshot.par) return;
+
+	settingsWriter.Write(UndoFileName(fileIndex), tempSnapshot);
 
 	sUndoRecord record;
-	record.hasFrames = tempRecord.hasFrames;
-	record.hasKeyframes = tempRecord.hasKeyframes;
-	record.isLoaded = tempRecord.isLoaded;
-	*record.mainParams = *tempRecord.mainParams;
-	*record.fractParams = *tempRecord.fractParams;
+	if (baseline.par)
+	{
+		FindChanges(tempSnapshot.par, 0, &record.changes);
+		for (int f = 0; f < NUMBER_OF_FRACTALS; f++)
+		{
+			FindChanges(tempSnapshot.fractal->at(f), f + 1, &record.changes);
+		}
+		record.hasChanges = true;
+		WriteLogInt("cUndo: number of changed parameters", record.changes.size(), 2);
+	}
+	else
+	{
+		// first record in this session - there is no previous state to compare with
+		record.snapshot.par = tempSnapshot.par;
+		record.snapshot.fractal = tempSnapshot.fractal;
+		record.isLoaded = true;
+	}
 
-	if (tempRecord.hasFrames) *record.animationFrames = *tempRecord.animationFrames;
-	if (tempRecord.hasKeyframes) *record.animationKeyframes = *tempRecord.animationKeyframes;
+	record.animationFrames = tempSnapshot.frames;
+	record.hasFrames = bool(tempSnapshot.frames);
+	record.animationKeyframes = tempSnapshot.keyframes;
+	record.hasKeyframes = bool(tempSnapshot.keyframes);
 
 	if (undoBuffer.size() > level)
 	{
@@ -249,7 +245,6 @@ void cUndo::slotDelayedStore()
 			undoBuffer.removeAt(i);
 		}
 	}
-	record.isLoaded = true;
 	undoBuffer.append(record);
 	if (undoBuffer.size() > 100)
 	{
@@ -261,9 +256,110 @@ void cUndo::slotDelayedStore()
 	}
 	fileIndex = (fileIndex + 1 + 100) % 100;
 
-	tempRecord.hasFrames = false;
-	tempRecord.animationFrames.reset(new cAnimationFrames());
+	baseline.par = tempSnapshot.par;
+	baseline.fractal = tempSnapshot.fractal;
+
+	tempSnapshot = cSettingsWriter::sSnapshot();
+}
+
+void cUndo::FindChanges(std::shared_ptr<const cParameterContainer> newPar, int containerIndex,
+	QList<sParameterChange> *changes) const
+{
+	std::shared_ptr<const cParameterContainer> oldPar =
+		(containerIndex == 0) ? baseline.par : baseline.fractal->at(containerIndex - 1);
+
+	QList<QString> differences = newPar->GetListOfDifferences(*oldPar);
+	for (const QString &parameterName : differences)
+	{
+		sParameterChange change;
+		change.containerIndex = containerIndex;
+		change.parameterName = parameterName;
+		if (oldPar->IfExists(parameterName)) change.before = oldPar->GetAsOneParameter(parameterName);
+		if (newPar->IfExists(parameterName)) change.after = newPar->GetAsOneParameter(parameterName);
+		changes->append(change);
+	}
+}
+
+void cUndo::ApplyChanges(const QList<sParameterChange> &changes, bool redo,
+	std::shared_ptr<cParameterContainer> par, std::shared_ptr<cFractalContainer> parFractal)
+{
+	for (const sParameterChange &change : changes)
+	{
+		std::shared_ptr<cParameterContainer> container =
+			(change.containerIndex == 0) ? par : parFractal->at(change.containerIndex - 1);
+		const cOneParameter &value = redo ? change.after : change.before;
+
+		if (value.IsEmpty())
+		{
+			if (container->IfExists(change.parameterName))
+				container->DeleteParameter(change.parameterName);
+		}
+		else if (container->IfExists(change.parameterName))
+		{
+			container->SetFromOneParameter(change.parameterName, value);
+		}
+		else
+		{
+			container->AddParamFromOneParameter(change.parameterName, value);
+		}
+	}
+}
+
+void cUndo::ApplyAnimation(const sUndoRecord &record, std::shared_ptr<cParameterContainer> par,
+	std::shared_ptr<cAnimationFrames> frames, std::shared_ptr<cKeyframes> keyframes,
+	bool *refreshFrames, bool *refreshKeyframes)
+{
+	if (frames && record.hasFrames)
+	{
+		frames->Override(
+			record.animationFrames->GetFrames(), record.animationFrames->GetListOfParameters());
+		*refreshFrames = true;
+	}
+	if (keyframes && record.hasKeyframes)
+	{
+		keyframes->Override(
+			record.animationKeyframes->GetFrames(), record.animationKeyframes->GetListOfParameters());
+		keyframes->ClearMorphCache();
+		keyframes->UpdateFramesIndexesTable();
+		keyframes->RegenerateAudioTracks(par);
+		*refreshKeyframes = true;
+	}
+}
+
+bool cUndo::LoadRecord(int recordIndex, int recordFileIndex,
+	std::shared_ptr<cParameterContainer> par, std::shared_ptr<cFractalContainer> parFractal)
+{
+	// if record in not in memory then load from settings stored in undo folder
+	settingsWriter.WaitForDone();
+
+	QString undoFilename = UndoFileName(recordFileIndex);
+	if (!QFile::exists(undoFilename)) return false;
+
+	cSettingsWriter::sSnapshot snapshot =
+		cSettingsWriter::CreateSnapshot(par, parFractal, nullptr, nullptr);
+	std::shared_ptr<cAnimationFrames> frames(new cAnimationFrames());
+	std::shared_ptr<cKeyframes> keyframes(new cKeyframes());
 
-	tempRecord.hasKeyframes = false;
-	tempRecord.animationKeyframes.reset(new cKeyframes());
+	cSettings parSettings(cSettings::formatCondensedText);
+	parSettings.LoadFromFile(undoFilename);
+	if (!parSettings.Decode(snapshot.par, snapshot.fractal, frames, keyframes)) return false;
+
+	undoBuffer[recordIndex].snapshot = snapshot;
+	undoBuffer[recordIndex].isLoaded = true;
+	return true;
+}
+
+void cUndo::UpdateBaseline(std::shared_ptr<const cParameterContainer> par,
+	std::shared_ptr<const cFractalContainer> parFractal)
+{
+	cSettingsWriter::sSnapshot snapshot =
+		cSettingsWriter::CreateSnapshot(par, parFractal, nullptr, nullptr);
+	baseline.par = snapshot.par;
+	baseline.fractal = snapshot.fractal;
+}
+
+QString cUndo::UndoFileName(int index)
+{
+	return systemDirectories.GetUndoFolder() + QDir::separator()
+				 + QString("undo_%1.fract").arg(index, 2, 10, QChar('0'));
 }
@@ -36,17 +36,22 @@
  * The buffer is a simple LIFO buffer which holds the parameter entries.
  * (A Store() invocation while Undo-ed in the list will truncate to the current level
  * and append the new entry. The Redo entries will be lost.)
+ * Each entry holds only the parameters which were changed since the previous entry (with values
+ * before and after change). Every state is also written in background to the undo folder, so
+ * the history is available after restarting the application.
  */
 
 #ifndef MANDELBULBER2_SRC_UNDO_H_
 #define MANDELBULBER2_SRC_UNDO_H_
 
+#include <QList>
 #include <QObject>
 
 #include "animation_frames.hpp"
 #include "fractal_container.hpp"
 #include "keyframes.hpp"
 #include "parameters.hpp"
+#include "settings_writer.hpp"
 
 class QTimer;
 
@@ -67,31 +72,52 @@ public:
 		std::shared_ptr<cAnimationFrames> frames, std::shared_ptr<cKeyframes> keyframes,
 		bool *refreshFrames, bool *refreshKeyframes);
 
+	// cancels pending autosave and waits until already queued files are written
+	void StopAutosave();
+
 private slots:
 	void slotDelayedStore();
+	void slotAutosave();
 
 private:
-	struct sUndoRecord
+	struct sParameterChange
 	{
-		sUndoRecord()
-		{
-			mainParams.reset(new cParameterContainer);
-			fractParams.reset(new cFractalContainer);
-			animationFrames.reset(new cAnimationFrames);
-			animationKeyframes.reset(new cKeyframes);
-		}
+		int containerIndex; // 0 - main parameters, 1..NUMBER_OF_FRACTALS - fractal parameters
+		QString parameterName;
+		cOneParameter before; // empty if parameter was added
+		cOneParameter after;	// empty if parameter was removed
+	};
 
-		std::shared_ptr<cParameterContainer> mainParams;
-		std::shared_ptr<cFractalContainer> fractParams;
+	struct sUndoRecord
+	{
+		QList<sParameterChange> changes;
+		cSettingsWriter::sSnapshot snapshot; // full state, only if loaded from undo file
 		std::shared_ptr<cAnimationFrames> animationFrames;
 		std::shared_ptr<cKeyframes> animationKeyframes;
+		bool hasChanges = false; // changes are relative to previous record
 		bool hasFrames = false;
 		bool hasKeyframes = false;
 		bool isLoaded = false;
 	};
 
+	void FindChanges(std::shared_ptr<const cParameterContainer> newPar, int containerIndex,
+		QList<sParameterChange> *changes) const;
+	static void ApplyChanges(const QList<sParameterChange> &changes, bool redo,
+		std::shared_ptr<cParameterContainer> par, std::shared_ptr<cFractalContainer> parFractal);
+	static void ApplyAnimation(const sUndoRecord &record, std::shared_ptr<cParameterContainer> par,
+		std::shared_ptr<cAnimationFrames> frames, std::shared_ptr<cKeyframes> keyframes,
+		bool *refreshFrames, bool *refreshKeyframes);
+	bool LoadRecord(int recordIndex, int recordFileIndex, std::shared_ptr<cParameterContainer> par,
+		std::shared_ptr<cFractalContainer> parFractal);
+	void UpdateBaseline(std::shared_ptr<const cParameterContainer> par,
+		std::shared_ptr<const cFractalContainer> parFractal);
+	static QString UndoFileName(int index);
+
 	QTimer *timer;
-	sUndoRecord tempRecord;
+	QTimer *autosaveTimer;
+	cSettingsWriter settingsWriter;
+	cSettingsWriter::sSnapshot tempSnapshot;
+	cSettingsWriter::sSnapshot baseline; // state of parameters stored in last active record
 	QList<sUndoRecord> undoBuffer;
 	int level;
 	int fileIndex;
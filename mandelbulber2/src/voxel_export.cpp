@@ -35,10 +35,14 @@
  * with a resolution of w * h * l. for each voxel ProcessVolume() determines if the point
  * is inside the fractal, or not. The result is saved in layers of X-Y planes in StoreLayer
  * to the output folder as a black-and-white PNG file.
+ *
+ * In sparse mode ProcessSparseVolume() evaluates only 8^3 bricks which can be close to the surface
+ * (checked with distance estimation) and saves narrow band distances to a single file
  */
 
 #include "voxel_export.hpp"
 
+#include <algorithm>
 #include <memory>
 
 #include <QVector>
@@ -55,10 +59,11 @@
 #include "opencl_global.h"
 #include "progress_text.hpp"
 #include "render_data.hpp"
+#include "sparse_volume_file.hpp"
 #include "write_log.hpp"
 
 cVoxelExport::cVoxelExport(int w, int h, int l, CVector3 limitMin, CVector3 limitMax, QDir folder,
-	int maxIter, bool greyscale)
+	int maxIter, bool greyscale, bool sparse)
 		: QObject()
 {
 	this->w = w;
@@ -69,7 +74,8 @@ cVoxelExport::cVoxelExport(int w, int h, int l, CVector3 limitMin, CVector3 limi
 	this->folder = folder;
 	this->maxIter = maxIter;
 	this->greyscale = greyscale;
-	voxelLayer.resize(w * h);
+	this->sparse = sparse;
+	if (!sparse) voxelLayer.resize(w * h);
 	stop = false;
 }
 
@@ -105,6 +111,14 @@ void cVoxelExport::ProcessVolume()
 	cProgressText progressText;
 	progressText.ResetTimer();
 
+	if (sparse)
+	{
+		// sparse volume is calculated only on CPU
+		ProcessSparseVolume(*params, *fractals, dist_thresh, &progressText);
+		emit finished();
+		return;
+	}
+
 	bool openClEnabled = false;
 	std::vector<double> voxelDistances;
 	std::vector<int> voxelIterations;
@@ -272,3 +286,165 @@ bool cVoxelExport::StoreLayer(int z) const
 	}
 	return true;
 }
+
+void cVoxelExport::ProcessSparseVolume(const sParamRender &params, const cNineFractals &fractals,
+	double distThresh, cProgressText *progressText)
+{
+	const int brickSize = cSparseVolumeFile::brickSize;
+	const int brickVoxels = cSparseVolumeFile::brickVoxels;
+	// bricks are first tested in groups of nodeSize x nodeSize bricks
+	const int nodeSize = 8;
+	// number of bricks evaluated at once (limits memory usage)
+	const long long batchSize = 4096;
+	// width of narrow band in voxels
+	const double bandVoxels = 3.0;
+
+	const CVector3 step((limitMax.x - limitMin.x) / w, (limitMax.y - limitMin.y) / h,
+		(limitMax.z - limitMin.z) / l);
+	const double bandWidth = bandVoxels * dMax(step.x, step.y, step.z);
+
+	const long long bricksX = (w + brickSize - 1) / brickSize;
+	const long long bricksY = (h + brickSize - 1) / brickSize;
+	const long long bricksZ = (l + brickSize - 1) / brickSize;
+	const long long nodesX = (bricksX + nodeSize - 1) / nodeSize;
+	const long long nodesY = (bricksY + nodeSize - 1) / nodeSize;
+
+	const QString fileName = folder.absolutePath() + QDir::separator() + "volume.mbsv";
+	cSparseVolumeFile volumeFile(fileName);
+	if (!volumeFile.Open(int(w), int(h), int(l), limitMin, limitMax, bandWidth))
+	{
+		emit updateProgressAndStatus(
+			tr("Voxel Export - Failed to open output file!"), progressText->getText(1.0), 1.0);
+		return;
+	}
+
+	auto distance = [&](const CVector3 &point)
+	{
+		sDistanceOut distanceOut;
+		const sDistanceIn distanceIn(point, distThresh, false);
+		return CalculateDistance(params, fractals, distanceIn, &distanceOut);
+	};
+
+	// checks if a box of voxels can touch the narrow band. Distance estimation is a lower bound
+	// of real distance (corrected by DE factor), so boxes far from the surface can be skipped.
+	// Inside the fractal DE is close to zero and gives no bound, so boxes which are not skipped
+	// are always evaluated voxel by voxel. Sampled points can't prove that the whole box is inside
+	// (surfaces and holes smaller than the box would be lost)
+	auto boxCanTouchBand = [&](long long x, long long y, long long z, long long size, long long depth)
+	{
+		const CVector3 extent((size - 1) * step.x, (size - 1) * step.y, (depth - 1) * step.z);
+		const CVector3 corner = limitMin + CVector3(x * step.x, y * step.y, z * step.z);
+		const double centerDistance = distance(corner + extent * 0.5);
+		return centerDistance * params.DEFactor <= 0.5 * extent.Length() + bandWidth;
+	};
+
+	std::vector<char> nodeActive(nodesX * nodesY);
+	std::vector<long long> activeBricks;
+	std::vector<char> brickActive;
+	std::vector<float> brickData;
+
+	for (long long bz = 0; bz < bricksZ; bz++)
+	{
+		const QString statusText = " - "
+															 + tr("Processing brick layer %1 of %2")
+																	 .arg(QString::number(bz + 1), QString::number(bricksZ));
+		const double percentDone = double(bz) / bricksZ;
+		emit updateProgressAndStatus(
+			tr("Voxel Export") + statusText, progressText->getText(percentDone), percentDone);
+
+		// coarse test of groups of bricks
+#pragma omp parallel for schedule(dynamic, 1)
+		for (long long n = 0; n < nodesX * nodesY; n++)
+		{
+			if (stop) continue;
+			const long long nx = n % nodesX;
+			const long long ny = n / nodesX;
+			nodeActive[n] = boxCanTouchBand(nx * nodeSize * brickSize, ny * nodeSize * brickSize,
+				bz * brickSize, nodeSize * brickSize, brickSize);
+		}
+
+		activeBricks.clear();
+		for (long long by = 0; by < bricksY; by++)
+			for (long long bx = 0; bx < bricksX; bx++)
+				if (nodeActive[(by / nodeSize) * nodesX + bx / nodeSize])
+					activeBricks.push_back(by * bricksX + bx);
+
+		// test of single bricks
+		brickActive.assign(activeBricks.size(), false);
+#pragma omp parallel for schedule(dynamic, 1)
+		for (long long i = 0; i < (long long)activeBricks.size(); i++)
+		{
+			if (stop) continue;
+			const long long bx = activeBricks[i] % bricksX;
+			const long long by = activeBricks[i] / bricksX;
+			brickActive[i] =
+				boxCanTouchBand(bx * brickSize, by * brickSize, bz * brickSize, brickSize, brickSize);
+		}
+		long long activeCount = 0;
+		for (size_t i = 0; i < activeBricks.size(); i++)
+		{
+			if (brickActive[i]) activeBricks[activeCount++] = activeBricks[i];
+		}
+		activeBricks.resize(activeCount);
+
+		// evaluation of voxels in bricks
+		for (long long batchStart = 0; batchStart < activeCount && !stop; batchStart += batchSize)
+		{
+			const long long batchCount = std::min(batchSize, activeCount - batchStart);
+			brickData.resize(batchCount * brickVoxels);
+
+#pragma omp parallel for schedule(dynamic, 1)
+			for (long long i = 0; i < batchCount; i++)
+			{
+				if (stop) continue;
+				const long long bx = activeBricks[batchStart + i] % bricksX;
+				const long long by = activeBricks[batchStart + i] / bricksX;
+				float *values = &brickData[i * brickVoxels];
+
+				for (int v = 0; v < brickVoxels; v++)
+				{
+					const long long x = bx * brickSize + v % brickSize;
+					const long long y = by * brickSize + (v / brickSize) % brickSize;
+					const long long z = bz * brickSize + v / (brickSize * brickSize);
+					if (x >= w || y >= h || z >= l)
+					{
+						values[v] = float(bandWidth);
+						continue;
+					}
+					const CVector3 point = limitMin + CVector3(x * step.x, y * step.y, z * step.z);
+					const double dist = distance(point);
+					values[v] = float(dist <= distThresh ? -bandWidth : qMin(dist - distThresh, bandWidth));
+				}
+			}
+
+			for (long long i = 0; i < batchCount; i++)
+			{
+				const long long bx = activeBricks[batchStart + i] % bricksX;
+				const long long by = activeBricks[batchStart + i] / bricksX;
+				const float *values = &brickData[i * brickVoxels];
+				// only bricks with all voxels inside are stored as interior tiles
+				const bool interior =
+					std::all_of(values, values + brickVoxels, [](float value) { return value < 0.0f; });
+				if (interior)
+					volumeFile.AddInteriorTile(int(bx), int(by), int(bz));
+				else
+					volumeFile.AddBrick(int(bx), int(by), int(bz), values);
+			}
+		}
+
+		if (stop) break;
+	}
+
+	bool result = volumeFile.Close();
+
+	QString statusText;
+	if (stop)
+		statusText = tr("Voxel Export finished - Cancelled export");
+	else if (!result)
+		statusText = tr("Voxel Export - Cannot write to file %1").arg(fileName);
+	else
+		statusText = tr("Voxel Export finished - Saved %1 bricks to %2")
+									 .arg(QString::number(volumeFile.GetBrickCount() + volumeFile.GetTileCount()))
+									 .arg(fileName);
+	emit updateProgressAndStatus(statusText, progressText->getText(1.0), 1.0);
+}
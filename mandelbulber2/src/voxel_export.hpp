@@ -45,13 +45,17 @@
 
 #include "algebra.hpp"
 
+struct sParamRender;
+class cNineFractals;
+class cProgressText;
+
 class cVoxelExport : public QObject
 {
 	Q_OBJECT
 
 public:
 	cVoxelExport(int w, int h, int l, CVector3 limitMin, CVector3 limitMax, QDir folder, int maxIter,
-		bool greyscale);
+		bool greyscale, bool sparse = false);
 	~cVoxelExport() override;
 
 signals:
@@ -64,6 +68,8 @@ public slots:
 
 private:
 	bool StoreLayer(int z) const;
+	void ProcessSparseVolume(const sParamRender &params, const cNineFractals &fractals,
+		double distThresh, cProgressText *progressText);
 
 	std::vector<unsigned char> voxelLayer;
 	long long w, h, l;
@@ -72,6 +78,7 @@ private:
 	QDir folder;
 	int maxIter;
 	bool greyscale;
+	bool sparse;
 	bool stop;
 };
 
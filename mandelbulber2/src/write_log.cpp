@@ -29,12 +29,25 @@
  *
  * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
  *
- * TODO: description
+ * WriteLog() - asynchronous system log. Messages are pushed into a lock-free
+ * ring buffer and written to the log file by a background thread, which keeps
+ * the file open and flushes it when the queue becomes idle.
+ *
+ * The writer is never destroyed, so it can be used from static destructors. At exit
+ * WriteLogShutdown() stops the thread and next messages are written synchronously.
  */
 
 #include "write_log.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <cstdlib>
 
 #include <QCoreApplication>
 #include <QFile>
@@ -53,19 +66,224 @@ void WriteLogCout(const QString &text, int verbosityLevel)
 	WriteLog(text, verbosityLevel);
 }
 
-void WriteLog(const QString &text, int verbosityLevel)
+namespace
+{
+// bounded multi-producer ring buffer (D. Vyukov's algorithm) drained by a single writer thread
+class cAsyncLogWriter
+{
+public:
+	cAsyncLogWriter();
+	void Write(const QString &text, const QString &fileName, bool synchronous);
+	void Shutdown();
+
+private:
+	struct sLogEntry
+	{
+		std::atomic<size_t> sequence;
+		QString text;
+		QString fileName;
+	};
+
+	size_t Push(const QString &text, const QString &fileName);
+	bool Pop(QString *text, QString *fileName);
+	void WaitForWritten(size_t pos);
+	void Run();
+	static void WriteDirectly(const QString &text, const QString &fileName);
+
+	static const size_t bufferSize = 4096; // must be power of 2
+	sLogEntry buffer[bufferSize];
+	std::atomic<size_t> enqueuePos;
+	std::atomic<size_t> dequeuePos;
+	std::atomic<bool> stop;
+	std::atomic<bool> stopped;
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+	std::atomic<size_t> writtenPos; // all messages before this position are flushed to the file
+	std::mutex writtenMutex;
+	std::condition_variable writtenCondition;
+	std::mutex shutdownMutex;
+	std::thread thread;
+};
+
+cAsyncLogWriter::cAsyncLogWriter()
+		: enqueuePos(0), dequeuePos(0), stop(false), stopped(false), writtenPos(0)
+{
+	for (size_t i = 0; i < bufferSize; i++)
+		buffer[i].sequence.store(i, std::memory_order_relaxed);
+	thread = std::thread(&cAsyncLogWriter::Run, this);
+}
+
+void cAsyncLogWriter::Write(const QString &text, const QString &fileName, bool synchronous)
+{
+	if (stop.load())
+	{
+		WriteDirectly(text, fileName);
+		return;
+	}
+
+	const size_t pos = Push(text, fileName);
+	if (synchronous) WaitForWritten(pos);
+}
+
+void cAsyncLogWriter::Shutdown()
+{
+	std::lock_guard<std::mutex> lock(shutdownMutex);
+	if (stopped.load()) return;
+
+	// remaining messages are written before the thread finishes
+	stop.store(true);
+	wakeCondition.notify_one();
+	if (thread.joinable()) thread.join();
+
+	// messages pushed while the thread was finishing
+	QString text;
+	QString fileName;
+	while (Pop(&text, &fileName))
+		WriteDirectly(text, fileName);
+
+	stopped.store(true);
+	writtenCondition.notify_all();
+}
+
+void cAsyncLogWriter::WaitForWritten(size_t pos)
+{
+	std::unique_lock<std::mutex> lock(writtenMutex);
+	while (writtenPos.load() <= pos && !stopped.load())
+	{
+		// timeout protects against waiting for the writer which was stopped in the meantime
+		writtenCondition.wait_for(lock, std::chrono::milliseconds(100));
+	}
+}
+
+void cAsyncLogWriter::WriteDirectly(const QString &text, const QString &fileName)
+{
+	static std::mutex directWriteMutex;
+	std::lock_guard<std::mutex> lock(directWriteMutex);
+	QFile logFile(fileName);
+	if (logFile.open(QIODevice::Append | QIODevice::Text))
+	{
+		logFile.write(text.toUtf8());
+		logFile.close();
+	}
+}
+
+size_t cAsyncLogWriter::Push(const QString &text, const QString &fileName)
+{
+	size_t pos = enqueuePos.load(std::memory_order_relaxed);
+	sLogEntry *entry;
+	while (true)
+	{
+		entry = &buffer[pos & (bufferSize - 1)];
+		const size_t sequence = entry->sequence.load(std::memory_order_acquire);
+		const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+		if (diff == 0)
+		{
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0)
+		{
+			// buffer is full - wait for the writer instead of dropping the message
+			wakeCondition.notify_one();
+			std::this_thread::yield();
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+		else
+		{
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+	entry->text = text;
+	entry->fileName = fileName;
+	entry->sequence.store(pos + 1, std::memory_order_release);
+	wakeCondition.notify_one();
+	return pos;
+}
+
+bool cAsyncLogWriter::Pop(QString *text, QString *fileName)
+{
+	const size_t pos = dequeuePos.load(std::memory_order_relaxed);
+	sLogEntry *entry = &buffer[pos & (bufferSize - 1)];
+	const size_t sequence = entry->sequence.load(std::memory_order_acquire);
+	if (intptr_t(sequence) - intptr_t(pos + 1) < 0) return false;
+
+	// only one consumer, so no CAS is needed
+	dequeuePos.store(pos + 1, std::memory_order_relaxed);
+	*text = std::move(entry->text);
+	*fileName = std::move(entry->fileName);
+	entry->sequence.store(pos + bufferSize, std::memory_order_release);
+	return true;
+}
+
+void cAsyncLogWriter::Run()
+{
+	QFile logFile;
+	QString text;
+	QString fileName;
+	while (true)
+	{
+		bool written = false;
+		bool popped = false;
+		while (Pop(&text, &fileName))
+		{
+			popped = true;
+			if (logFile.fileName() != fileName || !logFile.isOpen())
+			{
+				logFile.close();
+				logFile.setFileName(fileName);
+				logFile.open(QIODevice::Append | QIODevice::Text);
+			}
+			if (logFile.isOpen())
+			{
+				logFile.write(text.toUtf8());
+				written = true;
+			}
+		}
+		if (popped)
+		{
+			if (written) logFile.flush();
+			// also when the file could not be opened, to not block synchronous writes
+			{
+				std::lock_guard<std::mutex> lock(writtenMutex);
+				writtenPos.store(dequeuePos.load(std::memory_order_relaxed));
+			}
+			writtenCondition.notify_all();
+		}
+
+		if (stop.load())
+		{
+			// last check for messages pushed between Pop() and stop flag
+			if (!Pop(&text, &fileName)) break;
+			if (logFile.isOpen()) logFile.write(text.toUtf8());
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wakeCondition.wait_for(lock, std::chrono::milliseconds(50));
+	}
+	logFile.close();
+}
+
+cAsyncLogWriter &LogWriter()
+{
+	// intentionally not destroyed: static destructors and threads still running during exit()
+	// can log after destruction of function-local statics
+	static cAsyncLogWriter *writer = []() {
+		cAsyncLogWriter *newWriter = new cAsyncLogWriter;
+		atexit(WriteLogShutdown);
+		return newWriter;
+	}();
+	return *writer;
+}
+
+void WriteLogInternal(const QString &text, int verbosityLevel, bool synchronous)
 {
 	// verbosity level:
 	// 1 - only errors
 	// 2 - main events / actions
 	// 3 - detailed events / actions
 
-	QMutex mutex;
-
 	if (verbosityLevel <= systemData.loggingVerbosity)
 	{
-		mutex.lock();
-
 #ifdef _WIN32
 		QString logText = QString("PID: %1, time: %2, %3\n")
 												.arg(QCoreApplication::applicationPid())
@@ -79,22 +297,31 @@ void WriteLog(const QString &text, int verbosityLevel)
 				.arg(text);
 #endif
 
-		QFile logfile(systemData.logfileName);
-		if (logfile.open(QIODevice::Append | QIODevice::Text))
-		{
-			QTextStream out(&logfile);
-			out << logText;
-			logfile.close();
-		}
+		LogWriter().Write(logText, systemData.logfileName, synchronous);
 
 		// write to log in window
 		if (gMainInterface && gMainInterface->mainWindow != nullptr)
 		{
 			emit gMainInterface->mainWindow->AppendToLog(logText);
 		}
-		mutex.unlock();
 	}
 }
+} // namespace
+
+void WriteLog(const QString &text, int verbosityLevel)
+{
+	WriteLogInternal(text, verbosityLevel, false);
+}
+
+void WriteLogSynchronous(const QString &text, int verbosityLevel)
+{
+	WriteLogInternal(text, verbosityLevel, true);
+}
+
+void WriteLogShutdown()
+{
+	LogWriter().Shutdown();
+}
 
 void WriteLogString(const QString &text, const QString &value, int verbosityLevel)
 {
@@ -38,6 +38,11 @@
 #define MANDELBULBER2_SRC_WRITE_LOG_HPP_
 
 void WriteLog(const QString &text, int verbosityLevel);
+// waits until the message is stored in the file (for critical errors which can precede a crash)
+void WriteLogSynchronous(const QString &text, int verbosityLevel);
+// writes pending messages and stops the writer thread. Later messages are written directly.
+// Called at exit, so messages from static destructors and still running threads are not lost
+void WriteLogShutdown();
 void WriteLogCout(const QString &text, int verbosityLevel);
 void WriteLogDouble(const QString &text, double value, int verbosityLevel);
 void WriteLogInt(const QString &text, int value, int verbosityLevel);